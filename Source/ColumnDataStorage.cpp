@@ -0,0 +1,210 @@
+#include "ColumnDataStorage.h"
+
+#include <atomic>
+
+ColumnDataStorage::ColumnDataStorage() {}
+
+RowId ColumnDataStorage::AllocateRow()
+{
+    RowId res;
+
+    // Reuse row of erased record if there is one
+    if (!FreeRows.empty())
+    {
+        res = FreeRows.back();
+        FreeRows.pop_back();
+        IsRowAlive[res] = 1;
+    }
+    else
+    {
+        res = IsRowAlive.size();
+        IsRowAlive.emplace_back(1);
+
+        for (auto& it : Columns)
+            if (it != nullptr)
+                it->AddRow();
+    }
+
+    return res;
+}
+
+bool ColumnDataStorage::IsKeyExist(const std::string& keyName) const
+{
+    bool res;
+    RecursiveReadWriteMtx.ReadLock();
+    res = Schema.find(keyName) != Schema.end();
+    RecursiveReadWriteMtx.ReadUnlock();
+    return res;
+}
+
+void ColumnDataStorage::RemoveKey(const std::string& keyName)
+{
+    RecursiveReadWriteMtx.WriteLock();
+
+    auto f = Schema.find(keyName);
+    if (f != Schema.end())
+    {
+        // Delete column. The index of the column is not reused, so all handles to it become invalid
+        delete Columns[f->second];
+        Columns[f->second] = nullptr;
+        Schema.erase(f);
+    }
+
+    RecursiveReadWriteMtx.WriteUnlock();
+}
+
+RowId ColumnDataStorage::CreateRecord()
+{
+    RowId res;
+    RecursiveReadWriteMtx.WriteLock();
+    res = AllocateRow();
+    RecursiveReadWriteMtx.WriteUnlock();
+    return res;
+}
+
+RowId ColumnDataStorage::CreateRecord(const std::vector<std::pair<std::string, DataSaver>>& params)
+{
+    RowId res;
+    RecursiveReadWriteMtx.WriteLock();
+
+    res = AllocateRow();
+
+    // Copy data from function parametrs
+    for (auto& it : params)
+    {
+        auto f = Schema.find(it.first);
+        if (f != Schema.end())
+            Columns[f->second]->SetRowFromDataSaver(res, it.second);
+    }
+
+    RecursiveReadWriteMtx.WriteUnlock();
+    return res;
+}
+
+bool ColumnDataStorage::IsRecordExist(RowId row) const
+{
+    bool res;
+    RecursiveReadWriteMtx.ReadLock();
+    res = row < IsRowAlive.size() && IsRowAlive[row];
+    RecursiveReadWriteMtx.ReadUnlock();
+    return res;
+}
+
+void ColumnDataStorage::EraseRecord(RowId row)
+{
+    RecursiveReadWriteMtx.WriteLock();
+
+    if (row < IsRowAlive.size() && IsRowAlive[row])
+    {
+        // Reset values to release memory held by them, for example by strings
+        for (auto& it : Columns)
+            if (it != nullptr)
+                it->ResetRow(row);
+
+        IsRowAlive[row] = 0;
+        FreeRows.emplace_back(row);
+    }
+
+    RecursiveReadWriteMtx.WriteUnlock();
+}
+
+std::vector<RowId> ColumnDataStorage::FindRecords(const ColumnDataStorageQuery& query) const
+{
+    std::vector<RowId> res;
+    RecursiveReadWriteMtx.ReadLock();
+
+    ScanBlocks(query, 0, IsRowAlive.size(), [&res](RowId blockBegin, const std::uint8_t* isMatch, std::size_t count)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+                if (isMatch[i] != 0)
+                    res.emplace_back(blockBegin + i);
+        }
+    );
+
+    RecursiveReadWriteMtx.ReadUnlock();
+    return res;
+}
+
+std::size_t ColumnDataStorage::Count(const ColumnDataStorageQuery& query, bool isParallel) const
+{
+    std::atomic<std::size_t> res(0);
+    RecursiveReadWriteMtx.ReadLock();
+
+    ForEachRowsPart(isParallel, [this, &query, &res](RowId begin, RowId end)
+        {
+            std::size_t part = 0;
+            ScanBlocks(query, begin, end, [&part](RowId, const std::uint8_t* isMatch, std::size_t count)
+                {
+                    for (std::size_t i = 0; i < count; ++i)
+                        part += isMatch[i];
+                }
+            );
+
+            res.fetch_add(part, std::memory_order_relaxed);
+        }
+    );
+
+    RecursiveReadWriteMtx.ReadUnlock();
+    return res.load();
+}
+
+void ColumnDataStorage::Reserve(std::size_t recordsCount)
+{
+    RecursiveReadWriteMtx.WriteLock();
+
+    IsRowAlive.reserve(recordsCount);
+    for (auto& it : Columns)
+        if (it != nullptr)
+            it->Reserve(recordsCount);
+
+    RecursiveReadWriteMtx.WriteUnlock();
+}
+
+void ColumnDataStorage::DropDataStorage()
+{
+    RecursiveReadWriteMtx.WriteLock();
+
+    // Delete all columns. Indices of the columns are not reused, so all handles to them become invalid
+    for (auto& it : Columns)
+    {
+        delete it;
+        it = nullptr;
+    }
+
+    Schema.clear();
+    IsRowAlive.clear();
+    FreeRows.clear();
+
+    RecursiveReadWriteMtx.WriteUnlock();
+}
+
+void ColumnDataStorage::DropData()
+{
+    RecursiveReadWriteMtx.WriteLock();
+
+    // Clear all columns
+    for (auto& it : Columns)
+        if (it != nullptr)
+            it->Clear();
+
+    IsRowAlive.clear();
+    FreeRows.clear();
+
+    RecursiveReadWriteMtx.WriteUnlock();
+}
+
+std::size_t ColumnDataStorage::Size() const
+{
+    std::size_t res;
+    RecursiveReadWriteMtx.ReadLock();
+    res = IsRowAlive.size() - FreeRows.size();
+    RecursiveReadWriteMtx.ReadUnlock();
+    return res;
+}
+
+ColumnDataStorage::~ColumnDataStorage()
+{
+    // Delete all columns
+    for (auto& it : Columns)
+        delete it;
+}
\ No newline at end of file
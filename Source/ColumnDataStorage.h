@@ -0,0 +1,1165 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+#include "DataSaver.h"
+#include "ColumnDataStorageQuery.h"
+#include "ParallelFor.h"
+#include "ReadWriteMutex.h"
+
+// Class declaration
+class ColumnDataStorage;
+
+/// Type of record identifier inside ColumnDataStorage. The record is a row number inside every column
+typedef std::size_t RowId;
+
+/// Value of invalid RowId. Returned when the record was not found
+constexpr RowId InvalidRowId = std::numeric_limits<RowId>::max();
+
+/**
+    \brief Base class for ColumnDataStorage columns
+
+    Provides an interface that does not depend on the type of data stored in the column.
+    It is used by the ColumnDataStorage to work with all columns at once, for example, when creating or erasing records.
+*/
+class DataStorageColumnBase
+{
+public:
+    /// \brief Method for getting the type of data stored inside the column
+    /// \return the type of data stored inside the column
+    virtual const std::type_info& GetDataType() const = 0;
+
+    /// \brief Method for checking whether the column stores codes of a dictionary instead of values, see DataStorageDictionaryColumn
+    /// \return returns true if the column is dictionary-encoded, otherwise false
+    virtual bool IsDictionaryEncoded() const = 0;
+
+    /// Method for adding a new row with a default value to the end of column
+    virtual void AddRow() = 0;
+
+    /// \brief Method for setting a default value to the row
+    /// \param [in] row the row to be reset
+    virtual void ResetRow(RowId row) = 0;
+
+    /**
+        \brief Method for setting a value from DataSaver to the row
+
+        \param [in] row the row to be changed
+        \param [in] dataSaver dataSaver with the value. It must store data of the same type as the column
+
+        \return returns true if the types matched, otherwise false
+    */
+    virtual bool SetRowFromDataSaver(RowId row, const DataSaver& dataSaver) = 0;
+
+    /// \brief Method for reserving memory for rows
+    /// \param [in] rowsCount the number of rows to reserve memory for
+    virtual void Reserve(std::size_t rowsCount) = 0;
+
+    /// Method for deleting all rows
+    virtual void Clear() = 0;
+
+    /// Default virtual destructor
+    virtual ~DataStorageColumnBase() {}
+};
+
+/**
+    \brief Column of ColumnDataStorage
+
+    \tparam <T> Any type of data except for c arrays
+
+    Stores the values of one key for all records in a contiguous std::vector.
+    The value of the record is located at the index equal to the record RowId.
+*/
+template <class T>
+class DataStorageColumn : public DataStorageColumnBase
+{
+private:
+    // Values of all records
+    std::vector<T> Data;
+
+    // Value for new records
+    T DefaultValue;
+
+public:
+    /// Making the ColumnDataStorage class friendly so that it has access to the column data
+    friend ColumnDataStorage;
+
+    /// Making the ColumnDataStorageQuery class friendly so that its requests can read the column data
+    friend ColumnDataStorageQuery;
+
+    /// \brief Constructor
+    /// \param [in] defaultValue value for new records
+    DataStorageColumn(const T& defaultValue) : DefaultValue(defaultValue) {}
+
+    const std::type_info& GetDataType() const override { return typeid(T); }
+
+    bool IsDictionaryEncoded() const override { return false; }
+
+    void AddRow() override { Data.emplace_back(DefaultValue); }
+
+    void ResetRow(RowId row) override { Data[row] = DefaultValue; }
+
+    bool SetRowFromDataSaver(RowId row, const DataSaver& dataSaver) override
+    {
+        T value;
+        if (!dataSaver.GetData(value))
+            return false;
+
+        Data[row] = std::move(value);
+        return true;
+    }
+
+    void Reserve(std::size_t rowsCount) override { Data.reserve(rowsCount); }
+
+    void Clear() override { Data.clear(); }
+};
+
+/**
+    \brief Dictionary-encoded column of ColumnDataStorage
+
+    \tparam <T> Any type of data for which std::hash is specialized, usually std::string
+
+    Each distinct value is stored once in the dictionary of the column, and the records store only 32-bit codes of their values
+    in a contiguous std::vector. So a key with a few distinct values repeated by many records, for example a category or a socket name,
+    takes 4 bytes per record instead of a copy of the value, and an equal search compares codes instead of values.
+    The code of the default value is always 0. Values stay in the dictionary until DropData, even if no record uses them anymore.
+*/
+template <class T>
+class DataStorageDictionaryColumn : public DataStorageColumnBase
+{
+private:
+    // Codes of the values of all records
+    std::vector<std::uint32_t> Codes;
+
+    // Dictionary of the column. Code of each distinct value
+    std::unordered_map<T, std::uint32_t> ValueCodes;
+
+    // Values by their codes. The pointers point to the keys of ValueCodes, which are not moved by its rehashing
+    std::vector<const T*> Values;
+
+    // Add the default value with code 0 to the empty dictionary
+    void AddDefaultValue(const T& defaultValue)
+    {
+        Values.emplace_back(&ValueCodes.emplace(defaultValue, 0).first->first);
+    }
+
+    // Get the code of the value. The value is added to the dictionary if it is not there
+    std::uint32_t GetOrAddCode(const T& value)
+    {
+        auto res = ValueCodes.emplace(value, static_cast<std::uint32_t>(Values.size()));
+        if (res.second)
+            Values.emplace_back(&res.first->first);
+
+        return res.first->second;
+    }
+
+    // Find the code of the value. Returns false if the value is not in the dictionary, so no record has it
+    bool FindCode(const T& value, std::uint32_t& code) const
+    {
+        auto f = ValueCodes.find(value);
+        if (f == ValueCodes.end())
+            return false;
+
+        code = f->second;
+        return true;
+    }
+
+    // Get the value of the row
+    const T& GetValue(RowId row) const { return *Values[Codes[row]]; }
+
+public:
+    /// Making the ColumnDataStorage class friendly so that it has access to the column data
+    friend ColumnDataStorage;
+
+    /// Making the ColumnDataStorageQuery class friendly so that its requests can read the column data
+    friend ColumnDataStorageQuery;
+
+    /// \brief Constructor
+    /// \param [in] defaultValue value for new records
+    DataStorageDictionaryColumn(const T& defaultValue) { AddDefaultValue(defaultValue); }
+
+    /// Deleted copy constructor
+    DataStorageDictionaryColumn(const DataStorageDictionaryColumn& other) = delete;
+
+    /// Deleted assign operator
+    DataStorageDictionaryColumn& operator= (const DataStorageDictionaryColumn& other) = delete;
+
+    const std::type_info& GetDataType() const override { return typeid(T); }
+
+    bool IsDictionaryEncoded() const override { return true; }
+
+    void AddRow() override { Codes.emplace_back(0); }
+
+    void ResetRow(RowId row) override { Codes[row] = 0; }
+
+    bool SetRowFromDataSaver(RowId row, const DataSaver& dataSaver) override
+    {
+        const T* value = dataSaver.GetDataPtr<T>();
+        if (value == nullptr)
+            return false;
+
+        Codes[row] = GetOrAddCode(*value);
+        return true;
+    }
+
+    void Reserve(std::size_t rowsCount) override { Codes.reserve(rowsCount); }
+
+    void Clear() override
+    {
+        T defaultValue = *Values[0];
+
+        Codes.clear();
+        ValueCodes.clear();
+        Values.clear();
+        AddDefaultValue(defaultValue);
+    }
+
+    /// \brief Method for getting the number of distinct values in the dictionary
+    /// \return number of values including the default value
+    std::size_t GetDictionarySize() const { return Values.size(); }
+};
+
+/**
+    \brief A class to quickly access a column inside ColumnDataStorage
+
+    \tparam <T> The type of data stored in the column
+
+    The handle is obtained once using ColumnDataStorage::GetColumnHandle or ColumnDataStorage::SetKey,
+    after that, access to the data by handle does not require searching for a key by name and checking the type,
+    since they were checked when creating the handle. Thus access to the record value is just an array index.
+    If the key has been removed, then the handle becomes invalid and all operations with it will be ignored.
+*/
+template <class T>
+class ColumnHandle
+{
+private:
+    // Index of column inside ColumnDataStorage
+    std::size_t ColumnIndex = std::numeric_limits<std::size_t>::max();
+
+public:
+    /// Making the ColumnDataStorage class friendly so that it has access to the column index
+    friend ColumnDataStorage;
+
+    /// \brief A function to check that the handle was received from ColumnDataStorage
+    /// \return returns true if the handle points to a column, otherwise false
+    bool IsValid() const { return ColumnIndex != std::numeric_limits<std::size_t>::max(); }
+};
+
+/**
+    \brief A class to quickly access a dictionary-encoded column inside ColumnDataStorage
+
+    \tparam <T> The type of data stored in the column
+
+    Works the same way as ColumnHandle, but is obtained using ColumnDataStorage::GetDictionaryColumnHandle or ColumnDataStorage::SetDictionaryKey,
+    see DataStorageDictionaryColumn.
+*/
+template <class T>
+class DictionaryColumnHandle
+{
+private:
+    // Index of column inside ColumnDataStorage
+    std::size_t ColumnIndex = std::numeric_limits<std::size_t>::max();
+
+public:
+    /// Making the ColumnDataStorage class friendly so that it has access to the column index
+    friend ColumnDataStorage;
+
+    /// \brief A function to check that the handle was received from ColumnDataStorage
+    /// \return returns true if the handle points to a column, otherwise false
+    bool IsValid() const { return ColumnIndex != std::numeric_limits<std::size_t>::max(); }
+};
+
+/**
+    \brief Result of ColumnDataStorage::Aggregate
+
+    \tparam <T> Arithmetic type of the column except for bool
+
+    Integer values are summed in 64-bit integers and floating point values in double.
+    If no records were aggregated, Min and Max are equal to the limits of T.
+*/
+template <class T>
+struct ColumnAggregate
+{
+    /// Type of the sum of values
+    typedef typename std::conditional<std::is_floating_point<T>::value, double,
+        typename std::conditional<std::is_signed<T>::value, std::int64_t, std::uint64_t>::type>::type SumType;
+
+    /// Number of aggregated records
+    std::size_t Count = 0;
+
+    /// Sum of values
+    SumType Sum = 0;
+
+    /// Minimum value
+    T Min = std::numeric_limits<T>::max();
+
+    /// Maximum value
+    T Max = std::numeric_limits<T>::lowest();
+
+    /// \brief Method for getting the average value
+    /// \return average value or 0 if no records were aggregated
+    double GetAverage() const
+    {
+        return Count == 0 ? 0.0 : static_cast<double>(Sum) / static_cast<double>(Count);
+    }
+
+    /// \brief Method for adding the result of aggregating other records
+    /// \param [in] other the result to be added
+    void Merge(const ColumnAggregate& other)
+    {
+        Count += other.Count;
+        Sum += other.Sum;
+        Min = other.Min < Min ? other.Min : Min;
+        Max = Max < other.Max ? other.Max : Max;
+    }
+};
+
+/**
+    \brief A class for storing data by columns
+
+    An alternative to DataStorage, designed for tables with a large number of records.
+    The keys that are added using SetKey form the schema of the storage.
+    Each key is stored as a separate contiguous typed column, and the record is simply a row number inside all columns, see RowId.
+    Unlike DataStorage, records do not store key names and do not allocate memory for each value,
+    so full scans over the column are cache-friendly and memory per record is equal to the sum of sizes of the key types.
+    To quickly access the data, ColumnHandle is used, which is once obtained from the schema by the key name.
+    Aggregates and filtered scans, see Aggregate and ColumnDataStorageQuery, work directly on the arrays of columns.
+    Keys with a few distinct values repeated by many records can be added using SetDictionaryKey,
+    then the column stores 32-bit codes of the values, and the values are stored once, see DataStorageDictionaryColumn.
+
+    The RowId of erased records will be reused by new records.
+
+    Usage example:
+    \code
+        ColumnDataStorage cds;
+        ColumnHandle<int> idColumn = cds.SetKey("id", -1);
+        cds.SetKey<std::string>("name", "");
+
+        RowId row = cds.CreateRecord({ {"id", 0}, {"name", std::string("mrognor")} });
+
+        int id;
+        cds.GetData(row, idColumn, id);
+    \endcode
+*/
+class ColumnDataStorage
+{
+private:
+    // All columns. The index of column is stored inside schema. The pointer is nullptr if the key was removed
+    std::vector<DataStorageColumnBase*> Columns;
+
+    // Schema of storage. Key name to column index
+    std::unordered_map<std::string, std::size_t> Schema;
+
+    // Is the row used by a record. Bytes equal to 0 or 1 are used instead of bits, so that scans can use them as flags of matching rows
+    std::vector<std::uint8_t> IsRowAlive;
+
+    // Rows of erased records to reuse
+    std::vector<RowId> FreeRows;
+
+    // Recursive mutex for thread safety
+    mutable RecursiveReadWriteMutex RecursiveReadWriteMtx;
+
+    // Check that the column at the index exists, has T type and is dictionary-encoded or not
+    template <class T>
+    bool IsColumnOfType(std::size_t columnIndex, bool isDictionaryEncoded) const
+    {
+        return columnIndex < Columns.size() && Columns[columnIndex] != nullptr && Columns[columnIndex]->GetDataType() == typeid(T) &&
+            Columns[columnIndex]->IsDictionaryEncoded() == isDictionaryEncoded;
+    }
+
+    // Get column with T type. Returns nullptr if the handle is not valid. The column is checked on each call,
+    // so the handle can not point to a column of another class
+    template <class T>
+    DataStorageColumn<T>* GetColumn(const ColumnHandle<T>& handle) const
+    {
+        if (!IsColumnOfType<T>(handle.ColumnIndex, false))
+            return nullptr;
+
+        return static_cast<DataStorageColumn<T>*>(Columns[handle.ColumnIndex]);
+    }
+
+    // Get dictionary-encoded column with T type. Returns nullptr if the handle is not valid
+    template <class T>
+    DataStorageDictionaryColumn<T>* GetColumn(const DictionaryColumnHandle<T>& handle) const
+    {
+        if (!IsColumnOfType<T>(handle.ColumnIndex, true))
+            return nullptr;
+
+        return static_cast<DataStorageDictionaryColumn<T>*>(Columns[handle.ColumnIndex]);
+    }
+
+    // Get index of the column with T type by the key name. Returns the max value of std::size_t if there is no such column
+    template <class T>
+    std::size_t FindColumnIndex(const std::string& keyName, bool isDictionaryEncoded) const
+    {
+        auto f = Schema.find(keyName);
+        if (f != Schema.end() && IsColumnOfType<T>(f->second, isDictionaryEncoded))
+            return f->second;
+
+        return std::numeric_limits<std::size_t>::max();
+    }
+
+    // Get row for a new record
+    RowId AllocateRow();
+
+    // Number of rows checked by the requests of the query at once. The flags of the block fit into the L1 cache
+    static constexpr std::size_t ScanBlockSize = 1024;
+
+    // Minimum number of rows scanned by one thread
+    static constexpr std::size_t MinScanPartSize = 64 * 1024;
+
+    // Call func(begin, isMatch, count) for blocks of rows [begin, end), where isMatch[i] is 1 if the row begin + i is alive and satisfies the query,
+    // otherwise 0. Must be called under the lock
+    template <class F>
+    void ScanBlocks(const ColumnDataStorageQuery& query, RowId begin, RowId end, F&& func) const
+    {
+        std::uint8_t isMatch[ScanBlockSize];
+
+        for (RowId blockBegin = begin; blockBegin < end; blockBegin += ScanBlockSize)
+        {
+            std::size_t count = std::min<std::size_t>(ScanBlockSize, end - blockBegin);
+
+            // Without requests the flags of alive rows are used directly
+            if (query.Predicates.empty())
+            {
+                func(blockBegin, IsRowAlive.data() + blockBegin, count);
+                continue;
+            }
+
+            std::copy(IsRowAlive.begin() + blockBegin, IsRowAlive.begin() + blockBegin + count, isMatch);
+            for (auto& it : query.Predicates)
+                it(*this, blockBegin, count, isMatch);
+
+            func(blockBegin, static_cast<const std::uint8_t*>(isMatch), count);
+        }
+    }
+
+    // Call func(begin, end) for all rows, divided into parts for parallel threads if isParallel is true. Must be called under the lock
+    template <class F>
+    void ForEachRowsPart(bool isParallel, F&& func) const
+    {
+        if (isParallel)
+            ParallelFor(IsRowAlive.size(), MinScanPartSize, func);
+        else
+            func(0, IsRowAlive.size());
+    }
+
+    // Add values with isMatch equal to 1 to the result. Each of the 8 lanes has its own accumulators,
+    // so the loop has no dependencies between neighboring values and is vectorized by the compiler without changing the result
+    template <class T>
+    static void AggregateRows(const T* values, const std::uint8_t* isMatch, std::size_t count, ColumnAggregate<T>& res)
+    {
+        typedef typename ColumnAggregate<T>::SumType SumType;
+        constexpr std::size_t LanesCount = 8;
+
+        SumType sums[LanesCount] = {};
+        std::size_t counts[LanesCount] = {};
+        T mins[LanesCount];
+        T maxs[LanesCount];
+
+        for (std::size_t lane = 0; lane < LanesCount; ++lane)
+        {
+            mins[lane] = res.Min;
+            maxs[lane] = res.Max;
+        }
+
+        std::size_t i = 0;
+        for (; i + LanesCount <= count; i += LanesCount)
+        {
+            for (std::size_t lane = 0; lane < LanesCount; ++lane)
+            {
+                T value = values[i + lane];
+                bool isLaneMatch = isMatch[i + lane] != 0;
+                sums[lane] += isLaneMatch ? static_cast<SumType>(value) : SumType(0);
+                counts[lane] += isMatch[i + lane];
+                mins[lane] = isLaneMatch && value < mins[lane] ? value : mins[lane];
+                maxs[lane] = isLaneMatch && maxs[lane] < value ? value : maxs[lane];
+            }
+        }
+
+        for (; i < count; ++i)
+        {
+            if (isMatch[i] != 0)
+            {
+                sums[0] += static_cast<SumType>(values[i]);
+                ++counts[0];
+                mins[0] = values[i] < mins[0] ? values[i] : mins[0];
+                maxs[0] = maxs[0] < values[i] ? values[i] : maxs[0];
+            }
+        }
+
+        for (std::size_t lane = 0; lane < LanesCount; ++lane)
+        {
+            res.Sum += sums[lane];
+            res.Count += counts[lane];
+            res.Min = mins[lane] < res.Min ? mins[lane] : res.Min;
+            res.Max = res.Max < maxs[lane] ? maxs[lane] : res.Max;
+        }
+    }
+
+public:
+    /// Making the ColumnDataStorageQuery class friendly so that its requests can get columns by handles
+    friend ColumnDataStorageQuery;
+
+    /// Default constructor
+    ColumnDataStorage();
+
+    /// Deleted copy constructor
+    ColumnDataStorage(const ColumnDataStorage& other) = delete;
+
+    /// Deleted assign operator
+    ColumnDataStorage& operator= (const ColumnDataStorage& other) = delete;
+
+    /**
+        \brief Template function to add new key with default value to ColumnDataStorage
+
+        \tparam <T> Any type of data except for c arrays
+
+        If the key was added earlier, it will be removed and created again, the values of all records will be set to default.
+
+        \param [in] keyName new key name
+        \param [in] defaultKeyValue default key value
+
+        \return handle to the new column
+    */
+    template <class T>
+    ColumnHandle<T> SetKey(const std::string& keyName, const T& defaultKeyValue)
+    {
+        RecursiveReadWriteMtx.WriteLock();
+
+        // If the key was added earlier, then it must be deleted
+        RemoveKey(keyName);
+
+        // Create new column with default values for all existing rows
+        DataStorageColumn<T>* column = new DataStorageColumn<T>(defaultKeyValue);
+        column->Data.resize(IsRowAlive.size(), defaultKeyValue);
+
+        ColumnHandle<T> res;
+        res.ColumnIndex = Columns.size();
+
+        Columns.emplace_back(column);
+        Schema.emplace(keyName, res.ColumnIndex);
+
+        RecursiveReadWriteMtx.WriteUnlock();
+        return res;
+    }
+
+    /**
+        \brief Template function to add new dictionary-encoded key with default value to ColumnDataStorage
+
+        \tparam <T> Any type of data for which std::hash is specialized, usually std::string
+
+        Works the same way as SetKey, but the column stores 32-bit codes of the values in the dictionary of the key, see DataStorageDictionaryColumn.
+        Records take 4 bytes for the key, and FindRecords and Equal requests of ColumnDataStorageQuery compare codes instead of values.
+        The key can be used by name in the same way as keys added by SetKey.
+
+        \code
+            DictionaryColumnHandle<std::string> socketColumn = cds.SetDictionaryKey<std::string>("socket", "");
+            std::vector<RowId> am4 = cds.FindRecords(socketColumn, std::string("AM4"));
+        \endcode
+
+        \param [in] keyName new key name
+        \param [in] defaultKeyValue default key value
+
+        \return handle to the new column
+    */
+    template <class T>
+    DictionaryColumnHandle<T> SetDictionaryKey(const std::string& keyName, const T& defaultKeyValue)
+    {
+        RecursiveReadWriteMtx.WriteLock();
+
+        // If the key was added earlier, then it must be deleted
+        RemoveKey(keyName);
+
+        // Create new column with the code of the default value for all existing rows
+        DataStorageDictionaryColumn<T>* column = new DataStorageDictionaryColumn<T>(defaultKeyValue);
+        column->Codes.resize(IsRowAlive.size(), 0);
+
+        DictionaryColumnHandle<T> res;
+        res.ColumnIndex = Columns.size();
+
+        Columns.emplace_back(column);
+        Schema.emplace(keyName, res.ColumnIndex);
+
+        RecursiveReadWriteMtx.WriteUnlock();
+        return res;
+    }
+
+    /**
+        \brief The method for checking whether the key exists
+
+        \param [in] keyName the name of the key to search for
+
+        \return returns true if the key was found otherwise returns false
+    */
+    bool IsKeyExist(const std::string& keyName) const;
+
+    /**
+        \brief The method for getting a default key value
+
+        \tparam <T> Any type of data except for c arrays
+
+        \param [in] keyName the name of the key to search for
+        \param [out] defaultKeyValue the ref to which the default value will be written
+
+        \return returns true if the key with T type was found otherwise returns false
+    */
+    template <class T>
+    bool GetKeyValue(const std::string& keyName, T& defaultKeyValue) const
+    {
+        bool res = false;
+        RecursiveReadWriteMtx.ReadLock();
+
+        DataStorageColumn<T>* column = GetColumn(GetColumnHandle<T>(keyName));
+        DataStorageDictionaryColumn<T>* dictionaryColumn = GetColumn(GetDictionaryColumnHandle<T>(keyName));
+        if (column != nullptr)
+        {
+            defaultKeyValue = column->DefaultValue;
+            res = true;
+        }
+        else if (dictionaryColumn != nullptr)
+        {
+            defaultKeyValue = *dictionaryColumn->Values[0];
+            res = true;
+        }
+
+        RecursiveReadWriteMtx.ReadUnlock();
+        return res;
+    }
+
+    /**
+        \brief The method for getting a handle to the column
+
+        \tparam <T> The type of data stored in the column
+
+        \param [in] keyName the name of the key
+
+        \return handle to the column. If there is no such key, or the key has a different type or is dictionary-encoded, the handle will be invalid
+    */
+    template <class T>
+    ColumnHandle<T> GetColumnHandle(const std::string& keyName) const
+    {
+        ColumnHandle<T> res;
+        RecursiveReadWriteMtx.ReadLock();
+        res.ColumnIndex = FindColumnIndex<T>(keyName, false);
+        RecursiveReadWriteMtx.ReadUnlock();
+        return res;
+    }
+
+    /**
+        \brief The method for getting a handle to the dictionary-encoded column
+
+        \tparam <T> The type of data stored in the column
+
+        \param [in] keyName the name of the key
+
+        \return handle to the column. If there is no such key, or the key has a different type or is not dictionary-encoded, the handle will be invalid
+    */
+    template <class T>
+    DictionaryColumnHandle<T> GetDictionaryColumnHandle(const std::string& keyName) const
+    {
+        DictionaryColumnHandle<T> res;
+        RecursiveReadWriteMtx.ReadLock();
+        res.ColumnIndex = FindColumnIndex<T>(keyName, true);
+        RecursiveReadWriteMtx.ReadUnlock();
+        return res;
+    }
+
+    /**
+        \brief The method for getting the number of distinct values in the dictionary of the column
+
+        \tparam <T> The type of data stored in the column
+
+        \param [in] handle the handle of the column
+
+        \return number of values including the default value, or 0 if the handle is invalid
+    */
+    template <class T>
+    std::size_t GetDictionarySize(const DictionaryColumnHandle<T>& handle) const
+    {
+        std::size_t res = 0;
+        RecursiveReadWriteMtx.ReadLock();
+
+        DataStorageDictionaryColumn<T>* column = GetColumn(handle);
+        if (column != nullptr)
+            res = column->GetDictionarySize();
+
+        RecursiveReadWriteMtx.ReadUnlock();
+        return res;
+    }
+
+    /// \brief The method for deleting the key
+    /// All handles to this key will become invalid
+    /// \param [in] keyName the key to remove
+    void RemoveKey(const std::string& keyName);
+
+    /// \brief Method to create new record with default values
+    /// \return RowId of new record
+    RowId CreateRecord();
+
+    /**
+        \brief Method to create new record.
+
+        Works the same way as DataStorage::CreateRecord(const std::vector<std::pair<std::string, DataSaver>>& params).
+        Values for unknown keys are ignored.
+
+        \param [in] params a vector of pairs with data to be put in the ColumnDataStorage
+
+        \return RowId of new record
+    */
+    RowId CreateRecord(const std::vector<std::pair<std::string, DataSaver>>& params);
+
+    /// \brief Method to check that the record exists
+    /// \param [in] row the record to check
+    /// \return returns true if the record exists, otherwise false
+    bool IsRecordExist(RowId row) const;
+
+    /**
+        \brief Method for updating record data using a column handle
+
+        \tparam <T> The type of data stored in the column
+
+        \param [in] row the record to change
+        \param [in] handle the handle of the column to change
+        \param [in] data new value
+
+        \return returns true if the record and the column exist otherwise returns false
+    */
+    template <class T>
+    bool SetData(RowId row, const ColumnHandle<T>& handle, const T& data)
+    {
+        bool res = false;
+        RecursiveReadWriteMtx.WriteLock();
+
+        DataStorageColumn<T>* column = GetColumn(handle);
+        if (column != nullptr && row < IsRowAlive.size() && IsRowAlive[row])
+        {
+            column->Data[row] = data;
+            res = true;
+        }
+
+        RecursiveReadWriteMtx.WriteUnlock();
+        return res;
+    }
+
+    /**
+        \brief Method for updating record data using a key name
+
+        \tparam <T> The type of data stored in the column
+
+        \param [in] row the record to change
+        \param [in] keyName the name of the key to change
+        \param [in] data new value
+
+        \return returns true if the record and the key with T type exist otherwise returns false
+    */
+    template <class T>
+    bool SetData(RowId row, const std::string& keyName, const T& data)
+    {
+        ColumnHandle<T> handle = GetColumnHandle<T>(keyName);
+        if (handle.IsValid())
+            return SetData(row, handle, data);
+
+        return SetData(row, GetDictionaryColumnHandle<T>(keyName), data);
+    }
+
+    /**
+        \brief Method for updating record data using a handle of the dictionary-encoded column
+
+        \tparam <T> The type of data stored in the column
+
+        The value is added to the dictionary of the column if it is not there
+
+        \param [in] row the record to change
+        \param [in] handle the handle of the column to change
+        \param [in] data new value
+
+        \return returns true if the record and the column exist otherwise returns false
+    */
+    template <class T>
+    bool SetData(RowId row, const DictionaryColumnHandle<T>& handle, const T& data)
+    {
+        bool res = false;
+        RecursiveReadWriteMtx.WriteLock();
+
+        DataStorageDictionaryColumn<T>* column = GetColumn(handle);
+        if (column != nullptr && row < IsRowAlive.size() && IsRowAlive[row])
+        {
+            column->Codes[row] = column->GetOrAddCode(data);
+            res = true;
+        }
+
+        RecursiveReadWriteMtx.WriteUnlock();
+        return res;
+    }
+
+    /**
+        \brief Method for getting record data using a column handle
+
+        \tparam <T> The type of data stored in the column
+
+        \param [in] row the record to get data from
+        \param [in] handle the handle of the column
+        \param [out] data reference to record the received data
+
+        \return returns true if the data was received, otherwise false
+    */
+    template <class T>
+    bool GetData(RowId row, const ColumnHandle<T>& handle, T& data) const
+    {
+        bool res = false;
+        RecursiveReadWriteMtx.ReadLock();
+
+        DataStorageColumn<T>* column = GetColumn(handle);
+        if (column != nullptr && row < IsRowAlive.size() && IsRowAlive[row])
+        {
+            data = column->Data[row];
+            res = true;
+        }
+
+        RecursiveReadWriteMtx.ReadUnlock();
+        return res;
+    }
+
+    /**
+        \brief Method for getting record data using a key name
+
+        \tparam <T> The type of data stored in the column
+
+        \param [in] row the record to get data from
+        \param [in] keyName the name of the key
+        \param [out] data reference to record the received data
+
+        \return returns true if the data was received, otherwise false
+    */
+    template <class T>
+    bool GetData(RowId row, const std::string& keyName, T& data) const
+    {
+        ColumnHandle<T> handle = GetColumnHandle<T>(keyName);
+        if (handle.IsValid())
+            return GetData(row, handle, data);
+
+        return GetData(row, GetDictionaryColumnHandle<T>(keyName), data);
+    }
+
+    /**
+        \brief Method for getting record data using a handle of the dictionary-encoded column
+
+        \tparam <T> The type of data stored in the column
+
+        \param [in] row the record to get data from
+        \param [in] handle the handle of the column
+        \param [out] data reference to record the received data
+
+        \return returns true if the data was received, otherwise false
+    */
+    template <class T>
+    bool GetData(RowId row, const DictionaryColumnHandle<T>& handle, T& data) const
+    {
+        bool res = false;
+        RecursiveReadWriteMtx.ReadLock();
+
+        DataStorageDictionaryColumn<T>* column = GetColumn(handle);
+        if (column != nullptr && row < IsRowAlive.size() && IsRowAlive[row])
+        {
+            data = column->GetValue(row);
+            res = true;
+        }
+
+        RecursiveReadWriteMtx.ReadUnlock();
+        return res;
+    }
+
+    /**
+        \brief Method for iterating over all values of the column
+
+        \tparam <T> The type of data stored in the column
+        \tparam <F> Function or lambda function with the signature void(RowId row, const T& value)
+
+        Values are iterated in the order of rows, so the iteration is a sequential walk over memory.
+        The storage is locked for reading during the iteration, so the function must not change the storage.
+
+        \param [in] handle the handle of the column
+        \param [in] func function to be called for each record
+    */
+    template <class T, class F>
+    void ForEach(const ColumnHandle<T>& handle, F&& func) const
+    {
+        RecursiveReadWriteMtx.ReadLock();
+
+        DataStorageColumn<T>* column = GetColumn(handle);
+        if (column != nullptr)
+        {
+            for (RowId row = 0; row < column->Data.size(); ++row)
+                if (IsRowAlive[row])
+                    func(row, column->Data[row]);
+        }
+
+        RecursiveReadWriteMtx.ReadUnlock();
+    }
+
+    /**
+        \brief Method for iterating over all values of the dictionary-encoded column
+
+        \tparam <T> The type of data stored in the column
+        \tparam <F> Function or lambda function with the signature void(RowId row, const T& value)
+
+        Works the same way as ForEach for ColumnHandle. The values are passed from the dictionary without copying
+
+        \param [in] handle the handle of the column
+        \param [in] func function to be called for each record
+    */
+    template <class T, class F>
+    void ForEach(const DictionaryColumnHandle<T>& handle, F&& func) const
+    {
+        RecursiveReadWriteMtx.ReadLock();
+
+        DataStorageDictionaryColumn<T>* column = GetColumn(handle);
+        if (column != nullptr)
+        {
+            for (RowId row = 0; row < column->Codes.size(); ++row)
+                if (IsRowAlive[row])
+                    func(row, column->GetValue(row));
+        }
+
+        RecursiveReadWriteMtx.ReadUnlock();
+    }
+
+    /**
+        \brief Method for finding all records with the value of the key
+
+        \tparam <T> The type of data stored in the column
+
+        The column does not have an index, so a linear scan over the column is used
+
+        \param [in] handle the handle of the column
+        \param [in] keyValue the value of the key to be found
+
+        \return vector with RowId's of found records
+    */
+    template <class T>
+    std::vector<RowId> FindRecords(const ColumnHandle<T>& handle, const T& keyValue) const
+    {
+        std::vector<RowId> res;
+        ForEach(handle, [&](RowId row, const T& value)
+            {
+                if (value == keyValue)
+                    res.emplace_back(row);
+            }
+        );
+        return res;
+    }
+
+    /**
+        \brief Method for finding all records with the value of the dictionary-encoded key
+
+        \tparam <T> The type of data stored in the column
+
+        The value is searched in the dictionary once, and then the codes of the column are compared with its code
+
+        \param [in] handle the handle of the column
+        \param [in] keyValue the value of the key to be found
+
+        \return vector with RowId's of found records
+    */
+    template <class T>
+    std::vector<RowId> FindRecords(const DictionaryColumnHandle<T>& handle, const T& keyValue) const
+    {
+        std::vector<RowId> res;
+        RecursiveReadWriteMtx.ReadLock();
+
+        DataStorageDictionaryColumn<T>* column = GetColumn(handle);
+        std::uint32_t code;
+        if (column != nullptr && column->FindCode(keyValue, code))
+        {
+            for (RowId row = 0; row < column->Codes.size(); ++row)
+                if (column->Codes[row] == code && IsRowAlive[row])
+                    res.emplace_back(row);
+        }
+
+        RecursiveReadWriteMtx.ReadUnlock();
+        return res;
+    }
+
+    /**
+        \brief Method for finding all records satisfying all requests of the query
+
+        The requests are checked on blocks of rows by walking the columns, see ColumnDataStorageQuery
+
+        \param [in] query the query with requests on the columns
+
+        \return vector with RowId's of found records in ascending order
+    */
+    std::vector<RowId> FindRecords(const ColumnDataStorageQuery& query) const;
+
+    /**
+        \brief Method for counting records satisfying all requests of the query
+
+        \param [in] query the query with requests on the columns
+        \param [in] isParallel if true, rows are divided between hardware threads
+
+        \return number of found records
+    */
+    std::size_t Count(const ColumnDataStorageQuery& query, bool isParallel = false) const;
+
+    /**
+        \brief Method for computing the count, sum, minimum, maximum and average of the column values of records satisfying the query
+
+        \tparam <T> Arithmetic type of the column except for bool
+
+        All values are computed in one pass over the column. The column is read as a contiguous array, and the loop over it
+        has no branches, so it is vectorized by the compiler. Large columns can be divided between hardware threads.
+
+        \code
+            ColumnAggregate<int> cpuMark = cds.Aggregate(cpuMarkColumn);
+            std::cout << cpuMark.Min << " " << cpuMark.Max << " " << cpuMark.GetAverage() << std::endl;
+        \endcode
+
+        \param [in] handle the handle of the column to aggregate
+        \param [in] query the query with requests on the columns. If it is empty, all records are aggregated
+        \param [in] isParallel if true, rows are divided between hardware threads
+
+        \return result of aggregation. If the handle is invalid, no records are aggregated
+    */
+    template <class T>
+    ColumnAggregate<T> Aggregate(const ColumnHandle<T>& handle, const ColumnDataStorageQuery& query, bool isParallel = false) const
+    {
+        static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value, "Only arithmetic columns except for bool can be aggregated");
+
+        ColumnAggregate<T> res;
+        std::mutex resMtx;
+        RecursiveReadWriteMtx.ReadLock();
+
+        DataStorageColumn<T>* column = GetColumn(handle);
+        if (column != nullptr)
+        {
+            const T* values = column->Data.data();
+            ForEachRowsPart(isParallel, [&](RowId begin, RowId end)
+                {
+                    ColumnAggregate<T> part;
+                    ScanBlocks(query, begin, end, [values, &part](RowId blockBegin, const std::uint8_t* isMatch, std::size_t count)
+                        {
+                            AggregateRows(values + blockBegin, isMatch, count, part);
+                        }
+                    );
+
+                    std::lock_guard<std::mutex> lock(resMtx);
+                    res.Merge(part);
+                }
+            );
+        }
+
+        RecursiveReadWriteMtx.ReadUnlock();
+        return res;
+    }
+
+    /**
+        \brief Method for computing the count, sum, minimum, maximum and average of the column values of all records
+
+        \tparam <T> Arithmetic type of the column except for bool
+
+        Works the same way as Aggregate(const ColumnHandle<T>& handle, const ColumnDataStorageQuery& query, bool isParallel) with an empty query
+
+        \param [in] handle the handle of the column to aggregate
+        \param [in] isParallel if true, rows are divided between hardware threads
+
+        \return result of aggregation. If the handle is invalid, no records are aggregated
+    */
+    template <class T>
+    ColumnAggregate<T> Aggregate(const ColumnHandle<T>& handle, bool isParallel = false) const
+    {
+        return Aggregate(handle, ColumnDataStorageQuery(), isParallel);
+    }
+
+    /// \brief Method for deleting a record
+    /// The RowId of this record may be reused by new records
+    /// \param row the record that needs to be deleted
+    void EraseRecord(RowId row);
+
+    /// \brief Method for reserving memory for records
+    /// \param [in] recordsCount the number of records to reserve memory for
+    void Reserve(std::size_t recordsCount);
+
+    /// \brief A method for deleting all data and keys
+    /// All handles to the keys will become invalid, even if keys with the same names are added again
+    void DropDataStorage();
+
+    /// A method for deleting all data, but keeping all keys
+    void DropData();
+
+    /// \brief Method for getting the number of records
+    /// \return number of records
+    std::size_t Size() const;
+
+    /// Default destructor
+    ~ColumnDataStorage();
+};
+
+template <class R>
+ColumnDataStorageQuery& ColumnDataStorageQuery::Where(const ColumnHandle<typename R::ValueType>& handle, const R& request)
+{
+    typedef typename R::ValueType T;
+
+    // The request is stored with its own type, so IsMatch is not a virtual call inside the loop
+    Predicates.emplace_back([handle, request](const ColumnDataStorage& columnDataStorage, std::size_t begin, std::size_t count, std::uint8_t* isMatch)
+        {
+            DataStorageColumn<T>* column = columnDataStorage.GetColumn(handle);
+            if (column == nullptr)
+            {
+                std::fill(isMatch, isMatch + count, std::uint8_t(0));
+                return;
+            }
+
+            for (std::size_t i = 0; i < count; ++i)
+                isMatch[i] &= request.IsMatch(column->Data[begin + i]) ? 1 : 0;
+        }
+    );
+
+    return *this;
+}
+
+template <class R>
+ColumnDataStorageQuery& ColumnDataStorageQuery::Where(const DictionaryColumnHandle<typename R::ValueType>& handle, const R& request)
+{
+    typedef typename R::ValueType T;
+
+    Predicates.emplace_back([handle, request](const ColumnDataStorage& columnDataStorage, std::size_t begin, std::size_t count, std::uint8_t* isMatch)
+        {
+            DataStorageDictionaryColumn<T>* column = columnDataStorage.GetColumn(handle);
+            if (column == nullptr)
+            {
+                std::fill(isMatch, isMatch + count, std::uint8_t(0));
+                return;
+            }
+
+            const std::uint32_t* codes = column->Codes.data() + begin;
+
+            // The value of the equal request is searched in the dictionary once per block, and then only codes are compared
+            if constexpr (std::is_same<R, Equal<T>>::value)
+            {
+                std::uint32_t code;
+                if (!column->FindCode(request.Value, code))
+                {
+                    std::fill(isMatch, isMatch + count, std::uint8_t(0));
+                    return;
+                }
+
+                for (std::size_t i = 0; i < count; ++i)
+                    isMatch[i] &= codes[i] == code ? 1 : 0;
+            }
+            else
+            {
+                for (std::size_t i = 0; i < count; ++i)
+                    isMatch[i] &= request.IsMatch(*column->Values[codes[i]]) ? 1 : 0;
+            }
+        }
+    );
+
+    return *this;
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "DataStorageRequests.h"
+
+// Class declaration
+class ColumnDataStorage;
+
+template <class T>
+class ColumnHandle;
+
+template <class T>
+class DictionaryColumnHandle;
+
+/**
+    \brief A class for filtered scans over ColumnDataStorage
+
+    The query is a list of requests to different columns, and a record satisfies the query if it satisfies all requests.
+    The same requests as for DataStorage are used, see DataStorageRequests.h. The columns do not have indices,
+    so ColumnDataStorage checks the requests on blocks of rows: each request walks its column over the block
+    and clears the flags of rows that do not match it, without branches, so the loop is vectorized by the compiler.
+
+    \code
+        ColumnDataStorageQuery query;
+        query.Where(cpuMarkColumn, Greater<int>(20000))
+            .Where(tdpColumn, Less<int>(65));
+
+        ColumnAggregate<int> prices = cds.Aggregate(priceColumn, query);
+    \endcode
+
+    The definition of Where is in ColumnDataStorage.h, so ColumnDataStorage.h must be included to use this class.
+*/
+class ColumnDataStorageQuery
+{
+private:
+    // Function to clear the flags of rows [begin, begin + count) that do not satisfy the request
+    typedef std::function<void(const ColumnDataStorage& columnDataStorage, std::size_t begin, std::size_t count, std::uint8_t* isMatch)> Predicate;
+
+    // All requests of the query
+    std::vector<Predicate> Predicates;
+
+public:
+    /// Making the ColumnDataStorage class friendly so that it has access to the requests of the query
+    friend ColumnDataStorage;
+
+    /**
+        \brief Method for adding a request on the column to the query
+
+        \tparam <R> Type of the request, for example Between<int>. The request is copied to the query
+
+        \param [in] handle the handle of the column. If it is invalid, no records satisfy the query
+        \param [in] request the request with the range of the column values, see DataStorageRequests.h
+
+        \return ref to this query to add more requests
+    */
+    template <class R>
+    ColumnDataStorageQuery& Where(const ColumnHandle<typename R::ValueType>& handle, const R& request);
+
+    /**
+        \brief Method for adding a request on the dictionary-encoded column to the query
+
+        \tparam <R> Type of the request, for example Equal<std::string>. The request is copied to the query
+
+        Equal requests compare the codes of the values, other requests are checked on the values from the dictionary, see DataStorageDictionaryColumn
+
+        \param [in] handle the handle of the column. If it is invalid, no records satisfy the query
+        \param [in] request the request with the range of the column values, see DataStorageRequests.h
+
+        \return ref to this query to add more requests
+    */
+    template <class R>
+    ColumnDataStorageQuery& Where(const DictionaryColumnHandle<typename R::ValueType>& handle, const R& request);
+
+    /// \brief Method for getting the number of requests in the query
+    /// \return number of requests
+    std::size_t Size() const
+    {
+        return Predicates.size();
+    }
+
+    /// Method for deleting all requests from the query
+    void Clear()
+    {
+        Predicates.clear();
+    }
+};
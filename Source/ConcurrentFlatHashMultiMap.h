@@ -0,0 +1,564 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <type_traits>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "EpochManager.h"
+#include "MemoryPool.h"
+#include "Prefetch.h"
+
+/**
+    \brief Open addressing hash table with lock-free readers
+
+    \tparam <K> Key type. std::hash must be specialized for it
+    \tparam <V> Value type. It must be trivially copyable, since values are stored in atomics, for example a pointer
+
+    The table allows multiple elements with the same key, like ConcurrentHashMultiMap, and has the same rules:
+    readers do not lock anything, only one writer can work at the same time, and readers must call search methods inside EpochGuard.
+
+    The table is an array of slots divided into groups of 8. Each slot has a control byte with 7 bits of the hash of its key,
+    and the control bytes of a group are stored in one 64-bit word. A search compares the control bytes of the whole group at once
+    using bit operations, and reads only the slots with the matching hash bits, so most probes do not touch keys.
+    Each slot points to an entry with a key and a contiguous array of all values with this key.
+    Elements are not allocated one by one, so the table uses less memory than ConcurrentHashMultiMap, and iterating over equal
+    elements reads one array instead of walking a list.
+
+    The Position of an element is its number inside the array of its key. It does not change after rehashing,
+    but erasing moves the last element of the array to the place of the erased one, see Erase.
+    Replaced entries and old slot arrays are deleted using EpochManager.
+*/
+template <class K, class V>
+class ConcurrentFlatHashMultiMap
+{
+private:
+    static_assert(std::is_trivially_copyable<V>::value, "Values of ConcurrentFlatHashMultiMap must be trivially copyable");
+
+    // Key with all its values. The values are stored right after the entry
+    struct Entry
+    {
+        K Key;
+
+        // Number of values the entry has place for
+        std::size_t Capacity;
+
+        // Number of values. Readers read only values before Count
+        std::atomic<std::size_t> Count;
+
+        Entry(const K& key, std::size_t capacity) : Key(key), Capacity(capacity), Count(0) {}
+
+        // Get the array of values
+        std::atomic<V>* GetValues()
+        {
+            return reinterpret_cast<std::atomic<V>*>(this + 1);
+        }
+
+        const std::atomic<V>* GetValues() const
+        {
+            return reinterpret_cast<const std::atomic<V>*>(this + 1);
+        }
+
+        // Create the entry with place for capacity values in the pool
+        static Entry* Create(MemoryPool* pool, const K& key, std::size_t capacity)
+        {
+            static_assert(alignof(std::atomic<V>) <= alignof(Entry), "Values must be placed right after the entry");
+
+            void* ptr = MemoryPool::Allocate(pool, sizeof(Entry) + capacity * sizeof(std::atomic<V>));
+            Entry* entry = new (ptr) Entry(key, capacity);
+
+            std::atomic<V>* values = entry->GetValues();
+            for (std::size_t i = 0; i < capacity; ++i)
+                new (values + i) std::atomic<V>();
+
+            return entry;
+        }
+
+        // Delete the entry. Used directly and by EpochManager
+        static void Delete(void* ptr)
+        {
+            Entry* entry = static_cast<Entry*>(ptr);
+            entry->~Entry();
+            MemoryPool::Deallocate(entry);
+        }
+    };
+
+    // Array of slots. Published as a whole when rehashing. Entries are owned by the table, not by the slot array,
+    // so the new slot array after rehashing points to the same entries
+    struct SlotArray
+    {
+        // Number of groups. Always a power of two
+        std::size_t GroupsCount;
+
+        // Control bytes of all groups. Byte i of the word is the control byte of slot i of the group
+        std::atomic<std::uint64_t>* Controls;
+
+        // Entries of all slots
+        std::atomic<Entry*>* Slots;
+
+        SlotArray(std::size_t groupsCount) : GroupsCount(groupsCount),
+            Controls(new std::atomic<std::uint64_t>[groupsCount]), Slots(new std::atomic<Entry*>[groupsCount * GroupSize]())
+        {
+            for (std::size_t i = 0; i < groupsCount; ++i)
+                Controls[i].store(EmptyGroup, std::memory_order_relaxed);
+        }
+
+        ~SlotArray()
+        {
+            delete[] Controls;
+            delete[] Slots;
+        }
+    };
+
+    // Number of slots in a group
+    static constexpr std::size_t GroupSize = 8;
+
+    // Control byte of a slot that has never been used. Searches stop at the group with such a slot
+    static constexpr std::uint64_t EmptyControl = 0x80;
+
+    // Control byte of a slot whose entry was erased. Searches continue after it
+    static constexpr std::uint64_t DeletedControl = 0xFE;
+
+    // Control bytes of a group without entries
+    static constexpr std::uint64_t EmptyGroup = 0x8080808080808080ull;
+
+    // Lowest bits of all control bytes of a group
+    static constexpr std::uint64_t LowBits = 0x0101010101010101ull;
+
+    // Highest bits of all control bytes of a group
+    static constexpr std::uint64_t HighBits = 0x8080808080808080ull;
+
+    // Initial number of groups
+    static constexpr std::size_t InitialGroupsCount = 2;
+
+    // Current slot array
+    std::atomic<SlotArray*> Slots;
+
+    // Number of slots with entries. Used only by the writer
+    std::size_t EntriesCount = 0;
+
+    // Number of slots with DeletedControl. Used only by the writer
+    std::size_t DeletedCount = 0;
+
+    // Number of elements. Used only by the writer
+    std::size_t ElementsCount = 0;
+
+    // Pool to allocate entries from. If it is nullptr, the operator new is used
+    MemoryPool* Pool = nullptr;
+
+    // Get the hash of the key. The low 7 bits are stored in the control byte and the other bits choose the group.
+    // Fibonacci hashing is used, since std::hash is often the identity function
+    static std::uint64_t GetHash(const K& key)
+    {
+        std::uint64_t hash = static_cast<std::uint64_t>(std::hash<K>()(key)) * 11400714819323198485ull;
+        return hash ^ (hash >> 32);
+    }
+
+    // Get the mask with the high bits of control bytes equal to the tag. It can also mark a byte after the matching byte,
+    // so keys of the found slots are always compared
+    static std::uint64_t MatchTag(std::uint64_t controls, std::uint64_t tag)
+    {
+        std::uint64_t x = controls ^ (LowBits * tag);
+        return (x - LowBits) & ~x & HighBits;
+    }
+
+    // Get the mask with the high bits of empty control bytes
+    static std::uint64_t MatchEmpty(std::uint64_t controls)
+    {
+        return controls & ~(controls << 6) & HighBits;
+    }
+
+    // Get the mask with the high bits of empty and deleted control bytes
+    static std::uint64_t MatchEmptyOrDeleted(std::uint64_t controls)
+    {
+        return controls & ~(controls << 7) & HighBits;
+    }
+
+    // Get the number of the slot of the lowest bit of the mask
+    static std::size_t LowestSlot(std::uint64_t mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, mask);
+        return static_cast<std::size_t>(index) >> 3;
+#else
+        return static_cast<std::size_t>(__builtin_ctzll(mask)) >> 3;
+#endif
+    }
+
+    // Find the entry of the key. Groups are probed using triangular numbers, so all groups are visited
+    static Entry* FindEntry(const SlotArray* slots, const K& key, std::size_t& slotIndex)
+    {
+        std::uint64_t hash = GetHash(key);
+        std::size_t mask = slots->GroupsCount - 1;
+        std::size_t group = static_cast<std::size_t>(hash >> 7) & mask;
+
+        for (std::size_t step = 1; ; ++step)
+        {
+            std::uint64_t controls = slots->Controls[group].load(std::memory_order_acquire);
+
+            for (std::uint64_t match = MatchTag(controls, hash & 0x7F); match != 0; match &= match - 1)
+            {
+                std::size_t i = group * GroupSize + LowestSlot(match);
+                Entry* entry = slots->Slots[i].load(std::memory_order_acquire);
+                if (entry != nullptr && entry->Key == key)
+                {
+                    slotIndex = i;
+                    return entry;
+                }
+            }
+
+            if (MatchEmpty(controls) != 0 || step > mask)
+                return nullptr;
+
+            group = (group + step) & mask;
+        }
+    }
+
+    // Set the control byte of the slot. Only for the writer
+    static void SetControl(SlotArray* slots, std::size_t slotIndex, std::uint64_t control)
+    {
+        std::atomic<std::uint64_t>& controls = slots->Controls[slotIndex / GroupSize];
+        unsigned shift = static_cast<unsigned>(slotIndex % GroupSize) * 8;
+
+        std::uint64_t value = controls.load(std::memory_order_relaxed);
+        value = (value & ~(std::uint64_t(0xFF) << shift)) | (control << shift);
+        controls.store(value, std::memory_order_release);
+    }
+
+    // Add the entry to the first free slot of its probe sequence. The slot is set before its control byte, so readers see a complete entry.
+    // Only for the writer
+    void LinkEntry(SlotArray* slots, Entry* entry)
+    {
+        std::uint64_t hash = GetHash(entry->Key);
+        std::size_t mask = slots->GroupsCount - 1;
+        std::size_t group = static_cast<std::size_t>(hash >> 7) & mask;
+
+        for (std::size_t step = 1; ; ++step)
+        {
+            std::uint64_t controls = slots->Controls[group].load(std::memory_order_relaxed);
+            std::uint64_t match = MatchEmptyOrDeleted(controls);
+            if (match != 0)
+            {
+                std::size_t i = group * GroupSize + LowestSlot(match);
+                if (((controls >> (LowestSlot(match) * 8)) & 0xFF) == DeletedControl)
+                    --DeletedCount;
+
+                slots->Slots[i].store(entry, std::memory_order_release);
+                SetControl(slots, i, hash & 0x7F);
+                ++EntriesCount;
+                return;
+            }
+
+            group = (group + step) & mask;
+        }
+    }
+
+    // Create a slot array with groupsCount groups and link all entries to it. Old slots are still used by readers, so they are retired
+    void Rehash(std::size_t groupsCount)
+    {
+        SlotArray* oldSlots = Slots.load(std::memory_order_relaxed);
+        SlotArray* newSlots = new SlotArray(groupsCount);
+
+        EntriesCount = 0;
+        DeletedCount = 0;
+        for (std::size_t i = 0; i < oldSlots->GroupsCount * GroupSize; ++i)
+        {
+            Entry* entry = oldSlots->Slots[i].load(std::memory_order_relaxed);
+            if (entry != nullptr)
+                LinkEntry(newSlots, entry);
+        }
+
+        Slots.store(newSlots, std::memory_order_release);
+        EpochManager::GetInstance().Retire(oldSlots);
+    }
+
+    // Delete all entries of the slot array immediately or after all readers leave
+    static void DeleteEntries(SlotArray* slots, bool isRetired)
+    {
+        for (std::size_t i = 0; i < slots->GroupsCount * GroupSize; ++i)
+        {
+            Entry* entry = slots->Slots[i].load(std::memory_order_relaxed);
+            if (entry == nullptr)
+                continue;
+
+            if (isRetired)
+                EpochManager::GetInstance().Retire(entry, &Entry::Delete);
+            else
+                Entry::Delete(entry);
+        }
+    }
+
+public:
+    /// Position of the element inside the array of elements with the same key. It is valid until an element with the same key is erased, see Erase
+    typedef std::size_t Position;
+
+    /// \brief Constructor
+    /// \param [in] memoryPool pool to allocate entries from. The pool must have an owner while the table is used
+    ConcurrentFlatHashMultiMap(MemoryPool* memoryPool = nullptr) : Pool(memoryPool)
+    {
+        Slots.store(new SlotArray(InitialGroupsCount));
+    }
+
+    /// Deleted copy constructor
+    ConcurrentFlatHashMultiMap(const ConcurrentFlatHashMultiMap& other) = delete;
+
+    /// \brief Move constructor. Only for the writer, other must not have readers
+    /// \param [in] other object to be moved. It becomes empty
+    ConcurrentFlatHashMultiMap(ConcurrentFlatHashMultiMap&& other)
+    {
+        Slots.store(other.Slots.load(std::memory_order_relaxed));
+        EntriesCount = other.EntriesCount;
+        DeletedCount = other.DeletedCount;
+        ElementsCount = other.ElementsCount;
+        Pool = other.Pool;
+
+        other.Slots.store(new SlotArray(InitialGroupsCount));
+        other.EntriesCount = 0;
+        other.DeletedCount = 0;
+        other.ElementsCount = 0;
+    }
+
+    /// Deleted assign operator
+    ConcurrentFlatHashMultiMap& operator= (const ConcurrentFlatHashMultiMap& other) = delete;
+
+    /**
+        \brief Method for adding a new element. Only for the writer
+
+        \param [in] key the key of the element
+        \param [in] value the value of the element
+
+        \return position of the new element
+    */
+    Position Emplace(const K& key, const V& value)
+    {
+        SlotArray* slots = Slots.load(std::memory_order_relaxed);
+        std::size_t slotIndex;
+        Entry* entry = FindEntry(slots, key, slotIndex);
+
+        if (entry == nullptr)
+        {
+            // Keep at most 7 / 8 of slots used. The table is grown only if entries take at least half of slots, otherwise deleted slots are cleared
+            std::size_t slotsCount = slots->GroupsCount * GroupSize;
+            if ((EntriesCount + DeletedCount + 1) * 8 > slotsCount * 7)
+            {
+                Rehash(EntriesCount * 2 >= slotsCount ? slots->GroupsCount * 2 : slots->GroupsCount);
+                slots = Slots.load(std::memory_order_relaxed);
+            }
+
+            entry = Entry::Create(Pool, key, 1);
+            entry->GetValues()[0].store(value, std::memory_order_relaxed);
+            entry->Count.store(1, std::memory_order_relaxed);
+            LinkEntry(slots, entry);
+            ++ElementsCount;
+            return 0;
+        }
+
+        std::size_t count = entry->Count.load(std::memory_order_relaxed);
+
+        // Replace the entry with a twice bigger copy. Readers of the old entry see the same values
+        if (count == entry->Capacity)
+        {
+            Entry* newEntry = Entry::Create(Pool, key, entry->Capacity * 2);
+            for (std::size_t i = 0; i < count; ++i)
+                newEntry->GetValues()[i].store(entry->GetValues()[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+            newEntry->Count.store(count, std::memory_order_relaxed);
+            slots->Slots[slotIndex].store(newEntry, std::memory_order_release);
+            EpochManager::GetInstance().Retire(entry, &Entry::Delete);
+            entry = newEntry;
+        }
+
+        entry->GetValues()[count].store(value, std::memory_order_relaxed);
+        entry->Count.store(count + 1, std::memory_order_release);
+        ++ElementsCount;
+        return count;
+    }
+
+    /**
+        \brief Method for erasing the element by its position in O(1). Only for the writer
+
+        The last element with the same key is moved to the place of the erased element, and onMove is called for it,
+        so that the owner of the moved element can store its new position.
+
+        \tparam <F> Function or lambda function with the signature void(const V& value, Position position)
+
+        \param [in] key the key of the element
+        \param [in] position position of the element returned by Emplace or ForEachPosition
+        \param [in] onMove function to be called for the moved element
+    */
+    template <class F>
+    void Erase(const K& key, Position position, F&& onMove)
+    {
+        SlotArray* slots = Slots.load(std::memory_order_relaxed);
+        std::size_t slotIndex;
+        Entry* entry = FindEntry(slots, key, slotIndex);
+        if (entry == nullptr)
+            return;
+
+        std::size_t count = entry->Count.load(std::memory_order_relaxed);
+        if (position >= count)
+            return;
+
+        --ElementsCount;
+
+        // The entry without values is removed from the slots. The slot is marked as deleted, so searches of other keys continue after it
+        if (count == 1)
+        {
+            SetControl(slots, slotIndex, DeletedControl);
+            slots->Slots[slotIndex].store(nullptr, std::memory_order_release);
+            EpochManager::GetInstance().Retire(entry, &Entry::Delete);
+            --EntriesCount;
+            ++DeletedCount;
+            return;
+        }
+
+        if (position != count - 1)
+        {
+            V last = entry->GetValues()[count - 1].load(std::memory_order_relaxed);
+            entry->GetValues()[position].store(last, std::memory_order_release);
+            onMove(last, position);
+        }
+
+        entry->Count.store(count - 1, std::memory_order_release);
+    }
+
+    /// Method for erasing all elements. Only for the writer
+    void Clear()
+    {
+        SlotArray* oldSlots = Slots.load(std::memory_order_relaxed);
+        Slots.store(new SlotArray(InitialGroupsCount), std::memory_order_release);
+        DeleteEntries(oldSlots, true);
+        EpochManager::GetInstance().Retire(oldSlots);
+        EntriesCount = 0;
+        DeletedCount = 0;
+        ElementsCount = 0;
+    }
+
+    /// \brief Method for loading the first group of the key to the cache before Find. Must be called inside EpochGuard or under the writer lock
+    /// \param [in] key the key to be found later
+    void Prefetch(const K& key) const
+    {
+        const SlotArray* slots = Slots.load(std::memory_order_acquire);
+        std::size_t group = static_cast<std::size_t>(GetHash(key) >> 7) & (slots->GroupsCount - 1);
+        PrefetchForRead(&slots->Controls[group]);
+        PrefetchForRead(&slots->Slots[group * GroupSize]);
+    }
+
+    /**
+        \brief Method for finding an element by the key. Must be called inside EpochGuard or under the writer lock
+
+        \param [in] key the key to find
+        \param [out] value the value of the first found element
+
+        \return returns true if the element was found, otherwise false
+    */
+    bool Find(const K& key, V& value) const
+    {
+        std::size_t slotIndex;
+        const Entry* entry = FindEntry(Slots.load(std::memory_order_acquire), key, slotIndex);
+        if (entry == nullptr || entry->Count.load(std::memory_order_acquire) == 0)
+            return false;
+
+        value = entry->GetValues()[0].load(std::memory_order_acquire);
+        return true;
+    }
+
+    /**
+        \brief Method for iterating over all elements with the key. Must be called inside EpochGuard or under the writer lock
+
+        \tparam <F> Function or lambda function with the signature void(const V& value)
+
+        \param [in] key the key to find
+        \param [in] func function to be called for each found element
+    */
+    template <class F>
+    void ForEachEqual(const K& key, F&& func) const
+    {
+        std::size_t slotIndex;
+        const Entry* entry = FindEntry(Slots.load(std::memory_order_acquire), key, slotIndex);
+        if (entry == nullptr)
+            return;
+
+        std::size_t count = entry->Count.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < count; ++i)
+            func(entry->GetValues()[i].load(std::memory_order_acquire));
+    }
+
+    /**
+        \brief Method for iterating over positions of all elements. Only for the writer
+
+        \tparam <F> Function or lambda function with the signature void(const V& value, Position position)
+
+        \param [in] func function to be called for each element
+    */
+    template <class F>
+    void ForEachPosition(F&& func) const
+    {
+        SlotArray* slots = Slots.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < slots->GroupsCount * GroupSize; ++i)
+        {
+            Entry* entry = slots->Slots[i].load(std::memory_order_relaxed);
+            if (entry == nullptr)
+                continue;
+
+            std::size_t count = entry->Count.load(std::memory_order_relaxed);
+            for (std::size_t j = 0; j < count; ++j)
+                func(entry->GetValues()[j].load(std::memory_order_relaxed), j);
+        }
+    }
+
+    /**
+        \brief Method for iterating over all keys. Only for the writer
+
+        \tparam <F> Function or lambda function with the signature void(const K& key, std::size_t valuesCount)
+
+        \param [in] func function to be called once for each key with the number of its values
+    */
+    template <class F>
+    void ForEachEntry(F&& func) const
+    {
+        SlotArray* slots = Slots.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < slots->GroupsCount * GroupSize; ++i)
+        {
+            Entry* entry = slots->Slots[i].load(std::memory_order_relaxed);
+            if (entry != nullptr)
+                func(entry->Key, entry->Count.load(std::memory_order_relaxed));
+        }
+    }
+
+    /// \brief Method for getting the number of slots. Only for the writer
+    /// \return number of slots
+    std::size_t GetSlotsCount() const
+    {
+        return Slots.load(std::memory_order_relaxed)->GroupsCount * GroupSize;
+    }
+
+    /// \brief Method for getting the number of slots with keys or erased keys. Only for the writer
+    /// Searches stop only at empty slots, so erased keys slow down searches until the next rehash
+    /// \return number of used slots
+    std::size_t GetUsedSlotsCount() const
+    {
+        return EntriesCount + DeletedCount;
+    }
+
+    /// \brief Method for getting the number of elements. Only for the writer
+    /// \return number of elements
+    std::size_t Size() const
+    {
+        return ElementsCount;
+    }
+
+    /// Destructor. There must be no readers at the moment of destruction
+    ~ConcurrentFlatHashMultiMap()
+    {
+        SlotArray* slots = Slots.load();
+        DeleteEntries(slots, false);
+        delete slots;
+    }
+};
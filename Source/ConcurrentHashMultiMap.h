@@ -0,0 +1,394 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+#include "EpochManager.h"
+#include "MemoryPool.h"
+#include "Prefetch.h"
+
+/**
+    \brief Hash table with lock-free readers
+
+    \tparam <K> Key type. std::hash must be specialized for it
+    \tparam <V> Value type. It is copied when it is found, so it should be small, for example a pointer
+
+    The table allows multiple elements with the same key, like std::unordered_multimap.
+    Readers do not lock anything and can work at the same time as the writer.
+    Only one writer can work at the same time, so all methods that change the table must be called under an external write lock.
+
+    Buckets are singly linked lists of nodes. The writer only adds nodes to the beginning of the list or unlinks them,
+    and each change is published by one atomic store, so readers always see a correct list.
+    Each node also stores the link pointing to it, so the writer can unlink the node by its Position in O(1),
+    even if many elements have the same key.
+    Unlinked nodes and old bucket arrays after rehashing are deleted using EpochManager,
+    so readers must call all search methods inside EpochGuard.
+*/
+template <class K, class V>
+class ConcurrentHashMultiMap
+{
+private:
+    // Node of bucket list
+    struct Node
+    {
+        K Key;
+        V Value;
+        std::atomic<Node*> Next;
+
+        // The bucket or the Next of the previous node, which points to this node. Used only by the writer
+        std::atomic<Node*>* PrevNext = nullptr;
+
+        Node(const K& key, const V& value, Node* next) : Key(key), Value(value), Next(next) {}
+
+        // Allocate node from the pool
+        static void* operator new(std::size_t size, MemoryPool* memoryPool)
+        {
+            return MemoryPool::Allocate(memoryPool, size);
+        }
+
+        // Delete node. Nodes are deleted using delete, also by EpochManager
+        static void operator delete(void* ptr)
+        {
+            MemoryPool::Deallocate(ptr);
+        }
+
+        // Called if the constructor throws
+        static void operator delete(void* ptr, MemoryPool*)
+        {
+            MemoryPool::Deallocate(ptr);
+        }
+    };
+
+    // Array of buckets. Published as a whole when rehashing
+    struct BucketArray
+    {
+        // Number of buckets. Always a power of two
+        std::size_t Size;
+
+        // Bit shift to get the bucket index from the hash
+        unsigned Shift;
+
+        // Buckets
+        std::atomic<Node*>* Buckets;
+
+        BucketArray(std::size_t size, unsigned shift) : Size(size), Shift(shift), Buckets(new std::atomic<Node*>[size]()) {}
+
+        // Delete the array together with all nodes
+        ~BucketArray()
+        {
+            for (std::size_t i = 0; i < Size; ++i)
+            {
+                Node* it = Buckets[i].load(std::memory_order_relaxed);
+                while (it != nullptr)
+                {
+                    Node* next = it->Next.load(std::memory_order_relaxed);
+                    delete it;
+                    it = next;
+                }
+            }
+
+            delete[] Buckets;
+        }
+
+        // Get bucket for the key. Fibonacci hashing is used, since std::hash is often the identity function
+        std::atomic<Node*>& GetBucket(const K& key) const
+        {
+            std::uint64_t hash = static_cast<std::uint64_t>(std::hash<K>()(key)) * 11400714819323198485ull;
+            return Buckets[static_cast<std::size_t>(hash >> Shift)];
+        }
+    };
+
+    // Current bucket array
+    std::atomic<BucketArray*> Buckets;
+
+    // Number of elements. Used only by the writer
+    std::size_t ElementsCount = 0;
+
+    // Number of rehashes. Positions of all elements change after rehashing. Used only by the writer
+    std::size_t RehashesCount = 0;
+
+    // Pool to allocate nodes from. If it is nullptr, the operator new is used
+    MemoryPool* Pool = nullptr;
+
+    // Initial number of buckets is 2 ^ (64 - InitialShift)
+    static constexpr unsigned InitialShift = 60;
+
+    // Add the node to the beginning of the bucket. Only for the writer
+    static void LinkNode(std::atomic<Node*>& bucket, Node* node, std::memory_order order)
+    {
+        Node* next = node->Next.load(std::memory_order_relaxed);
+        if (next != nullptr)
+            next->PrevNext = &node->Next;
+
+        node->PrevNext = &bucket;
+        bucket.store(node, order);
+    }
+
+    // Unlink the node from its bucket and delete it after all readers leave. Only for the writer
+    void UnlinkNode(Node* node)
+    {
+        Node* next = node->Next.load(std::memory_order_relaxed);
+        if (next != nullptr)
+            next->PrevNext = node->PrevNext;
+
+        // Readers standing on the node still see the rest of the list through its Next
+        node->PrevNext->store(next, std::memory_order_release);
+        EpochManager::GetInstance().Retire(node);
+        --ElementsCount;
+    }
+
+    // Create a bucket array with 2 ^ (64 - shift) buckets and copy all nodes to it. Old nodes are still used by readers, so they are retired
+    void Rehash(unsigned shift)
+    {
+        BucketArray* oldBuckets = Buckets.load(std::memory_order_relaxed);
+        BucketArray* newBuckets = new BucketArray(std::size_t(1) << (64 - shift), shift);
+
+        for (std::size_t i = 0; i < oldBuckets->Size; ++i)
+        {
+            for (Node* it = oldBuckets->Buckets[i].load(std::memory_order_relaxed); it != nullptr; it = it->Next.load(std::memory_order_relaxed))
+            {
+                std::atomic<Node*>& bucket = newBuckets->GetBucket(it->Key);
+                LinkNode(bucket, new (Pool) Node(it->Key, it->Value, bucket.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+            }
+        }
+
+        ++RehashesCount;
+        Buckets.store(newBuckets, std::memory_order_release);
+        EpochManager::GetInstance().Retire(oldBuckets);
+    }
+
+public:
+    /// Position of the element inside the table. It is valid until the element is erased or the table is rehashed, see GetRehashesCount
+    typedef Node* Position;
+
+    /// \brief Constructor
+    /// \param [in] memoryPool pool to allocate nodes from. The pool must have an owner while the table is used
+    ConcurrentHashMultiMap(MemoryPool* memoryPool = nullptr) : Pool(memoryPool)
+    {
+        Buckets.store(new BucketArray(std::size_t(1) << (64 - InitialShift), InitialShift));
+    }
+
+    /// Deleted copy constructor
+    ConcurrentHashMultiMap(const ConcurrentHashMultiMap& other) = delete;
+
+    /// \brief Move constructor. Only for the writer, other must not have readers
+    /// \param [in] other object to be moved. It becomes empty
+    ConcurrentHashMultiMap(ConcurrentHashMultiMap&& other)
+    {
+        Buckets.store(other.Buckets.load(std::memory_order_relaxed));
+        ElementsCount = other.ElementsCount;
+        RehashesCount = other.RehashesCount;
+        Pool = other.Pool;
+
+        other.Buckets.store(new BucketArray(std::size_t(1) << (64 - InitialShift), InitialShift));
+        other.ElementsCount = 0;
+    }
+
+    /// Deleted assign operator
+    ConcurrentHashMultiMap& operator= (const ConcurrentHashMultiMap& other) = delete;
+
+    /**
+        \brief Method for adding a new element. Only for the writer
+
+        \param [in] key the key of the element
+        \param [in] value the value of the element
+
+        \return position of the new element
+    */
+    Position Emplace(const K& key, const V& value)
+    {
+        // Keep the load factor not greater than 1
+        if (ElementsCount >= Buckets.load(std::memory_order_relaxed)->Size)
+            Rehash(Buckets.load(std::memory_order_relaxed)->Shift - 1);
+
+        std::atomic<Node*>& bucket = Buckets.load(std::memory_order_relaxed)->GetBucket(key);
+        Node* node = new (Pool) Node(key, value, bucket.load(std::memory_order_relaxed));
+        LinkNode(bucket, node, std::memory_order_release);
+        ++ElementsCount;
+        return node;
+    }
+
+    /**
+        \brief Method for erasing an element with the key and the value. Only for the writer
+
+        \param [in] key the key of the element
+        \param [in] value the value of the element
+
+        \return returns true if the element was found, otherwise false
+    */
+    bool Erase(const K& key, const V& value)
+    {
+        for (Node* it = Buckets.load(std::memory_order_relaxed)->GetBucket(key).load(std::memory_order_relaxed); it != nullptr; it = it->Next.load(std::memory_order_relaxed))
+        {
+            if (it->Key == key && it->Value == value)
+            {
+                UnlinkNode(it);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// \brief Method for erasing the element by its position in O(1). Only for the writer
+    /// \param [in] position position of the element returned by Emplace or ForEachPosition
+    void Erase(Position position)
+    {
+        UnlinkNode(position);
+    }
+
+    /**
+        \brief Method for allocating buckets for the number of elements in advance. Only for the writer
+
+        After that, adding elements up to this number does not rehash the table
+
+        \param [in] elementsCount expected number of elements
+    */
+    void Reserve(std::size_t elementsCount)
+    {
+        unsigned shift = Buckets.load(std::memory_order_relaxed)->Shift;
+        unsigned newShift = shift;
+
+        // Find the least power of two greater than elementsCount
+        while (newShift > 1 && (std::size_t(1) << (64 - newShift)) <= elementsCount)
+            --newShift;
+
+        if (newShift != shift)
+            Rehash(newShift);
+    }
+
+    /// Method for erasing all elements. Only for the writer
+    void Clear()
+    {
+        BucketArray* oldBuckets = Buckets.load(std::memory_order_relaxed);
+        Buckets.store(new BucketArray(std::size_t(1) << (64 - InitialShift), InitialShift), std::memory_order_release);
+        EpochManager::GetInstance().Retire(oldBuckets);
+        ElementsCount = 0;
+    }
+
+    /// \brief Method for loading the bucket of the key to the cache before Find. Must be called inside EpochGuard or under the writer lock
+    /// \param [in] key the key to be found later
+    void Prefetch(const K& key) const
+    {
+        PrefetchForRead(&Buckets.load(std::memory_order_acquire)->GetBucket(key));
+    }
+
+    /**
+        \brief Method for finding an element by the key. Must be called inside EpochGuard or under the writer lock
+
+        \param [in] key the key to find
+        \param [out] value the value of the first found element
+
+        \return returns true if the element was found, otherwise false
+    */
+    bool Find(const K& key, V& value) const
+    {
+        for (Node* it = Buckets.load(std::memory_order_acquire)->GetBucket(key).load(std::memory_order_acquire); it != nullptr; it = it->Next.load(std::memory_order_acquire))
+        {
+            if (it->Key == key)
+            {
+                value = it->Value;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+        \brief Method for iterating over all elements with the key. Must be called inside EpochGuard or under the writer lock
+
+        \tparam <F> Function or lambda function with the signature void(const V& value)
+
+        \param [in] key the key to find
+        \param [in] func function to be called for each found element
+    */
+    template <class F>
+    void ForEachEqual(const K& key, F&& func) const
+    {
+        for (Node* it = Buckets.load(std::memory_order_acquire)->GetBucket(key).load(std::memory_order_acquire); it != nullptr; it = it->Next.load(std::memory_order_acquire))
+            if (it->Key == key)
+                func(it->Value);
+    }
+
+    /**
+        \brief Method for iterating over positions of all elements. Only for the writer
+
+        \tparam <F> Function or lambda function with the signature void(const V& value, Position position)
+
+        \param [in] func function to be called for each element
+    */
+    template <class F>
+    void ForEachPosition(F&& func) const
+    {
+        BucketArray* buckets = Buckets.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < buckets->Size; ++i)
+            for (Node* it = buckets->Buckets[i].load(std::memory_order_relaxed); it != nullptr; it = it->Next.load(std::memory_order_relaxed))
+                func(it->Value, it);
+    }
+
+    /**
+        \brief Method for iterating over the keys of all elements. Only for the writer
+
+        \tparam <F> Function or lambda function with the signature void(const K& key). It is called once for each element, so equal keys are passed several times
+
+        \param [in] func function to be called for each element
+    */
+    template <class F>
+    void ForEachKey(F&& func) const
+    {
+        BucketArray* buckets = Buckets.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < buckets->Size; ++i)
+            for (Node* it = buckets->Buckets[i].load(std::memory_order_relaxed); it != nullptr; it = it->Next.load(std::memory_order_relaxed))
+                func(it->Key);
+    }
+
+    /// \brief Method for getting the number of buckets. Only for the writer
+    /// \return number of buckets
+    std::size_t GetBucketsCount() const
+    {
+        return Buckets.load(std::memory_order_relaxed)->Size;
+    }
+
+    /// \brief Method for getting the length of the longest bucket list. Only for the writer
+    /// All elements are visited, so it takes O(n)
+    /// \return maximum number of elements in one bucket
+    std::size_t GetMaxBucketLength() const
+    {
+        std::size_t res = 0;
+        BucketArray* buckets = Buckets.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < buckets->Size; ++i)
+        {
+            std::size_t length = 0;
+            for (Node* it = buckets->Buckets[i].load(std::memory_order_relaxed); it != nullptr; it = it->Next.load(std::memory_order_relaxed))
+                ++length;
+
+            if (length > res)
+                res = length;
+        }
+
+        return res;
+    }
+
+    /// \brief Method for getting the number of rehashes. Only for the writer
+    /// If the number has changed, positions of all elements have changed
+    /// \return number of rehashes
+    std::size_t GetRehashesCount() const
+    {
+        return RehashesCount;
+    }
+
+    /// \brief Method for getting the number of elements. Only for the writer
+    /// \return number of elements
+    std::size_t Size() const
+    {
+        return ElementsCount;
+    }
+
+    /// Destructor. There must be no readers at the moment of destruction
+    ~ConcurrentHashMultiMap()
+    {
+        delete Buckets.load();
+    }
+};
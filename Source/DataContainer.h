@@ -4,6 +4,8 @@
 #include <unordered_set>
 #include <map>
 #include <set>
+#include <tuple>
+#include <utility>
 
 #include "DataSaver.h"
 
@@ -29,6 +31,10 @@ protected:
     /// Container to store all data inside C container
     C Container;
 
+    /// Enables template overloads only for rvalues of types other than DataSaver, so lvalues are still copied by the const reference overloads
+    template <class T>
+    using EnableIfRvalue = typename std::enable_if<!std::is_reference<T>::value && !std::is_same<typename std::decay<T>::type, DataSaver>::value>::type;
+
 public:
     /// Redefine iterator from C container
     typedef typename C::iterator iterator;
@@ -59,7 +65,23 @@ public:
     template <class T>
     void AddData(const std::string& key, const T& data)
     {
-        Container.emplace(key, DataSaver(data));
+        Container.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(data));
+    }
+
+    /**
+        \brief Template method for moving a new temporary data to the container.
+
+        \tparam <T> Any type of data except for c arrays
+
+        Wrapper over emplace std container. The data is moved directly to the DataSaver inside the container
+
+        \param [in] key key for storing the data
+        \param [in] data data to move to container
+    */
+    template <class T, class = EnableIfRvalue<T>>
+    void AddData(const std::string& key, T&& data)
+    {
+        Container.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<T>(data)));
     }
 
     /**
@@ -77,7 +99,23 @@ public:
     template <class T, class F>
     void AddData(const std::string& key, const T& data, F&& deleteFunc)
     {
-        Container.emplace(key, DataSaver(data, deleteFunc));
+        Container.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(data, deleteFunc));
+    }
+
+    /**
+        \brief Template method for moving a new temporary data to the container and a function to delete this data
+
+        \tparam <T> Any type of data except for c arrays
+        \tparam <F> Function pointer or lambda function
+
+        \param [in] key key for storing the data
+        \param [in] data data to move to container
+        \param [in] deleteFunc function to delete data
+    */
+    template <class T, class F, class = EnableIfRvalue<T>>
+    void AddData(const std::string& key, T&& data, F&& deleteFunc)
+    {
+        Container.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<T>(data), deleteFunc));
     }
 
     /**
@@ -91,6 +129,17 @@ public:
         Container.emplace(key, dataSaver);
     }
 
+    /**
+        \brief Method for adding a new data to the container
+
+        \param [in] key the key whose value needs to be changed
+        \param [in] dataSaver dataSaver with any type, the value from which will be moved to the container. It will be empty after moving
+    */
+    void AddDataFromDataSaver(const std::string& key, DataSaver&& dataSaver)
+    {
+        Container.emplace(key, std::move(dataSaver));
+    }
+
     /**
         \brief Method for changing the value of a data inside a container using a key
 
@@ -107,6 +156,22 @@ public:
         SetData(key, data, nullptr);
     }
 
+    /**
+        \brief Method for changing the value of a data inside a container using a key and temporary data
+
+        \tparam <T> Any type of data except for c arrays
+
+        If there was no data with such a key, it will be created
+
+        \param [in] key the key whose value needs to be changed
+        \param [in] data new key value to be moved to the container
+    */
+    template <class T, class = EnableIfRvalue<T>>
+    void SetData(const std::string& key, T&& data)
+    {
+        SetData(key, std::forward<T>(data), nullptr);
+    }
+
     /**
         \brief Method for changing the value of a data inside a container using a key
 
@@ -132,6 +197,31 @@ public:
             f->second.SetData(data, deleteFunc); // Setting new data for the key if it was already in the container
     }
 
+    /**
+        \brief Method for changing the value of a data inside a container using a key and temporary data
+
+        \tparam <T> Any type of data except for c arrays
+        \tparam <F> Function pointer or lambda function
+
+        If there was no data with such a key, it will be created
+
+        \param [in] key the key whose value needs to be changed
+        \param [in] data new key value to be moved to the container
+        \param [in] deleteFunc function to delete data
+    */
+    template <class T, class F, class = EnableIfRvalue<T>>
+    void SetData(const std::string& key, T&& data, F&& deleteFunc)
+    {
+        // Find data iterator
+        auto f = Container.find(key);
+
+        // Checking whether there was such a key in the container
+        if (f == Container.end())
+            AddData(key, std::forward<T>(data), deleteFunc); // Adding data to the container if there was no key
+        else
+            f->second.SetData(std::forward<T>(data), deleteFunc); // Setting new data for the key if it was already in the container
+    }
+
     /**
         \brief Method for changing the value of a data inside a container using a key
 
@@ -152,6 +242,26 @@ public:
             f->second = dataSaver; // Setting new data for the key if it was already in the container
     }
 
+    /**
+        \brief Method for changing the value of a data inside a container using a key
+
+        If there was no data with such a key, it will be created
+
+        \param [in] key the key whose value needs to be changed
+        \param [in] dataSaver dataSaver with any type, the value from which will be moved to the container. It will be empty after moving
+    */
+    void SetDataFromDataSaver(const std::string& key, DataSaver&& dataSaver)
+    {
+        // Find data iterator
+        auto f = Container.find(key);
+
+        // Checking whether there was such a key in the container
+        if (f == Container.end())
+            AddDataFromDataSaver(key, std::move(dataSaver)); // Adding data to the container if there was no key
+        else
+            f->second = std::move(dataSaver); // Setting new data for the key if it was already in the container
+    }
+
     /**
         \brief Method for getting data from a container using a key
 
@@ -159,9 +269,9 @@ public:
 
         \param [in] key key for getting data
         \param [out] data a reference to data of type T to write data from the container there.
-        If the data was not found, then nothing will be written to the data
+        If the data was not found or has a different type, then nothing will be written to the data
 
-        \return Returns false if the key was not found, and otherwise returns true.
+        \return Returns false if the key was not found or the data has a different type, and otherwise returns true.
     */ 
     template <class T>
     bool GetData(const std::string& key, T& data) const
@@ -170,8 +280,38 @@ public:
         if (f == Container.end())
             return false;
 
-        f->second.GetData(data);
-        return true;
+        return f->second.GetData(data);
+    }
+
+    /**
+        \brief Method for getting a pointer to data inside a container without copying it
+
+        \tparam <T> Any type of data except for c arrays
+
+        \param [in] key key for getting data
+
+        \return pointer to the data. It is valid until the data is changed. Returns nullptr if the key was not found or the data has a different type
+    */
+    template <class T>
+    const T* GetDataPtr(const std::string& key) const
+    {
+        auto f = Container.find(key);
+        if (f == Container.end())
+            return nullptr;
+
+        return f->second.template GetDataPtr<T>();
+    }
+
+    /// \brief Method for getting the DataSaver with data of the key. Used to check several types of data with one search
+    /// \param [in] key key for getting data
+    /// \return pointer to the DataSaver. Returns nullptr if the key was not found
+    const DataSaver* GetDataSaver(const std::string& key) const
+    {
+        auto f = Container.find(key);
+        if (f == Container.end())
+            return nullptr;
+
+        return &f->second;
     }
 
     /// \brief A method for checking whether data with such a key is in the container
@@ -262,7 +402,7 @@ public:
     A simple typedef for HashMap. It is necessary for a more understandable separation of types.
     Represents the internal structure of the DataStorage.
     A string with the name of the key is used as the key. All keys are the same as in DataStorage.
-    The value stores a pointer to std::unordered_multimap<T, DataStorageRecord*>.
+    The value stores a pointer to ConcurrentHashMultiMap<T, DataStorageRecord*> or ConcurrentFlatHashMultiMap<T, DataStorageRecord*>.
     The key type is same as the DataStorage key value type.
     The value is a pointer to DataStorageRecord.
 
@@ -274,7 +414,7 @@ typedef DataHashMap DataStorageStructureHashMap;
     A simple typedef for Map. It is necessary for a more understandable separation of types.
     Represents the internal structure of the DataStorage.
     A string with the name of the key is used as the key. All keys are the same as in DataStorage.
-    The value stores a pointer to std::multimap<T, DataStorageRecord*>.
+    The value stores a pointer to DataStorageOrderedIndex<T>, which is a std::multimap<T, DataStorageRecord*> with PoolAllocator.
     The key type is same as the DataStorage key value type.
     The value is a pointer to DataStorageRecord.
 
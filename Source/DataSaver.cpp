@@ -1,8 +1,10 @@
 #include "DataSaver.h"
 
-DataTypeSaver::DataTypeSaver(const std::type_info& type) : TypeInfo(type) {}
+DataTypeSaver::DataTypeSaver(const std::type_info& type, bool isInline, void* (*copyFunc)(void*, const void*), 
+    void (*moveFunc)(void*, void*), void (*deleteFunc)(void*), std::string (*toStringFunc)(const void*), std::size_t (*allocatedSizeFunc)(const void*)) : 
+    TypeInfo(type), IsInline(isInline), CopyFunc(copyFunc), MoveFunc(moveFunc), DeleteFunc(deleteFunc), ToStringFunc(toStringFunc), AllocatedSizeFunc(allocatedSizeFunc) {}
 
-const std::type_info& DataTypeSaver::GetDataType() { return TypeInfo; }
+const std::type_info& DataTypeSaver::GetDataType() const { return TypeInfo; }
 
 
 DataSaver::DataSaver() {}
@@ -18,87 +20,131 @@ DataSaver& DataSaver::operator=(const DataSaver& dataSaver)
     // We check that there is no self-bonding
     if (&dataSaver != this)
     {
-        // Clear Ptr if it was data before
-        if (Ptr != nullptr)
-            DeleteFunc(Ptr);
-
-        // Clear DataType if it was data before
-        if (DataType != nullptr)
-            delete DataType;
+        // Clear data if it was data before
+        DeleteData();
+        CustomDeleteFunc = nullptr;
 
         // Check that dataSaver is not empty
-        if (dataSaver.Ptr != nullptr)
+        if (dataSaver.DataType != nullptr)
         {
-            // Create new DataType object copying data type from dataSaver
-            DataType = new DataTypeSaver(dataSaver.DataType->GetDataType());
-            
-            // Set new CopyFunc from dataSaver
-            CopyFunc = dataSaver.CopyFunc;
-            
-            // Call new copy func to copy data from dataSaver void pointer to local void pointer. Data to Ptr will be allocated inside function
-            CopyFunc(Ptr, dataSaver.Ptr);
-
-            // Copy to string function
-            ToStringFunc = dataSaver.ToStringFunc;
-
-            // Set delete function from dataSaver
-            DeleteFunc = dataSaver.DeleteFunc;
-            
+            // Call copy func to copy data from dataSaver. Data will be placed to buffer or allocated inside function
+            void* ptr = dataSaver.DataType->CopyFunc(Buffer, dataSaver.GetPtr());
+            if (!dataSaver.DataType->IsInline)
+                HeapPtr = ptr;
+
+            // Copy pointer to static data type saver from dataSaver only after the data was copied, so this object stays empty if copying throws
+            DataType = dataSaver.DataType;
+
             // Set custom delete function from dataSaver
             CustomDeleteFunc = dataSaver.CustomDeleteFunc;
         }
-        else
-        {
-            // If dataSaver is empty clear the variables
-            Ptr = nullptr;
-            DataType = nullptr;
-        }
     }
 
     return *this;
 }
 
-void DataSaver::ResetData()
+DataSaver::DataSaver(DataSaver&& dataSaver) noexcept
 {
-    if (CustomDeleteFunc != nullptr)
-    {
-        CustomDeleteFunc(Ptr);
-        CustomDeleteFunc = nullptr;
-    }
+    // Call move operator= method
+    *this = std::move(dataSaver);
+}
 
-    if (Ptr != nullptr)
+DataSaver& DataSaver::operator=(DataSaver&& dataSaver) noexcept
+{
+    // We check that there is no self-bonding
+    if (&dataSaver != this)
     {
-        DeleteFunc(Ptr);
-        Ptr = nullptr;
+        // Clear data if it was data before
+        DeleteData();
+
+        // Check that dataSaver is not empty
+        if (dataSaver.DataType != nullptr)
+        {
+            // Move inline data to local buffer or take the pointer to allocated data
+            if (dataSaver.DataType->IsInline)
+                dataSaver.DataType->MoveFunc(Buffer, dataSaver.Buffer);
+            else
+                HeapPtr = dataSaver.HeapPtr;
+
+            DataType = dataSaver.DataType;
+            CustomDeleteFunc = dataSaver.CustomDeleteFunc;
+
+            // Make dataSaver empty without deleting data
+            dataSaver.DataType = nullptr;
+            dataSaver.CustomDeleteFunc = nullptr;
+        }
+        else
+            CustomDeleteFunc = nullptr;
     }
 
+    return *this;
+}
+
+void* DataSaver::GetPtr()
+{
+    if (DataType == nullptr)
+        return nullptr;
+
+    return DataType->IsInline ? static_cast<void*>(Buffer) : HeapPtr;
+}
+
+const void* DataSaver::GetPtr() const
+{
+    if (DataType == nullptr)
+        return nullptr;
+
+    return DataType->IsInline ? static_cast<const void*>(Buffer) : HeapPtr;
+}
+
+void DataSaver::DeleteData()
+{
     if (DataType != nullptr)
     {
-        delete DataType;
+        DataType->DeleteFunc(GetPtr());
         DataType = nullptr;
     }
+}
 
-    CopyFunc = nullptr;
-    ToStringFunc = nullptr;
+void DataSaver::ResetData()
+{
+    if (CustomDeleteFunc != nullptr)
+    {
+        CustomDeleteFunc(GetPtr());
+        CustomDeleteFunc = nullptr;
+    }
+
+    DeleteData();
 }
 
 void DataSaver::Swap(DataSaver& dataSaver)
 {
-    DataSaver tmp = dataSaver;
-    dataSaver = *this;
-    *this = tmp;
+    DataSaver tmp = std::move(dataSaver);
+    dataSaver = std::move(*this);
+    *this = std::move(tmp);
 }
 
 std::string DataSaver::Str() const
 {
-    return ToStringFunc(Ptr);
+    return DataType->ToStringFunc(GetPtr());
 }
 
-DataSaver::~DataSaver()
+std::size_t DataSaver::GetAllocatedSize() const
 {
-    if (Ptr != nullptr)
-        DeleteFunc(Ptr);
+    if (DataType == nullptr)
+        return 0;
 
-    if (DataType != nullptr)
-        delete DataType;
+    return DataType->AllocatedSizeFunc(GetPtr());
+}
+
+bool DataSaver::IsSameType(const DataSaver& dataSaver) const
+{
+    if (DataType == nullptr || dataSaver.DataType == nullptr)
+        return false;
+
+    return DataType == dataSaver.DataType || DataType->GetDataType() == dataSaver.DataType->GetDataType();
+}
+
+DataSaver::~DataSaver()
+{
+    DeleteData();
 }
\ No newline at end of file
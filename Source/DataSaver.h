@@ -1,6 +1,12 @@
 #pragma once
 
 #include <iostream>
+#include <cstddef>
+#include <new>
+#include <string>
+#include <typeinfo>
+#include <type_traits>
+#include <utility>
 
 /**
     \todo Добавить описание этой функции в доки
@@ -24,7 +30,10 @@ std::string ToString(const T& data) { return ""; }
 /**
     \brief Class to make real time type check
 
-    Auxiliary class for Data Saver. Required for storing and comparing types inside Data Saver.
+    Auxiliary class for DataSaver. Required for storing and comparing types inside DataSaver.
+    There is only one static object of this class for each type stored in DataSaver, 
+    so DataSaver keeps a pointer to it and does not allocate memory to store the type.
+    In addition to the type, the object stores functions for copying, moving, deleting, converting data to a string and getting the size of allocated memory.
 */
 class DataTypeSaver
 {
@@ -33,44 +42,190 @@ private:
     const std::type_info& TypeInfo;
 
 public:
-    /// \brief A constructor that stores a variable in a class with the type of data stored inside DataSaver
-    /// \param [in] type variable with type
-    DataTypeSaver(const std::type_info& type);
+    /// Is data of this type stored inside the DataSaver buffer without memory allocation
+    const bool IsInline;
+
+    /// Pointer to copy function. Creates a copy of src inside buffer if the type is inline, otherwise allocates it. Returns the pointer to the copy
+    void* (*CopyFunc)(void* buffer, const void* src);
+
+    /// Pointer to move function. Used only for inline types. Moves src to buffer and destroys src
+    void (*MoveFunc)(void* buffer, void* src);
+
+    /// Pointer to delete function. Required to delete data since it is not possibly to delete void*
+    void (*DeleteFunc)(void* ptrToDelete);
+
+    /// A pointer to a function that will convert the value stored inside to a string
+    std::string (*ToStringFunc)(const void* ptrToPrint);
+
+    /// Pointer to a function returning the number of bytes allocated by data outside the DataSaver buffer
+    std::size_t (*AllocatedSizeFunc)(const void* ptr);
+
+    /**
+        \brief A constructor that stores a variable in a class with the type of data stored inside DataSaver
+
+        \param [in] type variable with type
+        \param [in] isInline is data of this type stored inside the DataSaver buffer
+        \param [in] copyFunc function to copy data
+        \param [in] moveFunc function to move inline data
+        \param [in] deleteFunc function to delete data
+        \param [in] toStringFunc function to convert data to a string
+        \param [in] allocatedSizeFunc function to get the number of bytes allocated by data
+    */
+    DataTypeSaver(const std::type_info& type, bool isInline, void* (*copyFunc)(void*, const void*), 
+        void (*moveFunc)(void*, void*), void (*deleteFunc)(void*), std::string (*toStringFunc)(const void*), std::size_t (*allocatedSizeFunc)(const void*));
 
     /// \brief Method for getting the data type stored inside the class
     /// \return the type of data stored inside the class
-    const std::type_info& GetDataType();
+    const std::type_info& GetDataType() const;
 };
 
 /**
    \brief A class for storing any type of data
 
     If a pointer is stored in a class, then you can set a function to automatically clear this pointer when an object of the class is destroyed.
+    Small data is stored inside the class buffer without memory allocation, see DataSaver::IsInlineType.
 
     \warning The class cannot store с-arrays
 */
 class DataSaver
 {
-private:
-    // Void pointer to save pointer to any data
-    void* Ptr = nullptr;
+public:
+    /// \brief The size of the buffer inside DataSaver.
+    /// Data whose size is not greater than this value is stored inside DataSaver without memory allocation
+    static constexpr std::size_t InlineBufferSize = sizeof(std::string) > 2 * sizeof(void*) ? sizeof(std::string) : 2 * sizeof(void*);
 
-    // Pointer to data type saver
-    DataTypeSaver* DataType = nullptr;
+    /**
+        \brief Checks whether data of type T will be stored inside the DataSaver buffer
 
-    // Pointer to copy function. Required to DataSaver copy
-    void (*CopyFunc)(void*& dst, void* src) = nullptr;
+        \tparam <T> Any type of data except for c arrays
 
-    // Pointer to delete function. Required to delete pointer since it is not possibly to delete void*
-    void (*DeleteFunc)(void*& ptrToDelete) = nullptr;
+        Small types with a non-throwing move constructor, such as int, float, bool, pointers and std::string, are stored inline.
+        Strings store their data inside themselves if they are short, so short strings do not allocate memory at all.
 
-    // A pointer to a function that will convert the value stored inside to a string
-    std::string (*ToStringFunc)(void* ptrToPrint) = nullptr;
+        \return true if data is stored inline, otherwise false
+    */
+    template <class T>
+    static constexpr bool IsInlineType()
+    {
+        return sizeof(T) <= InlineBufferSize && alignof(T) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible<T>::value;
+    }
+
+private:
+    // Storage for data. Small data is stored inside the buffer, and big data is allocated and stored by the pointer
+    union
+    {
+        // Buffer to store inline data
+        alignas(std::max_align_t) unsigned char Buffer[InlineBufferSize];
+        // Pointer to allocated data
+        void* HeapPtr;
+    };
+
+    // Pointer to static data type saver. Equal to nullptr if there is no data inside DataSaver
+    const DataTypeSaver* DataType = nullptr;
 
     // Pointer to custom delete function. Required to delete data if it is pointer
     void (*CustomDeleteFunc)(const void* ptr) = nullptr;
 
+    // Function to copy data of type T to buffer or to allocated memory
+    template <class T>
+    static void* CopyData(void* buffer, const void* src)
+    {
+        if constexpr (IsInlineType<T>())
+            return static_cast<void*>(new (buffer) T(*static_cast<const T*>(src)));
+        else
+            return static_cast<void*>(new T(*static_cast<const T*>(src)));
+    }
+
+    // Function to move inline data of type T from one buffer to another
+    template <class T>
+    static void MoveData(void* buffer, void* src)
+    {
+        new (buffer) T(std::move(*static_cast<T*>(src)));
+        static_cast<T*>(src)->~T();
+    }
+
+    // Function to delete data of type T
+    template <class T>
+    static void DeleteData(void* ptrToDelete)
+    {
+        if constexpr (IsInlineType<T>())
+            static_cast<T*>(ptrToDelete)->~T();
+        else
+            delete static_cast<T*>(ptrToDelete);
+    }
+
+    // Function to convert data of type T to string
+    template <class T>
+    static std::string DataToString(const void* ptrToPrint)
+    {
+        return ToString(*static_cast<const T*>(ptrToPrint));
+    }
+
+    // Function to get the number of bytes allocated by data of type T. Only the data itself and the characters of long strings are counted
+    template <class T>
+    static std::size_t DataAllocatedSize(const void* ptr)
+    {
+        std::size_t res = IsInlineType<T>() ? 0 : sizeof(T);
+
+        if constexpr (std::is_same<T, std::string>::value)
+        {
+            const std::string& str = *static_cast<const std::string*>(ptr);
+            if (str.capacity() > std::string().capacity())
+                res += str.capacity() + 1;
+        }
+
+        return res;
+    }
+
+    // Enables template overloads only for rvalues of types other than DataSaver, so lvalues are still copied by the const reference overloads
+    template <class T>
+    using EnableIfRvalue = typename std::enable_if<!std::is_reference<T>::value && !std::is_same<typename std::decay<T>::type, DataSaver>::value>::type;
+
+    // Save data of type T constructed from data inside DataSaver
+    template <class T, class U, class F>
+    void StoreData(U&& data, F&& customDeleteFunc)
+    {
+        // Clear data if it was data before
+        DeleteData();
+        CustomDeleteFunc = nullptr;
+
+        // Copy or move data to buffer or allocate new T type object if data is too big
+        if constexpr (IsInlineType<T>())
+            new (Buffer) T(std::forward<U>(data));
+        else
+            HeapPtr = static_cast<void*>(new T(std::forward<U>(data)));
+
+        // Set static data type saver for T type only after the data was constructed, so DataSaver stays empty if the constructor throws
+        DataType = GetDataTypeSaver<T>();
+
+        // Set custom delete function from dataSaver
+        CustomDeleteFunc = customDeleteFunc;
+    }
+
+    // Pointer to the data stored inside DataSaver
+    void* GetPtr();
+
+    // Const pointer to the data stored inside DataSaver
+    const void* GetPtr() const;
+
+    // Delete data without resetting custom delete function
+    void DeleteData();
+
 public:
+    /**
+        \brief Method for getting a static data type saver for type T
+
+        \tparam <T> Any type of data except for c arrays
+
+        \return pointer to the only data type saver for type T
+    */
+    template <class T>
+    static const DataTypeSaver* GetDataTypeSaver()
+    {
+        static const DataTypeSaver dataTypeSaver(typeid(T), IsInlineType<T>(), &CopyData<T>, &MoveData<T>, &DeleteData<T>, &DataToString<T>, &DataAllocatedSize<T>);
+        return &dataTypeSaver;
+    }
+
     /// Default constructor
     DataSaver();
 
@@ -87,6 +242,19 @@ public:
         SetData(data);
     }
 
+    /// \brief Move constructor
+    /// \param [in] dataSaver object to be moved. It will be empty after moving
+    DataSaver(DataSaver&& dataSaver) noexcept;
+
+    /// \brief A template constructor that accepts a temporary variable and moves it inside DataSaver
+    /// \tparam <T> Any type of data except for c arrays
+    /// \param [in] data data to be moved inside DataSaver
+    template<class T, class = EnableIfRvalue<T>>
+    DataSaver(T&& data)
+    {
+        SetData(std::forward<T>(data));
+    }
+
     /**
         \brief A template constructor that accepts a variable and a function to delete a variable
 
@@ -105,6 +273,21 @@ public:
         SetData(data, customDeleteFunc);
     }
 
+    /**
+        \brief A template constructor that accepts a temporary variable and a function to delete a variable
+
+        \tparam <T> Any type of data except for c arrays
+        \tparam <F> Function pointer or lambda function
+
+        \param [in] data data to be moved inside the class
+        \param [in] customDeleteFunc function to delete data
+    */ 
+    template<class T, class F, class = EnableIfRvalue<T>>
+    DataSaver(T&& data, F&& customDeleteFunc)
+    {
+        SetData(std::forward<T>(data), customDeleteFunc);
+    }
+
     /**
         \brief Assignment operator
         
@@ -112,6 +295,14 @@ public:
         \return returns a new object, with data from dataSaver
     */
     DataSaver& operator=(const DataSaver& dataSaver);
+
+    /**
+        \brief Move assignment operator
+
+        \param [in] dataSaver object to be moved. It will be empty after moving
+        \return returns this object, with data from dataSaver
+    */
+    DataSaver& operator=(DataSaver&& dataSaver) noexcept;
     
     /// \brief Template method to save data inside DataSaver
     /// \tparam <T> Any type of data except for c arrays
@@ -122,6 +313,15 @@ public:
         SetData(data, nullptr);
     }
 
+    /// \brief Template method to move temporary data inside DataSaver
+    /// \tparam <T> Any type of data except for c arrays
+    /// \param [in] data data to be moved inside the class
+    template <class T, class = EnableIfRvalue<T>>
+    void SetData(T&& data)
+    {   
+        SetData(std::forward<T>(data), nullptr);
+    }
+
     /**
         \brief Template method to save data and custom delete function inside DataSaver
 
@@ -134,43 +334,22 @@ public:
     template <class T, class F>
     void SetData(const T& data, F&& customDeleteFunc)
     {
-        // Clear Ptr if it was data before
-        if (Ptr != nullptr)
-            DeleteFunc(Ptr);
-
-        // Clear DataType if it was data before
-        if (DataType != nullptr)
-            delete DataType;
-
-        // Create new T type object and save it pointer like void ptr. Data from data will be copying using copy constructor
-        Ptr = static_cast<void*>(new T(data));
-
-        // Create new DataType object to save data type
-        DataType = new DataTypeSaver(typeid(data));
-
-        // Set new CopyFunc. It is get to void pointers and convert void pointers to T pointers and copy data.
-        CopyFunc = [](void*& dst, void* src)
-            {
-                // Convert src pointer to T pointer and get data from T pointer.
-                // Use T copy constructor to create T object.
-                // Allocate new memory to T type and convert it to void pointer.
-                dst = static_cast<void*>(new T(*static_cast<T*>(const_cast<void*>(src))));
-            };
-
-        // Set new DeleteFunc
-        DeleteFunc = [](void*& ptrToDelete)
-            {
-                delete static_cast<T*>(ptrToDelete);
-            };
-
-        // Set new to string function
-        ToStringFunc = [](void* ptrToPrint)
-            {
-                return ToString(*static_cast<T*>(ptrToPrint));
-            };
+        StoreData<T>(data, customDeleteFunc);
+    }
 
-        // Set custom delete function from dataSaver
-        CustomDeleteFunc = customDeleteFunc;
+    /**
+        \brief Template method to move temporary data and save custom delete function inside DataSaver
+
+        \tparam <T> Any type of data except for c arrays
+        \tparam <F> Function pointer or lambda function
+
+        \param [in] data data to be moved inside the class
+        \param [in] customDeleteFunc function to delete data
+    */
+    template <class T, class F, class = EnableIfRvalue<T>>
+    void SetData(T&& data, F&& customDeleteFunc)
+    {
+        StoreData<typename std::decay<T>::type>(std::forward<T>(data), customDeleteFunc);
     }
 
     /**
@@ -186,34 +365,61 @@ public:
     template <class T>
     bool GetData(T& data) const
     {
-        // Check data type stored in DataSaver
-        if (DataType != nullptr && DataType->GetDataType() != typeid(data))
+        // Check that was data inside DataSaver
+        if (DataType == nullptr)
+            return false;
+
+        // Check data type stored in DataSaver. Comparing pointers is enough in most cases, so type info is compared only if pointers are different
+        if (DataType != GetDataTypeSaver<T>() && DataType->GetDataType() != typeid(data))
         {
             std::cerr << "Wrong type! Was: " + std::string(DataType->GetDataType().name()) + " Requested: " + typeid(data).name() << std::endl;
             return false;
         }
 
-        // Check that was data inside Ptr
-        if (Ptr == nullptr)
-            return false;
-
-        // Copy data from Ptr to data
-        data = *static_cast<T*>(Ptr);
+        // Copy data from DataSaver to data
+        data = *static_cast<const T*>(GetPtr());
         return true;
     }
 
+    /**
+        \brief Template method to get a pointer to data inside DataSaver without copying it
+
+        \tparam <T> Any type of data except for c arrays
+
+        \return pointer to the data. It is valid until the data is changed. Returns nullptr if there was no data or they were of a different type
+    */
+    template <class T>
+    const T* GetDataPtr() const
+    {
+        if (DataType == nullptr || (DataType != GetDataTypeSaver<T>() && DataType->GetDataType() != typeid(T)))
+            return nullptr;
+
+        return static_cast<const T*>(GetPtr());
+    }
+
     /// \brief Resets the object to its initial state.
     /// If deleteFunc was set, it will be called
     void ResetData();
 
     /// \brief Swap data between 2 DataSavers
-    /// \param [in, out] dataSaver dataSaver from where the data will be copied to this and where the data from this will be written
+    /// Allocated data is not copied, only pointers are swapped. Inline data is moved
+    /// \param [in, out] dataSaver dataSaver from where the data will be moved to this and where the data from this will be written
     void Swap(DataSaver& dataSaver);
 
     /// \brief A method for getting a string that represents data inside a class object
     /// \return A string of data
     std::string Str() const;
 
+    /// \brief A method for getting the size of memory allocated by the data outside the DataSaver
+    /// Data of custom types is counted by its size only, and memory allocated by its members is not counted
+    /// \return number of allocated bytes. Returns 0 if the data is stored inline or there is no data
+    std::size_t GetAllocatedSize() const;
+
+    /// \brief A method for checking that two DataSavers store data of the same type
+    /// \param [in] dataSaver the DataSaver to compare with
+    /// \return returns true if both DataSavers store data of the same type, otherwise false. Empty DataSavers do not have a type
+    bool IsSameType(const DataSaver& dataSaver) const;
+
     /// Default destructor
     ~DataSaver();
 };
\ No newline at end of file
@@ -1,6 +1,198 @@
 #include "DataStorage.h"
 
-DataStorage::DataStorage() {}
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+DataStorage::DataStorage(MemoryPool* memoryPool)
+{
+    if (memoryPool == nullptr)
+        Pool = MemoryPool::Create();
+    else
+    {
+        Pool = memoryPool;
+        Pool->AddOwner();
+    }
+
+    LockFreeHashMapStructure.store(new DataStorageStructureHashMap);
+}
+
+void DataStorage::PublishHashMapStructure()
+{
+    // The copy only stores pointers to the hash maps, so it does not delete them
+    DataStorageStructureHashMap* oldHashMapStructure = LockFreeHashMapStructure.exchange(new DataStorageStructureHashMap(DataStorageHashMapStructure));
+    EpochManager::GetInstance().Retire(oldHashMapStructure);
+}
+
+void DataStorage::PreserveRecord(const DataStorageRecord* record) const
+{
+    for (auto& it : Views)
+    {
+        DataStorageView::Record* viewRecord = DataStorageView::FindRecord(*it, record->RecordId, record);
+
+        // Only the first change of the record is copied, since the view needs the data of the moment of its creation
+        if (viewRecord == nullptr || !DataStorageView::AcquireRecord(*viewRecord))
+            continue;
+
+        std::unique_ptr<DataHashMap> recordCopy(new DataHashMap);
+        DataStorageView::CopyRecord(*it, viewRecord - it->Records.get(), *recordCopy);
+        viewRecord->Copy = std::move(recordCopy);
+        ++it->PreservedRecordsCount;
+        viewRecord->Status.store(DataStorageView::CopiedRecord, std::memory_order_release);
+    }
+}
+
+void DataStorage::LockViewRecords(const std::string& removedKeyName) const
+{
+    for (auto& it : Views)
+    {
+        // Values of keys added after the view are not needed
+        bool isKeyInView = !removedKeyName.empty() && std::find(it->KeyNames.begin(), it->KeyNames.end(), removedKeyName) != it->KeyNames.end();
+
+        for (std::size_t i = 0; i < it->RecordIds.size(); ++i)
+        {
+            DataStorageView::Record& viewRecord = it->Records[i];
+            if (!DataStorageView::AcquireRecord(viewRecord) || !isKeyInView)
+                continue;
+
+            // The value of the key removed earlier is kept, since the key can be added again with another value
+            if (viewRecord.Copy == nullptr)
+                viewRecord.Copy.reset(new DataHashMap);
+
+            const DataSaver* value = it->RecordIds[i].second->GetDataSaver(removedKeyName);
+            if (value != nullptr && !viewRecord.Copy->IsData(removedKeyName))
+                viewRecord.Copy->AddDataFromDataSaver(removedKeyName, *value);
+        }
+    }
+}
+
+void DataStorage::UnlockViewRecords() const
+{
+    for (auto& it : Views)
+        for (std::size_t i = 0; i < it->RecordIds.size(); ++i)
+        {
+            // Records copied to the view before locking were not acquired
+            DataStorageView::Record& viewRecord = it->Records[i];
+            if (viewRecord.Status.load(std::memory_order_relaxed) == DataStorageView::ChangingRecord)
+                viewRecord.Status.store(DataStorageView::LiveRecord, std::memory_order_release);
+        }
+}
+
+void DataStorage::ReleaseView(DataStorageView::State* viewState) const
+{
+    // Writers do not use views under the read lock
+    RecursiveReadWriteMtx.ReadLock();
+
+    ViewsMtx.lock();
+    Views.erase(std::find(Views.begin(), Views.end(), viewState));
+    ViewsMtx.unlock();
+
+    RecursiveReadWriteMtx.ReadUnlock();
+}
+
+void DataStorage::PublishChange(DataStorageChangeType type, DataStorageRecord* record, const std::string& keyName, DataSaver&& oldValue) const
+{
+    if (ChangeFeeds.empty())
+        return;
+
+    DataStorageChange change;
+    change.Type = type;
+
+    if (record != nullptr)
+    {
+        change.RecordId = record->RecordId;
+
+        // Erased records can not be read
+        if (type != DataStorageChangeType::EraseRecordChange)
+            change.Record = DataStorageRecordRef(record, this);
+    }
+
+    if (type == DataStorageChangeType::SetDataChange)
+    {
+        change.KeyName = keyName;
+        change.OldValue = std::move(oldValue);
+
+        const DataSaver* newValue = record->GetDataSaver(keyName);
+        if (newValue != nullptr)
+            change.NewValue = *newValue;
+    }
+
+    // Each feed gets its own copy, and the last one gets the original
+    for (std::size_t i = 0; i + 1 < ChangeFeeds.size(); ++i)
+        ChangeFeeds[i]->Push(DataStorageChange(change));
+
+    ChangeFeeds.back()->Push(std::move(change));
+}
+
+void DataStorage::SaveOldValue(const DataStorageRecord* record, const std::string& keyName, DataSaver& oldValue) const
+{
+    if (ChangeFeeds.empty())
+        return;
+
+    const DataSaver* value = record->GetDataSaver(keyName);
+    if (value != nullptr)
+        oldValue = *value;
+}
+
+std::shared_ptr<DataStorageChangeFeed> DataStorage::Subscribe(std::size_t capacity)
+{
+    std::shared_ptr<DataStorageChangeFeed> res = std::make_shared<DataStorageChangeFeed>(capacity);
+
+    RecursiveReadWriteMtx.WriteLock();
+    ChangeFeeds.emplace_back(res);
+    RecursiveReadWriteMtx.WriteUnlock();
+
+    return res;
+}
+
+void DataStorage::Unsubscribe(const std::shared_ptr<DataStorageChangeFeed>& changeFeed)
+{
+    RecursiveReadWriteMtx.WriteLock();
+
+    auto f = std::find(ChangeFeeds.begin(), ChangeFeeds.end(), changeFeed);
+    if (f != ChangeFeeds.end())
+        ChangeFeeds.erase(f);
+
+    RecursiveReadWriteMtx.WriteUnlock();
+}
+
+DataStorageView DataStorage::Snapshot() const
+{
+    std::unique_ptr<DataStorageView::State> viewState(new DataStorageView::State);
+
+    // Writers are stopped only while pointers to records are copied and sorted. Readers are not stopped
+    RecursiveReadWriteMtx.ReadLock();
+
+    viewState->RecordIds.reserve(RecordsSet.size());
+    for (auto& it : RecordsSet)
+        viewState->RecordIds.emplace_back(it->RecordId, it);
+
+    // Writers find records of the view by their ids
+    std::sort(viewState->RecordIds.begin(), viewState->RecordIds.end());
+    viewState->Records.reset(new DataStorageView::Record[viewState->RecordIds.size()]);
+
+    for (auto it = RecordTemplate.cbegin(); it != RecordTemplate.cend(); ++it)
+        viewState->KeyNames.emplace_back(it->first);
+
+    viewState->NextRecordId = NextRecordId;
+
+    ViewsMtx.lock();
+    Views.emplace_back(viewState.get());
+    ViewsMtx.unlock();
+
+    RecursiveReadWriteMtx.ReadUnlock();
+
+    return DataStorageView(this, std::move(viewState));
+}
+
+void DataStorage::RetireRecord(DataStorageRecord* record)
+{
+    PreserveRecord(record);
+
+    // Refs to the record become invalid immediately, but lock-free readers can still read it, so it is deleted later
+    RecordSlotTable::GetInstance().Release(record->Handle);
+    EpochManager::GetInstance().Retire(record);
+}
 
 bool DataStorage::IsKeyExist(const std::string& keyName) const
 {
@@ -11,6 +203,115 @@ bool DataStorage::IsKeyExist(const std::string& keyName) const
     return res;
 }
 
+bool DataStorage::GetKeyIndexPolicy(const std::string& keyName, DataStorageIndexPolicy& indexPolicy) const
+{
+    bool res = false;
+    RecursiveReadWriteMtx.ReadLock();
+
+    auto f = KeyIndexPolicies.find(keyName);
+    if (f != KeyIndexPolicies.end())
+    {
+        indexPolicy = f->second;
+        res = true;
+    }
+
+    RecursiveReadWriteMtx.ReadUnlock();
+    return res;
+}
+
+bool DataStorage::AddPendingKeys(std::vector<PendingKey>& pendingKeys)
+{
+    std::vector<DataStorageRecord*> records;
+
+    // Build indices under the read lock, so that readers are not blocked. Indices of different keys are built in parallel threads
+    RecursiveReadWriteMtx.ReadLock();
+
+    records.assign(RecordsSet.begin(), RecordsSet.end());
+    std::size_t recordsSetVersion = RecordsSetVersion;
+
+    ParallelFor(pendingKeys.size(), 1, [&pendingKeys, &records](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+                pendingKeys[i].BuildIndices(records);
+        }
+    );
+
+    RecursiveReadWriteMtx.ReadUnlock();
+
+    RecursiveReadWriteMtx.WriteLock();
+
+    // Records were created or erased between the locks, so indices are built again
+    if (RecordsSetVersion != recordsSetVersion)
+    {
+        records.assign(RecordsSet.begin(), RecordsSet.end());
+
+        ParallelFor(pendingKeys.size(), 1, [&pendingKeys, &records](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                    pendingKeys[i].BuildIndices(records);
+            }
+        );
+    }
+
+    // All records get the default value, so unique keys are added only if it is not used by two records
+    std::size_t pendingKeysCount = pendingKeys.size();
+    if (records.size() + BatchRecords.size() > 1)
+        pendingKeys.erase(std::remove_if(pendingKeys.begin(), pendingKeys.end(), [](const PendingKey& pendingKey) { return pendingKey.IsUnique; }), pendingKeys.end());
+
+    // Views do not read records while new keys are added to them
+    LockViewRecords(std::string());
+
+    // Add keys with built indices
+    for (auto& it : pendingKeys)
+        it.Install();
+
+    // Set default values to all records and add places for positions inside new indices. Each record is changed by only one thread
+    std::size_t keyIndicesCount = KeyIndices.size();
+    ParallelFor(records.size(), MinRecordsPartSize, [&pendingKeys, &records, keyIndicesCount](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                for (auto& it : pendingKeys)
+                    records[i]->SetDataFromDataSaver(it.KeyName, it.DefaultKeyValue);
+
+                records[i]->IndexPositions.resize(keyIndicesCount);
+            }
+        }
+    );
+
+    // Store positions of records inside new indices. Each index changes only its own positions of records
+    std::vector<DataStorageKeyIndexBase*> newIndices;
+    for (auto& it : pendingKeys)
+    {
+        DataStorageKeyIndexBase* keyIndex = FindKeyIndex(it.KeyName);
+        if (keyIndex != nullptr)
+            newIndices.emplace_back(keyIndex);
+    }
+
+    ParallelFor(newIndices.size(), 1, [&newIndices](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+                newIndices[i]->UpdatePositions();
+        }
+    );
+
+    UnlockViewRecords();
+
+    // Records of the batch are added to indices by CommitBatch
+    for (auto& record : BatchRecords)
+        for (auto& it : pendingKeys)
+            record->SetDataFromDataSaver(it.KeyName, it.DefaultKeyValue);
+
+    // Make new keys available to lock-free readers
+    ++KeysVersion;
+    PublishHashMapStructure();
+
+    RecursiveReadWriteMtx.WriteUnlock();
+    WaitWalCommit();
+
+    return pendingKeys.size() == pendingKeysCount;
+}
+
 void DataStorage::RemoveKey(const std::string& keyName)
 {
     RecursiveReadWriteMtx.WriteLock();
@@ -20,70 +321,1256 @@ void DataStorage::RemoveKey(const std::string& keyName)
         return;
     }
 
+    // Views keep the values of the key in records, which are created before removing it
+    LockViewRecords(keyName);
+
     // Erase key from record template
     RecordTemplate.EraseData(keyName);
 
     // Erase key from DataStorageHashMapStructure
     DataStorageHashMapStructure.EraseData(keyName);
 
-    // Erase key from DataStorageMapStructure
-    DataStorageMapStructure.EraseData(keyName);
+    // Erase key from DataStorageMapStructure
+    DataStorageMapStructure.EraseData(keyName);
+
+    // Composite indices with the key can not be built without it
+    std::vector<std::string> compositeIndexNames;
+    for (auto& it : CompositeIndexIds)
+        if (static_cast<const DataStorageCompositeIndex*>(KeyIndices[it.second])->IsKeyUsed(keyName))
+            compositeIndexNames.emplace_back(it.first);
+
+    for (auto& it : compositeIndexNames)
+    {
+        auto compositeIndexId = CompositeIndexIds.find(it);
+        std::size_t id = compositeIndexId->second;
+        CompositeIndexIds.erase(compositeIndexId);
+        EraseKeyIndex(id);
+    }
+
+    // Delete the index of the key
+    auto keyIndexId = KeyIndexIds.find(keyName);
+    if (keyIndexId != KeyIndexIds.end())
+    {
+        std::size_t id = keyIndexId->second;
+        KeyIndexIds.erase(keyIndexId);
+        EraseKeyIndex(id);
+    }
+
+    // Erase key from all maps
+    DataStorageKeySnapshotFuncs.erase(keyName);
+    DataStorageKeyCsvParsers.erase(keyName);
+    KeyIndexPolicies.erase(keyName);
+
+    // Erase key data from all records
+    for (auto& it : RecordsSet)
+        it->EraseData(keyName);
+
+    UnlockViewRecords();
+
+    for (auto& it : BatchRecords)
+        it->EraseData(keyName);
+
+    // Remove key from lock-free readers
+    ++KeysVersion;
+    PublishHashMapStructure();
+
+    // Write the removal to the write-ahead log
+    if (Wal.load(std::memory_order_relaxed) != nullptr)
+    {
+        std::string entry;
+        DataStorageSnapshotCodec<std::uint8_t>::Save(DataStorageWalEntryType::RemoveKeyEntry, entry);
+        DataStorageSnapshotCodec<std::string>::Save(keyName, entry);
+        LogWalEntry(entry);
+    }
+    
+    RecursiveReadWriteMtx.WriteUnlock();
+    WaitWalCommit();
+}
+
+void DataStorage::EraseKeyIndex(std::size_t id)
+{
+    // Move the last index to the place of the deleted one
+    std::size_t lastId = KeyIndices.size() - 1;
+    delete KeyIndices[id];
+
+    if (id != lastId)
+    {
+        KeyIndices[id] = KeyIndices.back();
+        KeyIndices[id]->SetId(id);
+
+        // The moved index is either the index of a key or a composite index
+        auto keyIndexId = KeyIndexIds.find(KeyIndices[id]->GetKeyName());
+        if (keyIndexId != KeyIndexIds.end() && keyIndexId->second == lastId)
+            keyIndexId->second = id;
+        else
+            CompositeIndexIds[KeyIndices[id]->GetKeyName()] = id;
+    }
+
+    KeyIndices.pop_back();
+
+    // Positions of records are moved the same way. Records of the batch and records of keys being added can have fewer positions
+    auto movePositions = [id, lastId](DataStorageRecord* record)
+        {
+            std::vector<DataStorageIndexPosition>& positions = record->IndexPositions;
+            if (lastId < positions.size())
+            {
+                positions[id] = positions[lastId];
+                positions.pop_back();
+            }
+        };
+
+    for (auto& it : RecordsSet)
+        movePositions(it);
+
+    for (auto& it : BatchRecords)
+        movePositions(it);
+}
+
+std::string DataStorage::GetCompositeIndexName(const std::vector<std::string>& keyNames)
+{
+    std::string res;
+    for (auto& it : keyNames)
+        DataStorageSnapshotCodec<std::string>::Save(it, res);
+
+    return res;
+}
+
+bool DataStorage::AddCompositeIndex(const std::vector<std::string>& keyNames, DataStorageIndexPolicy indexPolicy)
+{
+    // The index of one key is maintained by SetKey
+    if (keyNames.size() < 2 || !(indexPolicy & (DataStorageIndexPolicy::HashAndOrderedIndex | DataStorageIndexPolicy::FlatHashIndex)))
+        return false;
+
+    RecursiveReadWriteMtx.WriteLock();
+
+    // Values of the keys are saved the same way as in snapshots
+    std::vector<std::function<void(const DataStorageRecord* record, std::string& out)>> saveValueFuncs;
+    for (auto& it : keyNames)
+    {
+        auto f = DataStorageKeySnapshotFuncs.find(it);
+        if (f == DataStorageKeySnapshotFuncs.end() || std::count(keyNames.begin(), keyNames.end(), it) != 1)
+        {
+            RecursiveReadWriteMtx.WriteUnlock();
+            return false;
+        }
+
+        saveValueFuncs.emplace_back(f->second.SaveValue);
+    }
+
+    // If the index was added earlier, then it must be deleted
+    std::string indexName = GetCompositeIndexName(keyNames);
+    auto compositeIndexId = CompositeIndexIds.find(indexName);
+    if (compositeIndexId != CompositeIndexIds.end())
+    {
+        std::size_t id = compositeIndexId->second;
+        CompositeIndexIds.erase(compositeIndexId);
+        EraseKeyIndex(id);
+    }
+
+    // The flat hash index replaces the hash index
+    ConcurrentHashMultiMap<std::string, DataStorageRecord*>* hashMap = nullptr;
+    ConcurrentFlatHashMultiMap<std::string, DataStorageRecord*>* flatHashMap = nullptr;
+    if (indexPolicy & DataStorageIndexPolicy::FlatHashIndex)
+        flatHashMap = new ConcurrentFlatHashMultiMap<std::string, DataStorageRecord*>(Pool);
+    else if (indexPolicy & DataStorageIndexPolicy::HashIndex)
+        hashMap = new ConcurrentHashMultiMap<std::string, DataStorageRecord*>(Pool);
+
+    DataStorageOrderedIndex<std::string>* map = nullptr;
+    if (indexPolicy & DataStorageIndexPolicy::OrderedIndex)
+        map = new DataStorageOrderedIndex<std::string>(PoolAllocator<std::pair<const std::string, DataStorageRecord*>>(Pool));
+
+    DataStorageCompositeIndex* compositeIndex = new DataStorageCompositeIndex(indexName, keyNames, saveValueFuncs, hashMap, flatHashMap, map);
+    CompositeIndexIds[indexName] = KeyIndices.size();
+    compositeIndex->SetId(KeyIndices.size());
+    KeyIndices.emplace_back(compositeIndex);
+
+    // Add all records to the new index in one pass. Records of the batch are added by CommitBatch
+    std::vector<DataStorageRecord*> records(RecordsSet.begin(), RecordsSet.end());
+    for (auto& it : records)
+        it->IndexPositions.resize(KeyIndices.size());
+
+    compositeIndex->BulkInsert(records);
+
+    // Write the index to the write-ahead log
+    if (Wal.load(std::memory_order_relaxed) != nullptr)
+    {
+        std::string entry;
+        DataStorageSnapshotCodec<std::uint8_t>::Save(DataStorageWalEntryType::AddCompositeIndexEntry, entry);
+        DataStorageSnapshotCodec<std::uint64_t>::Save(keyNames.size(), entry);
+        for (auto& it : keyNames)
+            DataStorageSnapshotCodec<std::string>::Save(it, entry);
+        DataStorageSnapshotCodec<std::uint32_t>::Save(indexPolicy, entry);
+        LogWalEntry(entry);
+    }
+
+    RecursiveReadWriteMtx.WriteUnlock();
+    WaitWalCommit();
+    return true;
+}
+
+void DataStorage::RemoveCompositeIndex(const std::vector<std::string>& keyNames)
+{
+    RecursiveReadWriteMtx.WriteLock();
+
+    auto compositeIndexId = CompositeIndexIds.find(GetCompositeIndexName(keyNames));
+    if (compositeIndexId == CompositeIndexIds.end())
+    {
+        RecursiveReadWriteMtx.WriteUnlock();
+        return;
+    }
+
+    std::size_t id = compositeIndexId->second;
+    CompositeIndexIds.erase(compositeIndexId);
+    EraseKeyIndex(id);
+
+    // Write the removal to the write-ahead log
+    if (Wal.load(std::memory_order_relaxed) != nullptr)
+    {
+        std::string entry;
+        DataStorageSnapshotCodec<std::uint8_t>::Save(DataStorageWalEntryType::RemoveCompositeIndexEntry, entry);
+        DataStorageSnapshotCodec<std::uint64_t>::Save(keyNames.size(), entry);
+        for (auto& it : keyNames)
+            DataStorageSnapshotCodec<std::string>::Save(it, entry);
+        LogWalEntry(entry);
+    }
+
+    RecursiveReadWriteMtx.WriteUnlock();
+    WaitWalCommit();
+}
+
+void DataStorage::EraseFromCompositeIndices(DataStorageRecord* record, const std::string& keyName, std::vector<DataStorageKeyIndexBase*>& compositeIndices) const
+{
+    for (auto& it : CompositeIndexIds)
+    {
+        DataStorageKeyIndexBase* compositeIndex = KeyIndices[it.second];
+        if (static_cast<const DataStorageCompositeIndex*>(compositeIndex)->IsKeyUsed(keyName) &&
+            std::find(compositeIndices.begin(), compositeIndices.end(), compositeIndex) == compositeIndices.end())
+        {
+            compositeIndex->Erase(record);
+            compositeIndices.emplace_back(compositeIndex);
+        }
+    }
+}
+
+DataStorageKeyIndexBase* DataStorage::FindKeyIndex(const std::string& keyName) const
+{
+    auto f = KeyIndexIds.find(keyName);
+    if (f == KeyIndexIds.end())
+        return nullptr;
+
+    return KeyIndices[f->second];
+}
+
+DataStorageRecordRef DataStorage::AddRecord(DataStorageRecord* newRecord)
+{
+    // Records loaded from snapshots and the write-ahead log already have ids
+    if (newRecord->RecordId == 0)
+        newRecord->RecordId = NextRecordId++;
+
+    // Records of the batch are added to indices by CommitBatch
+    if (IsBatchActive)
+    {
+        BatchRecords.emplace_back(newRecord);
+        return DataStorageRecordRef();
+    }
+
+    // Check that the values of unique keys are not used by other records
+    for (auto& it : KeyIndices)
+    {
+        if (it->IsUnique() && !it->IsUniqueValueFree(newRecord))
+        {
+            delete newRecord;
+            return DataStorageRecordRef();
+        }
+    }
+
+    // Add new record to set
+    RecordsSet.emplace(newRecord);
+    ++RecordsSetVersion;
+
+    // Add new record to the indices of all keys
+    newRecord->IndexPositions.resize(KeyIndices.size());
+    for (auto& it : KeyIndices)
+        it->Insert(newRecord);
+
+    AddToEvictionRing(newRecord);
+
+    LogCreateRecord(newRecord);
+    PublishChange(DataStorageChangeType::CreateRecordChange, newRecord);
+
+    return DataStorageRecordRef(newRecord, this);
+}
+
+DataStorageRecordRef DataStorage::CreateRecord()
+{
+    LatencyTimer timer(GetStatsHistogram(Stats.CreateRecord));
+
+    RecursiveReadWriteMtx.WriteLock();
+
+    // Create new record
+    DataStorageRecordRef res = AddRecord(new (Pool) DataStorageRecord(RecordTemplate));
+    EraseExpiredRecordsLocked(ExpiredRecordsPerCreation);
+    EvictRecords();
+
+    RecursiveReadWriteMtx.WriteUnlock();
+    WaitWalCommit();
+
+    return res;
+}
+
+DataStorageRecordRef DataStorage::CreateRecord(const std::vector<std::pair<std::string, DataSaver>>& params)
+{
+    LatencyTimer timer(GetStatsHistogram(Stats.CreateRecord));
+
+    RecursiveReadWriteMtx.WriteLock();
+
+    // Create new record
+    DataStorageRecord* newData = new (Pool) DataStorageRecord(RecordTemplate);
+    
+    // Copy data from function parametrs
+    for (auto& it : params)
+        if (newData->IsData(it.first))
+            newData->SetDataFromDataSaver(it.first, it.second);
+
+    DataStorageRecordRef res = AddRecord(newData);
+    EraseExpiredRecordsLocked(ExpiredRecordsPerCreation);
+    EvictRecords();
+
+    RecursiveReadWriteMtx.WriteUnlock();
+    WaitWalCommit();
+
+    return res;
+}
+
+DataStorageRecordRef DataStorage::CreateRecord(std::vector<std::pair<std::string, DataSaver>>&& params)
+{
+    LatencyTimer timer(GetStatsHistogram(Stats.CreateRecord));
+
+    RecursiveReadWriteMtx.WriteLock();
+
+    // Create new record
+    DataStorageRecord* newData = new (Pool) DataStorageRecord(RecordTemplate);
+    
+    // Move data from function parametrs
+    for (auto& it : params)
+        if (newData->IsData(it.first))
+            newData->SetDataFromDataSaver(it.first, std::move(it.second));
+
+    DataStorageRecordRef res = AddRecord(newData);
+    EraseExpiredRecordsLocked(ExpiredRecordsPerCreation);
+    EvictRecords();
+
+    RecursiveReadWriteMtx.WriteUnlock();
+    WaitWalCommit();
+
+    return res;
+}
+
+void DataStorage::BeginBatch(std::size_t expectedRecordsCount)
+{
+    RecursiveReadWriteMtx.WriteLock();
+
+    IsBatchActive = true;
+    BatchRecords.reserve(BatchRecords.size() + expectedRecordsCount);
+
+    RecursiveReadWriteMtx.WriteUnlock();
+}
+
+std::size_t DataStorage::CommitBatch(bool isParallel)
+{
+    RecursiveReadWriteMtx.WriteLock();
+
+    IsBatchActive = false;
+
+    // Records that passed the check of unique keys
+    std::vector<DataStorageRecord*> newRecords;
+
+    // Indices of unique keys are filled one by one, and indices of other keys are filled in one pass
+    std::vector<DataStorageKeyIndexBase*> uniqueIndices, bulkIndices;
+    for (auto& it : KeyIndices)
+    {
+        if (it->IsUnique())
+            uniqueIndices.emplace_back(it);
+        else
+            bulkIndices.emplace_back(it);
+    }
+
+    // Add places for positions of records inside indices
+    for (auto& it : BatchRecords)
+        it->IndexPositions.resize(KeyIndices.size());
+
+    if (uniqueIndices.empty())
+        newRecords.swap(BatchRecords);
+    else
+    {
+        newRecords.reserve(BatchRecords.size());
+
+        // Values of unique keys must be checked against the previous records, so indices of unique keys are filled one by one
+        for (auto& record : BatchRecords)
+        {
+            bool isUnique = true;
+            for (auto& it : uniqueIndices)
+            {
+                if (!it->IsUniqueValueFree(record))
+                {
+                    isUnique = false;
+                    break;
+                }
+            }
+
+            if (!isUnique)
+            {
+                delete record;
+                continue;
+            }
+
+            for (auto& it : uniqueIndices)
+                it->Insert(record);
+
+            newRecords.emplace_back(record);
+        }
+
+        BatchRecords.clear();
+    }
+
+    // Add records to set
+    RecordsSet.reserve(RecordsSet.size() + newRecords.size());
+    for (auto& it : newRecords)
+    {
+        RecordsSet.emplace(it);
+        AddToEvictionRing(it);
+    }
+
+    ++RecordsSetVersion;
+
+    if (Wal.load(std::memory_order_relaxed) != nullptr)
+        for (auto& it : newRecords)
+            LogCreateRecord(it);
+
+    if (!ChangeFeeds.empty())
+        for (auto& it : newRecords)
+            PublishChange(DataStorageChangeType::CreateRecordChange, it);
+
+    if (isParallel)
+    {
+        // Indices of different keys do not share data, so each of them can be filled in its own thread
+        ParallelFor(bulkIndices.size(), 1, [&bulkIndices, &newRecords](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                    bulkIndices[i]->BulkInsert(newRecords);
+            }
+        );
+    }
+    else
+    {
+        for (auto& it : bulkIndices)
+            it->BulkInsert(newRecords);
+    }
+
+    EvictRecords();
+
+    RecursiveReadWriteMtx.WriteUnlock();
+    WaitWalCommit();
+
+    return newRecords.size();
+}
+
+std::size_t DataStorage::BulkLoad(std::vector<std::vector<std::pair<std::string, DataSaver>>>&& records, bool isParallel)
+{
+    RecursiveReadWriteMtx.WriteLock();
+
+    BeginBatch(records.size());
+
+    for (auto& it : records)
+        CreateRecord(std::move(it));
+
+    std::size_t res = CommitBatch(isParallel);
+
+    RecursiveReadWriteMtx.WriteUnlock();
+    return res;
+}
+
+std::optional<std::size_t> DataStorage::ImportCsv(const std::string& path, bool isParallel, std::size_t chunkSize, DataStorageCsvError* error)
+{
+    DataStorageSnapshotFile file;
+    if (!file.Open(path))
+    {
+        if (error != nullptr)
+            *error = DataStorageCsvError();
+
+        return std::nullopt;
+    }
+
+    const char* ptr = file.GetData();
+    const char* dataEnd = ptr + file.GetSize();
+
+    // Skip UTF-8 byte order mark
+    if (dataEnd - ptr >= 3 && std::memcmp(ptr, "\xEF\xBB\xBF", 3) == 0)
+        ptr += 3;
+
+    // The first line contains names of keys
+    std::vector<std::pair<const char*, const char*>> keyNames;
+    std::vector<std::string> unescapedKeyNames;
+    DataStorageCsvParser::ParseLine(ptr, dataEnd, keyNames, unescapedKeyNames);
+
+    std::vector<std::pair<const char*, const char*>> chunks = DataStorageCsvParser::SplitChunks(ptr, dataEnd, chunkSize);
+
+    // Each chunk is parsed by one thread to its own vector of records, so the records keep the order of lines
+    std::vector<std::vector<DataStorageRecord*>> chunksRecords(chunks.size());
+
+    // Numbers of lines of chunks and positions of the first errors inside them. Lines of the failed chunk are counted only up to the error
+    std::vector<std::size_t> chunksLinesCounts(chunks.size());
+    std::vector<std::size_t> chunksErrorColumns(chunks.size());
+
+    // Parse all chunks to records with keys of the template. Returns false if a field can not be parsed
+    auto parse = [&](const DataStorageRecord& recordTemplate, const std::vector<std::function<bool(const char* begin, const char* end, DataStorageRecord* record)>>& columnParsers)
+        {
+            ParallelFor(chunks.size(), isParallel ? 1 : std::max<std::size_t>(chunks.size(), 1), [&](std::size_t begin, std::size_t end)
+                {
+                    std::vector<std::pair<const char*, const char*>> fields;
+                    std::vector<std::string> unescapedFields;
+
+                    for (std::size_t i = begin; i < end; ++i)
+                    {
+                        chunksLinesCounts[i] = 0;
+                        chunksErrorColumns[i] = 0;
+
+                        const char* linePtr = chunks[i].first;
+                        while (linePtr != chunks[i].second && chunksErrorColumns[i] == 0)
+                        {
+                            DataStorageCsvParser::ParseLine(linePtr, chunks[i].second, fields, unescapedFields);
+                            ++chunksLinesCounts[i];
+
+                            // Skip empty lines
+                            if (fields.size() == 1 && fields[0].first == fields[0].second)
+                                continue;
+
+                            DataStorageRecord* newRecord = new (Pool) DataStorageRecord(recordTemplate);
+                            chunksRecords[i].emplace_back(newRecord);
+
+                            // Empty fields keep default values
+                            for (std::size_t j = 0; j < fields.size() && j < columnParsers.size(); ++j)
+                                if (columnParsers[j] && fields[j].first != fields[j].second && !columnParsers[j](fields[j].first, fields[j].second, newRecord))
+                                {
+                                    chunksErrorColumns[i] = j + 1;
+                                    break;
+                                }
+                        }
+                    }
+                }
+            );
+
+            for (std::size_t i = 0; i < chunks.size(); ++i)
+                if (chunksErrorColumns[i] != 0)
+                    return false;
+
+            return true;
+        };
+
+    // Parsers of columns. Empty for columns that are skipped. They are copied with the record template, so that records are parsed without the lock
+    auto getColumnParsers = [this, &keyNames]()
+        {
+            std::vector<std::function<bool(const char* begin, const char* end, DataStorageRecord* record)>> res;
+            for (auto& it : keyNames)
+            {
+                auto f = DataStorageKeyCsvParsers.find(std::string(it.first, it.second));
+                res.emplace_back(f != DataStorageKeyCsvParsers.end() ? f->second : nullptr);
+            }
+
+            return res;
+        };
+
+    auto deleteRecords = [&chunksRecords]()
+        {
+            for (auto& chunkRecords : chunksRecords)
+            {
+                for (auto& it : chunkRecords)
+                    delete it;
+
+                chunkRecords.clear();
+            }
+        };
+
+    RecursiveReadWriteMtx.ReadLock();
+    DataStorageRecord recordTemplateCopy(RecordTemplate);
+    auto columnParsers = getColumnParsers();
+    std::size_t keysVersion = KeysVersion;
+    RecursiveReadWriteMtx.ReadUnlock();
+
+    bool isParsed = parse(recordTemplateCopy, columnParsers);
+
+    RecursiveReadWriteMtx.WriteLock();
+
+    // Keys were changed while parsing, so records are parsed again with the new keys
+    if (isParsed && KeysVersion != keysVersion)
+    {
+        deleteRecords();
+        isParsed = parse(RecordTemplate, getColumnParsers());
+    }
+
+    if (!isParsed)
+    {
+        RecursiveReadWriteMtx.WriteUnlock();
+        deleteRecords();
+
+        if (error != nullptr)
+        {
+            // The first line contains names of keys
+            error->Line = 1;
+            for (std::size_t i = 0; i < chunks.size(); ++i)
+            {
+                error->Line += chunksLinesCounts[i];
+                if (chunksErrorColumns[i] != 0)
+                {
+                    error->Column = chunksErrorColumns[i];
+                    break;
+                }
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    // Add records to the batch
+    bool isBatchActive = IsBatchActive;
+    IsBatchActive = true;
+
+    std::size_t res = 0;
+    for (auto& it : chunksRecords)
+        res += it.size();
+
+    BatchRecords.reserve(BatchRecords.size() + res);
+    for (auto& chunkRecords : chunksRecords)
+    {
+        for (auto& it : chunkRecords)
+        {
+            it->RecordId = NextRecordId++;
+            BatchRecords.emplace_back(it);
+        }
+    }
+
+    // Records are added to indices by the batch started by the user
+    if (!isBatchActive)
+        res = CommitBatch(isParallel);
+
+    RecursiveReadWriteMtx.WriteUnlock();
+    return res;
+}
+
+bool DataStorage::SaveSnapshot(const std::string& path) const
+{
+    // The snapshot is written to the temporary file and replaces the previous one only when it is complete
+    std::string tmpPath = path + ".tmp";
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        return false;
+
+    RecursiveReadWriteMtx.ReadLock();
+
+    // All columns store values of records in the same order
+    std::vector<DataStorageRecord*> records(RecordsSet.begin(), RecordsSet.end());
+
+    // Write the header with the number of records and keys and the LSN of the last change included in the snapshot
+    DataStorageWal* wal = Wal.load(std::memory_order_relaxed);
+    std::string header(SnapshotSignature, sizeof(SnapshotSignature) - 1);
+    DataStorageSnapshotCodec<std::uint64_t>::Save(records.size(), header);
+    DataStorageSnapshotCodec<std::uint64_t>::Save(DataStorageKeySnapshotFuncs.size(), header);
+    DataStorageSnapshotCodec<std::uint64_t>::Save(wal != nullptr ? wal->GetLastLsn() : WalLsn, header);
+    file.write(header.data(), header.size());
+
+    // Write ids of records
+    std::string column;
+    for (auto& it : records)
+        DataStorageSnapshotCodec<std::uint64_t>::Save(it->RecordId, column);
+    file.write(column.data(), column.size());
+
+    // Write each key as the name, the type name, the size of the column and the column with values of all records
+    for (auto& it : DataStorageKeySnapshotFuncs)
+    {
+        column.clear();
+        it.second.Save(records, column);
+
+        header.clear();
+        DataStorageSnapshotCodec<std::string>::Save(it.first, header);
+        DataStorageSnapshotCodec<std::string>::Save(it.second.TypeName, header);
+        DataStorageSnapshotCodec<std::uint64_t>::Save(column.size(), header);
+
+        file.write(header.data(), header.size());
+        file.write(column.data(), column.size());
+    }
+
+    RecursiveReadWriteMtx.ReadUnlock();
+
+    file.close();
+    if (!file)
+    {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+
+#if defined(_WIN32)
+    // std::rename does not replace existing files on Windows
+    std::remove(path.c_str());
+#endif
+
+    return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+bool DataStorage::LoadSnapshot(const std::string& path, bool isParallel, std::size_t* skippedColumnsCount)
+{
+    // Saved column of one key
+    struct SnapshotColumn
+    {
+        std::string KeyName;
+        std::string TypeName;
+        const char* Begin;
+        const char* End;
+    };
+
+    DataStorageSnapshotFile file;
+    if (!file.Open(path))
+        return false;
+
+    const char* ptr = file.GetData();
+    const char* dataEnd = ptr + file.GetSize();
+
+    // Check the header
+    std::size_t signatureSize = sizeof(SnapshotSignature) - 1;
+    if (static_cast<std::size_t>(dataEnd - ptr) < signatureSize || std::memcmp(ptr, SnapshotSignature, signatureSize) != 0)
+        return false;
+    ptr += signatureSize;
+
+    std::uint64_t recordsCount, keysCount, walLsn;
+    if (!DataStorageSnapshotCodec<std::uint64_t>::Load(ptr, dataEnd, recordsCount) || !DataStorageSnapshotCodec<std::uint64_t>::Load(ptr, dataEnd, keysCount) ||
+        !DataStorageSnapshotCodec<std::uint64_t>::Load(ptr, dataEnd, walLsn))
+        return false;
+
+    // Ids of records
+    if (static_cast<std::uint64_t>(dataEnd - ptr) / sizeof(std::uint64_t) < recordsCount)
+        return false;
+
+    const char* idsPtr = ptr;
+    const char* idsEnd = ptr + recordsCount * sizeof(std::uint64_t);
+    ptr = idsEnd;
+
+    // Find columns of all keys before changing the DataStorage
+    std::vector<SnapshotColumn> columns;
+    for (std::uint64_t i = 0; i < keysCount; ++i)
+    {
+        SnapshotColumn column;
+        std::uint64_t columnSize;
+        if (!DataStorageSnapshotCodec<std::string>::Load(ptr, dataEnd, column.KeyName) || !DataStorageSnapshotCodec<std::string>::Load(ptr, dataEnd, column.TypeName) ||
+            !DataStorageSnapshotCodec<std::uint64_t>::Load(ptr, dataEnd, columnSize) || static_cast<std::uint64_t>(dataEnd - ptr) < columnSize)
+            return false;
+
+        column.Begin = ptr;
+        column.End = ptr + columnSize;
+        ptr = column.End;
+        columns.emplace_back(std::move(column));
+    }
+
+    if (ptr != dataEnd)
+        return false;
+
+    RecursiveReadWriteMtx.WriteLock();
+
+    // Loaded records would not be written to the log, and the records of the active batch would be dropped
+    if (Wal.load(std::memory_order_relaxed) != nullptr || IsBatchActive)
+    {
+        RecursiveReadWriteMtx.WriteUnlock();
+        return false;
+    }
+
+    // Columns to be loaded to the keys of the DataStorage
+    std::vector<std::pair<const KeySnapshotFuncs*, const SnapshotColumn*>> loadedColumns;
+    for (auto& it : columns)
+    {
+        auto f = DataStorageKeySnapshotFuncs.find(it.KeyName);
+        if (f != DataStorageKeySnapshotFuncs.end() && f->second.TypeName == it.TypeName)
+            loadedColumns.emplace_back(&f->second, &it);
+    }
+
+    // Columns of unknown keys and keys of other types are skipped only if the caller counts them
+    if (loadedColumns.size() != columns.size() && skippedColumnsCount == nullptr)
+    {
+        RecursiveReadWriteMtx.WriteUnlock();
+        return false;
+    }
+
+    // Create records with default values
+    std::vector<DataStorageRecord*> records;
+    records.reserve(recordsCount);
+    for (std::uint64_t i = 0; i < recordsCount; ++i)
+    {
+        records.emplace_back(new (Pool) DataStorageRecord(RecordTemplate));
+        DataStorageSnapshotCodec<std::uint64_t>::Load(idsPtr, idsEnd, records.back()->RecordId);
+    }
+
+    // Set values of the keys. Different keys are stored in different values of records, so they can be loaded in parallel threads
+    std::vector<char> isColumnLoaded(loadedColumns.size(), false);
+    ParallelFor(loadedColumns.size(), isParallel ? 1 : std::max<std::size_t>(loadedColumns.size(), 1), [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+                isColumnLoaded[i] = loadedColumns[i].first->Load(loadedColumns[i].second->Begin, loadedColumns[i].second->End, records);
+        }
+    );
+
+    if (std::find(isColumnLoaded.begin(), isColumnLoaded.end(), false) != isColumnLoaded.end())
+    {
+        for (auto& it : records)
+            delete it;
+
+        RecursiveReadWriteMtx.WriteUnlock();
+        return false;
+    }
+
+    // Replace the records and build indices in one pass
+    DropData();
+    BatchRecords.swap(records);
+    CommitBatch(isParallel);
+
+    if (skippedColumnsCount != nullptr)
+        *skippedColumnsCount = columns.size() - loadedColumns.size();
+
+    // Continue ids and LSN after the snapshot
+    WalLsn = walLsn;
+    NextRecordId = 1;
+    for (auto& it : RecordsSet)
+        NextRecordId = std::max(NextRecordId, it->RecordId + 1);
+
+    RecursiveReadWriteMtx.WriteUnlock();
+    return true;
+}
+
+void DataStorage::LogWalEntry(const std::string& entry) const
+{
+    if (Wal.load(std::memory_order_relaxed) == nullptr)
+        return;
+
+    // Entries are appended only under the write lock, including changes by DataStorageRecordRef::SetData, so the log can not be disabled meanwhile.
+    // The log still locks its own mutex, since its commit thread and WaitWalCommit use the buffer without the lock of the DataStorage
+    Wal.load(std::memory_order_relaxed)->Append(entry);
+}
+
+void DataStorage::LogCreateRecord(const DataStorageRecord* record) const
+{
+    if (Wal.load(std::memory_order_relaxed) == nullptr)
+        return;
+
+    // The id of the record and the names and values of all keys
+    std::string entry;
+    DataStorageSnapshotCodec<std::uint8_t>::Save(DataStorageWalEntryType::CreateRecordEntry, entry);
+    DataStorageSnapshotCodec<std::uint64_t>::Save(record->RecordId, entry);
+    DataStorageSnapshotCodec<std::uint64_t>::Save(DataStorageKeySnapshotFuncs.size(), entry);
+
+    for (auto& it : DataStorageKeySnapshotFuncs)
+    {
+        DataStorageSnapshotCodec<std::string>::Save(it.first, entry);
+        it.second.SaveValue(record, entry);
+    }
+
+    LogWalEntry(entry);
+}
+
+void DataStorage::LogSetData(const DataStorageRecord* record, const std::string& keyName) const
+{
+    if (Wal.load(std::memory_order_relaxed) == nullptr)
+        return;
+
+    auto f = DataStorageKeySnapshotFuncs.find(keyName);
+    if (f != DataStorageKeySnapshotFuncs.end())
+    {
+        std::string entry;
+        DataStorageSnapshotCodec<std::uint8_t>::Save(DataStorageWalEntryType::SetDataEntry, entry);
+        DataStorageSnapshotCodec<std::uint64_t>::Save(record->RecordId, entry);
+        DataStorageSnapshotCodec<std::string>::Save(keyName, entry);
+        f->second.SaveValue(record, entry);
+        LogWalEntry(entry);
+    }
+}
+
+void DataStorage::WaitWalCommit() const
+{
+    if (Wal.load(std::memory_order_relaxed) == nullptr)
+        return;
+
+    EpochGuard epochGuard;
+    DataStorageWal* wal = Wal.load(std::memory_order_acquire);
+
+    // All entries are written together, so waiting for the last one is not longer than waiting for the own entry
+    if (wal != nullptr && wal->GetSettings().IsSyncCommit)
+        wal->WaitForCommit(wal->GetLastLsn());
+}
+
+bool DataStorage::ApplyWalEntry(const char* ptr, const char* end, std::unordered_map<std::uint64_t, DataStorageRecord*>& records)
+{
+    std::uint8_t entryType;
+    std::uint64_t recordId;
+    std::string keyName;
+
+    if (!DataStorageSnapshotCodec<std::uint8_t>::Load(ptr, end, entryType))
+        return false;
+
+    switch (entryType)
+    {
+    case DataStorageWalEntryType::CreateRecordEntry:
+    {
+        std::uint64_t valuesCount;
+        if (!DataStorageSnapshotCodec<std::uint64_t>::Load(ptr, end, recordId) || !DataStorageSnapshotCodec<std::uint64_t>::Load(ptr, end, valuesCount))
+            return false;
+
+        // Set saved values to the new record
+        DataStorageRecord* newRecord = new (Pool) DataStorageRecord(RecordTemplate);
+        newRecord->RecordId = recordId;
+
+        for (std::uint64_t i = 0; i < valuesCount; ++i)
+        {
+            DataSaver value;
+            if (!DataStorageSnapshotCodec<std::string>::Load(ptr, end, keyName))
+            {
+                delete newRecord;
+                return false;
+            }
+
+            auto f = DataStorageKeySnapshotFuncs.find(keyName);
+            if (f == DataStorageKeySnapshotFuncs.end() || !f->second.LoadValue(ptr, end, value))
+            {
+                delete newRecord;
+                return false;
+            }
+
+            newRecord->SetDataFromDataSaver(keyName, std::move(value));
+        }
+
+        NextRecordId = std::max(NextRecordId, recordId + 1);
+        if (AddRecord(newRecord).IsValid())
+            records[recordId] = newRecord;
+
+        return ptr == end;
+    }
+    case DataStorageWalEntryType::EraseRecordEntry:
+    {
+        if (!DataStorageSnapshotCodec<std::uint64_t>::Load(ptr, end, recordId))
+            return false;
+
+        auto f = records.find(recordId);
+        if (f != records.end())
+        {
+            EraseRecord(DataStorageRecordRef(f->second, this));
+            records.erase(f);
+        }
+
+        return ptr == end;
+    }
+    case DataStorageWalEntryType::SetDataEntry:
+    {
+        DataSaver value;
+        if (!DataStorageSnapshotCodec<std::uint64_t>::Load(ptr, end, recordId) || !DataStorageSnapshotCodec<std::string>::Load(ptr, end, keyName))
+            return false;
+
+        auto funcs = DataStorageKeySnapshotFuncs.find(keyName);
+        if (funcs == DataStorageKeySnapshotFuncs.end() || !funcs->second.LoadValue(ptr, end, value))
+            return false;
+
+        // The record is moved in indices of the key to the new value
+        auto f = records.find(recordId);
+        if (f != records.end())
+        {
+            PreserveRecord(f->second);
+
+            std::vector<DataStorageKeyIndexBase*> compositeIndices;
+            EraseFromCompositeIndices(f->second, keyName, compositeIndices);
+
+            DataSaver oldValue;
+            SaveOldValue(f->second, keyName, oldValue);
+
+            DataStorageKeyIndexBase* keyIndex = FindKeyIndex(keyName);
+            if (keyIndex != nullptr)
+                keyIndex->Update(f->second, value);
+            else
+                f->second->SetDataFromDataSaver(keyName, std::move(value));
+
+            for (auto& it : compositeIndices)
+                it->Insert(f->second);
+
+            PublishChange(DataStorageChangeType::SetDataChange, f->second, keyName, std::move(oldValue));
+        }
+
+        return ptr == end;
+    }
+    case DataStorageWalEntryType::AddKeyEntry:
+    {
+        std::string typeName;
+        std::uint32_t indexPolicy;
+        if (!DataStorageSnapshotCodec<std::string>::Load(ptr, end, keyName) || !DataStorageSnapshotCodec<std::string>::Load(ptr, end, typeName) ||
+            !DataStorageSnapshotCodec<std::uint32_t>::Load(ptr, end, indexPolicy))
+            return false;
+
+        // The type of the key must be known, since the key is created by the template function
+        auto installer = KeyTypeInstallers.find(typeName);
+        if (installer == KeyTypeInstallers.end() || !installer->second(keyName, static_cast<DataStorageIndexPolicy>(indexPolicy), ptr, end))
+            return false;
+
+        return ptr == end;
+    }
+    case DataStorageWalEntryType::RemoveKeyEntry:
+    {
+        if (!DataStorageSnapshotCodec<std::string>::Load(ptr, end, keyName))
+            return false;
+
+        RemoveKey(keyName);
+        return ptr == end;
+    }
+    case DataStorageWalEntryType::AddCompositeIndexEntry:
+    case DataStorageWalEntryType::RemoveCompositeIndexEntry:
+    {
+        std::uint64_t keysCount;
+        std::vector<std::string> keyNames;
+        if (!DataStorageSnapshotCodec<std::uint64_t>::Load(ptr, end, keysCount))
+            return false;
+
+        for (std::uint64_t i = 0; i < keysCount; ++i)
+        {
+            if (!DataStorageSnapshotCodec<std::string>::Load(ptr, end, keyName))
+                return false;
+
+            keyNames.emplace_back(std::move(keyName));
+        }
+
+        if (entryType == DataStorageWalEntryType::RemoveCompositeIndexEntry)
+        {
+            RemoveCompositeIndex(keyNames);
+            return ptr == end;
+        }
+
+        std::uint32_t indexPolicy;
+        if (!DataStorageSnapshotCodec<std::uint32_t>::Load(ptr, end, indexPolicy) || !AddCompositeIndex(keyNames, static_cast<DataStorageIndexPolicy>(indexPolicy)))
+            return false;
+
+        return ptr == end;
+    }
+    case DataStorageWalEntryType::DropDataEntry:
+        DropData();
+        records.clear();
+        return ptr == end;
+    case DataStorageWalEntryType::DropDataStorageEntry:
+        DropDataStorage();
+        records.clear();
+        return ptr == end;
+    default:
+        return false;
+    }
+}
+
+bool DataStorage::EnableWal(const std::string& path, const DataStorageWalSettings& settings)
+{
+    RecursiveReadWriteMtx.WriteLock();
+
+    DisableWal();
+
+    // LSN of new entries continues after the loaded snapshot and the replayed log
+    DataStorageWal* wal = new DataStorageWal;
+    if (!wal->Open(path, settings, WalLsn))
+    {
+        delete wal;
+        RecursiveReadWriteMtx.WriteUnlock();
+        return false;
+    }
+
+    Wal.store(wal, std::memory_order_release);
+
+    RecursiveReadWriteMtx.WriteUnlock();
+    return true;
+}
+
+void DataStorage::DisableWal()
+{
+    RecursiveReadWriteMtx.WriteLock();
+
+    DataStorageWal* wal = Wal.exchange(nullptr);
+    if (wal != nullptr)
+    {
+        WalLsn = wal->GetLastLsn();
+
+        // Threads inside WaitWalCommit wait for the log after unlocking the DataStorage, so it is deleted using EpochManager
+        wal->Close();
+        EpochManager::GetInstance().Retire(wal);
+    }
+
+    RecursiveReadWriteMtx.WriteUnlock();
+}
+
+bool DataStorage::ReplayWal(const std::string& path)
+{
+    RecursiveReadWriteMtx.WriteLock();
+
+    // Applied changes would be written to the log again
+    if (Wal.load(std::memory_order_relaxed) != nullptr)
+    {
+        RecursiveReadWriteMtx.WriteUnlock();
+        return false;
+    }
+
+    // Records are found by ids in entries
+    std::unordered_map<std::uint64_t, DataStorageRecord*> records;
+    records.reserve(RecordsSet.size());
+    for (auto& it : RecordsSet)
+        records.emplace(it->RecordId, it);
+
+    bool isApplied = true;
+    std::size_t validSize;
+    bool isRead = DataStorageWal::Read(path, [this, &records, &isApplied](std::uint64_t lsn, const char* begin, const char* end)
+        {
+            // The entry is already included in the snapshot
+            if (lsn <= WalLsn)
+                return true;
 
-    // Erase key from all maps
-    DataStorageRecordAdders.erase(keyName);
-    DataStorageRecordClearers.erase(keyName);
-    DataStorageRecordErasers.erase(keyName);
+            isApplied = ApplyWalEntry(begin, end, records);
+            if (isApplied)
+                WalLsn = lsn;
+
+            return isApplied;
+        },
+        validSize
+    );
 
-    // Erase key data from all records
-    for (auto& it : RecordsSet)
-        it->EraseData(keyName);
-    
     RecursiveReadWriteMtx.WriteUnlock();
+    return isRead && isApplied;
 }
 
-DataStorageRecordRef DataStorage::CreateRecord()
+bool DataStorage::Checkpoint(const std::string& snapshotPath)
 {
     RecursiveReadWriteMtx.WriteLock();
 
-    // Create new record
-    DataStorageRecord* newData = new DataStorageRecord(RecordTemplate);
-    // Add new record to set
-    RecordsSet.emplace(newData);
-
-    // Add new record to every maps inside DataStorageStructureHashMap
-    for (auto& it : DataStorageRecordAdders)
-        it.second(newData);
+    // All entries of the log are included in the snapshot, so they are not needed
+    bool res = SaveSnapshot(snapshotPath);
 
-    DataStorageRecordRef res(newData, &DataStorageHashMapStructure, &DataStorageMapStructure);
+    DataStorageWal* wal = Wal.load(std::memory_order_relaxed);
+    if (res && wal != nullptr)
+        res = wal->Clear();
 
     RecursiveReadWriteMtx.WriteUnlock();
-
     return res;
 }
 
-DataStorageRecordRef DataStorage::CreateRecord(const std::vector<std::pair<std::string, DataSaver>>& params)
+bool DataStorage::FlushWal()
 {
-    RecursiveReadWriteMtx.WriteLock();
+    EpochGuard epochGuard;
+    DataStorageWal* wal = Wal.load(std::memory_order_acquire);
+    return wal == nullptr || wal->Flush();
+}
 
-    // Create new record
-    DataStorageRecord* newData = new DataStorageRecord(RecordTemplate);
-    
-    // Copy data from function parametrs
-    for (auto& it : params)
-        if (newData->IsData(it.first))
-            newData->SetDataFromDataSaver(it.first, it.second);
+std::vector<std::size_t> DataStorage::GetWalCommitWaitHistogram() const
+{
+    EpochGuard epochGuard;
+    DataStorageWal* wal = Wal.load(std::memory_order_acquire);
+    if (wal == nullptr)
+        return std::vector<std::size_t>();
 
-    // Add new record to set
-    RecordsSet.emplace(newData);
+    return wal->GetCommitWaitHistogram();
+}
 
+void DataStorage::ForEachRecordPtr(const DataStorageQuery& query, const std::function<bool(DataStorageRecord* record)>& func) const
+{
+    // Without requests all records satisfy the query
+    if (query.Predicates.empty())
+    {
+        for (auto& it : RecordsSet)
+            if (!func(it))
+                break;
 
-    // Add new record to every maps inside DataStorageStructureHashMap
-    for (auto& it : DataStorageRecordAdders)
-        it.second(newData);
-    
-    DataStorageRecordRef res(newData, &DataStorageHashMapStructure, &DataStorageMapStructure);
+        return;
+    }
 
-    RecursiveReadWriteMtx.WriteUnlock();
+    // Find the request with the least number of candidates. Counting of each next request stops at the best count
+    std::size_t bestPredicateIndex = 0;
+    std::size_t bestCount = RecordsSet.size() + 1;
+
+    // Composite indices are checked first, since they usually have the least number of candidates
+    const DataStorageCompositeIndex* bestCompositeIndex = nullptr;
+    std::string bestCompositeValue, compositeValue;
+
+    for (auto& it : CompositeIndexIds)
+    {
+        const DataStorageCompositeIndex* compositeIndex = static_cast<const DataStorageCompositeIndex*>(KeyIndices[it.second]);
+
+        // The index can be used only if all its keys have Equal requests
+        compositeValue.clear();
+        if (!query.SaveEqualValues(compositeIndex->GetKeyNames(), compositeValue))
+            continue;
+
+        std::size_t count = compositeIndex->CountEqual(compositeValue, bestCount);
+        if (count < bestCount)
+        {
+            bestCount = count;
+            bestCompositeIndex = compositeIndex;
+            bestCompositeValue.swap(compositeValue);
+        }
+
+        // No records satisfy the query
+        if (bestCount == 0)
+            return;
+    }
+
+    for (std::size_t i = 0; i < query.Predicates.size(); ++i)
+    {
+        std::size_t count = query.Predicates[i].CountFunc(*this, bestCount);
+        if (count < bestCount)
+        {
+            bestCount = count;
+            bestPredicateIndex = i;
+            bestCompositeIndex = nullptr;
+        }
+
+        // No records satisfy the query
+        if (bestCount == 0)
+            return;
+    }
+
+    // Iterate over the candidates of the composite index. All requests are checked, since the index compares saved bytes of values
+    if (bestCompositeIndex != nullptr)
+    {
+        bestCompositeIndex->ForEachEqual(bestCompositeValue, [&query, &func](DataStorageRecord* record)
+            {
+                for (auto& it : query.Predicates)
+                    if (!it.MatchFunc(record))
+                        return true;
+
+                return func(record);
+            }
+        );
+
+        return;
+    }
+
+    // Iterate over the candidates of the best request and check the remaining requests on each of them
+    query.Predicates[bestPredicateIndex].ForEachFunc(*this, [&query, &func, bestPredicateIndex](DataStorageRecord* record)
+        {
+            for (std::size_t i = 0; i < query.Predicates.size(); ++i)
+                if (i != bestPredicateIndex && !query.Predicates[i].MatchFunc(record))
+                    return true;
+
+            return func(record);
+        }
+    );
+}
+
+DataStorageRecordSet DataStorage::GetRecords(const DataStorageQuery& query) const
+{
+    DataStorageRecordSet res;
+    ForEachRecord(query, [&res](const DataStorageRecordRef& recordRef) { res.AddNewRecord(recordRef); });
+    return res;
+}
+
+DataStorageRecordRef DataStorage::GetRecord(const DataStorageQuery& query) const
+{
+    DataStorageRecordRef res;
+    ForEachRecord(query, [&res](const DataStorageRecordRef& recordRef)
+        {
+            res = recordRef;
+            return false;
+        }
+    );
 
     return res;
 }
@@ -110,58 +1597,236 @@ void DataStorage::DropDataStorage()
     DataStorageMapStructure.Clear();
 
 
+    // Delete indices of all keys
+    for (auto& it : KeyIndices)
+        delete it;
+
+    KeyIndices.clear();
+    KeyIndexIds.clear();
+    CompositeIndexIds.clear();
+
     // Clear all maps with functions
-    DataStorageRecordAdders.clear();
-    DataStorageRecordClearers.clear();
-    DataStorageRecordErasers.clear();
+    DataStorageKeySnapshotFuncs.clear();
+    DataStorageKeyCsvParsers.clear();
+    KeyIndexPolicies.clear();
 
     // Delete all Records
     for (auto& it : RecordsSet)
-        delete it;
+        RetireRecord(it);
 
     // Clear RecordsSet
     RecordsSet.clear();
+    ++RecordsSetVersion;
+
+    // Limits of records are kept, but there are no records to expire or evict
+    ExpiryQueue.clear();
+    EvictionRing.clear();
+    EvictionHand = 0;
+    CountedRecordsBytes = 0;
+
+    // Records of the batch were never available to readers, so they are deleted immediately
+    for (auto& it : BatchRecords)
+        delete it;
+
+    BatchRecords.clear();
+
+    // Remove all keys from lock-free readers
+    ++KeysVersion;
+    PublishHashMapStructure();
+
+    if (Wal.load(std::memory_order_relaxed) != nullptr)
+        LogWalEntry(std::string(1, static_cast<char>(DataStorageWalEntryType::DropDataStorageEntry)));
+
+    PublishChange(DataStorageChangeType::DropDataStorageChange, nullptr);
 
     RecursiveReadWriteMtx.WriteUnlock();
+    WaitWalCommit();
 }
 
 void DataStorage::DropData()
 {
     RecursiveReadWriteMtx.WriteLock();
 
-    // Call functions to clear DataStorageHashMapStructure without
-    for (auto& it : DataStorageRecordClearers)
-        it.second();
+    // Clear indices of all keys
+    for (auto& it : KeyIndices)
+        it->Clear();
 
     // Delete all Records
     for (auto& it : RecordsSet)
-        delete it;
+        RetireRecord(it);
 
     // Clear RecordsSet
     RecordsSet.clear();
+    ++RecordsSetVersion;
+
+    // Limits of records are kept, but there are no records to expire or evict
+    ExpiryQueue.clear();
+    EvictionRing.clear();
+    EvictionHand = 0;
+    CountedRecordsBytes = 0;
+
+    // Records of the batch were never available to readers, so they are deleted immediately
+    for (auto& it : BatchRecords)
+        delete it;
+
+    BatchRecords.clear();
+
+    if (Wal.load(std::memory_order_relaxed) != nullptr)
+        LogWalEntry(std::string(1, static_cast<char>(DataStorageWalEntryType::DropDataEntry)));
+
+    PublishChange(DataStorageChangeType::DropDataChange, nullptr);
 
     RecursiveReadWriteMtx.WriteUnlock();
+    WaitWalCommit();
 }
 
 void DataStorage::EraseRecord(const DataStorageRecordRef& recordRefToErase)
 {
+    LatencyTimer timer(GetStatsHistogram(Stats.EraseRecord));
+
     RecursiveReadWriteMtx.WriteLock();
 
-    if (RecordsSet.count(recordRefToErase.DataRecord) == 0)
+    // The memory of the deleted record can be reused by a new record, so the handle is checked first
+    if (!recordRefToErase.IsValid() || RecordsSet.count(recordRefToErase.DataRecord) == 0)
     {
         RecursiveReadWriteMtx.WriteUnlock();
         return;
     }
 
-    // Get pointer to record from record ref
-    DataStorageRecord* tmpRec = recordRefToErase.DataRecord;
-    // Iterate over all DataStorageRecordErasers and call function to erase record from structure
-    for (auto& erasers : DataStorageRecordErasers)
-        erasers.second(tmpRec);
+    EraseRecordPtr(recordRefToErase.DataRecord);
+
+    RecursiveReadWriteMtx.WriteUnlock();
+    WaitWalCommit();
+}
+
+void DataStorage::EraseRecordPtr(DataStorageRecord* record)
+{
+    // Erase record from indices of all keys
+    for (auto& it : KeyIndices)
+        it->Erase(record);
+
+    RecordsSet.erase(record);
+    ++RecordsSetVersion;
+
+    // Write the erasure to the write-ahead log
+    if (Wal.load(std::memory_order_relaxed) != nullptr)
+    {
+        std::string entry;
+        DataStorageSnapshotCodec<std::uint8_t>::Save(DataStorageWalEntryType::EraseRecordEntry, entry);
+        DataStorageSnapshotCodec<std::uint64_t>::Save(record->RecordId, entry);
+        LogWalEntry(entry);
+    }
+
+    PublishChange(DataStorageChangeType::EraseRecordChange, record);
+
+    EraseFromExpiryQueue(record);
+    EraseFromEvictionRing(record);
+
+    RetireRecord(record);
+}
+
+void DataStorage::SetShardKeyName(const std::string& keyName)
+{
+    RecursiveReadWriteMtx.WriteLock();
+    ShardKeyName = keyName;
+    RecursiveReadWriteMtx.WriteUnlock();
+}
+
+bool DataStorage::LockRecordChange() const
+{
+    // The read lock can not be changed to the write lock, and changing the record under it would race with other readers
+    if (RecursiveReadWriteMtx.IsOnlyReadLocked())
+        return false;
+
+    RecursiveReadWriteMtx.WriteLock();
+    return true;
+}
 
-    RecordsSet.erase(tmpRec);
-    delete tmpRec;
+void DataStorage::UnlockRecordChange() const
+{
     RecursiveReadWriteMtx.WriteUnlock();
+    WaitWalCommit();
+}
+
+template <class Params>
+bool DataStorage::UpdateRecordData(const DataStorageRecordRef& recordRef, Params&& params)
+{
+    LatencyTimer timer(GetStatsHistogram(Stats.SetData));
+
+    if (!LockRecordChange())
+        return false;
+
+    // The handle is checked before using the record, since the record can be already deleted
+    if (!recordRef.IsValid())
+    {
+        UnlockRecordChange();
+        return false;
+    }
+
+    DataStorageRecord* record = recordRef.DataRecord;
+
+    // Check all values before changing, so that the record is not changed partially. The key must exist and have the type of the value
+    std::vector<DataStorageKeyIndexBase*> keyIndices(params.size(), nullptr);
+    for (std::size_t i = 0; i < params.size(); ++i)
+    {
+        // The shard key can not be changed, since the record would stay in the shard of the old value
+        const DataSaver* defaultKeyValue = RecordTemplate.GetDataSaver(params[i].first);
+        if (defaultKeyValue == nullptr || !defaultKeyValue->IsSameType(params[i].second) || params[i].first == ShardKeyName)
+        {
+            UnlockRecordChange();
+            return false;
+        }
+
+        keyIndices[i] = FindKeyIndex(params[i].first);
+        if (keyIndices[i] != nullptr && !keyIndices[i]->IsUpdatePossible(record, params[i].second))
+        {
+            UnlockRecordChange();
+            return false;
+        }
+    }
+
+    PreserveRecord(record);
+
+    // The record is erased from composite indices with the changed keys once and added back after all changes
+    std::vector<DataStorageKeyIndexBase*> compositeIndices;
+    if (!CompositeIndexIds.empty())
+        for (auto& it : params)
+            EraseFromCompositeIndices(record, it.first, compositeIndices);
+
+    for (std::size_t i = 0; i < params.size(); ++i)
+    {
+        DataSaver oldValue;
+        SaveOldValue(record, params[i].first, oldValue);
+
+        // Keys without indices are only changed inside the record
+        if (keyIndices[i] != nullptr)
+            keyIndices[i]->Update(record, params[i].second);
+        else if constexpr (std::is_rvalue_reference<Params&&>::value)
+            record->SetDataFromDataSaver(params[i].first, std::move(params[i].second));
+        else
+            record->SetDataFromDataSaver(params[i].first, params[i].second);
+
+        LogSetData(record, params[i].first);
+        PublishChange(DataStorageChangeType::SetDataChange, record, params[i].first, std::move(oldValue));
+    }
+
+    for (auto& it : compositeIndices)
+        it->Insert(record);
+
+    UpdateCountedBytes(record);
+
+    UnlockRecordChange();
+    return true;
+}
+
+bool DataStorage::UpdateRecord(const DataStorageRecordRef& recordRef, const std::vector<std::pair<std::string, DataSaver>>& params)
+{
+    return UpdateRecordData(recordRef, params);
+}
+
+bool DataStorage::UpdateRecord(const DataStorageRecordRef& recordRef, std::vector<std::pair<std::string, DataSaver>>&& params)
+{
+    return UpdateRecordData(recordRef, std::move(params));
 }
 
 std::size_t DataStorage::Size() const
@@ -173,8 +1838,264 @@ std::size_t DataStorage::Size() const
     return res;
 }
 
+void DataStorage::SetStatsEnabled(bool isEnabled)
+{
+    IsStatsCollected.store(isEnabled);
+    RecursiveReadWriteMtx.SetStats(isEnabled ? &Stats.Lock : nullptr);
+}
+
+bool DataStorage::IsStatsEnabled() const
+{
+    return IsStatsCollected.load();
+}
+
+const DataStorageStats& DataStorage::GetStats() const
+{
+    return Stats;
+}
+
+void DataStorage::ResetStats()
+{
+    Stats.Reset();
+}
+
+std::vector<DataStorageKeyStats> DataStorage::GetKeyStats() const
+{
+    std::vector<DataStorageKeyStats> res;
+
+    // The sizes of the indices are changed only by writers, see ConcurrentHashMultiMap::Size, so the read lock is enough to read them
+    RecursiveReadWriteMtx.ReadLock();
+
+    res.reserve(KeyIndexPolicies.size());
+    for (auto& it : KeyIndexPolicies)
+    {
+        DataStorageKeyStats keyStats;
+        keyStats.KeyName = it.first;
+        keyStats.IndexPolicy = it.second;
+
+        auto keyIndexId = KeyIndexIds.find(it.first);
+        if (keyIndexId != KeyIndexIds.end())
+            KeyIndices[keyIndexId->second]->GetStats(keyStats);
+
+        res.emplace_back(std::move(keyStats));
+    }
+
+    RecursiveReadWriteMtx.ReadUnlock();
+
+    return res;
+}
+
+void DataStorage::AddRecordMemory(const DataStorageRecord* record, DataStorageMemoryStats& memoryStats)
+{
+    // Node of std::unordered_map with the key and its value: the pair, the pointer to the next node, the cached hash and the bucket
+    constexpr std::size_t keyNodeSize = sizeof(std::pair<const std::string, DataSaver>) + 3 * sizeof(void*);
+    static const std::size_t inlineStringCapacity = std::string().capacity();
+
+    memoryStats.RecordsBytes += sizeof(DataStorageRecord) + record->IndexPositions.capacity() * sizeof(DataStorageIndexPosition);
+
+    for (auto it = record->cbegin(); it != record->cend(); ++it)
+    {
+        memoryStats.RecordsBytes += keyNodeSize;
+        if (it->first.capacity() > inlineStringCapacity)
+            memoryStats.RecordsBytes += it->first.capacity() + 1;
+
+        memoryStats.PayloadBytes += it->second.GetAllocatedSize();
+    }
+}
+
+DataStorageMemoryStats DataStorage::GetMemoryStats() const
+{
+    DataStorageMemoryStats res;
+
+    RecursiveReadWriteMtx.ReadLock();
+
+    res.RecordsCount = RecordsSet.size();
+    for (auto& it : RecordsSet)
+        AddRecordMemory(it, res);
+
+    RecursiveReadWriteMtx.ReadUnlock();
+
+    return res;
+}
+
+bool DataStorage::SetRecordTimeToLive(const DataStorageRecordRef& recordRef, std::chrono::steady_clock::duration timeToLive)
+{
+    RecursiveReadWriteMtx.WriteLock();
+
+    // Records of the active batch are not in RecordsSet, and their refs are invalid
+    if (!recordRef.IsValid() || RecordsSet.count(recordRef.DataRecord) == 0)
+    {
+        RecursiveReadWriteMtx.WriteUnlock();
+        return false;
+    }
+
+    DataStorageRecord* record = recordRef.DataRecord;
+    EraseFromExpiryQueue(record);
+
+    if (timeToLive > std::chrono::steady_clock::duration::zero())
+    {
+        // Zero means that the record does not expire, so it is never used as the expiry time
+        std::int64_t expiryTime = std::max<std::int64_t>(GetSteadyTime() + std::chrono::duration_cast<std::chrono::nanoseconds>(timeToLive).count(), 1);
+        record->ExpiryTime.store(expiryTime, std::memory_order_relaxed);
+        ExpiryQueue.emplace(expiryTime, record);
+    }
+
+    RecursiveReadWriteMtx.WriteUnlock();
+    return true;
+}
+
+std::size_t DataStorage::EraseExpiredRecords(std::size_t maxRecordsCount)
+{
+    RecursiveReadWriteMtx.WriteLock();
+    std::size_t res = EraseExpiredRecordsLocked(maxRecordsCount);
+    RecursiveReadWriteMtx.WriteUnlock();
+    WaitWalCommit();
+
+    return res;
+}
+
+void DataStorage::SetCapacity(std::size_t maxRecordsCount, std::size_t maxBytes)
+{
+    RecursiveReadWriteMtx.WriteLock();
+
+    MaxRecordsCount = maxRecordsCount;
+    MaxRecordsBytes = maxBytes;
+    IsCapacityLimited.store(maxRecordsCount != 0 || maxBytes != 0);
+
+    // The ring is built again, since the memory of records is counted only if it is limited
+    EvictionRing.clear();
+    EvictionHand = 0;
+    CountedRecordsBytes = 0;
+
+    EvictionRing.reserve(RecordsSet.size());
+    for (auto& it : RecordsSet)
+        AddToEvictionRing(it);
+
+    EvictRecords();
+
+    RecursiveReadWriteMtx.WriteUnlock();
+    WaitWalCommit();
+}
+
+void DataStorage::AddToEvictionRing(DataStorageRecord* record)
+{
+    if (!IsCapacityLimited.load(std::memory_order_relaxed))
+        return;
+
+    // The new record gets the second chance, so it is not evicted before the records created earlier
+    record->IsRecentlyUsed.store(true, std::memory_order_relaxed);
+    record->EvictionPosition = EvictionRing.size();
+    EvictionRing.emplace_back(record);
+
+    if (MaxRecordsBytes != 0)
+    {
+        DataStorageMemoryStats memoryStats;
+        AddRecordMemory(record, memoryStats);
+        record->CountedBytes = memoryStats.RecordsBytes + memoryStats.PayloadBytes;
+        CountedRecordsBytes += record->CountedBytes;
+    }
+}
+
+void DataStorage::EraseFromEvictionRing(DataStorageRecord* record)
+{
+    if (!IsCapacityLimited.load(std::memory_order_relaxed))
+        return;
+
+    // The last record takes the place of the erased one, so the hand checks it next
+    DataStorageRecord* lastRecord = EvictionRing.back();
+    EvictionRing[record->EvictionPosition] = lastRecord;
+    lastRecord->EvictionPosition = record->EvictionPosition;
+    EvictionRing.pop_back();
+
+    if (MaxRecordsBytes != 0)
+        CountedRecordsBytes -= record->CountedBytes;
+}
+
+void DataStorage::EraseFromExpiryQueue(DataStorageRecord* record)
+{
+    std::int64_t expiryTime = record->ExpiryTime.load(std::memory_order_relaxed);
+    if (expiryTime == 0)
+        return;
+
+    auto range = ExpiryQueue.equal_range(expiryTime);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second == record)
+        {
+            ExpiryQueue.erase(it);
+            break;
+        }
+    }
+
+    record->ExpiryTime.store(0, std::memory_order_relaxed);
+}
+
+void DataStorage::UpdateCountedBytes(DataStorageRecord* record) const
+{
+    if (MaxRecordsBytes == 0 || !IsCapacityLimited.load(std::memory_order_relaxed))
+        return;
+
+    DataStorageMemoryStats memoryStats;
+    AddRecordMemory(record, memoryStats);
+
+    std::size_t countedBytes = memoryStats.RecordsBytes + memoryStats.PayloadBytes;
+    CountedRecordsBytes += countedBytes;
+    CountedRecordsBytes -= record->CountedBytes;
+    record->CountedBytes = countedBytes;
+}
+
+std::size_t DataStorage::EraseExpiredRecordsLocked(std::size_t maxRecordsCount)
+{
+    if (ExpiryQueue.empty())
+        return 0;
+
+    // The queue is ordered by the expiry time, so only expired records are visited
+    std::int64_t now = GetSteadyTime();
+    std::size_t res = 0;
+    while (res < maxRecordsCount && !ExpiryQueue.empty() && ExpiryQueue.begin()->first <= now)
+    {
+        EraseRecordPtr(ExpiryQueue.begin()->second);
+        ++res;
+    }
+
+    return res;
+}
+
+void DataStorage::EvictRecords()
+{
+    // Number of records passed by the hand since the last eviction. After a full pass all records are evicted without the second chance,
+    // so readers that keep marking records can not stop the eviction
+    std::size_t passedRecordsCount = 0;
+
+    while (!EvictionRing.empty() && ((MaxRecordsCount != 0 && RecordsSet.size() > MaxRecordsCount) ||
+        (MaxRecordsBytes != 0 && CountedRecordsBytes > MaxRecordsBytes)))
+    {
+        if (EvictionHand >= EvictionRing.size())
+            EvictionHand = 0;
+
+        DataStorageRecord* record = EvictionRing[EvictionHand];
+        if (passedRecordsCount < EvictionRing.size() && record->IsRecentlyUsed.load(std::memory_order_relaxed))
+        {
+            record->IsRecentlyUsed.store(false, std::memory_order_relaxed);
+            ++EvictionHand;
+            ++passedRecordsCount;
+            continue;
+        }
+
+        EraseRecordPtr(record);
+        passedRecordsCount = 0;
+    }
+}
+
 DataStorage::~DataStorage()
 {
+    // Write all entries of the write-ahead log to the disk
+    delete Wal.load();
+
+    // Delete indices of all keys. The hash and ordered indices are deleted with DataStorage structures
+    for (auto& it : KeyIndices)
+        delete it;
+
     // Clear DataStorageHashMapStructure
     for (auto& it : DataStorageHashMapStructure)
         it.second.ResetData();
@@ -186,4 +2107,13 @@ DataStorage::~DataStorage()
     // Clear all records
     for (auto& it : RecordsSet)
         delete it;
+
+    for (auto& it : BatchRecords)
+        delete it;
+
+    // There are no readers at the moment of destruction, so the copy can be deleted immediately
+    delete LockFreeHashMapStructure.load();
+
+    // The pool is deleted when retired indices are deleted
+    Pool->ReleaseOwner();
 }
\ No newline at end of file
@@ -1,14 +1,62 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
 #include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <typeinfo>
 #include <vector>
 
 #include "DataStorageClasses.h"
 #include "DataSaver.h"
-#include "SmartPointerWrapper.h"
 #include "DataContainer.h"
 #include "DataStorageRecord.h"
+#include "DataStorageKeyIndex.h"
+#include "DataStorageCompositeIndex.h"
+#include "DataStorageRecordSet.h"
+#include "DataStorageRequests.h"
+#include "DataStorageQuery.h"
+#include "DataStorageView.h"
+#include "DataStorageChangeFeed.h"
+#include "DataStorageCsv.h"
+#include "DataStorageSnapshot.h"
+#include "DataStorageWal.h"
+#include "DataStorageStats.h"
 #include "ReadWriteMutex.h"
+#include "EpochManager.h"
+#include "ConcurrentHashMultiMap.h"
+#include "ConcurrentFlatHashMultiMap.h"
+#include "ParallelFor.h"
+
+/**
+    \brief Description of the key for DataStorage::AddKeys
+
+    \tparam <T> Any type of data except for c arrays
+*/
+template <class T>
+struct DataStorageKey
+{
+    /// Name of the key
+    std::string KeyName;
+
+    /// Default value of the key
+    T DefaultKeyValue;
+
+    /// Indices to maintain for the key, see DataStorage::SetKey
+    DataStorageIndexPolicy IndexPolicy;
+
+    /// \brief Constructor
+    /// \param [in] keyName name of the key
+    /// \param [in] defaultKeyValue default value of the key
+    /// \param [in] indexPolicy indices to maintain for the key
+    DataStorageKey(const std::string& keyName, const T& defaultKeyValue, DataStorageIndexPolicy indexPolicy = DataStorageIndexPolicy::HashAndOrderedIndex) :
+        KeyName(keyName), DefaultKeyValue(defaultKeyValue), IndexPolicy(indexPolicy) {}
+};
 
 /**
     \brief A class for storing data with the ability to quickly search for a variety of different keys of any type
@@ -20,6 +68,9 @@
     key to the DataStorage, data will be added to this template entry. When creating new records, they will be copied from this template record.
     Each record is unique, but the key values can be the same for many records.
     To work with records inside the DataStorage, the DataStorageRecordRef is used. You can use it to change the values of records inside the DataStorage.
+
+    GetRecord does not lock the DataStorage. The hash indices are ConcurrentHashMultiMap's or ConcurrentFlatHashMultiMap's,
+    and erased records and indices are deleted using EpochManager only after all readers that could see them have left.
 */
 class DataStorage
 {
@@ -32,7 +83,7 @@ private:
         A simple typedef for HashMap. It is necessary for a more understandable separation of types.
         Represents the internal structure of the DataStorage.
         A string with the name of the key is used as the key. All keys are the same as in DataStorage.
-        The value stores a pointer to std::unordered_multimap<T, DataStorageRecord*>.
+        The value stores a pointer to ConcurrentHashMultiMap<T, DataStorageRecord*> or ConcurrentFlatHashMultiMap<T, DataStorageRecord*>.
         The key type is same as the DataStorage key value type.
         The value is a pointer to DataStorageRecord.
 
@@ -40,11 +91,17 @@ private:
     */
     mutable DataStorageStructureHashMap DataStorageHashMapStructure;
 
+    // Pool for records and nodes of indices
+    MemoryPool* Pool;
+
+    // Copy of DataStorageHashMapStructure for lock-free readers. It is replaced with a new copy after each change of keys
+    std::atomic<DataStorageStructureHashMap*> LockFreeHashMapStructure;
+
     /*
         A simple typedef for Map. It is necessary for a more understandable separation of types.
         Represents the internal structure of the DataStorage.
         A string with the name of the key is used as the key. All keys are the same as in DataStorage.
-        The value stores a pointer to std::multimap<T, DataStorageRecord*>.
+        The value stores a pointer to DataStorageOrderedIndex<T>.
         The key type is same as the DataStorage key value type.
         The value is a pointer to DataStorageRecord.
 
@@ -53,281 +110,1494 @@ private:
     */
     mutable DataStorageStructureMap DataStorageMapStructure;
 
-    // unordered_map of functions that add a new element to the DataStorageStructureHashMap
-    std::unordered_map<std::string, std::function<void(DataStorageRecord*)>> DataStorageRecordAdders;
+    // Indices of all keys with the hash or ordered index. Removed indices are replaced with the last one, so the vector has no gaps
+    std::vector<DataStorageKeyIndexBase*> KeyIndices;
+
+    // Number of the index of the key inside KeyIndices by the key name
+    std::unordered_map<std::string, std::size_t> KeyIndexIds;
+
+    // Number of the composite index inside KeyIndices by the name of the index, see GetCompositeIndexName
+    std::unordered_map<std::string, std::size_t> CompositeIndexIds;
+
+    // Indices maintained for each key
+    std::unordered_map<std::string, DataStorageIndexPolicy> KeyIndexPolicies;
+
+    // Functions to save and load values of the key in snapshots
+    struct KeySnapshotFuncs
+    {
+        // Name of the key type. Snapshot columns are loaded only to keys of the same type
+        std::string TypeName;
+
+        // Function to append values of the key of all records to the string
+        std::function<void(const std::vector<DataStorageRecord*>& records, std::string& out)> Save;
+
+        // Function to set values of the key from the saved column to all records. Returns false if the column is damaged
+        std::function<bool(const char* begin, const char* end, const std::vector<DataStorageRecord*>& records)> Load;
+
+        // Function to append the value of the key of one record to the string
+        std::function<void(const DataStorageRecord* record, std::string& out)> SaveValue;
+
+        // Function to read one saved value. Returns false if the value is damaged
+        std::function<bool(const char*& ptr, const char* end, DataSaver& value)> LoadValue;
+    };
+
+    // unordered_map of functions to save and load keys in snapshots. Keys with types not supported by DataStorageSnapshotCodec are not stored here
+    std::unordered_map<std::string, KeySnapshotFuncs> DataStorageKeySnapshotFuncs;
+
+    // unordered_map of functions to add keys of types that were used in this DataStorage by the name of the type. Used to replay the write-ahead log
+    // The function reads the default value of the key and returns false if it is damaged
+    std::unordered_map<std::string, std::function<bool(const std::string& keyName, DataStorageIndexPolicy indexPolicy, const char*& ptr, const char* end)>> KeyTypeInstallers;
+
+    // unordered_map of functions that parse the value of the key from the csv field and set it to the record. Used by ImportCsv
+    // Keys with types not supported by DataStorageCsvCodec are not stored here
+    std::unordered_map<std::string, std::function<bool(const char* begin, const char* end, DataStorageRecord* record)>> DataStorageKeyCsvParsers;
+
+    // Write-ahead log. Equal to nullptr if the log is disabled
+    std::atomic<DataStorageWal*> Wal{nullptr};
 
-    // unordered_map of functions that delete all data from the unordered_map's stored in the DataStorageRecordAdders
-    std::unordered_map<std::string, std::function<void()>> DataStorageRecordClearers;
+    // LSN of the last entry of the write-ahead log included in the records. Set by LoadSnapshot and ReplayWal
+    std::uint64_t WalLsn = 0;
 
-    // unordered_map of functions that erase record from the unordered_map's stored in the DataStorageRecordAdders
-    std::unordered_map<std::string, std::function<void(DataStorageRecord* newRecord)>> DataStorageRecordErasers;
+    // Id of the next record
+    std::uint64_t NextRecordId = 1;
 
     // Unordered set with all DataStorageRecord pointers
     std::unordered_set<DataStorageRecord*> RecordsSet;
 
+    // Is the batch started by BeginBatch active
+    bool IsBatchActive = false;
+
+    // Records created inside the batch. They are not added to RecordsSet and indices until CommitBatch
+    std::vector<DataStorageRecord*> BatchRecords;
+
+    // Number of changes of RecordsSet. Used to check that records were not changed while indices were built under the read lock
+    std::size_t RecordsSetVersion = 0;
+
+    // Number of changes of keys. Used to check that keys were not changed while records were parsed without the lock
+    std::size_t KeysVersion = 0;
+
+    // Name of the key that selects the shard of records, if the DataStorage is a shard of ShardedDataStorage. Records can not change it,
+    // since they would stay in the shard of the old value. Empty if there is no such key
+    std::string ShardKeyName;
+
     // Recursive mutex for thread safety
     mutable RecursiveReadWriteMutex RecursiveReadWriteMtx;
 
-public:
+    // Data of all existing views created by Snapshot. Records are copied to them before changing.
+    // Views are added and removed under the read lock and ViewsMtx, and used by writers under the write lock
+    mutable std::vector<DataStorageView::State*> Views;
 
-    /// Default constructor
-    DataStorage();
+    // Mutex for adding and removing views under the read lock
+    mutable std::mutex ViewsMtx;
 
-    /// Deleted copy constructor
-    DataStorage(const DataStorage& other) = delete;
+    // Feeds subscribed to changes of records, see Subscribe
+    std::vector<std::shared_ptr<DataStorageChangeFeed>> ChangeFeeds;
 
-    /// Deleted assign operator
-    DataStorage& operator= (const DataStorage& other) = delete;
+    // Durations of operations and of the lock. Collected only if IsStatsCollected is true
+    mutable DataStorageStats Stats;
 
-    /**
-        \brief Template function to add new key with default value to DataStorage
+    // Are statistics collected, see SetStatsEnabled
+    std::atomic_bool IsStatsCollected{false};
 
-        \tparam <T> Any type of data except for c arrays
+    // Records with the time to live by their expiry time, see SetRecordTimeToLive
+    std::multimap<std::int64_t, DataStorageRecord*> ExpiryQueue;
 
-        If the key was added earlier, the default value will be updated when this function is called again
+    // Maximum number of records. Equal to 0 if the number is not limited, see SetCapacity
+    std::size_t MaxRecordsCount = 0;
 
-        \param [in] keyName new key name
-        \param [in] defaultKeyValue default key value
-    */
-    template <class T>
-    void SetKey(const std::string& keyName, const T& defaultKeyValue)
-    {
-        RecursiveReadWriteMtx.WriteLock();
+    // Maximum memory of records in bytes. Equal to 0 if the memory is not limited, see SetCapacity
+    std::size_t MaxRecordsBytes = 0;
 
-        // If the key was added earlier, then it must be deleted
-        if (IsKeyExist(keyName))
-            RemoveKey(keyName);
+    // Is the number or the memory of records limited. Checked by lock-free readers to mark records as used
+    std::atomic_bool IsCapacityLimited{false};
 
-        // Add data to template
-        RecordTemplate.SetData(keyName, defaultKeyValue);
+    // All records in the order of the CLOCK eviction. Filled only if the capacity is limited
+    std::vector<DataStorageRecord*> EvictionRing;
 
-        // Create new hash map to store data with template T key
-        std::unordered_multimap<T, DataStorageRecord*>* TtoDataStorageRecordHashMap = new std::unordered_multimap<T, DataStorageRecord*>;
-        DataStorageHashMapStructure.SetData(keyName, TtoDataStorageRecordHashMap, [](const void* ptr)
-            {
-                delete* (std::unordered_multimap<T, DataStorageRecord*>**)ptr;
-            }
-        );
+    // Position of the next record to check in EvictionRing
+    std::size_t EvictionHand = 0;
 
-        // Create new map to store data with template T key
-        std::multimap<T, DataStorageRecord*>* TtoDataStorageRecordMap = new std::multimap<T, DataStorageRecord*>;
-        DataStorageMapStructure.SetData(keyName, TtoDataStorageRecordMap, [](const void* ptr)
-            {
-                delete* (std::multimap<T, DataStorageRecord*>**)ptr;
-            }
-        );
+    // Sum of DataStorageRecord::CountedBytes of all records. Changed by DataStorageRecordRef under the write lock
+    mutable std::size_t CountedRecordsBytes = 0;
 
-        // Add function to DataStorageRecord creation
-        DataStorageRecordAdders.emplace(keyName, [=](DataStorageRecord* newRecord)
-            {
-                // Make temporary variable to store key value
-                T value = defaultKeyValue;
-                // Try to get key value from new record. If it is not value inside then defaultKeyValue will be used
-                newRecord->GetData(keyName, value);
-                TtoDataStorageRecordHashMap->emplace(value, newRecord);
-                TtoDataStorageRecordMap->emplace(value, newRecord);
-            }
-        );
+    // Number of expired records erased by each creation of records, so the expired records are erased gradually without scanning
+    static constexpr std::size_t ExpiredRecordsPerCreation = 8;
 
-        // Add function to TtoDataStorageRecordHashMap cleareing
-        DataStorageRecordClearers.emplace(keyName, [=]()
-            {
-                TtoDataStorageRecordHashMap->clear();
-                TtoDataStorageRecordMap->clear();
-            }
-        );
+    // Signature at the beginning of snapshot files
+    static constexpr char SnapshotSignature[9] = "DSSNAP01";
 
-        // Add function to erase newRecord from TtoDataStorageRecordHashMap
-        DataStorageRecordErasers.emplace(keyName, [=](DataStorageRecord* newRecord)
-            {
-                // Get T type data with keyName key
-                T recordTData;
-                newRecord->GetData(keyName, recordTData);
+    // Replace the copy of DataStorageHashMapStructure for lock-free readers. Must be called under the write lock
+    void PublishHashMapStructure();
 
-                // Find all elements on multi_map with recordTData value
-                auto FirstAndLastIteratorsWithKeyOnHashMap = TtoDataStorageRecordHashMap->equal_range(recordTData);
+    // Append the entry to the write-ahead log if it is enabled. Must be called under the write lock
+    void LogWalEntry(const std::string& entry) const;
 
-                // Find newRecord and erase it from TtoDataStorageRecordHashMap
-                for (auto& it = FirstAndLastIteratorsWithKeyOnHashMap.first; it != FirstAndLastIteratorsWithKeyOnHashMap.second; ++it)
-                {
-                    if (it->second == newRecord)
-                    {
-                        TtoDataStorageRecordHashMap->erase(it);
-                        break;
-                    }
-                }
+    // Write the creation of the record to the write-ahead log. Must be called under the write lock
+    void LogCreateRecord(const DataStorageRecord* record) const;
 
-                // Find all elements on map with recordTData value
-                auto FirstAndLastIteratorsWithKeyOnMap = TtoDataStorageRecordMap->equal_range(recordTData);
-                // Find newRecord and erase it from TtoDataStorageRecordHashMap
-                for (auto& it = FirstAndLastIteratorsWithKeyOnMap.first; it != FirstAndLastIteratorsWithKeyOnMap.second; ++it)
-                {
-                    if (it->second == newRecord)
-                    {
-                        TtoDataStorageRecordMap->erase(it);
-                        break;
-                    }
-                }
-            }
-        );
+    // Write the change of the key of the record to the write-ahead log. Must be called under the write lock
+    void LogSetData(const DataStorageRecord* record, const std::string& keyName) const;
 
-        // Add new data to record set
-        for (auto& it : RecordsSet)
-        {
-            it->SetData(keyName, defaultKeyValue);
-            TtoDataStorageRecordHashMap->emplace(defaultKeyValue, it);
-            TtoDataStorageRecordMap->emplace(defaultKeyValue, it);
-        }
+    // Send the change of the record to all change feeds. The old value is used only by SetDataChange, and the new value is copied from the record
+    // Must be called after the change under the lock for the change
+    void PublishChange(DataStorageChangeType type, DataStorageRecord* record, const std::string& keyName = std::string(), DataSaver&& oldValue = DataSaver()) const;
+
+    // Copy the value of the key of the record before changing it, if there are change feeds. Must be called under the lock for the change
+    void SaveOldValue(const DataStorageRecord* record, const std::string& keyName, DataSaver& oldValue) const;
 
-        RecursiveReadWriteMtx.WriteUnlock();
+    // Get the current time of std::chrono::steady_clock in nanoseconds
+    static std::int64_t GetSteadyTime()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
     }
 
-    /**
-        \brief The method for getting a default key value
+    // Check that the found record has not expired, and mark it as used for the eviction. Called by lock-free readers
+    bool TouchRecord(DataStorageRecord* record) const
+    {
+        std::int64_t expiryTime = record->ExpiryTime.load(std::memory_order_relaxed);
+        if (expiryTime != 0 && expiryTime <= GetSteadyTime())
+            return false;
 
-        \param [in] keyName the name of the key to search for
+        // The flag is written only if it changes, so readers of popular records do not write to the same cache line
+        if (IsCapacityLimited.load(std::memory_order_relaxed) && !record->IsRecentlyUsed.load(std::memory_order_relaxed))
+            record->IsRecentlyUsed.store(true, std::memory_order_relaxed);
 
-        \return returns true if the key was found otherwise returns false
-    */
-    bool IsKeyExist(const std::string& keyName) const;
-    
-    /**
-        \brief The method for getting a default key value
+        return true;
+    }
 
-        \tparam <T> Any type of data except for c arrays
+    // Add the memory used by the record to the statistics
+    static void AddRecordMemory(const DataStorageRecord* record, DataStorageMemoryStats& memoryStats);
 
-        \param [in] keyName the name of the key to search for
-        \param [in] keyValue the value of the key
+    // Add the new record to the eviction ring if the capacity is limited. Must be called under the write lock
+    void AddToEvictionRing(DataStorageRecord* record);
 
-        \return returns true if the key was found otherwise returns false
-    */
-    template <class T>
-    bool GetKeyValue(const std::string& keyName, T& defaultKeyValue) const
-    {
-        bool res;
-        RecursiveReadWriteMtx.ReadLock();
-        res = RecordTemplate.GetData(keyName, defaultKeyValue);
-        RecursiveReadWriteMtx.ReadUnlock();
-        return res;
-    }
+    // Erase the record from the eviction ring. Must be called under the write lock
+    void EraseFromEvictionRing(DataStorageRecord* record);
 
-    /// \brief The method for deleting the key
-    /// \param [in] keyName the key to remove
-    void RemoveKey(const std::string& keyName);
+    // Erase the record from the expiry queue. Must be called under the write lock
+    void EraseFromExpiryQueue(DataStorageRecord* record);
 
-    /// \brief Method to create new DataStorageRecord. A record will be created by copying RecordTemplate.
-    /// \return ref to new record 
-    DataStorageRecordRef CreateRecord();
+    // Recount the memory of the changed record if the memory is limited. Must be called under the lock for the change
+    void UpdateCountedBytes(DataStorageRecord* record) const;
 
-    /**
-        \brief Method to create new DataStorageRecord.
+    // Erase expired records, but not more than maxRecordsCount, and evict records above the capacity. Must be called under the write lock
+    std::size_t EraseExpiredRecordsLocked(std::size_t maxRecordsCount);
 
-        The method accepts a vector of pairs, the first element of the pair is a string with a key, 
-        and the second element of the pair are key values of any type.
-        The order of the pairs is not important, assignment takes place by key. The number of pairs can be any, 
-        for all keys for which no value has been specified, the default value will remain
+    // Evict records while the number or the memory of records is above the capacity. Must be called under the write lock
+    void EvictRecords();
 
-        The DataStorage in the example has 2 keys. One is the id of the int type, and the second is the name of the std::string type
-        Usage example:
+    // Erase the record of DataStorage from indices and all structures and retire it. Must be called under the write lock
+    void EraseRecordPtr(DataStorageRecord* record);
 
-        \code
-            // A record with id 0 and name mrognor will be created
-            ds.CreateRecord({ {"id", 0}, {"name", std::string("mrognor")} });
-        \endcode
+    // Get the histogram for the operation if statistics are collected, otherwise nullptr, so LatencyTimer does not read the clock
+    LatencyHistogram* GetStatsHistogram(LatencyHistogram& histogram) const
+    {
+        return IsStatsCollected.load(std::memory_order_relaxed) ? &histogram : nullptr;
+    }
 
-        or
+    // Set the name of the key that can not be changed by records, see ShardKeyName
+    void SetShardKeyName(const std::string& keyName);
 
-        \code
-            // A record with id 0 and name mrognor will be created
-            ds.CreateRecord({ {"name", std::string("mrognor")}, {"id", 0} });
-        \endcode
+    // Lock the DataStorage for writing to change a record. Returns false without locking if the thread holds only the read lock,
+    // for example inside ForEachRecordInRange, since the read lock can not be changed to the write lock and other readers use the indices
+    bool LockRecordChange() const;
 
-        or
+    // Unlock the DataStorage locked by LockRecordChange and wait for the write-ahead log
+    void UnlockRecordChange() const;
 
-        \code
-            // A record with name mrognor will be created. The Id will be set to the default value
-            ds.CreateRecord({ {"name", std::string("mrognor")} });
-        \endcode
+    // Change keys of the record under one write lock. Values are copied or moved from params depending on the type of params
+    template <class Params>
+    bool UpdateRecordData(const DataStorageRecordRef& recordRef, Params&& params);
 
-        or
+    // Wait until all entries are written to the disk if the write-ahead log is synchronous. Must be called after unlocking, so that other changes are not blocked
+    void WaitWalCommit() const;
 
-        \code
-            // A record with id 0 and name mrognor will be created
-            std::vector<std::pair<std::string, DataSaver>> params = { {"id", 0}, {"name", std::string("mrognor")} };
-            DataStorageRecordRef dsrr = ds.CreateRecord(params);
-        \endcode
+    // Apply one entry of the write-ahead log. Returns false if the entry can not be applied. Must be called under the write lock
+    bool ApplyWalEntry(const char* ptr, const char* end, std::unordered_map<std::uint64_t, DataStorageRecord*>& records);
 
-        what is equivalent to such a code without passing values to a function
+    // Get the index of the key. Returns nullptr if the key does not exist or does not have indices
+    DataStorageKeyIndexBase* FindKeyIndex(const std::string& keyName) const;
 
-        \code
-            DataStorageRecordRef dsrr = ds.CreateRecord();
+    // Get the name of the composite index with the keys. The names are saved with their lengths, so different lists of keys have different names
+    static std::string GetCompositeIndexName(const std::vector<std::string>& keyNames);
 
-            dsrr.SetData("id", 0);
-            dsrr.SetData<std::string>("name", "mrognor");
-        \endcode
+    // Delete the index with the id and move the last index of KeyIndices to its place. The id of the index must be already erased from KeyIndexIds or CompositeIndexIds
+    // Must be called under the write lock
+    void EraseKeyIndex(std::size_t id);
 
-        \param [in] params a vector of pairs with data to be put in the DataStorage
+    // Erase the record from the composite indices with the key before the key is changed. The indices are added to compositeIndices,
+    // if they are not there yet, so that the record is added back to them after the change. Must be called under the lock for the change
+    void EraseFromCompositeIndices(DataStorageRecord* record, const std::string& keyName, std::vector<DataStorageKeyIndexBase*>& compositeIndices) const;
 
-        \return ref to new record 
-    */
-    DataStorageRecordRef CreateRecord(const std::vector<std::pair<std::string, DataSaver>>& params);
+    // Copy the record to the views which see it and do not have its copy yet. Must be called before changing or erasing the record under the write lock
+    void PreserveRecord(const DataStorageRecord* record) const;
 
-    /**
-        \brief The method for getting a reference to the data inside DataStorage
+    // Stop views from reading all records which are not copied, before adding or removing keys. Values of the removed key are copied to the views.
+    // Must be called under the write lock, and UnlockViewRecords must be called after changing the records
+    void LockViewRecords(const std::string& removedKeyName) const;
 
-        \tparam <T> Any type of data except for c arrays
+    // Allow views to read records again after LockViewRecords
+    void UnlockViewRecords() const;
 
-        \param [in] keyName the name of the key to search for
-        \param [in] keyValue the value of the key to be found
-        \param [out] foundedRecord a ref to the DataStorageRecordRef where found record will be placed
+    // Stop copying records to the view. Called by the destructor of the view
+    void ReleaseView(DataStorageView::State* viewState) const;
 
-        \return ref to requested record 
-    */
-    template <class T>
-    DataStorageRecordRef GetRecord(const std::string& keyName, const T& keyValue) const
+    // Invalidate the record and delete it after all readers leave. The record is copied to the views first. Must be called under the write lock
+    void RetireRecord(DataStorageRecord* record);
+
+    // Add new record to the DataStorage and to all indices. If the value of a unique key is already used, the record is deleted and invalid ref is returned
+    // Inside the batch the record is only added to BatchRecords
+    // Must be called under the write lock
+    DataStorageRecordRef AddRecord(DataStorageRecord* newRecord);
+
+    // Call func with the pointer to the hash or flat hash index of the key. Both indices have the same search methods,
+    // so func is usually a generic lambda. Returns false if the key does not exist or does not have hash indices
+    template <class T, class F>
+    static bool VisitHashIndex(const DataStorageStructureHashMap& hashMapStructure, const std::string& keyName, F&& func)
     {
-        // Pointer to store map inside DataStorageStructureHashMap
-        std::unordered_multimap<T, DataStorageRecord*>* TtoDataStorageRecordHashMap = nullptr;
+        // The key name is searched only once for both types of indices
+        const DataSaver* hashIndex = hashMapStructure.GetDataSaver(keyName);
+        if (hashIndex == nullptr)
+            return false;
+
+        if (ConcurrentHashMultiMap<T, DataStorageRecord*>* const* hashMap = hashIndex->GetDataPtr<ConcurrentHashMultiMap<T, DataStorageRecord*>*>())
+            func(*hashMap);
+        else if (ConcurrentFlatHashMultiMap<T, DataStorageRecord*>* const* flatHashMap = hashIndex->GetDataPtr<ConcurrentFlatHashMultiMap<T, DataStorageRecord*>*>())
+            func(*flatHashMap);
+        else
+            return false;
+
+        return true;
+    }
 
+    // Find record by a key without the hash index. The ordered index is used if it exists, otherwise all records are checked
+    template <class T>
+    DataStorageRecordRef GetRecordWithoutHashIndex(const std::string& keyName, const T& keyValue) const
+    {
         DataStorageRecordRef res;
-
         RecursiveReadWriteMtx.ReadLock();
-        // Checking whether such a key exists
-        if (DataStorageHashMapStructure.GetData(keyName, TtoDataStorageRecordHashMap))
+
+        DataStorageRecord* foundedRecord = nullptr;
+        DataStorageOrderedIndex<T>* TtoDataStorageRecordMap = nullptr;
+        T value;
+
+        if (DataStorageMapStructure.GetData(keyName, TtoDataStorageRecordMap))
+        {
+            auto it = TtoDataStorageRecordMap->find(keyValue);
+            if (it != TtoDataStorageRecordMap->end())
+                foundedRecord = it->second;
+        }
+        else if (RecordTemplate.GetData(keyName, value))
         {
-            // Iterator to element with T type and keyValue value
-            auto TtoDataStorageRecordIt = TtoDataStorageRecordHashMap->find(keyValue);
-            if (TtoDataStorageRecordIt != TtoDataStorageRecordHashMap->end())
+            for (auto& it : RecordsSet)
             {
-                // Set data to DataStorageRecordRef
-                res.DataRecord = TtoDataStorageRecordIt->second;
-                res.DataStorageHashMapStructure = &DataStorageHashMapStructure;
-                res.DataStorageMapStructure = &DataStorageMapStructure;
-                res.IsDataStorageRecordValid = TtoDataStorageRecordIt->second->IsDataStorageRecordValid;
-                RecursiveReadWriteMtx.ReadUnlock();
-                return res;
+                it->GetData(keyName, value);
+                if (value == keyValue)
+                {
+                    foundedRecord = it;
+                    break;
+                }
             }
         }
 
-        res.IsDataStorageRecordValid.SetData(false);
+        if (foundedRecord != nullptr && TouchRecord(foundedRecord))
+            res = DataStorageRecordRef(foundedRecord, this);
+
         RecursiveReadWriteMtx.ReadUnlock();
         return res;
     }
 
-    /// A method for deleting all data and keys
-    void DropDataStorage();
+    // Iterate over records with the key values satisfying the request. The iteration stops when func returns false
+    // Returns false if the key does not exist. Must be called under the lock
+    template <class T, class F>
+    bool ForEachRecordPtrInRange(const std::string& keyName, const DataStorageRequest<T>& request, F&& func) const
+    {
+        DataStorageOrderedIndex<T>* TtoDataStorageRecordMap = nullptr;
+        const Equal<T>* equalRequest = dynamic_cast<const Equal<T>*>(&request);
+        T value;
 
-    /// A method for deleting all data, but keeping all keys
-    void DropData();
+        if (DataStorageMapStructure.GetData(keyName, TtoDataStorageRecordMap))
+        {
+            // Walk the range of the ordered index
+            auto FirstAndLastIteratorsOnMap = request.ProcessRequest(TtoDataStorageRecordMap);
+            for (auto it = FirstAndLastIteratorsOnMap.first; it != FirstAndLastIteratorsOnMap.second; ++it)
+                if (!func(it->second))
+                    break;
 
-    /// \brief Method for deleting a record from a DataStorage
-    /// \param recordRefToErase the reference to the record that needs to be deleted
-    void EraseRecord(const DataStorageRecordRef& recordRefToErase);
+            return true;
+        }
 
-    /// \brief Method for getting the number of records
-    /// \return number of records
-    std::size_t Size() const;
+        // Equal values can be found using the hash index
+        if (equalRequest != nullptr && VisitHashIndex<T>(DataStorageHashMapStructure, keyName, [&func, equalRequest](auto* TtoDataStorageRecordHashMap)
+            {
+                bool isStopped = false;
+                TtoDataStorageRecordHashMap->ForEachEqual(equalRequest->Value, [&func, &isStopped](DataStorageRecord* record)
+                    {
+                        if (!isStopped)
+                            isStopped = !func(record);
+                    }
+                );
+            }
+        ))
+            return true;
 
-    /// Default destructor 
-    ~DataStorage();
-};
\ No newline at end of file
+        if (RecordTemplate.GetData(keyName, value))
+        {
+            // Check all records if the key does not have a suitable index
+            for (auto& it : RecordsSet)
+            {
+                it->GetData(keyName, value);
+                if (request.IsMatch(value) && !func(it))
+                    break;
+            }
+
+            return true;
+        }
+
+        return false;
+    }
+
+    // Count records to be checked by ForEachRecordPtrInRange. Counting stops at the limit, so it is not slower than the best request
+    // Returns 0 if the key does not exist. Must be called under the lock
+    template <class T>
+    std::size_t CountRecordsInRange(const std::string& keyName, const DataStorageRequest<T>& request, std::size_t limit) const
+    {
+        DataStorageOrderedIndex<T>* TtoDataStorageRecordMap = nullptr;
+        const Equal<T>* equalRequest = dynamic_cast<const Equal<T>*>(&request);
+        T value;
+        std::size_t res = 0;
+
+        if (DataStorageMapStructure.GetData(keyName, TtoDataStorageRecordMap))
+        {
+            auto FirstAndLastIteratorsOnMap = request.ProcessRequest(TtoDataStorageRecordMap);
+            for (auto it = FirstAndLastIteratorsOnMap.first; it != FirstAndLastIteratorsOnMap.second && res < limit; ++it)
+                ++res;
+
+            return res;
+        }
+
+        if (equalRequest != nullptr && VisitHashIndex<T>(DataStorageHashMapStructure, keyName, [&res, equalRequest](auto* TtoDataStorageRecordHashMap)
+            {
+                TtoDataStorageRecordHashMap->ForEachEqual(equalRequest->Value, [&res](DataStorageRecord*) { ++res; });
+            }
+        ))
+            return res;
+
+        // All records are checked without a suitable index
+        if (RecordTemplate.GetData(keyName, value))
+            res = RecordsSet.size();
+
+        return res;
+    }
+
+    // Iterate over records satisfying all requests of the query. Must be called under the lock
+    void ForEachRecordPtr(const DataStorageQuery& query, const std::function<bool(DataStorageRecord* record)>& func) const;
+
+    // Call the function for the found record. Returns false if the function returned false to stop the iteration
+    template <class F>
+    bool CallForRecord(F& func, DataStorageRecord* record) const
+    {
+        DataStorageRecordRef recordRef(record, this);
+
+        if constexpr (std::is_same<decltype(func(recordRef)), bool>::value)
+            return func(recordRef);
+        else
+        {
+            func(recordRef);
+            return true;
+        }
+    }
+
+    // Add the key with already built indices to DataStorage. Values of the key in records are set by the caller
+    // Must be called under the write lock
+    template <class T>
+    void InstallKey(const std::string& keyName, const T& defaultKeyValue, DataStorageIndexPolicy indexPolicy, ConcurrentHashMultiMap<T, DataStorageRecord*>* TtoDataStorageRecordHashMap,
+        ConcurrentFlatHashMultiMap<T, DataStorageRecord*>* TtoDataStorageRecordFlatHashMap, DataStorageOrderedIndex<T>* TtoDataStorageRecordMap)
+    {
+        // If the key was added earlier, then it must be deleted
+        if (IsKeyExist(keyName))
+            RemoveKey(keyName);
+
+        // Add data to template
+        RecordTemplate.SetData(keyName, defaultKeyValue);
+        KeyIndexPolicies[keyName] = indexPolicy;
+
+        // Add hash map to store data with template T key. Lock-free readers can still use it after removing the key, so it is retired
+        if (TtoDataStorageRecordHashMap != nullptr)
+        {
+            DataStorageHashMapStructure.SetData(keyName, TtoDataStorageRecordHashMap, [](const void* ptr)
+                {
+                    EpochManager::GetInstance().Retire(*(ConcurrentHashMultiMap<T, DataStorageRecord*>**)ptr);
+                }
+            );
+        }
+
+        // The flat hash index is stored at the same place, since the key has only one of the hash indices
+        if (TtoDataStorageRecordFlatHashMap != nullptr)
+        {
+            DataStorageHashMapStructure.SetData(keyName, TtoDataStorageRecordFlatHashMap, [](const void* ptr)
+                {
+                    EpochManager::GetInstance().Retire(*(ConcurrentFlatHashMultiMap<T, DataStorageRecord*>**)ptr);
+                }
+            );
+        }
+
+        // Add map to store data with template T key
+        if (TtoDataStorageRecordMap != nullptr)
+        {
+            DataStorageMapStructure.SetData(keyName, TtoDataStorageRecordMap, [](const void* ptr)
+                {
+                    delete* (DataStorageOrderedIndex<T>**)ptr;
+                }
+            );
+        }
+
+        // Add functions to save and load values of the key in snapshots
+        if constexpr (DataStorageSnapshotCodec<T>::IsSupported)
+        {
+            KeySnapshotFuncs snapshotFuncs;
+            snapshotFuncs.TypeName = typeid(T).name();
+
+            snapshotFuncs.Save = [=](const std::vector<DataStorageRecord*>& records, std::string& out)
+                {
+                    for (auto& it : records)
+                    {
+                        T value = defaultKeyValue;
+                        it->GetData(keyName, value);
+                        DataStorageSnapshotCodec<T>::Save(value, out);
+                    }
+                };
+
+            snapshotFuncs.Load = [=](const char* begin, const char* end, const std::vector<DataStorageRecord*>& records)
+                {
+                    // Values are decoded directly from the file without parsing strings
+                    T value = defaultKeyValue;
+                    for (auto& it : records)
+                    {
+                        if (!DataStorageSnapshotCodec<T>::Load(begin, end, value))
+                            return false;
+
+                        it->SetData(keyName, std::move(value));
+                    }
+
+                    return begin == end;
+                };
+
+            snapshotFuncs.SaveValue = [=](const DataStorageRecord* record, std::string& out)
+                {
+                    T value = defaultKeyValue;
+                    record->GetData(keyName, value);
+                    DataStorageSnapshotCodec<T>::Save(value, out);
+                };
+
+            snapshotFuncs.LoadValue = [=](const char*& ptr, const char* end, DataSaver& value)
+                {
+                    T loadedValue = defaultKeyValue;
+                    if (!DataStorageSnapshotCodec<T>::Load(ptr, end, loadedValue))
+                        return false;
+
+                    value.SetData(std::move(loadedValue));
+                    return true;
+                };
+
+            DataStorageKeySnapshotFuncs.emplace(keyName, std::move(snapshotFuncs));
+
+            // Keys of this type can be added by ReplayWal
+            KeyTypeInstallers.emplace(typeid(T).name(), [this, defaultKeyValue](const std::string& installedKeyName, DataStorageIndexPolicy installedIndexPolicy, const char*& ptr, const char* end)
+                {
+                    T installedDefaultKeyValue = defaultKeyValue;
+                    if (!DataStorageSnapshotCodec<T>::Load(ptr, end, installedDefaultKeyValue))
+                        return false;
+
+                    return SetKey(installedKeyName, installedDefaultKeyValue, installedIndexPolicy);
+                }
+            );
+
+            // Write the key to the write-ahead log
+            if (Wal.load(std::memory_order_relaxed) != nullptr)
+            {
+                std::string entry;
+                DataStorageSnapshotCodec<std::uint8_t>::Save(DataStorageWalEntryType::AddKeyEntry, entry);
+                DataStorageSnapshotCodec<std::string>::Save(keyName, entry);
+                DataStorageSnapshotCodec<std::string>::Save(typeid(T).name(), entry);
+                DataStorageSnapshotCodec<std::uint32_t>::Save(indexPolicy, entry);
+                DataStorageSnapshotCodec<T>::Save(defaultKeyValue, entry);
+                LogWalEntry(entry);
+            }
+        }
+
+        // Add function to parse values of the key from csv
+        if constexpr (DataStorageCsvCodec<T>::IsSupported)
+        {
+            DataStorageKeyCsvParsers.emplace(keyName, [=](const char* begin, const char* end, DataStorageRecord* record)
+                {
+                    T value = defaultKeyValue;
+                    if (!DataStorageCsvCodec<T>::Parse(begin, end, value))
+                        return false;
+
+                    record->SetData(keyName, std::move(value));
+                    return true;
+                }
+            );
+        }
+
+        // Keys without indices are stored only inside records
+        if (indexPolicy == DataStorageIndexPolicy::NoIndex)
+            return;
+
+        // Add the index of the key. Positions of records inside it are stored by the caller, see DataStorageKeyIndexBase::UpdatePositions
+        KeyIndexIds[keyName] = KeyIndices.size();
+        KeyIndices.emplace_back(new DataStorageKeyIndex<T>(keyName, defaultKeyValue, indexPolicy & DataStorageIndexPolicy::UniqueIndex,
+            TtoDataStorageRecordHashMap, TtoDataStorageRecordFlatHashMap, TtoDataStorageRecordMap));
+        KeyIndices.back()->SetId(KeyIndices.size() - 1);
+    }
+
+    // New key with indices built before locking the DataStorage for writing
+    struct PendingKey
+    {
+        // Name of the key
+        std::string KeyName;
+
+        // Default value of the key to be set to all records
+        DataSaver DefaultKeyValue;
+
+        // Are the values of the key unique. Such key can not be added to more than one record, since all records get the default value
+        bool IsUnique = false;
+
+        // Function to fill indices of the key for the records. Does not change the DataStorage, so it can be called under the read lock
+        std::function<void(const std::vector<DataStorageRecord*>& records)> BuildIndices;
+
+        // Function to add the key with built indices to the DataStorage. Must be called under the write lock
+        std::function<void()> Install;
+    };
+
+    // Create the pending key. Indices are allocated, but not filled
+    template <class T>
+    PendingKey CreatePendingKey(const DataStorageKey<T>& key)
+    {
+        DataStorageIndexPolicy indexPolicy = key.IndexPolicy;
+
+        // Unique values can be checked only using an index
+        if ((indexPolicy & DataStorageIndexPolicy::UniqueIndex) && !(indexPolicy & (DataStorageIndexPolicy::HashAndOrderedIndex | DataStorageIndexPolicy::FlatHashIndex)))
+            indexPolicy = indexPolicy | DataStorageIndexPolicy::HashIndex;
+
+        // Indices are shared by the functions of the pending key. The flat hash index replaces the hash index
+        std::shared_ptr<ConcurrentHashMultiMap<T, DataStorageRecord*>> hashMap;
+        std::shared_ptr<ConcurrentFlatHashMultiMap<T, DataStorageRecord*>> flatHashMap;
+        if (indexPolicy & DataStorageIndexPolicy::FlatHashIndex)
+            flatHashMap = std::make_shared<ConcurrentFlatHashMultiMap<T, DataStorageRecord*>>(Pool);
+        else if (indexPolicy & DataStorageIndexPolicy::HashIndex)
+            hashMap = std::make_shared<ConcurrentHashMultiMap<T, DataStorageRecord*>>(Pool);
+
+        std::shared_ptr<DataStorageOrderedIndex<T>> map;
+        if (indexPolicy & DataStorageIndexPolicy::OrderedIndex)
+            map = std::make_shared<DataStorageOrderedIndex<T>>(PoolAllocator<std::pair<const T, DataStorageRecord*>>(Pool));
+
+        PendingKey res;
+        res.KeyName = key.KeyName;
+        res.DefaultKeyValue = key.DefaultKeyValue;
+        res.IsUnique = indexPolicy & DataStorageIndexPolicy::UniqueIndex;
+
+        res.BuildIndices = [hashMap, flatHashMap, map, key](const std::vector<DataStorageRecord*>& records)
+            {
+                // All records have the default value, so records are added to the end of the ordered index in O(1) each
+                if (hashMap != nullptr)
+                {
+                    hashMap->Clear();
+                    hashMap->Reserve(records.size());
+                    for (auto& it : records)
+                        hashMap->Emplace(key.DefaultKeyValue, it);
+                }
+
+                // All records are added to the array of one entry
+                if (flatHashMap != nullptr)
+                {
+                    flatHashMap->Clear();
+                    for (auto& it : records)
+                        flatHashMap->Emplace(key.DefaultKeyValue, it);
+                }
+
+                if (map != nullptr)
+                {
+                    map->clear();
+                    for (auto& it : records)
+                        map->emplace_hint(map->end(), key.DefaultKeyValue, it);
+                }
+            };
+
+        res.Install = [this, hashMap, flatHashMap, map, key, indexPolicy]()
+            {
+                // The DataStorage takes ownership of the indices
+                ConcurrentHashMultiMap<T, DataStorageRecord*>* TtoDataStorageRecordHashMap = nullptr;
+                if (hashMap != nullptr)
+                    TtoDataStorageRecordHashMap = new ConcurrentHashMultiMap<T, DataStorageRecord*>(std::move(*hashMap));
+
+                ConcurrentFlatHashMultiMap<T, DataStorageRecord*>* TtoDataStorageRecordFlatHashMap = nullptr;
+                if (flatHashMap != nullptr)
+                    TtoDataStorageRecordFlatHashMap = new ConcurrentFlatHashMultiMap<T, DataStorageRecord*>(std::move(*flatHashMap));
+
+                DataStorageOrderedIndex<T>* TtoDataStorageRecordMap = nullptr;
+                if (map != nullptr)
+                    TtoDataStorageRecordMap = new DataStorageOrderedIndex<T>(std::move(*map));
+
+                InstallKey(key.KeyName, key.DefaultKeyValue, indexPolicy, TtoDataStorageRecordHashMap, TtoDataStorageRecordFlatHashMap, TtoDataStorageRecordMap);
+            };
+
+        return res;
+    }
+
+    // Number of values searched by GetRecords ahead of the current value when their buckets are loaded to the cache
+    static constexpr std::size_t BatchPrefetchDistance = 8;
+
+    // Minimum number of records changed by one thread when keys are added
+    static constexpr std::size_t MinRecordsPartSize = 4096;
+
+    // Build indices of the pending keys and add them to the DataStorage. Returns false if unique keys were not added, see SetKey
+    bool AddPendingKeys(std::vector<PendingKey>& pendingKeys);
+
+public:
+
+    /// Making the DataStorageQuery class friendly so that its requests can use the indices
+    friend DataStorageQuery;
+
+    /// Making the DataStorageRecordRef class friendly so that it can lock the DataStorage and write changes to the write-ahead log
+    friend DataStorageRecordRef;
+
+    /// Making the DataStorageView class friendly so that it can unregister itself
+    friend DataStorageView;
+
+    /// Making the ShardedDataStorage class friendly so that it can forbid changing the shard key
+    friend ShardedDataStorage;
+
+    /**
+        \brief Constructor
+
+        Records and nodes of indices are allocated from the memory pool, which takes memory from the system in big chunks
+        and reuses blocks of erased records.
+
+        \param [in] memoryPool the pool to allocate from. If it is nullptr, a new pool is created for this DataStorage.
+        The pool can be shared by several DataStorage's, the DataStorage becomes its owner, see MemoryPool::AddOwner
+    */
+    DataStorage(MemoryPool* memoryPool = nullptr);
+
+    /// Deleted copy constructor
+    DataStorage(const DataStorage& other) = delete;
+
+    /// Deleted assign operator
+    DataStorage& operator= (const DataStorage& other) = delete;
+
+    /**
+        \brief Template function to add new key with default value to DataStorage
+
+        \tparam <T> Any type of data except for c arrays
+
+        If the key was added earlier, the default value will be updated when this function is called again.
+        Indices of the key are built for existing records under the read lock, so only other writers wait for it.
+        Then default values are set in records under the write lock in parallel threads, and the key becomes available to all readers at once.
+        Each index costs time on every CreateRecord, EraseRecord and DataStorageRecordRef::SetData, and memory for every record,
+        so keys that are never searched for should be added without indices, see DataStorageIndexPolicy.
+        A key with UniqueIndex is not added if the DataStorage has more than one record, since all of them would get the same default value.
+        In this case the function returns false, and the key with the same name added earlier is not changed.
+
+        \code
+            // Key for GetRecord
+            ds.SetKey("id", -1, DataStorageIndexPolicy::HashIndex | DataStorageIndexPolicy::UniqueIndex);
+            // Key with many equal values
+            ds.SetKey<std::string>("city", "", DataStorageIndexPolicy::FlatHashIndex);
+            // Payload key
+            ds.SetKey<std::string>("description", "", DataStorageIndexPolicy::NoIndex);
+        \endcode
+
+        \param [in] keyName new key name
+        \param [in] defaultKeyValue default key value
+        \param [in] indexPolicy indices to maintain for the key. Hash and ordered indices are created by default
+
+        \return returns true if the key was added, and false if the key is unique and the DataStorage has more than one record
+    */
+    template <class T>
+    bool SetKey(const std::string& keyName, const T& defaultKeyValue, DataStorageIndexPolicy indexPolicy = DataStorageIndexPolicy::HashAndOrderedIndex)
+    {
+        return AddKeys(DataStorageKey<T>(keyName, defaultKeyValue, indexPolicy));
+    }
+
+    /**
+        \brief Template function to add several keys to DataStorage at once
+
+        \tparam <T...> Types of the keys. Any type of data except for c arrays
+
+        Works the same way as SetKey for each key, but indices of different keys are built in parallel threads,
+        and records are changed only once for all keys. Unique keys rejected as in SetKey are not added, but other keys are added.
+
+        \code
+            ds.AddKeys(DataStorageKey<int>("age", 0), DataStorageKey<std::string>("name", "", DataStorageIndexPolicy::NoIndex));
+        \endcode
+
+        \param [in] keys descriptions of the keys
+
+        \return returns true if all keys were added, and false if some unique keys were not added
+    */
+    template <class... T>
+    bool AddKeys(const DataStorageKey<T>&... keys)
+    {
+        std::vector<PendingKey> pendingKeys;
+        pendingKeys.reserve(sizeof...(keys));
+        (pendingKeys.emplace_back(CreatePendingKey(keys)), ...);
+        return AddPendingKeys(pendingKeys);
+    }
+
+
+    /**
+        \brief The method for getting a default key value
+
+        \param [in] keyName the name of the key to search for
+
+        \return returns true if the key was found otherwise returns false
+    */
+    bool IsKeyExist(const std::string& keyName) const;
+    
+    /**
+        \brief The method for getting a default key value
+
+        \tparam <T> Any type of data except for c arrays
+
+        \param [in] keyName the name of the key to search for
+        \param [in] keyValue the value of the key
+
+        \return returns true if the key was found otherwise returns false
+    */
+    template <class T>
+    bool GetKeyValue(const std::string& keyName, T& defaultKeyValue) const
+    {
+        bool res;
+        RecursiveReadWriteMtx.ReadLock();
+        res = RecordTemplate.GetData(keyName, defaultKeyValue);
+        RecursiveReadWriteMtx.ReadUnlock();
+        return res;
+    }
+
+    /**
+        \brief The method for getting indices maintained for the key
+
+        \param [in] keyName the name of the key to search for
+        \param [out] indexPolicy the ref to which the index policy will be written
+
+        \return returns true if the key was found otherwise returns false
+    */
+    bool GetKeyIndexPolicy(const std::string& keyName, DataStorageIndexPolicy& indexPolicy) const;
+
+    /// \brief The method for deleting the key. Composite indices with the key are deleted too
+    /// \param [in] keyName the key to remove
+    void RemoveKey(const std::string& keyName);
+
+    /**
+        \brief Method for adding the index over the values of several keys
+
+        Records are found by the values of all keys of the index with one search, instead of filtering the candidates of one of the keys.
+        The index is used automatically by the queries, if all its keys have Equal requests, see DataStorageQuery and GetRecord(const DataStorageQuery& query).
+        The index is kept in sync with the records like the indices of single keys: when one of its keys of the record is changed,
+        the record is erased from the index and added back with the new value.
+
+        Values of the keys are saved to one string by DataStorageSnapshotCodec and compared by the saved bytes, so the keys must have types supported by the codec,
+        and values of floating point keys are found only by values with the same bits, for example 0.0 does not find -0.0.
+        The UniqueIndex policy is not supported for composite indices and is ignored.
+
+        \code
+            ds.AddCompositeIndex({"socket", "cores"});
+
+            DataStorageQuery query;
+            query.Where("socket", Equal<std::string>("AM5")).Where("cores", Equal<int>(16));
+            DataStorageRecordRef cpu = ds.GetRecord(query);
+        \endcode
+
+        \param [in] keyNames names of at least two different keys of the index. The index with the same keys is replaced
+        \param [in] indexPolicy indices to maintain for the values of the keys. The flat hash index replaces the hash index like for single keys
+
+        \return returns true if the index was added, or false if a key does not exist, has a type not supported by DataStorageSnapshotCodec,
+        is repeated, or the policy does not have any index
+    */
+    bool AddCompositeIndex(const std::vector<std::string>& keyNames, DataStorageIndexPolicy indexPolicy = DataStorageIndexPolicy::HashIndex);
+
+    /// \brief Method for deleting the composite index added by AddCompositeIndex
+    /// \param [in] keyNames names of the keys of the index in the same order as in AddCompositeIndex
+    void RemoveCompositeIndex(const std::vector<std::string>& keyNames);
+
+    /// \brief Method to create new DataStorageRecord. A record will be created by copying RecordTemplate.
+    /// If a unique key already has a record with the default value, the record will not be created.
+    /// Inside the batch, see BeginBatch, the record is added only by CommitBatch
+    /// \return ref to new record or invalid ref if the record was not created or the batch is active
+    DataStorageRecordRef CreateRecord();
+
+    /**
+        \brief Method to create new DataStorageRecord.
+
+        The method accepts a vector of pairs, the first element of the pair is a string with a key, 
+        and the second element of the pair are key values of any type.
+        The order of the pairs is not important, assignment takes place by key. The number of pairs can be any, 
+        for all keys for which no value has been specified, the default value will remain
+
+        The DataStorage in the example has 2 keys. One is the id of the int type, and the second is the name of the std::string type
+        Usage example:
+
+        \code
+            // A record with id 0 and name mrognor will be created
+            ds.CreateRecord({ {"id", 0}, {"name", std::string("mrognor")} });
+        \endcode
+
+        or
+
+        \code
+            // A record with id 0 and name mrognor will be created
+            ds.CreateRecord({ {"name", std::string("mrognor")}, {"id", 0} });
+        \endcode
+
+        or
+
+        \code
+            // A record with name mrognor will be created. The Id will be set to the default value
+            ds.CreateRecord({ {"name", std::string("mrognor")} });
+        \endcode
+
+        or
+
+        \code
+            // A record with id 0 and name mrognor will be created
+            std::vector<std::pair<std::string, DataSaver>> params = { {"id", 0}, {"name", std::string("mrognor")} };
+            DataStorageRecordRef dsrr = ds.CreateRecord(params);
+        \endcode
+
+        what is equivalent to such a code without passing values to a function
+
+        \code
+            DataStorageRecordRef dsrr = ds.CreateRecord();
+
+            dsrr.SetData("id", 0);
+            dsrr.SetData<std::string>("name", "mrognor");
+        \endcode
+
+        If a unique key already has a record with the same value, the record will not be created.
+        Inside the batch, see BeginBatch, the record is added only by CommitBatch
+
+        \param [in] params a vector of pairs with data to be put in the DataStorage
+
+        \return ref to new record or invalid ref if the record was not created or the batch is active
+    */
+    DataStorageRecordRef CreateRecord(const std::vector<std::pair<std::string, DataSaver>>& params);
+
+    /**
+        \brief Method to create new DataStorageRecord by moving data from params.
+
+        Works the same way as DataStorage::CreateRecord(const std::vector<std::pair<std::string, DataSaver>>& params), 
+        but the values are moved to the new record instead of copying. It is used automatically for temporary vectors, 
+        for example when passing an initializer list. Use std::move to pass an existing vector. 
+        After the call, all DataSavers inside params, whose keys exist in DataStorage, will be empty.
+
+        \code
+            std::vector<std::pair<std::string, DataSaver>> params = { {"id", 0}, {"name", std::string("mrognor")} };
+            DataStorageRecordRef dsrr = ds.CreateRecord(std::move(params));
+        \endcode
+
+        \param [in] params a vector of pairs with data to be moved to the DataStorage
+
+        \return ref to new record or invalid ref if the record was not created or the batch is active
+    */
+    DataStorageRecordRef CreateRecord(std::vector<std::pair<std::string, DataSaver>>&& params);
+
+    /**
+        \brief The method for getting a reference to the data inside DataStorage
+
+        \tparam <T> Any type of data except for c arrays
+
+        If the key has the hash or flat hash index, the search takes O(1) and does not lock the DataStorage.
+        If the key has only the ordered index, the search takes O(log n), and without indices all records are checked.
+
+        \param [in] keyName the name of the key to search for
+        \param [in] keyValue the value of the key to be found
+
+        \return ref to requested record 
+    */
+    template <class T>
+    DataStorageRecordRef GetRecord(const std::string& keyName, const T& keyValue) const
+    {
+        LatencyTimer timer(GetStatsHistogram(Stats.GetRecord));
+        DataStorageRecordRef res;
+
+        // The DataStorage is not locked. Structures read inside the epoch will not be deleted until the end of the function
+        EpochGuard epochGuard;
+
+        // Checking whether such a key exists and has the hash index
+        if (VisitHashIndex<T>(*LockFreeHashMapStructure.load(std::memory_order_acquire), keyName, [this, &keyValue, &res](auto* TtoDataStorageRecordHashMap)
+            {
+                // Find record with T type and keyValue value
+                DataStorageRecord* record;
+                if (TtoDataStorageRecordHashMap->Find(keyValue, record) && TouchRecord(record))
+                {
+                    // Set data to DataStorageRecordRef
+                    res.DataRecord = record;
+                    res.Storage = this;
+                    res.Handle = record->Handle;
+                }
+            }
+        ))
+            return res;
+
+        // The key does not exist or does not have the hash index
+        return GetRecordWithoutHashIndex(keyName, keyValue);
+    }
+
+    /**
+        \brief The method for getting references to records with many values of the key at once
+
+        \tparam <T> Any type of data except for c arrays
+
+        Works the same way as calling GetRecord for each value, but the key is searched only once and
+        buckets of the hash index are loaded to the cache several values in advance, so independent searches overlap.
+        If the key does not have the hash index, the DataStorage is locked for reading only once for all values.
+
+        \code
+            std::vector<DataStorageRecordRef> found(ids.size());
+            ds.GetRecords("id", ids.data(), ids.size(), found.data());
+        \endcode
+
+        \param [in] keyName the name of the key to search for
+        \param [in] keyValues pointer to the array of values of the key to be found
+        \param [in] count the number of values
+        \param [out] foundRecords pointer to the array of count refs. The ref at i is set to the record with keyValues[i] or to an invalid ref
+    */
+    template <class T>
+    void GetRecords(const std::string& keyName, const T* keyValues, std::size_t count, DataStorageRecordRef* foundRecords) const
+    {
+        // The DataStorage is not locked. Structures read inside the epoch will not be deleted until the end of the function
+        EpochGuard epochGuard;
+
+        if (VisitHashIndex<T>(*LockFreeHashMapStructure.load(std::memory_order_acquire), keyName, [this, keyValues, count, foundRecords](auto* TtoDataStorageRecordHashMap)
+            {
+                for (std::size_t i = 0; i < count && i < BatchPrefetchDistance; ++i)
+                    TtoDataStorageRecordHashMap->Prefetch(keyValues[i]);
+
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    if (i + BatchPrefetchDistance < count)
+                        TtoDataStorageRecordHashMap->Prefetch(keyValues[i + BatchPrefetchDistance]);
+
+                    DataStorageRecord* record;
+                    if (TtoDataStorageRecordHashMap->Find(keyValues[i], record) && TouchRecord(record))
+                    {
+                        foundRecords[i].DataRecord = record;
+                        foundRecords[i].Storage = this;
+                        foundRecords[i].Handle = record->Handle;
+                    }
+                    else
+                        foundRecords[i] = DataStorageRecordRef();
+                }
+            }
+        ))
+            return;
+
+        // The lock is recursive, so the searches without the hash index do not lock the DataStorage again
+        RecursiveReadWriteMtx.ReadLock();
+        for (std::size_t i = 0; i < count; ++i)
+            foundRecords[i] = GetRecordWithoutHashIndex(keyName, keyValues[i]);
+        RecursiveReadWriteMtx.ReadUnlock();
+    }
+
+    /**
+        \brief The method for getting references to records with many values of the key at once
+
+        \tparam <T> Any type of data except for c arrays and bool
+
+        Works the same way as GetRecords(const std::string& keyName, const T* keyValues, std::size_t count, DataStorageRecordRef* foundRecords).
+        The vector of found records is resized to the number of values, so it can be reused between calls without allocations.
+
+        \param [in] keyName the name of the key to search for
+        \param [in] keyValues values of the key to be found
+        \param [out] foundRecords the vector to which the refs will be written in the order of values
+    */
+    template <class T>
+    void GetRecords(const std::string& keyName, const std::vector<T>& keyValues, std::vector<DataStorageRecordRef>& foundRecords) const
+    {
+        foundRecords.resize(keyValues.size());
+        GetRecords(keyName, keyValues.data(), keyValues.size(), foundRecords.data());
+    }
+
+    /**
+        \brief The method for iterating over all records with the key values satisfying the request
+
+        \tparam <T> Any type of data for which the operator < is defined
+        \tparam <F> Function or lambda function with the signature void(const DataStorageRecordRef& recordRef) or bool(const DataStorageRecordRef& recordRef).
+        If the function returns false, the iteration stops
+
+        Records are not collected into a set, so this method can be used to process any number of records without additional memory.
+        If the key has the ordered index, the range is found in O(log n) and records are processed in ascending order of the key values,
+        otherwise all records are checked in no particular order.
+
+        \code
+            ds.ForEachRecordInRange("age", Between<int>(18, 30), [](const DataStorageRecordRef& recordRef)
+                {
+                    std::cout << recordRef.GetRecordUniqueId() << std::endl;
+                }
+            );
+        \endcode
+
+        \warning The DataStorage is locked for reading during the iteration, so the function must not create, change or erase records.
+        DataStorageRecordRef::SetData and UpdateRecord called inside the function return false without changing the record
+
+        \param [in] keyName the name of the key to search for
+        \param [in] request the request with the range of the key values, see DataStorageRequests.h
+        \param [in] func function to be called for each found record
+
+        \return returns true if the key was found otherwise returns false
+    */
+    template <class T, class F>
+    bool ForEachRecordInRange(const std::string& keyName, const DataStorageRequest<T>& request, F&& func) const
+    {
+        RecursiveReadWriteMtx.ReadLock();
+        bool res = ForEachRecordPtrInRange(keyName, request, [this, &func](DataStorageRecord* record) { return CallForRecord(func, record); });
+        RecursiveReadWriteMtx.ReadUnlock();
+        return res;
+    }
+
+    /**
+        \brief The method for getting all records with the key values satisfying the request
+
+        \tparam <T> Any type of data for which the operator < is defined
+
+        Works the same way as ForEachRecordInRange, but collects found records into a set.
+
+        \code
+            DataStorageRecordSet adults = ds.GetRecordsInRange("age", GreaterOrEqual<int>(18));
+            DataStorageRecordSet names = ds.GetRecordsInRange<std::string>("name", StartsWith("mr"));
+        \endcode
+
+        \param [in] keyName the name of the key to search for
+        \param [in] request the request with the range of the key values, see DataStorageRequests.h
+
+        \return set of found records. It is empty if the key was not found
+    */
+    template <class T>
+    DataStorageRecordSet GetRecordsInRange(const std::string& keyName, const DataStorageRequest<T>& request) const
+    {
+        DataStorageRecordSet res;
+        ForEachRecordInRange(keyName, request, [&res](const DataStorageRecordRef& recordRef) { res.AddNewRecord(recordRef); });
+        return res;
+    }
+
+    /**
+        \brief The method for iterating over all records satisfying all requests of the query
+
+        \tparam <F> Function or lambda function with the signature void(const DataStorageRecordRef& recordRef) or bool(const DataStorageRecordRef& recordRef).
+        If the function returns false, the iteration stops
+
+        The number of candidates of each request is estimated using the indices, and only the candidates of the most selective request are iterated.
+        The remaining requests are checked on each candidate, so no intermediate sets are created. If the query is empty, all records are iterated.
+
+        \warning The DataStorage is locked for reading during the iteration, so the function must not create or erase records
+        and must not change the values of the keys of the query
+
+        \param [in] query the query with requests on the keys, see DataStorageQuery
+        \param [in] func function to be called for each found record
+    */
+    template <class F>
+    void ForEachRecord(const DataStorageQuery& query, F&& func) const
+    {
+        RecursiveReadWriteMtx.ReadLock();
+        ForEachRecordPtr(query, [this, &func](DataStorageRecord* record) { return CallForRecord(func, record); });
+        RecursiveReadWriteMtx.ReadUnlock();
+    }
+
+    /**
+        \brief The method for getting all records satisfying all requests of the query
+
+        Works the same way as ForEachRecord, but collects found records into a set.
+
+        \param [in] query the query with requests on the keys, see DataStorageQuery
+
+        \return set of found records
+    */
+    DataStorageRecordSet GetRecords(const DataStorageQuery& query) const;
+
+    /**
+        \brief The method for getting a record satisfying all requests of the query
+
+        Works the same way as ForEachRecord, but stops at the first found record.
+        If all keys of a composite index have Equal requests in the query, the record is found in O(1), see AddCompositeIndex.
+
+        \param [in] query the query with requests on the keys, see DataStorageQuery
+
+        \return ref to the found record or invalid ref if no records satisfy the query
+    */
+    DataStorageRecordRef GetRecord(const DataStorageQuery& query) const;
+
+    /**
+        \brief Method for subscribing to changes of records
+
+        All following creations and erasures of records, changes of keys by DataStorageRecordRef::SetData and UpdateRecord, and deletions of all records
+        are added to the feed in the order in which they are made, see DataStorageChange. Replayed entries of the write-ahead log and loaded snapshots are added too.
+        The feed only accumulates changes, so the DataStorage is not slowed down by the consumer, see DataStorageChangeFeed.
+        Without feeds, changes are not copied at all.
+
+        \param [in] capacity maximum number of changes not taken by the consumer. Changes above it are dropped
+
+        \return the new feed. It receives changes until Unsubscribe
+    */
+    std::shared_ptr<DataStorageChangeFeed> Subscribe(std::size_t capacity = 1 << 20);
+
+    /// \brief Method for stopping sending changes to the feed
+    /// \param [in] changeFeed the feed returned by Subscribe
+    void Unsubscribe(const std::shared_ptr<DataStorageChangeFeed>& changeFeed);
+
+    /**
+        \brief Method for creating the view of all records at this moment
+
+        The view is not changed by the following changes of the DataStorage, so long reports and exports can read it
+        without locking the DataStorage, see DataStorageView.
+        Creating the view takes the read lock to copy and sort pointers to all records. While views exist, each record is copied
+        to them once before its first change or erasure, and values of a key are copied before removing it, so views should be destroyed when they are not needed.
+        Unlike SaveSnapshot, the view is stored in memory.
+
+        \return the view of all records
+    */
+    DataStorageView Snapshot() const;
+
+    /**
+        \brief Method to start the batch of new records
+
+        Records created by CreateRecord inside the batch are only stored, without checking unique keys and without adding them to indices.
+        CommitBatch adds all of them to indices in one pass for each key, which is much faster for loading many records than adding them one by one.
+        Records of the batch are not available until CommitBatch, so CreateRecord returns invalid refs inside the batch.
+
+        \code
+            ds.BeginBatch(rows.size());
+            for (auto& it : rows)
+                ds.CreateRecord(std::move(it));
+            ds.CommitBatch(true);
+        \endcode
+
+        \param [in] expectedRecordsCount number of records in the batch. Used to allocate memory in advance
+    */
+    void BeginBatch(std::size_t expectedRecordsCount = 0);
+
+    /**
+        \brief Method to add all records of the batch to the DataStorage and its indices
+
+        Records are checked for unique keys one by one, and records with already used values are deleted.
+        Other indices are built in one pass. The values of the key are sorted and added to the end of the ordered index,
+        and all buckets of the hash index are allocated before filling it.
+
+        \param [in] isParallel if true, indices of different keys are built in parallel threads
+
+        \return number of added records
+    */
+    std::size_t CommitBatch(bool isParallel = false);
+
+    /**
+        \brief Method to create many records at once
+
+        Works the same way as calling CreateRecord inside BeginBatch and CommitBatch
+
+        \param [in] records vector with data of each record. Data is moved to the DataStorage
+        \param [in] isParallel if true, indices of different keys are built in parallel threads
+
+        \return number of added records
+    */
+    std::size_t BulkLoad(std::vector<std::vector<std::pair<std::string, DataSaver>>>&& records, bool isParallel = false);
+
+    /**
+        \brief Method to create records from the csv file
+
+        The first line of the file contains names of keys, and each next line is a record. Keys must be added to the DataStorage before importing,
+        since their types are known only at compile time. Columns without keys and keys whose type is not supported by DataStorageCsvCodec are skipped.
+        Empty fields get default values. If a field can not be parsed, no records are added.
+
+        The file is mapped to memory and split into chunks of whole lines, and each chunk is parsed directly to records without creating
+        intermediate strings, so the memory used is only the memory of the records. Records are parsed without locking the DataStorage,
+        and the write lock is taken only to add them to indices in one pass like in CommitBatch. If keys are changed while parsing, the file is parsed again under the write lock.
+        If the batch is active, see BeginBatch, the records are added to the batch.
+
+        \code
+            DataStorage ds;
+            ds.SetKey<std::string>("cpuName", "");
+            ds.SetKey("cores", 0);
+            ds.SetKey("powerPerf", 0.0);
+            DataStorageCsvError error;
+            if (!ds.ImportCsv("CPU_benchmark_v4.csv", true, 16 * 1024 * 1024, &error))
+                std::cerr << "Error at line " << error.Line << ", column " << error.Column << std::endl;
+        \endcode
+
+        \param [in] path path to the csv file
+        \param [in] isParallel if true, chunks are parsed and indices of different keys are built in parallel threads
+        \param [in] chunkSize approximate size of chunks in bytes
+        \param [out] error the position of the first field that can not be parsed, if it is not nullptr. Line is 0 if the file can not be opened
+
+        \return number of added records, or std::nullopt if the file can not be opened or a field can not be parsed
+    */
+    std::optional<std::size_t> ImportCsv(const std::string& path, bool isParallel = false, std::size_t chunkSize = 16 * 1024 * 1024, DataStorageCsvError* error = nullptr);
+
+    /**
+        \brief Method to save all records to the binary snapshot file
+
+        The file contains the names and types of keys and the values of each key of all records stored one after another.
+        Keys whose type is not supported by DataStorageSnapshotCodec are not saved. Records of an active batch are not saved.
+        The snapshot is written to the temporary file first and then renamed, so the previous snapshot is not damaged if saving fails.
+
+        \param [in] path path to the snapshot file
+
+        \return returns true if the snapshot was saved, otherwise false
+    */
+    bool SaveSnapshot(const std::string& path) const;
+
+    /**
+        \brief Method to replace all records with the records from the binary snapshot file
+
+        The file is mapped to memory and values are copied to records without parsing, then indices are built in one pass
+        like in CommitBatch. Keys must be added to the DataStorage before loading, since their types are known only at compile time.
+        Keys of the snapshot that do not exist in the DataStorage or have another type are skipped only if skippedColumnsCount is not nullptr,
+        otherwise the snapshot is not loaded. Keys of the DataStorage that are not in the snapshot get default values.
+        Type names depend on the compiler, so snapshots should be loaded by programs built by the same compiler.
+
+        \code
+            DataStorage ds;
+            ds.SetKey("id", 0);
+            ds.SetKey<std::string>("name", "");
+            ds.LoadSnapshot("ds.snapshot", true);
+        \endcode
+
+        \param [in] path path to the snapshot file
+        \param [in] isParallel if true, keys are loaded and indices of different keys are built in parallel threads
+        \param [out] skippedColumnsCount number of skipped keys of the snapshot, if it is not nullptr
+
+        The snapshot stores the LSN of the last entry of the write-ahead log included in it, so ReplayWal applies only later entries.
+        The snapshot can not be loaded while the write-ahead log is enabled, since loaded records are not written to the log,
+        and while the batch is active, see BeginBatch, since its records would be dropped.
+
+        \return returns true if the snapshot was loaded. If the file is not found or damaged, keys are skipped and skippedColumnsCount is nullptr,
+        the write-ahead log is enabled or the batch is active, false is returned and the DataStorage is not changed
+    */
+    bool LoadSnapshot(const std::string& path, bool isParallel = false, std::size_t* skippedColumnsCount = nullptr);
+
+    /**
+        \brief Method to enable the write-ahead log
+
+        After enabling, CreateRecord, EraseRecord, DataStorageRecordRef::SetData, SetKey, RemoveKey, DropData and DropDataStorage
+        append compact binary entries to the log, and the background thread writes them to the disk with one fsync for many entries.
+        Changes of keys whose type is not supported by DataStorageSnapshotCodec are not written.
+        The DataStorage is restored by loading the last snapshot and replaying the log:
+
+        \code
+            DataStorage ds;
+            ds.SetKey("id", 0);
+            ds.LoadSnapshot("ds.snapshot");
+            ds.ReplayWal("ds.wal");
+            ds.EnableWal("ds.wal");
+            ...
+            // Save all records and clear the log
+            ds.Checkpoint("ds.snapshot");
+        \endcode
+
+        \param [in] path path to the log file. New entries are appended to the file
+        \param [in] settings the commit interval and size, and whether changes wait for the disk, see DataStorageWalSettings
+
+        \return returns true if the log was opened, otherwise false
+    */
+    bool EnableWal(const std::string& path, const DataStorageWalSettings& settings = DataStorageWalSettings());
+
+    /// Method to disable the write-ahead log. All appended entries are written to the disk
+    void DisableWal();
+
+    /**
+        \brief Method to apply changes from the write-ahead log
+
+        Entries with LSN not greater than the LSN of the loaded snapshot are skipped. Replaying stops at the first damaged entry,
+        which can be left by a crash during writing. Keys added by the log must have types used by SetKey of this DataStorage before.
+        The log can not be replayed while it is enabled.
+
+        \param [in] path path to the log file. The missing file is an empty log
+
+        \return returns true if all correct entries were applied, otherwise false
+    */
+    bool ReplayWal(const std::string& path);
+
+    /**
+        \brief Method to save the snapshot and clear the write-ahead log
+
+        Changes are blocked while the snapshot is saved, so all entries of the log are included in the snapshot.
+        If the program crashes after saving the snapshot, but before clearing the log, ReplayWal skips the saved entries.
+
+        \param [in] snapshotPath path to the snapshot file
+
+        \return returns true if the snapshot was saved and the log was cleared, otherwise false
+    */
+    bool Checkpoint(const std::string& snapshotPath);
+
+    /// \brief Method for writing all entries of the write-ahead log to the disk immediately
+    /// \return returns true if the entries were written or the log is disabled, otherwise false
+    bool FlushWal();
+
+    /// \brief Method for getting the histogram of waits for the disk when IsSyncCommit is enabled, see DataStorageWal::GetCommitWaitHistogram
+    /// \return vector where the element i is the number of waits from 2^i to 2^(i+1) microseconds. Empty if the log is disabled
+    std::vector<std::size_t> GetWalCommitWaitHistogram() const;
+
+    /// A method for deleting all data and keys
+    void DropDataStorage();
+
+    /// A method for deleting all data, but keeping all keys
+    void DropData();
+
+    /// \brief Method for deleting a record from a DataStorage
+    /// \param recordRefToErase the reference to the record that needs to be deleted
+    void EraseRecord(const DataStorageRecordRef& recordRefToErase);
+
+    /**
+        \brief Method for changing several keys of the record at once
+
+        All changes are made under one write lock, so readers see either the old or the new values of all keys.
+        All values are checked first: if a key is not in the DataStorage, a value has a different type than the key
+        or the value of a unique key is already used by another record, then no keys are changed.
+        Only the changed keys are moved inside their indices, and keys with the same value are not reindexed. The record is not changed inside ForEachRecordInRange and other iterations
+        under the read lock, since the read lock can not be changed to the write lock.
+
+        \code
+            ds.UpdateRecord(recordRef, {{"age", 33}, {"name", std::string("Bob")}});
+        \endcode
+
+        \param [in] recordRef the reference to the record that needs to be changed
+        \param [in] params a vector of pairs with the names of keys and new values
+
+        \return returns true if the record was changed, otherwise false
+    */
+    bool UpdateRecord(const DataStorageRecordRef& recordRef, const std::vector<std::pair<std::string, DataSaver>>& params);
+
+    /// \brief Method for changing several keys of the record at once by moving values from params
+    /// Works the same way as UpdateRecord(const DataStorageRecordRef& recordRef, const std::vector<std::pair<std::string, DataSaver>>& params)
+    /// \param [in] recordRef the reference to the record that needs to be changed
+    /// \param [in] params a vector of pairs with the names of keys and new values to be moved to the record
+    /// \return returns true if the record was changed, otherwise false
+    bool UpdateRecord(const DataStorageRecordRef& recordRef, std::vector<std::pair<std::string, DataSaver>>&& params);
+
+    /// \brief Method for getting the number of records
+    /// \return number of records
+    std::size_t Size() const;
+
+    /**
+        \brief Method for setting the time after which the record is erased
+
+        Expired records are not returned by GetRecord and GetRecords by the key value, but other searches find them until they are erased.
+        Records are erased in the order of their expiry: each CreateRecord erases a few expired records, so the cost is spread over operations
+        and the DataStorage is never scanned, and EraseExpiredRecords erases them at once, for example from a background thread.
+        Erasures of expired records are written to the write-ahead log and change feeds like EraseRecord.
+        The time to live itself is not saved in snapshots and the write-ahead log.
+
+        \code
+            DataStorageRecordRef session = ds.CreateRecord({ {"token", token} });
+            ds.SetRecordTimeToLive(session, std::chrono::minutes(30));
+        \endcode
+
+        \param [in] recordRef the reference to the record
+        \param [in] timeToLive time from now until the record expires. If it is not greater than zero, the record does not expire anymore
+
+        \return returns true if the time was set, or false if the record was erased
+    */
+    bool SetRecordTimeToLive(const DataStorageRecordRef& recordRef, std::chrono::steady_clock::duration timeToLive);
+
+    /// \brief Method for erasing expired records at once, see SetRecordTimeToLive
+    /// \param [in] maxRecordsCount maximum number of records to erase, so the write lock is not held for long
+    /// \return number of erased records
+    std::size_t EraseExpiredRecords(std::size_t maxRecordsCount = std::numeric_limits<std::size_t>::max());
+
+    /**
+        \brief Method for limiting the number of records and the memory used by them
+
+        When records are created above the limits, other records are evicted by the CLOCK algorithm: all records are passed in a ring,
+        records found by GetRecord or GetRecords since the previous pass get a second chance, and the first record without it is erased.
+        So frequently read records stay in the DataStorage, and an eviction takes O(1) on average without ordering records by the time of use.
+        Evicted records are erased from the indices of all keys using their stored positions, and are written to the write-ahead log and change feeds like EraseRecord.
+
+        The memory is estimated the same way as by GetMemoryStats. Changes of records by SetData and UpdateRecord are counted,
+        but records are evicted only when records are created, so the memory can be above the limit until the next creation.
+
+        \param [in] maxRecordsCount maximum number of records or 0 for no limit
+        \param [in] maxBytes maximum memory of records in bytes or 0 for no limit
+    */
+    void SetCapacity(std::size_t maxRecordsCount, std::size_t maxBytes = 0);
+
+    /**
+        \brief Method for enabling or disabling collection of statistics
+
+        When statistics are enabled, durations of CreateRecord, GetRecord, EraseRecord, DataStorageRecordRef::SetData and UpdateRecord
+        and durations of waiting for and holding the lock are added to the histograms returned by GetStats.
+        When they are disabled, each operation only checks a flag and the clock is not read. Statistics are disabled by default.
+
+        \param [in] isEnabled should statistics be collected
+    */
+    void SetStatsEnabled(bool isEnabled);
+
+    /// \brief Method for checking whether statistics are collected
+    /// \return returns true if statistics are collected, otherwise false
+    bool IsStatsEnabled() const;
+
+    /// \brief Method for getting durations of operations and of the lock. They are not deleted when statistics are disabled
+    /// \return ref to the statistics. It is valid while the DataStorage exists and can be read while other threads change it
+    const DataStorageStats& GetStats() const;
+
+    /// Method for deleting all collected durations
+    void ResetStats();
+
+    /**
+        \brief Method for getting the state of the indices of all keys
+
+        Sizes of the indices, numbers of different values and load factors of the hash indices are found by visiting all records in the indices,
+        so it takes O(n) under the read lock. It is intended for diagnostics, not for frequent calls.
+        Keys without indices are returned with the index policy only. Composite indices are not returned.
+
+        \return statistics of all keys in no particular order
+    */
+    std::vector<DataStorageKeyStats> GetKeyStats() const;
+
+    /**
+        \brief Method for getting the memory used by records
+
+        All records are visited under the read lock, so it takes O(n). The indices are not counted.
+
+        \return estimated memory of records and values of their keys
+    */
+    DataStorageMemoryStats GetMemoryStats() const;
+
+    /// Default destructor 
+    ~DataStorage();
+};
+
+template <class R>
+DataStorageQuery& DataStorageQuery::Where(const std::string& keyName, const R& request)
+{
+    typedef typename R::ValueType T;
+
+    Predicate predicate;
+    predicate.KeyName = keyName;
+
+    predicate.CountFunc = [keyName, request](const DataStorage& dataStorage, std::size_t limit)
+        {
+            return dataStorage.CountRecordsInRange<T>(keyName, request, limit);
+        };
+
+    predicate.ForEachFunc = [keyName, request](const DataStorage& dataStorage, const std::function<bool(DataStorageRecord* record)>& func)
+        {
+            dataStorage.ForEachRecordPtrInRange<T>(keyName, request, func);
+        };
+
+    predicate.MatchFunc = [keyName, request](const DataStorageRecord* record)
+        {
+            T value;
+            return record->GetData(keyName, value) && request.IsMatch(value);
+        };
+
+    // Equal requests can be answered by composite indices, which store saved values of keys
+    if constexpr (std::is_same<R, Equal<T>>::value && DataStorageSnapshotCodec<T>::IsSupported)
+    {
+        predicate.SaveEqualValue = [request](std::string& out)
+            {
+                DataStorageSnapshotCodec<T>::Save(request.Value, out);
+            };
+    }
+
+    Predicates.emplace_back(std::move(predicate));
+    return *this;
+}
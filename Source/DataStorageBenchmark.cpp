@@ -0,0 +1,219 @@
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DataStorage.h"
+
+// Parse the number without a sign. Returns false if the string has other characters or the number is too big
+static bool ParseNumber(const std::string& str, std::size_t& res)
+{
+    if (str.empty() || str.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+
+    try
+    {
+        res = std::stoull(str);
+    }
+    catch (const std::out_of_range&)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+// Parse the list of numbers separated by commas, for example "1000,100000". Returns false if any number is invalid
+static bool ParseList(const std::string& str, std::vector<std::size_t>& res)
+{
+    res.clear();
+    std::stringstream ss(str);
+    std::string item;
+    std::size_t number;
+    while (std::getline(ss, item, ','))
+    {
+        if (item.empty())
+            continue;
+
+        if (!ParseNumber(item, number))
+            return false;
+
+        res.push_back(number);
+    }
+
+    return true;
+}
+
+// Print one line of the result in csv format
+static void PrintResult(const std::string& operation, std::size_t recordsCount, std::size_t cardinality, std::size_t threadsCount, std::size_t operations, double seconds)
+{
+    std::cout << operation << "," << recordsCount << "," << cardinality << "," << threadsCount << "," << operations << "," << seconds << ","
+        << static_cast<std::size_t>(operations / seconds) << std::endl;
+}
+
+// Call func(threadIndex, iteration) in each thread for a fixed time. Returns the total number of calls
+static std::size_t RunThreads(std::size_t threadsCount, int durationMs, double& seconds, const std::function<void(std::size_t, std::size_t)>& func)
+{
+    std::atomic_bool isStarted(false), isStopped(false);
+    std::vector<std::size_t> operations(threadsCount, 0);
+    std::vector<std::thread> threads;
+
+    for (std::size_t i = 0; i < threadsCount; ++i)
+        threads.emplace_back([&, i]()
+            {
+                while (!isStarted.load()) std::this_thread::yield();
+
+                std::size_t count = 0;
+                while (!isStopped.load(std::memory_order_relaxed))
+                {
+                    func(i, count);
+                    ++count;
+                }
+
+                operations[i] = count;
+            }
+        );
+
+    auto start = std::chrono::steady_clock::now();
+    isStarted.store(true);
+    std::this_thread::sleep_for(std::chrono::milliseconds(durationMs));
+    isStopped.store(true);
+
+    for (auto& it : threads)
+        it.join();
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::size_t total = 0;
+    for (auto& it : operations)
+        total += it;
+
+    return total;
+}
+
+/*
+    Benchmark of the main operations of DataStorage. For each number of records and each cardinality of the "group" key:
+    CreateRecord, EraseRecord and SetKey on populated storage are measured once in one thread,
+    GetRecord, SetData, range queries and combined queries are measured for a fixed time for each number of threads.
+    The result is printed in csv format.
+
+    Usage: DataStorageBenchmark [records counts] [cardinalities] [max threads count] [duration in milliseconds]
+    For example: DataStorageBenchmark 1000,1000000,100000000 10,10000 16 1000
+*/
+int main(int argc, char** argv)
+{
+    // Numbers of records inside DataStorage
+    std::vector<std::size_t> recordsCounts = { 1000, 100000, 1000000 };
+    // Numbers of different values of the "group" key
+    std::vector<std::size_t> cardinalities = { 16, 1024 };
+    // Maximum number of threads. Measurements are made for 1, 2, 4 ... threads
+    std::size_t maxThreadsCount = std::thread::hardware_concurrency();
+    // Duration of each measurement for a fixed time in milliseconds
+    int durationMs = 500;
+
+    std::size_t duration = durationMs;
+    if ((argc > 1 && !ParseList(argv[1], recordsCounts)) || (argc > 2 && !ParseList(argv[2], cardinalities)) ||
+        (argc > 3 && !ParseNumber(argv[3], maxThreadsCount)) || (argc > 4 && (!ParseNumber(argv[4], duration) || duration > 24 * 60 * 60 * 1000)))
+    {
+        std::cerr << "Usage: DataStorageBenchmark [records counts] [cardinalities] [max threads count] [duration in milliseconds]" << std::endl;
+        std::cerr << "For example: DataStorageBenchmark 1000,1000000,100000000 10,10000 16 1000" << std::endl;
+        return 1;
+    }
+    durationMs = static_cast<int>(duration);
+
+    if (maxThreadsCount < 1) maxThreadsCount = 1;
+
+    std::cout << "operation,records,cardinality,threads,operations,seconds,operations_per_second" << std::endl;
+
+    for (std::size_t recordsCount : recordsCounts)
+    {
+        if (recordsCount == 0) continue;
+
+        for (std::size_t cardinality : cardinalities)
+        {
+            if (cardinality == 0) continue;
+
+            DataStorage ds;
+            // Unique identifier of the record
+            ds.SetKey("id", -1, DataStorageIndexPolicy::HashIndex | DataStorageIndexPolicy::UniqueIndex);
+            // Key with the given number of different values
+            ds.SetKey("group", -1, DataStorageIndexPolicy::HashAndOrderedIndex);
+            // Key with pseudo random values changed by SetData
+            ds.SetKey("value", -1, DataStorageIndexPolicy::OrderedIndex);
+            // Payload without indices
+            ds.SetKey<std::string>("payload", "", DataStorageIndexPolicy::NoIndex);
+
+            // CreateRecord
+            std::vector<DataStorageRecordRef> records;
+            records.reserve(recordsCount);
+
+            auto start = std::chrono::steady_clock::now();
+            for (std::size_t i = 0; i < recordsCount; ++i)
+                records.push_back(ds.CreateRecord({ {"id", static_cast<int>(i)}, {"group", static_cast<int>(i % cardinality)},
+                    {"value", static_cast<int>((i * 7919) % recordsCount)}, {"payload", std::string("payload")} }));
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            PrintResult("CreateRecord", recordsCount, cardinality, 1, recordsCount, seconds);
+
+            for (std::size_t threadsCount = 1; threadsCount <= maxThreadsCount; threadsCount *= 2)
+            {
+                // GetRecord by the unique key
+                std::size_t operations = RunThreads(threadsCount, durationMs, seconds, [&](std::size_t thread, std::size_t iteration)
+                    {
+                        ds.GetRecord("id", static_cast<int>((thread + iteration * 7919) % recordsCount));
+                    }
+                );
+                PrintResult("GetRecord", recordsCount, cardinality, threadsCount, operations, seconds);
+
+                // SetData of the key with the ordered index
+                operations = RunThreads(threadsCount, durationMs, seconds, [&](std::size_t thread, std::size_t iteration)
+                    {
+                        std::size_t i = (thread + iteration * 7919) % recordsCount;
+                        records[i].SetData("value", static_cast<int>((i + iteration) % recordsCount));
+                    }
+                );
+                PrintResult("SetData", recordsCount, cardinality, threadsCount, operations, seconds);
+
+                // Range query over about 1% of the values of the "group" key
+                operations = RunThreads(threadsCount, durationMs, seconds, [&](std::size_t thread, std::size_t iteration)
+                    {
+                        int lowerBound = static_cast<int>((thread + iteration * 7919) % cardinality);
+                        std::size_t found = 0;
+                        ds.ForEachRecordInRange("group", Between<int>(lowerBound, lowerBound + static_cast<int>(cardinality / 100)),
+                            [&found](const DataStorageRecordRef&) { ++found; });
+                    }
+                );
+                PrintResult("RangeQuery", recordsCount, cardinality, threadsCount, operations, seconds);
+
+                // Combined query with an equal request and a range request on different keys
+                operations = RunThreads(threadsCount, durationMs, seconds, [&](std::size_t thread, std::size_t iteration)
+                    {
+                        DataStorageQuery query;
+                        query.Where("group", Equal<int>(static_cast<int>((thread + iteration * 7919) % cardinality)))
+                            .Where("value", Less<int>(static_cast<int>(recordsCount / 10)));
+
+                        std::size_t found = 0;
+                        ds.ForEachRecord(query, [&found](const DataStorageRecordRef&) { ++found; });
+                    }
+                );
+                PrintResult("CombinedQuery", recordsCount, cardinality, threadsCount, operations, seconds);
+            }
+
+            // SetKey on populated storage. Operations are the indexed records
+            start = std::chrono::steady_clock::now();
+            ds.SetKey("extra", 0, DataStorageIndexPolicy::HashAndOrderedIndex);
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            PrintResult("SetKey", recordsCount, cardinality, 1, recordsCount, seconds);
+
+            // EraseRecord
+            start = std::chrono::steady_clock::now();
+            for (auto& it : records)
+                ds.EraseRecord(it);
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            PrintResult("EraseRecord", recordsCount, cardinality, 1, recordsCount, seconds);
+        }
+    }
+}
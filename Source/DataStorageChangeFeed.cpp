@@ -0,0 +1,35 @@
+#include "DataStorageChangeFeed.h"
+
+DataStorageChangeFeed::DataStorageChangeFeed(std::size_t capacity) : Capacity(capacity) {}
+
+void DataStorageChangeFeed::Push(DataStorageChange&& change)
+{
+    std::lock_guard<std::mutex> lock(Mtx);
+
+    if (Changes.size() >= Capacity)
+    {
+        IsOverflowed = true;
+        return;
+    }
+
+    Changes.emplace_back(std::move(change));
+}
+
+bool DataStorageChangeFeed::Poll(std::vector<DataStorageChange>& changes)
+{
+    // The memory of the consumer vector is given to the feed, so the feed does not allocate memory again after each call
+    changes.clear();
+
+    std::lock_guard<std::mutex> lock(Mtx);
+    Changes.swap(changes);
+
+    bool res = !IsOverflowed;
+    IsOverflowed = false;
+    return res;
+}
+
+std::size_t DataStorageChangeFeed::Size() const
+{
+    std::lock_guard<std::mutex> lock(Mtx);
+    return Changes.size();
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "DataSaver.h"
+#include "DataStorageRecord.h"
+
+/// Types of changes of DataStorage sent to change feeds
+enum DataStorageChangeType : std::uint8_t
+{
+    /// A record was created. The record can be read using DataStorageChange::Record
+    CreateRecordChange = 1,
+    /// A record was erased
+    EraseRecordChange = 2,
+    /// The value of a key of a record was changed. Contains the name of the key, the old value and the new value
+    SetDataChange = 3,
+    /// All records were deleted
+    DropDataChange = 4,
+    /// All records and keys were deleted
+    DropDataStorageChange = 5
+};
+
+/// One change of DataStorage
+struct DataStorageChange
+{
+    /// Type of the change
+    DataStorageChangeType Type = DataStorageChangeType::CreateRecordChange;
+
+    /// Id of the changed record, the same as in the write-ahead log. Equal to 0 for changes of all records
+    std::uint64_t RecordId = 0;
+
+    /// Ref to the changed record. It becomes invalid when the record is erased, and it is invalid for erased records
+    DataStorageRecordRef Record;
+
+    /// Name of the changed key. Empty for changes other than SetDataChange
+    std::string KeyName;
+
+    /// Value of the key before the change. Empty for changes other than SetDataChange
+    DataSaver OldValue;
+
+    /// Value of the key after the change. Empty for changes other than SetDataChange
+    DataSaver NewValue;
+};
+
+/**
+    \brief A class for receiving changes of DataStorage
+
+    The feed is created by DataStorage::Subscribe. DataStorage appends each change to the feed while it changes the records,
+    and the consumer takes all accumulated changes at once using Poll, so the consumer works in O(changes) instead of comparing all records.
+    Appending only adds the change to the vector under the mutex of the feed, and Poll swaps the vector, so the DataStorage never waits for the consumer.
+    If the consumer does not take changes and the feed reaches its capacity, new changes are dropped and the feed is marked as overflowed,
+    so the consumer knows that it must read all records again.
+
+    \code
+        std::shared_ptr<DataStorageChangeFeed> feed = ds.Subscribe();
+        std::vector<DataStorageChange> changes;
+        while (isRunning)
+        {
+            feed->Poll(changes);
+            for (auto& it : changes)
+                cache.Apply(it);
+        }
+        ds.Unsubscribe(feed);
+    \endcode
+
+    All methods are thread safe.
+*/
+class DataStorageChangeFeed
+{
+private:
+    // Changes not taken by the consumer
+    std::vector<DataStorageChange> Changes;
+
+    // Maximum number of changes not taken by the consumer
+    std::size_t Capacity;
+
+    // Were changes dropped since the last Poll
+    bool IsOverflowed = false;
+
+    // Mutex for all members
+    mutable std::mutex Mtx;
+
+public:
+    /// \brief Constructor
+    /// \param [in] capacity maximum number of changes not taken by the consumer. Changes above it are dropped
+    DataStorageChangeFeed(std::size_t capacity);
+
+    /// Deleted copy constructor
+    DataStorageChangeFeed(const DataStorageChangeFeed& other) = delete;
+
+    /// Deleted assign operator
+    DataStorageChangeFeed& operator= (const DataStorageChangeFeed& other) = delete;
+
+    /// \brief Method for adding the change to the feed. Called by DataStorage
+    /// \param [in] change the change to be moved to the feed
+    void Push(DataStorageChange&& change);
+
+    /**
+        \brief Method for taking all changes accumulated since the last call
+
+        \param [out] changes vector to which the changes are written. Its previous content is deleted, and its memory is reused by the feed
+
+        \return returns false if some changes were dropped since the last call because of the capacity, otherwise true
+    */
+    bool Poll(std::vector<DataStorageChange>& changes);
+
+    /// \brief Method for getting the number of changes not taken by the consumer
+    /// \return number of changes
+    std::size_t Size() const;
+};
@@ -1,5 +1,58 @@
 #pragma once
 
+#include <functional>
+#include <map>
+
+#include "MemoryPool.h"
+
 class DataStorage;
 class DataStorageRecord;
-class DataStorageRecordRef;
\ No newline at end of file
+class DataStorageRecordRef;
+class DataStorageQuery;
+class DataStorageKeyIndexBase;
+class ShardedDataStorage;
+
+template <class T>
+class DataStorageKeyIndex;
+
+/**
+    \brief Indices maintained by DataStorage for a key
+
+    Flags can be combined using the | operator. The policy is passed to DataStorage::SetKey.
+*/
+enum DataStorageIndexPolicy : unsigned
+{
+    /// No indices. The key is only stored inside records. Searching by this key checks all records
+    NoIndex = 0,
+
+    /// Hash index. Used by DataStorage::GetRecord to find records in O(1)
+    HashIndex = 1,
+
+    /// Ordered index. Used to find records in O(log n) and to get sets of records in a range of values
+    OrderedIndex = 2,
+
+    /// Hash and ordered indices
+    HashAndOrderedIndex = HashIndex | OrderedIndex,
+
+    /// The values of the key are unique. Records with already used values are not created or changed.
+    /// Requires an index, if neither HashIndex, FlatHashIndex nor OrderedIndex is set, then HashIndex is added
+    UniqueIndex = 4,
+
+    /// Flat hash index, see ConcurrentFlatHashMultiMap. Used by DataStorage::GetRecord instead of HashIndex, if both are set.
+    /// Records with equal values are stored in one array, so it takes less memory and is faster for keys with many equal values
+    FlatHashIndex = 8
+};
+
+/// \brief Operator to combine index policy flags
+/// \param [in] a first flags
+/// \param [in] b second flags
+/// \return combined flags
+constexpr DataStorageIndexPolicy operator|(DataStorageIndexPolicy a, DataStorageIndexPolicy b)
+{
+    return static_cast<DataStorageIndexPolicy>(static_cast<unsigned>(a) | static_cast<unsigned>(b));
+}
+
+/// \brief Ordered index of the key in DataStorage. Nodes are allocated from the MemoryPool of the DataStorage
+/// \tparam <T> Type of the key values
+template <class T>
+using DataStorageOrderedIndex = std::multimap<T, DataStorageRecord*, std::less<T>, PoolAllocator<std::pair<const T, DataStorageRecord*>>>;
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "DataStorageKeyIndex.h"
+
+/**
+    \brief Index of DataStorage over the values of several keys
+
+    The value of the index is the concatenation of the values of its keys saved by DataStorageSnapshotCodec, so records are found
+    by all keys with one search in the hash, flat hash or ordered index. The keys are saved in the order of the index,
+    and the values are compared by their saved bytes. The ordered index orders records by these bytes too,
+    so it is used only to find equal values.
+
+    Values of the index are not stored in records. The value is built from the keys of the record when the record is added to the index or erased from it,
+    so the record must be erased from the index before changing any of its keys, and added back after that, see DataStorage::AddCompositeIndex.
+    Unlike DataStorageKeyIndex, the index owns its hash and ordered indices, since they are used only under the lock of DataStorage.
+*/
+class DataStorageCompositeIndex : public DataStorageKeyIndex<std::string>
+{
+private:
+    // Names of the keys of the index
+    std::vector<std::string> KeyNames;
+
+    // Functions to append the saved value of each key of the record to the string
+    std::vector<std::function<void(const DataStorageRecord* record, std::string& out)>> SaveValueFuncs;
+
+public:
+    /**
+        \brief Constructor
+
+        \param [in] indexName name of the index. It is returned by GetKeyName
+        \param [in] keyNames names of the keys of the index
+        \param [in] saveValueFuncs functions to append the saved value of each key of the record to the string
+        \param [in] hashIndex hash index of the values or nullptr. The composite index becomes its owner
+        \param [in] flatHashIndex flat hash index of the values or nullptr. The composite index becomes its owner
+        \param [in] orderedIndex ordered index of the values or nullptr. The composite index becomes its owner
+    */
+    DataStorageCompositeIndex(const std::string& indexName, const std::vector<std::string>& keyNames,
+        const std::vector<std::function<void(const DataStorageRecord* record, std::string& out)>>& saveValueFuncs,
+        ConcurrentHashMultiMap<std::string, DataStorageRecord*>* hashIndex, ConcurrentFlatHashMultiMap<std::string, DataStorageRecord*>* flatHashIndex,
+        DataStorageOrderedIndex<std::string>* orderedIndex) :
+        DataStorageKeyIndex<std::string>(indexName, std::string(), false, hashIndex, flatHashIndex, orderedIndex), KeyNames(keyNames), SaveValueFuncs(saveValueFuncs) {}
+
+    /// Deleted copy constructor
+    DataStorageCompositeIndex(const DataStorageCompositeIndex& other) = delete;
+
+    /// Deleted assign operator
+    DataStorageCompositeIndex& operator= (const DataStorageCompositeIndex& other) = delete;
+
+    /// \brief Method for getting the names of the keys of the index
+    /// \return names of the keys in the order of the index
+    const std::vector<std::string>& GetKeyNames() const
+    {
+        return KeyNames;
+    }
+
+    /// \brief Method for checking whether the key is one of the keys of the index
+    /// \param [in] keyName the name of the key
+    /// \return returns true if the index contains the key, otherwise false
+    bool IsKeyUsed(const std::string& keyName) const
+    {
+        for (auto& it : KeyNames)
+            if (it == keyName)
+                return true;
+
+        return false;
+    }
+
+    /// \brief Method for getting the value of the index for the record
+    /// \param [in] record the record
+    /// \return saved values of all keys of the record
+    std::string GetCompositeValue(const DataStorageRecord* record) const
+    {
+        std::string res;
+        for (auto& it : SaveValueFuncs)
+            it(record, res);
+
+        return res;
+    }
+
+    /**
+        \brief Method for counting records with the value
+
+        \param [in] value saved values of all keys, see GetCompositeValue
+        \param [in] limit counting stops at this number
+
+        \return number of records with the value, but not greater than limit
+    */
+    std::size_t CountEqual(const std::string& value, std::size_t limit) const
+    {
+        std::size_t res = 0;
+        ForEachEqual(value, [&res, limit](DataStorageRecord*) { return ++res < limit; });
+        return res;
+    }
+
+    /**
+        \brief Method for iterating over records with the value
+
+        \tparam <F> Function or lambda function with the signature bool(DataStorageRecord* record). If the function returns false, the iteration stops
+
+        \param [in] value saved values of all keys, see GetCompositeValue
+        \param [in] func function to be called for each found record
+    */
+    template <class F>
+    void ForEachEqual(const std::string& value, F&& func) const
+    {
+        bool isStopped = false;
+        auto callFunc = [&func, &isStopped](DataStorageRecord* record)
+            {
+                if (!isStopped)
+                    isStopped = !func(record);
+            };
+
+        if (HashIndex != nullptr)
+            HashIndex->ForEachEqual(value, callFunc);
+        else if (FlatHashIndex != nullptr)
+            FlatHashIndex->ForEachEqual(value, callFunc);
+        else
+        {
+            auto FirstAndLastIteratorsWithKeyOnMap = OrderedIndex->equal_range(value);
+            for (auto it = FirstAndLastIteratorsWithKeyOnMap.first; it != FirstAndLastIteratorsWithKeyOnMap.second && !isStopped; ++it)
+                callFunc(it->second);
+        }
+    }
+
+    bool IsUniqueValueFree(const DataStorageRecord*) const override
+    {
+        return true;
+    }
+
+    void Insert(DataStorageRecord* record) override
+    {
+        InsertValue(GetCompositeValue(record), record);
+    }
+
+    void BulkInsert(const std::vector<DataStorageRecord*>& records) override
+    {
+        std::vector<std::string> values;
+        values.reserve(records.size());
+        for (auto& it : records)
+            values.emplace_back(GetCompositeValue(it));
+
+        std::vector<std::pair<const std::string*, DataStorageRecord*>> valuePtrs;
+        valuePtrs.reserve(records.size());
+        for (std::size_t i = 0; i < records.size(); ++i)
+            valuePtrs.emplace_back(&values[i], records[i]);
+
+        BulkInsertValues(valuePtrs);
+    }
+
+    void Erase(DataStorageRecord* record) override
+    {
+        EraseValue(GetCompositeValue(record), record);
+    }
+
+    /// Values of the index are changed only by changing its keys
+    bool IsUpdatePossible(const DataStorageRecord*, const DataSaver&) const override
+    {
+        return false;
+    }
+
+    /// Values of the index are changed only by changing its keys
+    bool Update(DataStorageRecord*, const DataSaver&) override
+    {
+        return false;
+    }
+
+    /// Destructor. Deletes the hash and ordered indices
+    ~DataStorageCompositeIndex()
+    {
+        delete HashIndex;
+        delete FlatHashIndex;
+        delete OrderedIndex;
+    }
+};
@@ -0,0 +1,114 @@
+#include "DataStorageCsv.h"
+
+#include <algorithm>
+
+std::vector<std::pair<const char*, const char*>> DataStorageCsvParser::SplitChunks(const char* begin, const char* end, std::size_t chunkSize)
+{
+    std::vector<std::pair<const char*, const char*>> res;
+    chunkSize = std::max<std::size_t>(chunkSize, 1);
+
+    const char* chunkBegin = begin;
+    while (chunkBegin != end)
+    {
+        if (static_cast<std::size_t>(end - chunkBegin) <= chunkSize)
+        {
+            res.emplace_back(chunkBegin, end);
+            break;
+        }
+
+        // Line breaks after an odd number of quotes are inside a quoted field. Escaped quotes are doubled, so they do not change the parity
+        const char* ptr = chunkBegin + chunkSize;
+        bool isEscaping = std::count(chunkBegin, ptr, '"') % 2 != 0;
+
+        for (; ptr != end; ++ptr)
+        {
+            if (*ptr == '"')
+                isEscaping = !isEscaping;
+            else if (*ptr == '\n' && !isEscaping)
+            {
+                ++ptr;
+                break;
+            }
+        }
+
+        res.emplace_back(chunkBegin, ptr);
+        chunkBegin = ptr;
+    }
+
+    return res;
+}
+
+void DataStorageCsvParser::ParseLine(const char*& ptr, const char* end, std::vector<std::pair<const char*, const char*>>& fields, std::vector<std::string>& unescapedFields)
+{
+    fields.clear();
+
+    while (true)
+    {
+        if (ptr != end && *ptr == '"')
+        {
+            // Quoted field is copied without quotes. Its pointers are set after the line, since unescapedFields can be reallocated
+            if (unescapedFields.size() <= fields.size())
+                unescapedFields.resize(fields.size() + 1);
+
+            std::string& field = unescapedFields[fields.size()];
+            field.clear();
+            ++ptr;
+
+            while (ptr != end)
+            {
+                const char* quote = std::find(ptr, end, '"');
+                field.append(ptr, quote);
+                ptr = quote;
+
+                if (ptr == end)
+                    break;
+
+                // Two quotes inside the quoted field are one quote
+                ++ptr;
+                if (ptr != end && *ptr == '"')
+                {
+                    field += '"';
+                    ++ptr;
+                }
+                else
+                    break;
+            }
+
+            // Skip symbols between the closing quote and the separator
+            while (ptr != end && *ptr != ',' && *ptr != '\n' && *ptr != '\r')
+                ++ptr;
+
+            fields.emplace_back(nullptr, nullptr);
+        }
+        else
+        {
+            // Unquoted field points to the data
+            const char* fieldBegin = ptr;
+            while (ptr != end && *ptr != ',' && *ptr != '\n' && *ptr != '\r')
+                ++ptr;
+
+            fields.emplace_back(fieldBegin, ptr);
+        }
+
+        if (ptr == end)
+            break;
+
+        if (*ptr == ',')
+        {
+            ++ptr;
+            continue;
+        }
+
+        // Skip LF or CRLF
+        if (*ptr == '\r')
+            ++ptr;
+        if (ptr != end && *ptr == '\n')
+            ++ptr;
+
+        break;
+    }
+
+    for (std::size_t i = 0; i < fields.size(); ++i)
+        if (fields[i].first == nullptr)
+            fields[i] = {unescapedFields[i].data(), unescapedFields[i].data() + unescapedFields[i].size()};
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+    \brief A template class for parsing values of keys from csv fields
+
+    \tparam <T> Any type of data except for c arrays
+
+    Numbers are parsed using std::from_chars without creating strings. bool is parsed from true, false, 1 and 0.
+    Keys of other types are not parsed. If you plan to import keys of a custom type, you can specialize this class for the type.
+*/
+template <class T>
+struct DataStorageCsvCodec
+{
+    /// Can values of the type be parsed from csv
+    static constexpr bool IsSupported = std::is_arithmetic<T>::value;
+
+    /**
+        \brief Method for parsing the value
+
+        \param [in] begin beginning of the field
+        \param [in] end end of the field
+        \param [out] value the parsed value
+
+        \return returns true if the whole field is the value, otherwise false
+    */
+    static bool Parse(const char* begin, const char* end, T& value)
+    {
+        if constexpr (std::is_same<T, bool>::value)
+        {
+            std::string_view field(begin, end - begin);
+            if (field == "true" || field == "1")
+                value = true;
+            else if (field == "false" || field == "0")
+                value = false;
+            else
+                return false;
+
+            return true;
+        }
+        else
+        {
+            // from_chars does not skip the plus sign
+            if (begin != end && *begin == '+')
+                ++begin;
+
+            auto res = std::from_chars(begin, end, value);
+            return res.ec == std::errc() && res.ptr == end;
+        }
+    }
+};
+
+/// Specialization of DataStorageCsvCodec for std::string. The field is copied to the string
+template <>
+struct DataStorageCsvCodec<std::string>
+{
+    /// Strings can be parsed from csv
+    static constexpr bool IsSupported = true;
+
+    /// \brief Method for parsing the string
+    /// \param [in] begin beginning of the field
+    /// \param [in] end end of the field
+    /// \param [out] value the parsed string
+    /// \return true
+    static bool Parse(const char* begin, const char* end, std::string& value)
+    {
+        value.assign(begin, end);
+        return true;
+    }
+};
+
+/// Position of the field that can not be parsed by DataStorage::ImportCsv
+struct DataStorageCsvError
+{
+    /// Number of the line starting from 1 for the line with names of keys. Lines inside quoted fields are not counted.
+    /// Equal to 0 if the file can not be opened
+    std::size_t Line = 0;
+
+    /// Number of the column starting from 1
+    std::size_t Column = 0;
+};
+
+/**
+    \brief A class with functions for splitting csv data
+
+    Fields are separated by commas, and lines are separated by LF or CRLF. Fields with commas, quotes or line breaks
+    are placed in double quotes, and quotes inside them are duplicated, see RFC 4180.
+*/
+class DataStorageCsvParser
+{
+public:
+    /**
+        \brief Method for splitting the data into parts of whole lines
+
+        Quotes are counted to find line breaks outside of quoted fields, so each part can be parsed by its own thread.
+
+        \param [in] begin beginning of the data
+        \param [in] end end of the data
+        \param [in] chunkSize approximate size of parts in bytes
+
+        \return vector of the beginnings and ends of parts
+    */
+    static std::vector<std::pair<const char*, const char*>> SplitChunks(const char* begin, const char* end, std::size_t chunkSize);
+
+    /**
+        \brief Method for splitting one line into fields
+
+        \param [in, out] ptr beginning of the line. Moved to the beginning of the next line
+        \param [in] end end of the data
+        \param [out] fields beginnings and ends of fields. Unquoted fields point to the data, and quoted fields point to unescapedFields
+        \param [out] unescapedFields strings to store quoted fields without quotes. Reused between lines to avoid allocations
+    */
+    static void ParseLine(const char*& ptr, const char* end, std::vector<std::pair<const char*, const char*>>& fields, std::vector<std::string>& unescapedFields);
+};
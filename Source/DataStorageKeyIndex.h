@@ -0,0 +1,469 @@
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ConcurrentHashMultiMap.h"
+#include "ConcurrentFlatHashMultiMap.h"
+#include "DataStorageRecord.h"
+#include "DataStorageStats.h"
+
+/**
+    \brief Base class for indices of DataStorage keys
+
+    Provides an interface that does not depend on the type of the key.
+    DataStorage keeps indices of all keys in a vector and calls them for each created, changed or erased record,
+    so the functions to update indices are not searched by the key name.
+    Each record stores its positions inside the indices at the id of the index, see DataStorageRecord::IndexPositions.
+*/
+class DataStorageKeyIndexBase
+{
+protected:
+    // Number of the index inside DataStorage. Used to find positions of records
+    std::size_t Id = 0;
+
+public:
+    /// \brief Method for setting the number of the index inside DataStorage
+    /// \param [in] id the number of the index
+    void SetId(std::size_t id) { Id = id; }
+
+    /// \brief Method for getting the number of the index inside DataStorage
+    /// \return the number of the index
+    std::size_t GetId() const { return Id; }
+
+    /// \brief Method for getting the name of the key
+    /// \return name of the key
+    virtual const std::string& GetKeyName() const = 0;
+
+    /// \brief Method for checking whether the values of the key are unique
+    /// \return returns true if the key has UniqueIndex policy, otherwise false
+    virtual bool IsUnique() const = 0;
+
+    /// \brief Method for checking that the value of the record is not used by other records
+    /// \param [in] record the record to check
+    /// \return returns true if the value is not used by other records, otherwise false
+    virtual bool IsUniqueValueFree(const DataStorageRecord* record) const = 0;
+
+    /// \brief Method for adding the record to the index
+    /// \param [in] record the record to add
+    virtual void Insert(DataStorageRecord* record) = 0;
+
+    /// \brief Method for adding many records to the index in one pass
+    /// \param [in] records the records to add
+    virtual void BulkInsert(const std::vector<DataStorageRecord*>& records) = 0;
+
+    /// \brief Method for erasing the record from the index. The stored position is used, so the time does not depend on the number of equal values
+    /// \param [in] record the record to erase
+    virtual void Erase(DataStorageRecord* record) = 0;
+
+    /// Method for storing positions of all records inside the index. Used when the index was filled without DataStorageKeyIndex
+    virtual void UpdatePositions() = 0;
+
+    /// \brief Method for checking that the value can be set to the record by Update
+    /// \param [in] record the record to change
+    /// \param [in] newValue the new value
+    /// \return returns true if the value has the key type and is not used by other records if the key is unique, otherwise false
+    virtual bool IsUpdatePossible(const DataStorageRecord* record, const DataSaver& newValue) const = 0;
+
+    /**
+        \brief Method for changing the value of the key of the record and moving the record inside the index
+
+        If the new value is equal to the current one, the record is not moved.
+
+        \param [in] record the record to change
+        \param [in] newValue the new value. It must store data of the key type
+
+        \return returns true if the value was changed, or false if the type is different or the unique value is already used
+    */
+    virtual bool Update(DataStorageRecord* record, const DataSaver& newValue) = 0;
+
+    /// Method for erasing all records from the index
+    virtual void Clear() = 0;
+
+    /// \brief Method for getting the sizes of the indices. All records are visited, so it takes O(n). Only for the writer
+    /// \param [out] stats the statistics to fill. The name of the key and the index policy are not changed
+    virtual void GetStats(DataStorageKeyStats& stats) const = 0;
+
+    /// Default virtual destructor
+    virtual ~DataStorageKeyIndexBase() {}
+};
+
+/**
+    \brief Index of DataStorage key
+
+    \tparam <T> The type of the key
+
+    Works with the hash or flat hash index and the ordered index of the key. The indices are owned by DataStorage structures, see DataStorageStructureHashMap,
+    and are not deleted by this class. The values of records are read without copying.
+    The node of the hash index or the number of the record in the flat hash index, and the iterator of the ordered index are stored in the record,
+    so the record is erased from indices without searching it among records with equal values.
+*/
+template <class T>
+class DataStorageKeyIndex : public DataStorageKeyIndexBase
+{
+protected:
+    // Name of the key
+    std::string KeyName;
+
+    // Default value of the key. Used for records without the value
+    T DefaultKeyValue;
+
+    // Are the values of the key unique
+    bool IsUniqueKey;
+
+    // Hash index of the key. Equal to nullptr if the key does not have the hash index
+    ConcurrentHashMultiMap<T, DataStorageRecord*>* HashIndex;
+
+    // Flat hash index of the key. Equal to nullptr if the key does not have the flat hash index
+    ConcurrentFlatHashMultiMap<T, DataStorageRecord*>* FlatHashIndex;
+
+    // Ordered index of the key. Equal to nullptr if the key does not have the ordered index
+    DataStorageOrderedIndex<T>* OrderedIndex;
+
+    typedef typename ConcurrentHashMultiMap<T, DataStorageRecord*>::Position HashPosition;
+    typedef typename DataStorageOrderedIndex<T>::iterator OrderedIterator;
+
+    // Iterators of the ordered index are stored in the record if they fit in the place of a pointer, otherwise the record is searched
+    static constexpr bool IsOrderedIteratorStored = sizeof(OrderedIterator) <= sizeof(void*) && alignof(OrderedIterator) <= alignof(void*) &&
+        std::is_trivially_copyable<OrderedIterator>::value && std::is_trivially_destructible<OrderedIterator>::value;
+
+    // Store the iterator of the ordered index in the position
+    static void SetOrderedPosition(DataStorageIndexPosition& position, const OrderedIterator& it)
+    {
+        if constexpr (IsOrderedIteratorStored)
+            new (&position.OrderedNode) OrderedIterator(it);
+    }
+
+    // Get the iterator of the ordered index from the position
+    static const OrderedIterator& GetOrderedPosition(const DataStorageIndexPosition& position)
+    {
+        return *std::launder(reinterpret_cast<const OrderedIterator*>(&position.OrderedNode));
+    }
+
+    // Store positions of all records in the hash index. Positions of all nodes change when the hash index is rehashed
+    void UpdateHashPositions()
+    {
+        std::size_t id = Id;
+        HashIndex->ForEachPosition([id](DataStorageRecord* record, HashPosition position)
+            {
+                record->IndexPositions[id].HashNode = position;
+            }
+        );
+    }
+
+    // Store positions of all records in the flat hash index
+    void UpdateFlatHashPositions()
+    {
+        std::size_t id = Id;
+        FlatHashIndex->ForEachPosition([id](DataStorageRecord* record, std::size_t position)
+            {
+                record->IndexPositions[id].FlatHashItem = position;
+            }
+        );
+    }
+
+    // Get the value of the key of the record
+    const T& GetValue(const DataStorageRecord* record) const
+    {
+        const T* value = record->GetDataPtr<T>(KeyName);
+        return value != nullptr ? *value : DefaultKeyValue;
+    }
+
+    // Add the record with the value to the indices and store its positions
+    void InsertValue(const T& value, DataStorageRecord* record)
+    {
+        DataStorageIndexPosition& position = record->IndexPositions[Id];
+
+        if (HashIndex != nullptr)
+        {
+            std::size_t rehashesCount = HashIndex->GetRehashesCount();
+            position.HashNode = HashIndex->Emplace(value, record);
+
+            // Rehashing takes linear time, so updating all positions does not change the amortized time of insertion
+            if (rehashesCount != HashIndex->GetRehashesCount())
+                UpdateHashPositions();
+        }
+
+        // Positions in the flat hash index do not change when it is rehashed
+        if (FlatHashIndex != nullptr)
+            position.FlatHashItem = FlatHashIndex->Emplace(value, record);
+
+        if (OrderedIndex != nullptr)
+            SetOrderedPosition(position, OrderedIndex->emplace(value, record));
+    }
+
+    // Erase the record with the value from the indices using its positions
+    void EraseValue(const T& value, DataStorageRecord* record)
+    {
+        const DataStorageIndexPosition& position = record->IndexPositions[Id];
+
+        if (HashIndex != nullptr)
+            HashIndex->Erase(static_cast<HashPosition>(position.HashNode));
+
+        // The last record with the value is moved to the place of the erased one
+        if (FlatHashIndex != nullptr)
+        {
+            std::size_t id = Id;
+            FlatHashIndex->Erase(value, position.FlatHashItem, [id](DataStorageRecord* movedRecord, std::size_t newPosition)
+                {
+                    movedRecord->IndexPositions[id].FlatHashItem = newPosition;
+                }
+            );
+        }
+
+        if constexpr (IsOrderedIteratorStored)
+        {
+            if (OrderedIndex != nullptr)
+                OrderedIndex->erase(GetOrderedPosition(position));
+        }
+        else if (OrderedIndex != nullptr)
+        {
+            // Find all elements on map with the value and erase the record
+            auto FirstAndLastIteratorsWithKeyOnMap = OrderedIndex->equal_range(value);
+            for (auto it = FirstAndLastIteratorsWithKeyOnMap.first; it != FirstAndLastIteratorsWithKeyOnMap.second; ++it)
+            {
+                if (it->second == record)
+                {
+                    OrderedIndex->erase(it);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Add many records with their values to the indices in one pass. The values are sorted for the ordered index
+    void BulkInsertValues(std::vector<std::pair<const T*, DataStorageRecord*>>& values)
+    {
+        // Allocate all buckets at once, so that the hash map is not rehashed while filling
+        if (HashIndex != nullptr)
+        {
+            std::size_t rehashesCount = HashIndex->GetRehashesCount();
+            HashIndex->Reserve(HashIndex->Size() + values.size());
+
+            // Positions of records added earlier are changed by rehashing
+            if (rehashesCount != HashIndex->GetRehashesCount())
+                UpdateHashPositions();
+
+            for (auto& it : values)
+                it.second->IndexPositions[Id].HashNode = HashIndex->Emplace(*it.first, it.second);
+        }
+
+        // Equal values are added to the array of their entry, so the flat hash index is rehashed only for new values
+        if (FlatHashIndex != nullptr)
+        {
+            for (auto& it : values)
+                it.second->IndexPositions[Id].FlatHashItem = FlatHashIndex->Emplace(*it.first, it.second);
+        }
+
+        if (OrderedIndex != nullptr)
+        {
+            // Sorted values are added to the end of the empty map in O(1) each
+            std::stable_sort(values.begin(), values.end(), [](const std::pair<const T*, DataStorageRecord*>& a, const std::pair<const T*, DataStorageRecord*>& b)
+                {
+                    return *a.first < *b.first;
+                }
+            );
+
+            if (OrderedIndex->empty())
+            {
+                for (auto& it : values)
+                    SetOrderedPosition(it.second->IndexPositions[Id], OrderedIndex->emplace_hint(OrderedIndex->end(), *it.first, it.second));
+            }
+            else
+            {
+                for (auto& it : values)
+                    SetOrderedPosition(it.second->IndexPositions[Id], OrderedIndex->emplace(*it.first, it.second));
+            }
+        }
+    }
+
+public:
+    /**
+        \brief Constructor
+
+        \param [in] keyName name of the key
+        \param [in] defaultKeyValue default value of the key
+        \param [in] isUnique are the values of the key unique
+        \param [in] hashIndex hash index of the key or nullptr
+        \param [in] flatHashIndex flat hash index of the key or nullptr. The key can not have both hash indices
+        \param [in] orderedIndex ordered index of the key or nullptr
+    */
+    DataStorageKeyIndex(const std::string& keyName, const T& defaultKeyValue, bool isUnique, ConcurrentHashMultiMap<T, DataStorageRecord*>* hashIndex,
+        ConcurrentFlatHashMultiMap<T, DataStorageRecord*>* flatHashIndex, DataStorageOrderedIndex<T>* orderedIndex) :
+        KeyName(keyName), DefaultKeyValue(defaultKeyValue), IsUniqueKey(isUnique), HashIndex(hashIndex), FlatHashIndex(flatHashIndex), OrderedIndex(orderedIndex) {}
+
+    const std::string& GetKeyName() const override { return KeyName; }
+
+    bool IsUnique() const override { return IsUniqueKey; }
+
+    /// \brief Method for checking that the value is not used by records other than the record
+    /// \param [in] value the value to check
+    /// \param [in] record the record which can use the value
+    /// \return returns true if the value is not used by other records, otherwise false
+    bool IsUniqueValueFree(const T& value, const DataStorageRecord* record) const
+    {
+        DataStorageRecord* foundedRecord = nullptr;
+        if (HashIndex != nullptr)
+            return !HashIndex->Find(value, foundedRecord) || foundedRecord == record;
+
+        if (FlatHashIndex != nullptr)
+            return !FlatHashIndex->Find(value, foundedRecord) || foundedRecord == record;
+
+        auto it = OrderedIndex->find(value);
+        return it == OrderedIndex->end() || it->second == record;
+    }
+
+    bool IsUniqueValueFree(const DataStorageRecord* record) const override
+    {
+        return IsUniqueValueFree(GetValue(record), record);
+    }
+
+    void Insert(DataStorageRecord* record) override
+    {
+        InsertValue(GetValue(record), record);
+    }
+
+    void BulkInsert(const std::vector<DataStorageRecord*>& records) override
+    {
+        std::vector<std::pair<const T*, DataStorageRecord*>> values;
+        values.reserve(records.size());
+        for (auto& it : records)
+            values.emplace_back(&GetValue(it), it);
+
+        BulkInsertValues(values);
+    }
+
+    void Erase(DataStorageRecord* record) override
+    {
+        EraseValue(GetValue(record), record);
+    }
+
+    void UpdatePositions() override
+    {
+        if (HashIndex != nullptr)
+            UpdateHashPositions();
+
+        if (FlatHashIndex != nullptr)
+            UpdateFlatHashPositions();
+
+        if constexpr (IsOrderedIteratorStored)
+        {
+            if (OrderedIndex != nullptr)
+                for (auto it = OrderedIndex->begin(); it != OrderedIndex->end(); ++it)
+                    SetOrderedPosition(it->second->IndexPositions[Id], it);
+        }
+    }
+
+    /**
+        \brief Method for changing the value of the key of the record and moving the record inside the index
+
+        \param [in] record the record to change
+        \param [in] newValue the new value
+
+        \return returns true if the value was changed, or false if the unique value is already used
+    */
+    bool Update(DataStorageRecord* record, const T& newValue)
+    {
+        // The record stays at its place inside the indices
+        if (GetValue(record) == newValue)
+            return true;
+
+        if (IsUniqueKey && !IsUniqueValueFree(newValue, record))
+            return false;
+
+        EraseValue(GetValue(record), record);
+        record->SetData(KeyName, newValue);
+        InsertValue(GetValue(record), record);
+        return true;
+    }
+
+    bool IsUpdatePossible(const DataStorageRecord* record, const DataSaver& newValue) const override
+    {
+        const T* value = newValue.GetDataPtr<T>();
+        return value != nullptr && (!IsUniqueKey || IsUniqueValueFree(*value, record));
+    }
+
+    bool Update(DataStorageRecord* record, const DataSaver& newValue) override
+    {
+        const T* value = newValue.GetDataPtr<T>();
+        if (value == nullptr)
+            return false;
+
+        return Update(record, *value);
+    }
+
+    void GetStats(DataStorageKeyStats& stats) const override
+    {
+        std::size_t distinctValuesCount = 0;
+        std::size_t maxEqualRecordsCount = 0;
+
+        if (HashIndex != nullptr)
+        {
+            stats.IndexedRecordsCount = HashIndex->Size();
+            stats.HashBucketsCount = HashIndex->GetBucketsCount();
+            stats.HashLoadFactor = static_cast<double>(HashIndex->Size()) / stats.HashBucketsCount;
+            stats.MaxHashChainLength = HashIndex->GetMaxBucketLength();
+        }
+
+        // Equal values are counted by the cheapest index: the flat hash index stores them together, and the ordered index stores them in a row
+        if (FlatHashIndex != nullptr)
+        {
+            stats.IndexedRecordsCount = FlatHashIndex->Size();
+            stats.HashBucketsCount = FlatHashIndex->GetSlotsCount();
+            stats.HashLoadFactor = static_cast<double>(FlatHashIndex->GetUsedSlotsCount()) / stats.HashBucketsCount;
+
+            FlatHashIndex->ForEachEntry([&](const T&, std::size_t valuesCount)
+                {
+                    ++distinctValuesCount;
+                    maxEqualRecordsCount = std::max(maxEqualRecordsCount, valuesCount);
+                }
+            );
+        }
+        else if (OrderedIndex != nullptr)
+        {
+            stats.IndexedRecordsCount = OrderedIndex->size();
+
+            std::size_t equalRecordsCount = 0;
+            for (auto it = OrderedIndex->begin(); it != OrderedIndex->end(); ++it)
+            {
+                if (it == OrderedIndex->begin() || std::prev(it)->first < it->first)
+                {
+                    ++distinctValuesCount;
+                    equalRecordsCount = 0;
+                }
+
+                maxEqualRecordsCount = std::max(maxEqualRecordsCount, ++equalRecordsCount);
+            }
+        }
+        else if (HashIndex != nullptr)
+        {
+            std::unordered_map<T, std::size_t> equalRecordsCounts;
+            HashIndex->ForEachKey([&](const T& value) { ++equalRecordsCounts[value]; });
+
+            distinctValuesCount = equalRecordsCounts.size();
+            for (auto& it : equalRecordsCounts)
+                maxEqualRecordsCount = std::max(maxEqualRecordsCount, it.second);
+        }
+
+        stats.DistinctValuesCount = distinctValuesCount;
+        stats.MaxEqualRecordsCount = maxEqualRecordsCount;
+    }
+
+    void Clear() override
+    {
+        if (HashIndex != nullptr)
+            HashIndex->Clear();
+
+        if (FlatHashIndex != nullptr)
+            FlatHashIndex->Clear();
+
+        if (OrderedIndex != nullptr)
+            OrderedIndex->clear();
+    }
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "DataStorageClasses.h"
+#include "DataStorageRequests.h"
+
+/**
+    \brief A class for requests with conditions on several keys
+
+    The query is a list of requests to different keys, and a record satisfies the query if it satisfies all requests.
+    Intermediate sets of records are not created. DataStorage estimates the number of candidates for each request using the indices,
+    iterates only over the candidates of the most selective request and checks the remaining requests on each candidate directly.
+    If all keys of a composite index have Equal requests, the composite index is used as one more candidate request, see DataStorage::AddCompositeIndex.
+
+    \code
+        DataStorageQuery query;
+        query.Where("category", Equal<std::string>("Server"))
+            .Where("testDate", Greater<int>(2019))
+            .Where("cores", Equal<int>(64))
+            .Where("powerPerf", Between<int>(300, 400));
+
+        DataStorageRecordSet servers = ds.GetRecords(query);
+    \endcode
+
+    The definition of Where is in DataStorage.h, so DataStorage.h must be included to use this class.
+*/
+class DataStorageQuery
+{
+private:
+    // One request of the query
+    struct Predicate
+    {
+        // Name of the key
+        std::string KeyName;
+
+        // Function to count candidates of the request using the indices. Counting stops at the limit
+        std::function<std::size_t(const DataStorage& dataStorage, std::size_t limit)> CountFunc;
+
+        // Function to iterate over candidates of the request. Iteration stops when the function returns false
+        std::function<void(const DataStorage& dataStorage, const std::function<bool(DataStorageRecord* record)>& func)> ForEachFunc;
+
+        // Function to check the request on the record
+        std::function<bool(const DataStorageRecord* record)> MatchFunc;
+
+        // Function to append the saved value of the Equal request to the string, see DataStorageCompositeIndex. Empty for other requests
+        std::function<void(std::string& out)> SaveEqualValue;
+    };
+
+    // All requests of the query
+    std::vector<Predicate> Predicates;
+
+    // Append saved values of Equal requests on the keys to the string in the order of the keys. Returns false if some key does not have the Equal request
+    bool SaveEqualValues(const std::vector<std::string>& keyNames, std::string& out) const
+    {
+        for (auto& keyName : keyNames)
+        {
+            auto f = std::find_if(Predicates.begin(), Predicates.end(), [&keyName](const Predicate& predicate)
+                {
+                    return predicate.SaveEqualValue && predicate.KeyName == keyName;
+                }
+            );
+
+            if (f == Predicates.end())
+                return false;
+
+            f->SaveEqualValue(out);
+        }
+
+        return true;
+    }
+
+public:
+    /// Making the DataStorage class friendly so that it has access to the requests of the query
+    friend DataStorage;
+
+    /**
+        \brief Method for adding a request on the key to the query
+
+        \tparam <R> Type of the request, for example Between<int>. The request is copied to the query
+
+        \param [in] keyName the name of the key
+        \param [in] request the request with the range of the key values, see DataStorageRequests.h
+
+        \return ref to this query to add more requests
+    */
+    template <class R>
+    DataStorageQuery& Where(const std::string& keyName, const R& request);
+
+    /// \brief Method for getting the number of requests in the query
+    /// \return number of requests
+    std::size_t Size() const
+    {
+        return Predicates.size();
+    }
+
+    /// Method for deleting all requests from the query
+    void Clear()
+    {
+        Predicates.clear();
+    }
+};
@@ -1,57 +1,146 @@
 #include "DataStorageRecord.h"
 
+#include "DataStorage.h"
+
 DataStorageRecord::DataStorageRecord() {}
 
 DataStorageRecord::DataStorageRecord(const DataStorageRecord& recordTemplate)
 {
-    *this = recordTemplate;
-    IsDataStorageRecordValid.SetData(true);
+    // Copy only data, each record must have its own slot
+    DataHashMap::operator=(recordTemplate);
+    Handle = RecordSlotTable::GetInstance().Acquire();
+}
+
+void* DataStorageRecord::operator new(std::size_t size, MemoryPool* memoryPool)
+{
+    return MemoryPool::Allocate(memoryPool, size);
+}
+
+void* DataStorageRecord::operator new(std::size_t size)
+{
+    return MemoryPool::Allocate(nullptr, size);
+}
+
+void DataStorageRecord::operator delete(void* ptr)
+{
+    MemoryPool::Deallocate(ptr);
+}
+
+void DataStorageRecord::operator delete(void* ptr, MemoryPool*)
+{
+    MemoryPool::Deallocate(ptr);
 }
 
 DataStorageRecord::~DataStorageRecord()
 {
-    IsDataStorageRecordValid.SetData(false);
+    // Does nothing if the slot was already released by DataStorage
+    RecordSlotTable::GetInstance().Release(Handle);
 }
 
 
 DataStorageRecordRef::DataStorageRecordRef() {}
 
-DataStorageRecordRef::DataStorageRecordRef(DataStorageRecord* data, DataStorageStructureHashMap* dataStorageStructureHashMap, DataStorageStructureMap* dataStorageStructureMap) : 
-    DataRecord(data), DataStorageHashMapStructure(dataStorageStructureHashMap), DataStorageMapStructure(dataStorageStructureMap)
+DataStorageRecordRef::DataStorageRecordRef(DataStorageRecord* data, const DataStorage* dataStorage) : DataRecord(data), Storage(dataStorage)
 {
-    IsDataStorageRecordValid = data->IsDataStorageRecordValid;
+    Handle = data->Handle;
 }
 
 bool DataStorageRecordRef::operator==(const DataStorageRecordRef& other) const
 {
-    return DataRecord == other.DataRecord;
+    return Handle == other.Handle;
 }
 
 std::string DataStorageRecordRef::GetRecordUniqueId() const
 {
     std::stringstream ss;
-    ss << DataRecord;
+    ss << Handle;
     return ss.str();
 }
 
-void DataStorageRecordRef::SetData(const std::vector<std::pair<std::string, DataSaver>>& params)
+bool DataStorageRecordRef::SetData(const std::vector<std::pair<std::string, DataSaver>>& params)
+{
+    if (Storage == nullptr)
+        return false;
+
+    // Refs point to the DataStorage as const, since they are created by its const methods like GetRecord
+    return const_cast<DataStorage*>(Storage)->UpdateRecord(*this, params);
+}
+
+bool DataStorageRecordRef::SetData(std::vector<std::pair<std::string, DataSaver>>&& params)
+{
+    if (Storage == nullptr)
+        return false;
+
+    return const_cast<DataStorage*>(Storage)->UpdateRecord(*this, std::move(params));
+}
+
+bool DataStorageRecordRef::BeginChange(const std::string& key, DataSaver& oldValue) const
 {
-        // Copy data from function parametrs
-    for (auto& it : params)
-        if (DataRecord->IsData(it.first))
-            DataRecord->SetDataFromDataSaver(it.first, it.second);
+    if (Storage == nullptr || !Storage->LockRecordChange())
+        return false;
+
+    // The record can be deleted by another thread before locking, and the shard key of ShardedDataStorage can not be changed
+    if (!IsValid() || key == Storage->ShardKeyName)
+    {
+        Storage->UnlockRecordChange();
+        return false;
+    }
+
+    // Views see the data of the record before the change
+    Storage->PreserveRecord(DataRecord);
+    Storage->SaveOldValue(DataRecord, key, oldValue);
+    return true;
+}
+
+void DataStorageRecordRef::EndChange(bool isChanged, const std::string& key, DataSaver&& oldValue) const
+{
+    if (isChanged)
+    {
+        Storage->LogSetData(DataRecord, key);
+        Storage->PublishChange(DataStorageChangeType::SetDataChange, DataRecord, key, std::move(oldValue));
+        Storage->UpdateCountedBytes(DataRecord);
+    }
+
+    Storage->UnlockRecordChange();
+}
+
+DataStorageKeyIndexBase* DataStorageRecordRef::FindKeyIndex(const std::string& key) const
+{
+    if (Storage == nullptr)
+        return nullptr;
+
+    return Storage->FindKeyIndex(key);
+}
+
+void DataStorageRecordRef::EraseFromCompositeIndices(const std::string& key, std::vector<DataStorageKeyIndexBase*>& compositeIndices) const
+{
+    Storage->EraseFromCompositeIndices(DataRecord, key, compositeIndices);
+}
+
+void DataStorageRecordRef::InsertToCompositeIndices(const std::vector<DataStorageKeyIndexBase*>& compositeIndices) const
+{
+    for (auto& it : compositeIndices)
+        it->Insert(DataRecord);
+}
+
+LatencyHistogram* DataStorageRecordRef::GetSetDataHistogram() const
+{
+    if (Storage == nullptr)
+        return nullptr;
+
+    return Storage->GetStatsHistogram(Storage->Stats.SetData);
 }
 
 bool DataStorageRecordRef::IsValid() const
 {
-    return IsDataStorageRecordValid.GetData();
+    return RecordSlotTable::GetInstance().IsValid(Handle);
 }
 
 void DataStorageRecordRef::Unlink()
 {
     DataRecord = nullptr;
-    DataStorageHashMapStructure = nullptr;
-    DataStorageMapStructure = nullptr;
+    Storage = nullptr;
 
-    IsDataStorageRecordValid.Unlink();
+    // Unlinked ref is not valid
+    Handle = RecordSlotTable::InvalidHandle;
 }
\ No newline at end of file
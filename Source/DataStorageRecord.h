@@ -1,29 +1,71 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <vector>
 #include <sstream>
 
 #include "DataStorageClasses.h"
 #include "DataContainer.h"
-#include "SmartPointerWrapper.h"
+#include "RecordSlotTable.h"
+#include "ConcurrentHashMultiMap.h"
+#include "LatencyHistogram.h"
 
 // Class declaration
 class DataStorageRecordRef;
 
+/// \brief Position of the record inside the indices of one key. Used to erase the record from the indices without searching
+/// The pointers are stored by DataStorageKeyIndex and are equal to nullptr if the key does not have the index
+struct DataStorageIndexPosition
+{
+    /// The key has either the hash index or the flat hash index, so their positions share the place
+    union
+    {
+        /// Node of the record in the hash index
+        void* HashNode = nullptr;
+
+        /// Number of the record among records with the same value in the flat hash index
+        std::size_t FlatHashItem;
+    };
+
+    /// Iterator of the record in the ordered index
+    void* OrderedNode = nullptr;
+};
+
 /**
     \brief A class for storing data inside DataStorage
 
-    It is a wrapper over the Data Hash Map, but adds a SmartPointerWrapper to invalidate DataStorageRecordRef's pointing to an object of this class.  
+    It is a wrapper over the Data Hash Map, but adds a handle in RecordSlotTable to invalidate DataStorageRecordRef's pointing to an object of this class.  
     The functionality from HashMap stores allows you to store data of any type and provide access to them using string keys.  
-    IsDataStorageRecordValid is created when the class object is created and deleted when the object is deleted.
-    All DataStorageRecordRef's pointing to an object of this class store copies of IsDataStorageRecordValid inside themselves. 
-    Thus, when deleting IsDataStorageRecordValid, all DataStorageRecordRef's pointing to this object learn about its destruction and cease to be valid
+    The slot is acquired when the record is copied from the record template and released when the record is deleted.
+    All DataStorageRecordRef's pointing to an object of this class store copies of the handle inside themselves. 
+    Thus, when releasing the slot, all DataStorageRecordRef's pointing to this object learn about its destruction and cease to be valid
 */ 
 class DataStorageRecord : public DataHashMap
 {
 private:
-    // A variable for invalidating DataStorageRecordRef's pointing to this object. Before destroying the object, the value will be set to false.
-    SmartPointerWrapper<bool> IsDataStorageRecordValid;
+    // Handle of the slot for invalidating DataStorageRecordRef's pointing to this object. The slot is released before destroying the object.
+    // The record template does not have a slot
+    std::uint64_t Handle = RecordSlotTable::InvalidHandle;
+
+    // Id of the record in snapshots and the write-ahead log. Equal to 0 until the record is added to DataStorage
+    std::uint64_t RecordId = 0;
+
+    // Positions of the record in the indices of keys. The position of the index with id i is stored at i.
+    // Positions are not copied from the record template
+    std::vector<DataStorageIndexPosition> IndexPositions;
+
+    // Time when the record expires in nanoseconds of std::chrono::steady_clock. Equal to 0 if the record does not expire, see DataStorage::SetRecordTimeToLive
+    std::atomic<std::int64_t> ExpiryTime{0};
+
+    // Was the record found by GetRecord since the eviction last passed it, see DataStorage::SetCapacity
+    std::atomic_bool IsRecentlyUsed{false};
+
+    // Position of the record in the eviction ring of DataStorage. Used only if the capacity is limited
+    std::size_t EvictionPosition = 0;
+
+    // Size of the record counted in the memory limit of DataStorage. Used only if the memory is limited
+    std::size_t CountedBytes = 0;
 public:
     
     /// Declaring the DataStorageRecordRef class to access its private members
@@ -32,14 +74,38 @@ public:
     /// Declaring the DataStorage class to access its private members
     friend DataStorage;
 
+    /// Declaring the DataStorageKeyIndex class to access positions of the record
+    template <class T>
+    friend class DataStorageKeyIndex;
+
     /// Default constructor
     DataStorageRecord();
 
-    /// \brief Copy constructor
+    /// \brief Copy constructor. The new record gets its own slot
     /// \param [in] recordTemplate object to be copied. Usually it is record template from DataStorage
     DataStorageRecord(const DataStorageRecord& recordTemplate);
 
-    /// Default destructor
+    /// \brief Operator to allocate the record from the memory pool of DataStorage
+    /// \param [in] size size of the record
+    /// \param [in] memoryPool the pool to allocate from
+    /// \return pointer to the memory
+    static void* operator new(std::size_t size, MemoryPool* memoryPool);
+
+    /// \brief Operator to allocate the record without the memory pool
+    /// \param [in] size size of the record
+    /// \return pointer to the memory
+    static void* operator new(std::size_t size);
+
+    /// \brief Operator to delete the record. The pool is found using the header of the memory block
+    /// \param [in] ptr pointer to the record
+    static void operator delete(void* ptr);
+
+    /// \brief Operator to free memory if the constructor throws
+    /// \param [in] ptr pointer to the record
+    /// \param [in] memoryPool the pool used for allocation
+    static void operator delete(void* ptr, MemoryPool* memoryPool);
+
+    /// Destructor. Releases the slot of the record
     ~DataStorageRecord();
 };
 
@@ -58,14 +124,30 @@ private:
     // Pointer to DataStorageRecord inside DataStorage
     DataStorageRecord* DataRecord = nullptr;
 
-    // Pointer to DataStorageStructureHashMap 
-    DataStorageStructureHashMap* DataStorageHashMapStructure = nullptr;
+    // Pointer to the DataStorage of the record to update its indices and write changes to its write-ahead log
+    const DataStorage* Storage = nullptr;
+
+    // Handle of the record slot to get info about data storage record validity
+    std::uint64_t Handle = RecordSlotTable::InvalidHandle;
+
+    // Lock the DataStorage to change the key of the record, see DataStorage::LockRecordChange. Returns false without locking if the record was deleted
+    // The value of the key is copied to oldValue if DataStorage has change feeds
+    bool BeginChange(const std::string& key, DataSaver& oldValue) const;
 
-    // Pointer to DataStorageStructureMap 
-    DataStorageStructureMap* DataStorageMapStructure = nullptr;
+    // Write the change of the key to the write-ahead log and change feeds of DataStorage if the key was changed, and unlock the DataStorage
+    void EndChange(bool isChanged, const std::string& key, DataSaver&& oldValue) const;
 
-    // Smart pointer wrapper to get info about data storage record validity
-    SmartPointerWrapper<bool> IsDataStorageRecordValid;
+    // Get the index of the key inside DataStorage. Returns nullptr if the key does not have indices
+    DataStorageKeyIndexBase* FindKeyIndex(const std::string& key) const;
+
+    // Erase the record from the composite indices with the key before changing it, see DataStorage::AddCompositeIndex
+    void EraseFromCompositeIndices(const std::string& key, std::vector<DataStorageKeyIndexBase*>& compositeIndices) const;
+
+    // Add the record back to the composite indices after changing the key
+    void InsertToCompositeIndices(const std::vector<DataStorageKeyIndexBase*>& compositeIndices) const;
+
+    // Get the histogram for durations of SetData if DataStorage collects statistics, otherwise nullptr
+    LatencyHistogram* GetSetDataHistogram() const;
 public:
 
     /// Making the DataStorage class friendly so that it has access to the internal members of the DataStorageRecordRef class
@@ -80,10 +162,9 @@ public:
     /**
         \brief Constructor
         \param [in] data a pointer to the record that will be stored inside DataStorageRecordRef
-        \param [in] dataStorageStructureHashMap pointer to the DataStorageHashMap structure
-        \param [in] dataStorageStructureMap pointer to the DataStorageMap structure
+        \param [in] dataStorage pointer to the DataStorage of the record
     */
-    DataStorageRecordRef(DataStorageRecord* data, DataStorageStructureHashMap* dataStorageStructureHashMap, DataStorageStructureMap* dataStorageStructureMap);
+    DataStorageRecordRef(DataStorageRecord* data, const DataStorage* dataStorage);
 
     /// \brief Comparison operator
     /// \param [in] other the object to compare with
@@ -100,83 +181,71 @@ public:
 
         \tparam <T> Any type of data except for c arrays
 
-        Using this method, you can change the values inside the DataStorageRecord inside the DataStorage
+        Using this method, you can change the values inside the DataStorageRecord inside the DataStorage.
+        If the key is unique and the value is already used by another record, then the data will not be changed.
+        The shard key of ShardedDataStorage is not changed either, since the record would stay in the shard of the old value.
+        The DataStorage is locked for writing during the change, so the record is moved inside the indices of the key
+        without interfering with readers. If the thread holds the read lock, for example inside DataStorage::ForEachRecordInRange,
+        the data is not changed
 
         \param [in] key the key whose value needs to be changed
         \param [in] data new key data value
 
-        \return returns true if the key was found otherwise returns false
+        \return returns true if the data was changed otherwise returns false
     */
     template <class T>
     bool SetData(const std::string& key, const T& data)
     {
-        // A pointer for storing a std::unordered_multimap in which a template data type is used as a key, 
-        // and a pointer to the DataHashMap is used as a value
-        std::unordered_multimap<T, DataStorageRecord*>* TtoDataStorageRecordHashMap = nullptr;
-
-        // A pointer for storing a std::multimap in which a template data type is used as a key, 
-        // and a pointer to the DataHashMap is used as a value
-        std::multimap<T, DataStorageRecord*>* TtoDataStorageRecordMap = nullptr;
-
-        // Get std::unordered_multimap with T key and DataStorageRecord* value
-        if (!DataStorageHashMapStructure->GetData(key, TtoDataStorageRecordHashMap)) return false;
+        LatencyTimer timer(GetSetDataHistogram());
 
-        // Get std::multimap with T key and DataStorageRecord* value
-        if (!DataStorageMapStructure->GetData(key, TtoDataStorageRecordMap)) return false;
+        DataSaver oldValue;
+        if (!BeginChange(key, oldValue)) return false;
 
-        // Get the current value of the key key inside the DataStorageRecordRef and save it for further work
-        T oldData;
-        DataRecord->GetData(key, oldData);
+        // Check that the key exists and has T type
+        bool isChanged = DataRecord->GetDataPtr<T>(key) != nullptr;
 
-        // Remove oldData from TtoDataStorageRecordHashMap from DataStorageHashMapStructure
-        auto FirstAndLastIteratorsWithKeyOnHashMap = TtoDataStorageRecordHashMap->equal_range(oldData);
-
-        // Iterate over all data records with oldData key
-        for (auto& it = FirstAndLastIteratorsWithKeyOnHashMap.first; it != FirstAndLastIteratorsWithKeyOnHashMap.second; ++it)
+        if (isChanged)
         {
-            // Find required data record
-            if (it->second == DataRecord)
-            {
-                TtoDataStorageRecordHashMap->erase(it);
-                break;
-            }
-        }
-
-        // Add new data to TtoDataStorageRecordHashMap to DataStorage DataStorageHashMapStructure
-        TtoDataStorageRecordHashMap->emplace(data, DataRecord);
+            std::vector<DataStorageKeyIndexBase*> compositeIndices;
+            EraseFromCompositeIndices(key, compositeIndices);
 
+            // Move the record inside the indices of the key. The index has the T type, since the key has it
+            DataStorageKeyIndexBase* keyIndex = FindKeyIndex(key);
+            if (keyIndex != nullptr)
+                isChanged = static_cast<DataStorageKeyIndex<T>*>(keyIndex)->Update(DataRecord, data);
+            else
+                DataRecord->SetData(key, data);
 
-        // Remove oldData from TtoDataStorageRecordMap from DataStorageMapStructure
-        auto FirstAndLastIteratorsWithKeyOnMap = TtoDataStorageRecordMap->equal_range(oldData);
-
-        // Iterate over all data records with oldData key
-        for (auto& it = FirstAndLastIteratorsWithKeyOnMap.first; it != FirstAndLastIteratorsWithKeyOnMap.second; ++it)
-        {
-            // Find required data record
-            if (it->second == DataRecord)
-            {
-                TtoDataStorageRecordMap->erase(it);
-                break;
-            }
+            InsertToCompositeIndices(compositeIndices);
         }
 
-        // Add new data to TtoDataStorageRecordMap to DataStorage DataStorageMapStructure
-        TtoDataStorageRecordMap->emplace(data, DataRecord);
-
-        // Update data inside DataStorageRecord pointer inside DataStorageRecordRef and DataStorage
-        DataRecord->SetData(key, data);
-        return true;
+        EndChange(isChanged, key, std::move(oldValue));
+        return isChanged;
     }
 
     /**
-        \brief Method for updating data inside DataStorage
+        \brief Method for updating several keys inside DataStorage at once
 
         Using this method, you can change the values inside the DataStorageRecord inside the DataStorage.  
-        See DataStorage::CreateRecord(std::vector<std::pair<std::string, DataSaver>> params) for more information
+        All keys are changed under one lock of the DataStorage and moved inside their indices, see DataStorage::UpdateRecord for more information
 
         \param [in] params a vector of pairs with data to be put in the DataStorage
+
+        \return returns true if the data was changed otherwise returns false
+    */
+    bool SetData(const std::vector<std::pair<std::string, DataSaver>>& params);
+
+    /**
+        \brief Method for updating several keys inside DataStorage at once by moving data from params
+
+        Works the same way as DataStorageRecordRef::SetData(const std::vector<std::pair<std::string, DataSaver>>& params), 
+        but the values are moved to the record instead of copying
+
+        \param [in] params a vector of pairs with data to be moved to the DataStorage
+
+        \return returns true if the data was changed otherwise returns false
     */
-    void SetData(const std::vector<std::pair<std::string, DataSaver>>& params);
+    bool SetData(std::vector<std::pair<std::string, DataSaver>>&& params);
 
     /**
         \brief A method for getting data using a key
@@ -209,6 +278,6 @@ struct std::hash<DataStorageRecordRef>
 {
     std::size_t operator()(const DataStorageRecordRef& k) const
     {
-        return std::hash<DataStorageRecord*>()(k.DataRecord);
+        return std::hash<std::uint64_t>()(k.Handle);
     }
 };
@@ -0,0 +1,51 @@
+#include "DataStorageRecordSet.h"
+
+DataStorageRecordSet::iterator DataStorageRecordSet::begin() noexcept
+{
+    return Records.begin();
+}
+
+DataStorageRecordSet::const_iterator DataStorageRecordSet::begin() const noexcept
+{
+    return Records.begin();
+}
+
+DataStorageRecordSet::const_iterator DataStorageRecordSet::cbegin() const noexcept
+{
+    return Records.cbegin();
+}
+
+DataStorageRecordSet::iterator DataStorageRecordSet::end() noexcept
+{
+    return Records.end();
+}
+
+DataStorageRecordSet::const_iterator DataStorageRecordSet::end() const noexcept
+{
+    return Records.end();
+}
+
+DataStorageRecordSet::const_iterator DataStorageRecordSet::cend() const noexcept
+{
+    return Records.cend();
+}
+
+void DataStorageRecordSet::AddNewRecord(const DataStorageRecordRef& newRecordRef)
+{
+    Records.emplace_back(newRecordRef);
+}
+
+const DataStorageRecordRef& DataStorageRecordSet::operator[](std::size_t index) const
+{
+    return Records[index];
+}
+
+std::size_t DataStorageRecordSet::Size() const
+{
+    return Records.size();
+}
+
+void DataStorageRecordSet::Clear()
+{
+    Records.clear();
+}
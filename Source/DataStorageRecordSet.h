@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+#include "DataStorageClasses.h"
+#include "DataStorageRecord.h"
+
+/**
+    \brief A class for storing set of DataStorageRecordRef's
+
+    It is returned by requests to DataStorage. Records are stored in a vector in the order in which they were found,
+    so adding records does not require hashing. Each record is added only once by requests.
+*/
+class DataStorageRecordSet
+{
+private:
+    // Vector with all DataStorageRecordRef's
+    std::vector<DataStorageRecordRef> Records;
+public:
+
+    /// Redefine iterator from std::vector
+    typedef typename std::vector<DataStorageRecordRef>::iterator iterator;
+    /// Redefine const_iterator from std::vector
+    typedef typename std::vector<DataStorageRecordRef>::const_iterator const_iterator;
+
+    /// Returns an iterator that points to the first element in the DataStorageRecordSet
+    /// \return begin iterator
+    iterator begin() noexcept;
+
+    /// Returns a read-only (constant) iterator that points to the first element in the DataStorageRecordSet
+    /// \return begin iterator
+    const_iterator begin() const noexcept;
+
+    /// Returns a read-only (constant) iterator that points to the first element in the DataStorageRecordSet
+    /// \return begin iterator
+    const_iterator cbegin() const noexcept;
+
+    /// Returns an iterator that points one past the last element in the DataStorageRecordSet
+    /// \return end iterator
+    iterator end() noexcept;
+
+    /// Returns a read-only (constant) iterator that points one past the last element in the DataStorageRecordSet
+    /// \return end iterator
+    const_iterator end() const noexcept;
+
+    /// Returns a read-only (constant) iterator that points one past the last element in the DataStorageRecordSet
+    /// \return end iterator
+    const_iterator cend() const noexcept;
+
+    /// \brief A method for adding a new DataStorageRecordRef inside a DataStorageRecordSet
+    /// \param [in] newRecordRef the object to be added to the set
+    void AddNewRecord(const DataStorageRecordRef& newRecordRef);
+
+    /// \brief Access operator
+    /// \param [in] index index of the record
+    /// \return ref to the record with the index
+    const DataStorageRecordRef& operator[](std::size_t index) const;
+
+    /// \brief Returns the size of the DataStorageRecordSet
+    /// \return size of the DataStorageRecordSet
+    std::size_t Size() const;
+
+    /// Erases all elements in an DataStorageRecordSet
+    void Clear();
+};
@@ -0,0 +1,305 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <utility>
+
+#include "DataStorageClasses.h"
+
+/**
+    \brief Template interface for requests
+
+    \tparam <T> Any type of data for which the operator < is defined
+
+    A request describes a range of key values. If the key has the ordered index, the range is found in O(log n) using ProcessRequest,
+    otherwise each record is checked using IsMatch.
+*/
+template <class T>
+class DataStorageRequest
+{
+public:
+    /// Type of the key values
+    typedef T ValueType;
+
+    /// Iterator of the ordered index
+    typedef typename DataStorageOrderedIndex<T>::const_iterator MapIterator;
+
+    /// \brief Interface function for requests
+    /// \param dataStorageMapStructure ordered index of the key
+    /// \return A pair with iterators of the beginning and end of a block of data satisfying the request
+    virtual std::pair<MapIterator, MapIterator> ProcessRequest(const DataStorageOrderedIndex<T>* dataStorageMapStructure) const = 0;
+
+    /// \brief Interface function for checking one value. Used if the key does not have the ordered index
+    /// \param value the value of the key
+    /// \return true if the value satisfies the request, otherwise false
+    virtual bool IsMatch(const T& value) const = 0;
+
+    /// Default destructor
+    virtual ~DataStorageRequest() = default;
+};
+
+/// The template class of the request. Used to get all records equal to a certain value
+/// \tparam <T> Any type of data for which the operator < is defined
+template <class T>
+class Equal : public DataStorageRequest<T>
+{
+public:
+    /// The value of the request
+    T Value;
+
+    /**
+        \brief Interface function for requests
+
+        Returns all elements equal to Value
+
+        \param dataStorageMapStructure ordered index of the key
+
+        \return A pair with iterators of the beginning and end of a block of data satisfying the request
+    */
+    virtual std::pair<typename DataStorageRequest<T>::MapIterator, typename DataStorageRequest<T>::MapIterator> ProcessRequest(const DataStorageOrderedIndex<T>* dataStorageMapStructure) const override
+    {
+        return dataStorageMapStructure->equal_range(Value);
+    }
+
+    /// \brief Interface function for checking one value
+    /// \param value the value of the key
+    /// \return true if the value is equal to Value
+    virtual bool IsMatch(const T& value) const override
+    {
+        return !(value < Value) && !(Value < value);
+    }
+
+    /// A constructor that takes a template value to search for equal elements
+    /// \param [in] value The value to be compared with
+    Equal(const T& value) : Value(value) {}
+};
+
+/// The template class of the request. Used to get all records greater or equal than a certain value
+/// \tparam <T> Any type of data for which the operator < is defined
+template <class T>
+class GreaterOrEqual : public DataStorageRequest<T>
+{
+public:
+    /// The lower bound of the request
+    T LowerBound;
+
+    /**
+        \brief Interface function for requests
+
+        Returns all elements greater than or equal to LowerBound
+
+        \param dataStorageMapStructure ordered index of the key
+
+        \return A pair with iterators of the beginning and end of a block of data satisfying the request
+    */
+    virtual std::pair<typename DataStorageRequest<T>::MapIterator, typename DataStorageRequest<T>::MapIterator> ProcessRequest(const DataStorageOrderedIndex<T>* dataStorageMapStructure) const override
+    {
+        return {dataStorageMapStructure->lower_bound(LowerBound), dataStorageMapStructure->end()};
+    }
+
+    /// \brief Interface function for checking one value
+    /// \param value the value of the key
+    /// \return true if the value is greater than or equal to LowerBound
+    virtual bool IsMatch(const T& value) const override
+    {
+        return !(value < LowerBound);
+    }
+
+    /// A constructor that takes a template value to search for greater or equal elements
+    /// \param [in] lowerBound The value to be compared with
+    GreaterOrEqual(const T& lowerBound) : LowerBound(lowerBound) {}
+};
+
+/// The template class of the request. Used to get all records greater than a certain value
+/// \tparam <T> Any type of data for which the operator < is defined
+template <class T>
+class Greater : public DataStorageRequest<T>
+{
+public:
+    /// The lower bound of the request
+    T LowerBound;
+
+    /**
+        \brief Interface function for requests
+
+        Returns all elements greater than LowerBound
+
+        \param dataStorageMapStructure ordered index of the key
+
+        \return A pair with iterators of the beginning and end of a block of data satisfying the request
+    */
+    virtual std::pair<typename DataStorageRequest<T>::MapIterator, typename DataStorageRequest<T>::MapIterator> ProcessRequest(const DataStorageOrderedIndex<T>* dataStorageMapStructure) const override
+    {
+        return {dataStorageMapStructure->upper_bound(LowerBound), dataStorageMapStructure->end()};
+    }
+
+    /// \brief Interface function for checking one value
+    /// \param value the value of the key
+    /// \return true if the value is greater than LowerBound
+    virtual bool IsMatch(const T& value) const override
+    {
+        return LowerBound < value;
+    }
+
+    /// A constructor that takes a template value to search for greater elements
+    /// \param [in] lowerBound The value to be compared with
+    Greater(const T& lowerBound) : LowerBound(lowerBound) {}
+};
+
+/// The template class of the request. Used to get all records less or equal than a certain value
+/// \tparam <T> Any type of data for which the operator < is defined
+template <class T>
+class LessOrEqual : public DataStorageRequest<T>
+{
+public:
+    /// The upper bound of the request
+    T UpperBound;
+
+    /**
+        \brief Interface function for requests
+
+        Returns all elements less than or equal to UpperBound
+
+        \param dataStorageMapStructure ordered index of the key
+
+        \return A pair with iterators of the beginning and end of a block of data satisfying the request
+    */
+    virtual std::pair<typename DataStorageRequest<T>::MapIterator, typename DataStorageRequest<T>::MapIterator> ProcessRequest(const DataStorageOrderedIndex<T>* dataStorageMapStructure) const override
+    {
+        return {dataStorageMapStructure->begin(), dataStorageMapStructure->upper_bound(UpperBound)};
+    }
+
+    /// \brief Interface function for checking one value
+    /// \param value the value of the key
+    /// \return true if the value is less than or equal to UpperBound
+    virtual bool IsMatch(const T& value) const override
+    {
+        return !(UpperBound < value);
+    }
+
+    /// A constructor that takes a template value to search for less or equal elements
+    /// \param [in] upperBound The value to be compared with
+    LessOrEqual(const T& upperBound) : UpperBound(upperBound) {}
+};
+
+/// The template class of the request. Used to get all records less than a certain value
+/// \tparam <T> Any type of data for which the operator < is defined
+template <class T>
+class Less : public DataStorageRequest<T>
+{
+public:
+    /// The upper bound of the request
+    T UpperBound;
+
+    /**
+        \brief Interface function for requests
+
+        Returns all elements less than UpperBound
+
+        \param dataStorageMapStructure ordered index of the key
+
+        \return A pair with iterators of the beginning and end of a block of data satisfying the request
+    */
+    virtual std::pair<typename DataStorageRequest<T>::MapIterator, typename DataStorageRequest<T>::MapIterator> ProcessRequest(const DataStorageOrderedIndex<T>* dataStorageMapStructure) const override
+    {
+        return {dataStorageMapStructure->begin(), dataStorageMapStructure->lower_bound(UpperBound)};
+    }
+
+    /// \brief Interface function for checking one value
+    /// \param value the value of the key
+    /// \return true if the value is less than UpperBound
+    virtual bool IsMatch(const T& value) const override
+    {
+        return value < UpperBound;
+    }
+
+    /// A constructor that takes a template value to search for less elements
+    /// \param [in] upperBound The value to be compared with
+    Less(const T& upperBound) : UpperBound(upperBound) {}
+};
+
+/// The template class of the request. Used to get all records less or equal than a certain value and greater or equal then different value
+/// \tparam <T> Any type of data for which the operator < is defined
+template <class T>
+class Between : public DataStorageRequest<T>
+{
+public:
+    /// The bounds of the request
+    T LowerBound, UpperBound;
+
+    /**
+        \brief Interface function for requests
+
+        Returns all elements between LowerBound and UpperBound
+
+        \param dataStorageMapStructure ordered index of the key
+
+        \return A pair with iterators of the beginning and end of a block of data satisfying the request
+    */
+    virtual std::pair<typename DataStorageRequest<T>::MapIterator, typename DataStorageRequest<T>::MapIterator> ProcessRequest(const DataStorageOrderedIndex<T>* dataStorageMapStructure) const override
+    {
+        if (UpperBound < LowerBound)
+            return {dataStorageMapStructure->end(), dataStorageMapStructure->end()};
+        else
+            return {dataStorageMapStructure->lower_bound(LowerBound), dataStorageMapStructure->upper_bound(UpperBound)};
+    }
+
+    /// \brief Interface function for checking one value
+    /// \param value the value of the key
+    /// \return true if the value is between LowerBound and UpperBound
+    virtual bool IsMatch(const T& value) const override
+    {
+        return !(value < LowerBound) && !(UpperBound < value);
+    }
+
+    /// A constructor that accepts template parameters to search for all values between parameters
+    /// If the lowerBound is greater than the upperBound, an empty set will be returned
+    /// \param [in] lowerBound The lower value to be compared with
+    /// \param [in] upperBound The upper value to be compared with
+    Between(const T& lowerBound, const T& upperBound) : LowerBound(lowerBound), UpperBound(upperBound) {}
+};
+
+/// The class of the request. Used to get all records with string values starting with a certain prefix
+class StartsWith : public DataStorageRequest<std::string>
+{
+public:
+    /// The prefix of the request
+    std::string Prefix;
+
+    /**
+        \brief Interface function for requests
+
+        Returns all elements starting with Prefix. All such strings are placed together in the ordered index,
+        from Prefix to the first string greater than Prefix which does not start with it
+
+        \param dataStorageMapStructure ordered index of the key
+
+        \return A pair with iterators of the beginning and end of a block of data satisfying the request
+    */
+    virtual std::pair<MapIterator, MapIterator> ProcessRequest(const DataStorageOrderedIndex<std::string>* dataStorageMapStructure) const override
+    {
+        // Get the least string greater than all strings with the prefix. std::string compares chars as unsigned chars
+        std::string upperBound = Prefix;
+        while (!upperBound.empty() && static_cast<unsigned char>(upperBound.back()) == 0xFF)
+            upperBound.pop_back();
+
+        // All strings starting with 0xFF chars are greater than the prefix
+        if (upperBound.empty())
+            return {dataStorageMapStructure->lower_bound(Prefix), dataStorageMapStructure->end()};
+
+        upperBound.back() = static_cast<char>(static_cast<unsigned char>(upperBound.back()) + 1);
+        return {dataStorageMapStructure->lower_bound(Prefix), dataStorageMapStructure->lower_bound(upperBound)};
+    }
+
+    /// \brief Interface function for checking one value
+    /// \param value the value of the key
+    /// \return true if the value starts with Prefix
+    virtual bool IsMatch(const std::string& value) const override
+    {
+        return value.compare(0, Prefix.size(), Prefix) == 0;
+    }
+
+    /// A constructor that takes a prefix to search for strings starting with it
+    /// \param [in] prefix The prefix to be compared with
+    StartsWith(const std::string& prefix) : Prefix(prefix) {}
+};
@@ -0,0 +1,99 @@
+#include "DataStorageSnapshot.h"
+
+#if defined(_WIN32)
+    #include <fstream>
+    #include <sstream>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+DataStorageSnapshotFile::DataStorageSnapshotFile() {}
+
+bool DataStorageSnapshotFile::Open(const std::string& path)
+{
+    Close();
+
+#if defined(_WIN32)
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    std::stringstream ss;
+    ss << file.rdbuf();
+    Buffer = ss.str();
+
+    Data = Buffer.data();
+    Size = Buffer.size();
+    return true;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == -1)
+    {
+        close(fd);
+        return false;
+    }
+
+    Size = static_cast<std::size_t>(fileStat.st_size);
+
+    // Empty file can not be mapped
+    if (Size == 0)
+    {
+        close(fd);
+        Data = "";
+        return true;
+    }
+
+    void* mapped = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping holds the file, so the descriptor is not needed
+    close(fd);
+
+    if (mapped == MAP_FAILED)
+    {
+        Size = 0;
+        return false;
+    }
+
+    // The file is read from the beginning to the end
+    madvise(mapped, Size, MADV_SEQUENTIAL);
+
+    Data = static_cast<const char*>(mapped);
+    return true;
+#endif
+}
+
+void DataStorageSnapshotFile::Close()
+{
+#if defined(_WIN32)
+    Buffer.clear();
+    Buffer.shrink_to_fit();
+#else
+    if (Data != nullptr && Size != 0)
+        munmap(const_cast<char*>(Data), Size);
+#endif
+
+    Data = nullptr;
+    Size = 0;
+}
+
+const char* DataStorageSnapshotFile::GetData() const
+{
+    return Data;
+}
+
+std::size_t DataStorageSnapshotFile::GetSize() const
+{
+    return Size;
+}
+
+DataStorageSnapshotFile::~DataStorageSnapshotFile()
+{
+    Close();
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+/**
+    \brief A template class for saving values of keys to binary snapshots of DataStorage
+
+    \tparam <T> Any type of data except for c arrays
+
+    Values of trivially copyable types, except for pointers, are saved as raw bytes. std::string is saved as its length and chars.
+    Keys of other types are not saved to snapshots. If you plan to save keys of a custom type, you can specialize this class for the type.
+    Values are saved in the byte order of the machine, so snapshots can be loaded only on machines with the same byte order.
+*/
+template <class T>
+struct DataStorageSnapshotCodec
+{
+    /// Can values of the type be saved to snapshots
+    static constexpr bool IsSupported = std::is_trivially_copyable<T>::value && !std::is_pointer<T>::value;
+
+    /// \brief Method for saving the value
+    /// \param [in] value the value to save
+    /// \param [out] out the string to append the value to
+    static void Save(const T& value, std::string& out)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    /**
+        \brief Method for loading the value
+
+        \param [in, out] ptr pointer to the saved value. Moved to the end of the value
+        \param [in] end end of the saved data
+        \param [out] value the loaded value
+
+        \return returns true if the value was loaded, otherwise false
+    */
+    static bool Load(const char*& ptr, const char* end, T& value)
+    {
+        if (static_cast<std::size_t>(end - ptr) < sizeof(T))
+            return false;
+
+        std::memcpy(&value, ptr, sizeof(T));
+        ptr += sizeof(T);
+        return true;
+    }
+};
+
+/// Specialization of DataStorageSnapshotCodec for std::string. The string is saved as its length and chars
+template <>
+struct DataStorageSnapshotCodec<std::string>
+{
+    /// Strings can be saved to snapshots
+    static constexpr bool IsSupported = true;
+
+    /// \brief Method for saving the string
+    /// \param [in] value the string to save
+    /// \param [out] out the string to append the value to
+    static void Save(const std::string& value, std::string& out)
+    {
+        DataStorageSnapshotCodec<std::uint64_t>::Save(value.size(), out);
+        out.append(value);
+    }
+
+    /**
+        \brief Method for loading the string
+
+        \param [in, out] ptr pointer to the saved string. Moved to the end of the string
+        \param [in] end end of the saved data
+        \param [out] value the loaded string
+
+        \return returns true if the string was loaded, otherwise false
+    */
+    static bool Load(const char*& ptr, const char* end, std::string& value)
+    {
+        std::uint64_t size;
+        if (!DataStorageSnapshotCodec<std::uint64_t>::Load(ptr, end, size) || static_cast<std::uint64_t>(end - ptr) < size)
+            return false;
+
+        value.assign(ptr, static_cast<std::size_t>(size));
+        ptr += size;
+        return true;
+    }
+};
+
+/**
+    \brief A class for reading snapshot files without copying them
+
+    The file is mapped to memory, so pages are read by the system only when they are accessed.
+    On Windows the file is read to the memory buffer.
+*/
+class DataStorageSnapshotFile
+{
+private:
+    // Pointer to the content of the file
+    const char* Data = nullptr;
+
+    // Size of the file
+    std::size_t Size = 0;
+
+#if defined(_WIN32)
+    // Content of the file
+    std::string Buffer;
+#endif
+
+public:
+    /// Default constructor
+    DataStorageSnapshotFile();
+
+    /// Deleted copy constructor
+    DataStorageSnapshotFile(const DataStorageSnapshotFile& other) = delete;
+
+    /// Deleted assign operator
+    DataStorageSnapshotFile& operator= (const DataStorageSnapshotFile& other) = delete;
+
+    /// \brief Method for opening the file. The previous file is closed
+    /// \param [in] path path to the file
+    /// \return returns true if the file was opened, otherwise false
+    bool Open(const std::string& path);
+
+    /// Method for closing the file
+    void Close();
+
+    /// \brief Method for getting the content of the file
+    /// \return pointer to the content of the file. It is valid until the file is closed
+    const char* GetData() const;
+
+    /// \brief Method for getting the size of the file
+    /// \return size of the file in bytes
+    std::size_t GetSize() const;
+
+    /// Destructor. Closes the file
+    ~DataStorageSnapshotFile();
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "DataStorageClasses.h"
+#include "LatencyHistogram.h"
+#include "ReadWriteMutex.h"
+
+/**
+    \brief Durations of operations of DataStorage and of its lock
+
+    Collected only after DataStorage::SetStatsEnabled(true). Each duration includes waiting for the lock,
+    so latency spikes of operations can be compared with the durations of the lock to see whether they are caused by contention.
+
+    \code
+        ds.SetStatsEnabled(true);
+        ...
+        const DataStorageStats& stats = ds.GetStats();
+        std::cout << stats.GetRecord.GetPercentileNs(99) << " " << stats.Lock.WriteHold.GetMaxNs() << std::endl;
+    \endcode
+*/
+struct DataStorageStats
+{
+    /// Durations of DataStorage::CreateRecord
+    LatencyHistogram CreateRecord;
+
+    /// Durations of DataStorage::GetRecord by the key value
+    LatencyHistogram GetRecord;
+
+    /// Durations of DataStorage::EraseRecord
+    LatencyHistogram EraseRecord;
+
+    /// Durations of DataStorageRecordRef::SetData
+    LatencyHistogram SetData;
+
+    /// Durations of waiting for and holding the lock of DataStorage
+    ReadWriteMutexStats Lock;
+
+    /// Method for deleting all durations
+    void Reset()
+    {
+        CreateRecord.Reset();
+        GetRecord.Reset();
+        EraseRecord.Reset();
+        SetData.Reset();
+        Lock.Reset();
+    }
+};
+
+/**
+    \brief State of the indices of one key of DataStorage, see DataStorage::GetKeyStats
+
+    A degenerated index is seen as a big MaxEqualRecordsCount, which makes searches by equal values slow,
+    or as a big MaxHashChainLength compared with the load factor, which means that hashes of different values collide.
+*/
+struct DataStorageKeyStats
+{
+    /// Name of the key
+    std::string KeyName;
+
+    /// Indices maintained for the key
+    DataStorageIndexPolicy IndexPolicy = DataStorageIndexPolicy::NoIndex;
+
+    /// Number of records in the indices of the key. Equal to 0 if the key does not have indices
+    std::size_t IndexedRecordsCount = 0;
+
+    /// Number of different values in the indices of the key
+    std::size_t DistinctValuesCount = 0;
+
+    /// Maximum number of records with the same value
+    std::size_t MaxEqualRecordsCount = 0;
+
+    /// Number of buckets of the hash index or number of slots of the flat hash index. Equal to 0 if the key does not have them
+    std::size_t HashBucketsCount = 0;
+
+    /// Number of records per bucket of the hash index or part of used slots of the flat hash index
+    double HashLoadFactor = 0.0;
+
+    /// Maximum number of records in one bucket of the hash index. Equal to 0 for the flat hash index
+    std::size_t MaxHashChainLength = 0;
+};
+
+/**
+    \brief Memory used by records of DataStorage, see DataStorage::GetMemoryStats
+
+    The sizes are estimated from the sizes of the objects and the number of their elements, since the allocators do not report them.
+*/
+struct DataStorageMemoryStats
+{
+    /// Number of records
+    std::size_t RecordsCount = 0;
+
+    /// Bytes used by the records themselves: the record objects, the nodes of their keys and the positions inside the indices
+    std::size_t RecordsBytes = 0;
+
+    /// Bytes allocated by the values of the keys outside their DataSaver, see DataSaver::GetAllocatedSize
+    std::size_t PayloadBytes = 0;
+};
@@ -0,0 +1,433 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ColumnDataStorage.h"
+#include "DataStorage.h"
+#include "ShardedDataStorage.h"
+
+// Print the failed condition and stop the test
+#define DS_CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+            return false; \
+        } \
+    } while (false)
+
+// Path of the temporary file of the test. The file is deleted before the test
+static std::string GetTempPath(const std::string& fileName)
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() / ("DataStorageTests_" + fileName);
+    std::filesystem::remove(path);
+    return path.string();
+}
+
+// Count records of the DataStorage with the value of the key
+template <class T>
+static std::size_t CountRecords(const DataStorage& ds, const std::string& keyName, const T& value)
+{
+    std::size_t res = 0;
+    DataStorageQuery query;
+    query.Where(keyName, Equal<T>(value));
+    ds.ForEachRecord(query, [&res](const DataStorageRecordRef&) { ++res; });
+    return res;
+}
+
+// Changes written to the write-ahead log are applied by ReplayWal, and the damaged end of the log is cut off by EnableWal
+static bool TestWalReplay()
+{
+    std::string walPath = GetTempPath("replay.wal");
+
+    {
+        DataStorage ds;
+        DS_CHECK(ds.EnableWal(walPath));
+        ds.SetKey("id", 0, DataStorageIndexPolicy::HashIndex | DataStorageIndexPolicy::UniqueIndex);
+        ds.SetKey("group", 0);
+
+        for (int i = 0; i < 100; ++i)
+            ds.CreateRecord({ {"id", i}, {"group", i % 10} });
+
+        DS_CHECK(ds.GetRecord("id", 5).SetData("group", 100));
+        ds.EraseRecord(ds.GetRecord("id", 6));
+        ds.DisableWal();
+    }
+
+    // The entry torn by a crash during writing
+    {
+        std::ofstream file(walPath, std::ios::binary | std::ios::app);
+        file << "\x30\x00\x00\x00torn";
+    }
+
+    {
+        DataStorage ds;
+        ds.SetKey("id", 0, DataStorageIndexPolicy::HashIndex | DataStorageIndexPolicy::UniqueIndex);
+        ds.SetKey("group", 0);
+        DS_CHECK(ds.ReplayWal(walPath));
+        DS_CHECK(ds.Size() == 99);
+        DS_CHECK(!ds.GetRecord("id", 6).IsValid());
+        DS_CHECK(CountRecords(ds, "group", 100) == 1);
+
+        // New entries are appended after the last correct entry
+        std::uintmax_t tornSize = std::filesystem::file_size(walPath);
+        DS_CHECK(ds.EnableWal(walPath));
+        DS_CHECK(std::filesystem::file_size(walPath) < tornSize);
+        ds.CreateRecord({ {"id", 1000}, {"group", 1} });
+        ds.DisableWal();
+    }
+
+    {
+        DataStorage ds;
+        ds.SetKey("id", 0, DataStorageIndexPolicy::HashIndex | DataStorageIndexPolicy::UniqueIndex);
+        ds.SetKey("group", 0);
+        DS_CHECK(ds.ReplayWal(walPath));
+        DS_CHECK(ds.Size() == 100);
+        DS_CHECK(ds.GetRecord("id", 1000).IsValid());
+    }
+
+    std::filesystem::remove(walPath);
+    return true;
+}
+
+// Records saved by SaveSnapshot are loaded with the same values, and columns of unknown keys are not skipped silently
+static bool TestSnapshotRoundTrip()
+{
+    std::string snapshotPath = GetTempPath("round_trip.snapshot");
+
+    DataStorage ds;
+    ds.SetKey("id", 0, DataStorageIndexPolicy::HashIndex | DataStorageIndexPolicy::UniqueIndex);
+    ds.SetKey<std::string>("name", "", DataStorageIndexPolicy::NoIndex);
+    ds.SetKey("score", 0.0, DataStorageIndexPolicy::OrderedIndex);
+
+    for (int i = 0; i < 1000; ++i)
+        ds.CreateRecord({ {"id", i}, {"name", "name" + std::to_string(i)}, {"score", i * 0.5} });
+
+    DS_CHECK(ds.SaveSnapshot(snapshotPath));
+
+    DataStorage loaded;
+    loaded.SetKey("id", 0, DataStorageIndexPolicy::HashIndex | DataStorageIndexPolicy::UniqueIndex);
+    loaded.SetKey<std::string>("name", "", DataStorageIndexPolicy::NoIndex);
+    loaded.SetKey("score", 0.0, DataStorageIndexPolicy::OrderedIndex);
+    DS_CHECK(loaded.LoadSnapshot(snapshotPath, true));
+    DS_CHECK(loaded.Size() == 1000);
+
+    for (int i = 0; i < 1000; i += 99)
+    {
+        std::string name;
+        double score = 0;
+        DataStorageRecordRef record = loaded.GetRecord("id", i);
+        DS_CHECK(record.GetData("name", name) && name == "name" + std::to_string(i));
+        DS_CHECK(record.GetData("score", score) && score == i * 0.5);
+    }
+
+    DS_CHECK(loaded.GetRecordsInRange("score", Between<double>(0.0, 10.0)).Size() == 21);
+
+    // The "score" column has no key here
+    DataStorage partial;
+    partial.SetKey("id", 0, DataStorageIndexPolicy::HashIndex);
+    partial.SetKey<std::string>("name", "", DataStorageIndexPolicy::NoIndex);
+    DS_CHECK(!partial.LoadSnapshot(snapshotPath));
+    DS_CHECK(partial.Size() == 0);
+
+    std::size_t skippedColumnsCount = 0;
+    DS_CHECK(partial.LoadSnapshot(snapshotPath, false, &skippedColumnsCount));
+    DS_CHECK(skippedColumnsCount == 1 && partial.Size() == 1000);
+
+    // Records of the active batch are not dropped
+    partial.BeginBatch();
+    partial.CreateRecord({ {"id", 5000} });
+    DS_CHECK(!partial.LoadSnapshot(snapshotPath, false, &skippedColumnsCount));
+    partial.CommitBatch();
+    DS_CHECK(partial.Size() == 1001);
+
+    std::filesystem::remove(snapshotPath);
+    return true;
+}
+
+// Unique keys are not added when several records would get the same default value, and the rejection is reported
+static bool TestUniqueKeyRejection()
+{
+    DataStorage ds;
+    DS_CHECK(ds.SetKey("id", -1, DataStorageIndexPolicy::HashIndex | DataStorageIndexPolicy::UniqueIndex));
+    ds.CreateRecord({ {"id", 1} });
+
+    // One record can get the default value of a unique key
+    DS_CHECK(ds.SetKey("code", 0, DataStorageIndexPolicy::UniqueIndex));
+    ds.CreateRecord({ {"id", 2}, {"code", 5} });
+
+    DS_CHECK(!ds.SetKey("other", 0, DataStorageIndexPolicy::UniqueIndex));
+    DS_CHECK(!ds.IsKeyExist("other"));
+
+    DS_CHECK(!ds.AddKeys(DataStorageKey<int>("plain", 0), DataStorageKey<int>("unique", 0, DataStorageIndexPolicy::UniqueIndex)));
+    DS_CHECK(ds.IsKeyExist("plain") && !ds.IsKeyExist("unique"));
+
+    // Values of unique keys are still checked
+    DS_CHECK(!ds.CreateRecord({ {"id", 1} }).IsValid());
+    DS_CHECK(!ds.GetRecord("id", 2).SetData("code", 0));
+    DS_CHECK(ds.GetRecord("code", 5).IsValid());
+    return true;
+}
+
+// UpdateRecord changes nothing if a key does not exist or a value has another type
+static bool TestUpdateRecordTypeChecks()
+{
+    DataStorage ds;
+    ds.SetKey("id", -1, DataStorageIndexPolicy::HashIndex);
+    ds.SetKey<std::string>("name", "", DataStorageIndexPolicy::NoIndex);
+    DataStorageRecordRef record = ds.CreateRecord({ {"id", 1}, {"name", std::string("a")} });
+
+    DS_CHECK(!ds.UpdateRecord(record, { {"id", 2}, {"name", 42} }));
+    DS_CHECK(!ds.UpdateRecord(record, { {"id", 2}, {"unknown", 1} }));
+    DS_CHECK(!ds.UpdateRecord(record, { {"id", 2L} }));
+
+    std::string name;
+    int id = 0;
+    DS_CHECK(record.GetData("name", name) && name == "a");
+    DS_CHECK(record.GetData("id", id) && id == 1);
+    DS_CHECK(ds.GetRecord("id", 1).IsValid() && !ds.GetRecord("id", 2).IsValid());
+
+    DS_CHECK(ds.UpdateRecord(record, { {"id", 2}, {"name", std::string("b")} }));
+    DS_CHECK(ds.GetRecord("id", 2).IsValid() && !ds.GetRecord("id", 1).IsValid());
+    return true;
+}
+
+// Records are found in the flat hash index after erasing other records with the same and other values
+static bool TestFlatHashIndex()
+{
+    DataStorage ds;
+    ds.SetKey("id", 0, DataStorageIndexPolicy::FlatHashIndex | DataStorageIndexPolicy::UniqueIndex);
+    ds.SetKey("group", 0, DataStorageIndexPolicy::FlatHashIndex);
+
+    const int recordsCount = 10000;
+    for (int i = 0; i < recordsCount; ++i)
+        ds.CreateRecord({ {"id", i}, {"group", i % 16} });
+
+    // Erase every third record, so that slots are freed in the middle of probe sequences
+    for (int i = 0; i < recordsCount; i += 3)
+        ds.EraseRecord(ds.GetRecord("id", i));
+
+    for (int i = 0; i < recordsCount; ++i)
+        DS_CHECK(ds.GetRecord("id", i).IsValid() == (i % 3 != 0));
+
+    for (int group = 0; group < 16; ++group)
+    {
+        std::size_t expected = 0;
+        for (int i = group; i < recordsCount; i += 16)
+            expected += i % 3 != 0;
+
+        DS_CHECK(CountRecords(ds, "group", group) == expected);
+    }
+
+    // Moving records between values keeps both values consistent
+    for (int i = 1; i < recordsCount; i += 3)
+        DS_CHECK(ds.GetRecord("id", i).SetData("group", 100));
+
+    DS_CHECK(CountRecords(ds, "group", 100) == static_cast<std::size_t>((recordsCount + 1) / 3));
+
+    // Erased values can be used again
+    for (int i = 0; i < recordsCount; i += 3)
+        DS_CHECK(ds.CreateRecord({ {"id", i}, {"group", 200} }).IsValid());
+
+    DS_CHECK(ds.Size() == static_cast<std::size_t>(recordsCount));
+    DS_CHECK(CountRecords(ds, "group", 200) == static_cast<std::size_t>((recordsCount + 2) / 3));
+    return true;
+}
+
+// Records with expired time to live are not found and are erased by the following changes
+static bool TestTimeToLive()
+{
+    DataStorage ds;
+    ds.SetKey("id", -1, DataStorageIndexPolicy::HashIndex | DataStorageIndexPolicy::UniqueIndex);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        DataStorageRecordRef record = ds.CreateRecord({ {"id", i} });
+        if (i % 2 == 0)
+            DS_CHECK(ds.SetRecordTimeToLive(record, std::chrono::milliseconds(20)));
+    }
+
+    // Time to live is reset by zero
+    DataStorageRecordRef kept = ds.GetRecord("id", 2);
+    DS_CHECK(ds.SetRecordTimeToLive(kept, std::chrono::steady_clock::duration::zero()));
+
+    DS_CHECK(ds.GetRecord("id", 0).IsValid());
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+
+    DS_CHECK(!ds.GetRecord("id", 0).IsValid());
+    DS_CHECK(ds.GetRecord("id", 1).IsValid());
+    DS_CHECK(kept.IsValid());
+
+    DS_CHECK(ds.EraseExpiredRecords() == 49);
+    DS_CHECK(ds.Size() == 51);
+    DS_CHECK(ds.EraseExpiredRecords() == 0);
+    return true;
+}
+
+// Handles of other storages, other types or dropped columns do not access the wrong column
+static bool TestColumnHandleMisuse()
+{
+    ColumnDataStorage first, second;
+    ColumnHandle<int> handle = first.SetKey("x", 1);
+    DictionaryColumnHandle<int> dictionaryHandle = second.SetDictionaryKey("x", 2);
+    DS_CHECK(handle.IsValid() && dictionaryHandle.IsValid());
+
+    // The handle of the plain column used with the dictionary column of the same index
+    RowId row = second.CreateRecord();
+    int value = 0;
+    DS_CHECK(!second.GetData(row, handle, value));
+    DS_CHECK(!second.SetData(row, handle, 5));
+    DS_CHECK(second.GetData(row, dictionaryHandle, value) && value == 2);
+
+    DS_CHECK(!first.GetData(first.CreateRecord(), dictionaryHandle, value));
+
+    // Handles of other types are invalid
+    DS_CHECK(!first.GetColumnHandle<double>("x").IsValid());
+    DS_CHECK(!first.GetColumnHandle<int>("y").IsValid());
+
+    // The index of the dropped column is not reused by the new column of another type
+    first.DropDataStorage();
+    first.SetDictionaryKey<int>("b", 3);
+    DS_CHECK(!first.GetData(first.CreateRecord(), handle, value));
+    return true;
+}
+
+// Views see the records as they were at the moment of creation while the DataStorage is changed
+static bool TestViews()
+{
+    DataStorage ds;
+    ds.SetKey("id", 0, DataStorageIndexPolicy::HashIndex | DataStorageIndexPolicy::UniqueIndex);
+    ds.SetKey<std::string>("name", "", DataStorageIndexPolicy::NoIndex);
+
+    for (int i = 0; i < 1000; ++i)
+        ds.CreateRecord({ {"id", i}, {"name", std::to_string(i)} });
+
+    DataStorageView view = ds.Snapshot();
+
+    ds.GetRecord("id", 1).SetData<std::string>("name", "changed");
+    ds.EraseRecord(ds.GetRecord("id", 2));
+    ds.CreateRecord({ {"id", 5000} });
+    ds.SetKey("added", 0, DataStorageIndexPolicy::NoIndex);
+    ds.RemoveKey("name");
+
+    std::size_t recordsCount = 0;
+    bool isCorrect = true;
+    view.ForEachRecord([&](const DataHashMap& record)
+        {
+            int id = 0;
+            std::string name;
+            isCorrect = isCorrect && record.GetData("id", id) && record.GetData("name", name) && name == std::to_string(id) && !record.IsData("added");
+            ++recordsCount;
+        }
+    );
+
+    DS_CHECK(isCorrect);
+    DS_CHECK(recordsCount == 1000);
+    DS_CHECK(view.GetPreservedRecordsCount() == 2);
+    return true;
+}
+
+// Fields that can not be parsed fail the import and are reported with their position
+static bool TestCsvImport()
+{
+    std::string correctPath = GetTempPath("correct.csv");
+    std::string damagedPath = GetTempPath("damaged.csv");
+
+    {
+        std::ofstream file(correctPath);
+        file << "id,name,score,skipped\n1,\"a,b\",1.5,x\n\n2,c,,y\n";
+    }
+
+    {
+        std::ofstream file(damagedPath);
+        file << "id,name,score\n1,a,1.5\n2,\"two\nlines\",2\n3,c,bad\n";
+    }
+
+    DataStorage ds;
+    ds.SetKey("id", 0);
+    ds.SetKey<std::string>("name", "");
+    ds.SetKey("score", -1.0);
+
+    std::optional<std::size_t> importedCount = ds.ImportCsv(correctPath, true, 4);
+    DS_CHECK(importedCount && *importedCount == 2);
+
+    std::string name;
+    double score = 0;
+    DS_CHECK(ds.GetRecord("id", 1).GetData("name", name) && name == "a,b");
+    DS_CHECK(ds.GetRecord("id", 2).GetData("score", score) && score == -1.0);
+
+    DataStorageCsvError error;
+    DS_CHECK(!ds.ImportCsv(damagedPath, true, 4, &error));
+    DS_CHECK(error.Line == 4 && error.Column == 3);
+    DS_CHECK(ds.Size() == 2);
+
+    DS_CHECK(!ds.ImportCsv(GetTempPath("missing.csv"), false, 4, &error));
+    DS_CHECK(error.Line == 0);
+
+    std::filesystem::remove(correctPath);
+    std::filesystem::remove(damagedPath);
+    return true;
+}
+
+// The shard key is searched only with its own type and can not be changed by records
+static bool TestShardKey()
+{
+    ShardedDataStorage ds(4);
+    DS_CHECK(ds.SetShardKey("id", 0L, DataStorageIndexPolicy::HashIndex));
+    DS_CHECK(ds.SetKey("value", 0));
+
+    for (long i = 0; i < 100; ++i)
+        DS_CHECK(ds.CreateRecord({ {"id", i}, {"value", static_cast<int>(i)} }).IsValid());
+
+    DS_CHECK(!ds.CreateRecord({ {"id", 1000} }).IsValid());
+    DS_CHECK(ds.GetRecord("id", 5L).IsValid());
+    DS_CHECK(!ds.GetRecord("id", 5).IsValid());
+
+    DataStorageRecordRef record = ds.GetRecord("id", 7L);
+    DS_CHECK(!record.SetData("id", 2000L));
+    DS_CHECK(record.SetData("value", 1));
+
+    ds.EraseRecord(record);
+    DS_CHECK(ds.Size() == 99);
+    DS_CHECK(!ds.GetRecord("id", 7L).IsValid());
+    return true;
+}
+
+/*
+    Tests of DataStorage, ColumnDataStorage and ShardedDataStorage. Each test checks one behaviour and prints the failed check.
+    Returns 0 if all tests passed, otherwise 1.
+*/
+int main()
+{
+    std::vector<std::pair<std::string, std::function<bool()>>> tests = {
+        { "WalReplay", TestWalReplay },
+        { "SnapshotRoundTrip", TestSnapshotRoundTrip },
+        { "UniqueKeyRejection", TestUniqueKeyRejection },
+        { "UpdateRecordTypeChecks", TestUpdateRecordTypeChecks },
+        { "FlatHashIndex", TestFlatHashIndex },
+        { "TimeToLive", TestTimeToLive },
+        { "ColumnHandleMisuse", TestColumnHandleMisuse },
+        { "Views", TestViews },
+        { "CsvImport", TestCsvImport },
+        { "ShardKey", TestShardKey }
+    };
+
+    std::size_t failedCount = 0;
+    for (auto& it : tests)
+    {
+        bool isPassed = it.second();
+        std::cout << (isPassed ? "[PASSED] " : "[FAILED] ") << it.first << std::endl;
+        failedCount += !isPassed;
+    }
+
+    std::cout << tests.size() - failedCount << " of " << tests.size() << " tests passed" << std::endl;
+    return failedCount == 0 ? 0 : 1;
+}
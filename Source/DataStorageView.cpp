@@ -0,0 +1,99 @@
+#include "DataStorageView.h"
+
+#include <algorithm>
+
+#include "DataStorage.h"
+
+DataStorageView::DataStorageView() {}
+
+DataStorageView::DataStorageView(const DataStorage* dataStorage, std::unique_ptr<State>&& viewState) : Storage(dataStorage), ViewState(std::move(viewState)) {}
+
+DataStorageView::DataStorageView(DataStorageView&& other) noexcept : Storage(other.Storage), ViewState(std::move(other.ViewState))
+{
+    other.Storage = nullptr;
+}
+
+DataStorageView& DataStorageView::operator= (DataStorageView&& other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        Storage = other.Storage;
+        ViewState = std::move(other.ViewState);
+        other.Storage = nullptr;
+    }
+
+    return *this;
+}
+
+void DataStorageView::Release()
+{
+    if (ViewState == nullptr)
+        return;
+
+    // The DataStorage stops copying records to the view before its data is deleted
+    Storage->ReleaseView(ViewState.get());
+    ViewState.reset();
+    Storage = nullptr;
+}
+
+DataStorageView::Record* DataStorageView::FindRecord(State& viewState, std::uint64_t recordId, const DataStorageRecord* record)
+{
+    // Records created after the view are not seen by it
+    if (recordId >= viewState.NextRecordId)
+        return nullptr;
+
+    auto f = std::lower_bound(viewState.RecordIds.begin(), viewState.RecordIds.end(), std::make_pair(recordId, static_cast<const DataStorageRecord*>(nullptr)));
+    if (f == viewState.RecordIds.end() || f->first != recordId || f->second != record)
+        return nullptr;
+
+    return &viewState.Records[f - viewState.RecordIds.begin()];
+}
+
+void DataStorageView::CopyRecord(const State& viewState, std::size_t index, DataHashMap& res)
+{
+    const DataHashMap* record = viewState.RecordIds[index].second;
+    const DataHashMap* removedValues = viewState.Records[index].Copy.get();
+
+    // Keys added after the view are skipped, and removed keys are taken from their copies
+    for (auto& it : viewState.KeyNames)
+    {
+        const DataSaver* value = removedValues != nullptr ? removedValues->GetDataSaver(it) : nullptr;
+        if (value == nullptr)
+            value = record->GetDataSaver(it);
+
+        if (value != nullptr)
+            res.AddDataFromDataSaver(it, *value);
+    }
+}
+
+bool DataStorageView::AcquireRecord(Record& record)
+{
+    std::uint8_t status = record.Status.load(std::memory_order_acquire);
+    while (status != CopiedRecord)
+    {
+        // Readers keep the status only while they copy the record
+        if (status == LiveRecord && record.Status.compare_exchange_weak(status, ChangingRecord, std::memory_order_acquire))
+            return true;
+
+        std::this_thread::yield();
+        status = record.Status.load(std::memory_order_acquire);
+    }
+
+    return false;
+}
+
+std::size_t DataStorageView::Size() const
+{
+    return ViewState != nullptr ? ViewState->RecordIds.size() : 0;
+}
+
+std::size_t DataStorageView::GetPreservedRecordsCount() const
+{
+    return ViewState != nullptr ? ViewState->PreservedRecordsCount.load() : 0;
+}
+
+DataStorageView::~DataStorageView()
+{
+    Release();
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "DataStorageClasses.h"
+#include "DataStorageRecord.h"
+
+/**
+    \brief A class for reading all records of DataStorage as they were at one moment
+
+    The view is created by DataStorage::Snapshot. It stores pointers to the records that existed at that moment, not their copies.
+    Before a record seen by the view is changed or erased, DataStorage copies its old data to the view, so only changed records are copied.
+    Records created after the view are not seen by it, and keys added after the view are not seen in its records.
+    Removing a key copies only the values of the key.
+
+    ForEachRecord does not lock the DataStorage. Each record has its own status, which is changed by the reader only while it copies
+    the record, and by writers only while they copy or change the record. So readers never wait for the callbacks of other readers,
+    writers wait at most for copying of one record, and readers wait only for writers which add or remove keys.
+
+    \code
+        DataStorageView view = ds.Snapshot();
+        view.ForEachRecord([&out](const DataHashMap& record)
+            {
+                int id;
+                record.GetData("id", id);
+                out << id << '\n';
+            }
+        );
+    \endcode
+
+    \warning The view must be destroyed before its DataStorage.
+*/
+class DataStorageView
+{
+private:
+    // Status of the record of the view
+    enum RecordStatus : std::uint8_t
+    {
+        // The record of the DataStorage has the data of the view
+        LiveRecord,
+        // A reader of the view copies the record of the DataStorage
+        ReadingRecord,
+        // A writer of the DataStorage copies or changes the record
+        ChangingRecord,
+        // The view has the full copy of the record, and the record of the DataStorage is not used
+        CopiedRecord
+    };
+
+    // Record of the view
+    struct Record
+    {
+        // Status of the record, see RecordStatus. Readers and writers change the record only after changing the status from LiveRecord
+        std::atomic<std::uint8_t> Status{LiveRecord};
+
+        // The full copy of the record if the status is CopiedRecord, otherwise values of removed keys or nullptr
+        std::unique_ptr<DataHashMap> Copy;
+    };
+
+    // Data of the view, which is changed by DataStorage
+    struct State
+    {
+        // Ids and pointers of the records of the DataStorage at the moment of creation of the view, sorted by ids
+        std::vector<std::pair<std::uint64_t, const DataStorageRecord*>> RecordIds;
+
+        // Records of the view in the same order as RecordIds
+        std::unique_ptr<Record[]> Records;
+
+        // Keys of the DataStorage at the moment of creation of the view
+        std::vector<std::string> KeyNames;
+
+        // Records with ids not less than this one were created after the view
+        std::uint64_t NextRecordId = 0;
+
+        // Number of records with the status CopiedRecord
+        std::atomic<std::size_t> PreservedRecordsCount{0};
+    };
+
+    // Pointer to the DataStorage of the view. Equal to nullptr if the view is empty
+    const DataStorage* Storage = nullptr;
+
+    // Data of the view. It is registered in the DataStorage while the view exists
+    std::unique_ptr<State> ViewState;
+
+    // Constructor for DataStorage::Snapshot
+    DataStorageView(const DataStorage* dataStorage, std::unique_ptr<State>&& viewState);
+
+    // Unregister the view from the DataStorage and delete its data
+    void Release();
+
+    // Find the record of the view by the id and the pointer of the record of the DataStorage. Returns nullptr if the view does not see the record
+    static Record* FindRecord(State& viewState, std::uint64_t recordId, const DataStorageRecord* record);
+
+    // Copy the keys of the view from the record of the DataStorage with the index and the values of removed keys.
+    // The status of the record must be changed from LiveRecord by the caller
+    static void CopyRecord(const State& viewState, std::size_t index, DataHashMap& res);
+
+    // Change the status of the record from LiveRecord to ChangingRecord for the writer. Returns false if the record is already copied
+    static bool AcquireRecord(Record& record);
+
+public:
+    /// Making the DataStorage class friendly so that it can copy records to the view
+    friend DataStorage;
+
+    /// Default constructor. Creates an empty view without records
+    DataStorageView();
+
+    /// Deleted copy constructor
+    DataStorageView(const DataStorageView& other) = delete;
+
+    /// Deleted assign operator
+    DataStorageView& operator= (const DataStorageView& other) = delete;
+
+    /// \brief Move constructor
+    /// \param [in] other object to be moved. It becomes empty
+    DataStorageView(DataStorageView&& other) noexcept;
+
+    /// \brief Move assign operator. The current view is released
+    /// \param [in] other object to be moved. It becomes empty
+    /// \return ref to this object
+    DataStorageView& operator= (DataStorageView&& other) noexcept;
+
+    /**
+        \brief The method for iterating over all records of the view
+
+        \tparam <F> Function or lambda function with the signature void(const DataHashMap& record) or bool(const DataHashMap& record).
+        If the function returns false, the iteration stops
+
+        The record passed to the function is a copy, and it is valid only inside the function.
+        The DataStorage is not locked, so the function can read and change it.
+
+        \param [in] func function to be called for each record
+    */
+    template <class F>
+    void ForEachRecord(F&& func) const;
+
+    /// \brief Method for getting the number of records in the view
+    /// \return number of records
+    std::size_t Size() const;
+
+    /// \brief Method for getting the number of records copied to the view since its creation
+    /// \return number of copied records
+    std::size_t GetPreservedRecordsCount() const;
+
+    /// Destructor. Unregisters the view from the DataStorage
+    ~DataStorageView();
+};
+
+template <class F>
+void DataStorageView::ForEachRecord(F&& func) const
+{
+    if (ViewState == nullptr)
+        return;
+
+    DataHashMap recordCopy;
+    for (std::size_t i = 0; i < ViewState->RecordIds.size(); ++i)
+    {
+        Record& record = ViewState->Records[i];
+        const DataHashMap* data = nullptr;
+
+        // The status is changed by others only while they copy one record or add or remove keys
+        while (data == nullptr)
+        {
+            std::uint8_t status = record.Status.load(std::memory_order_acquire);
+            if (status == CopiedRecord)
+                data = record.Copy.get();
+            else if (status == LiveRecord && record.Status.compare_exchange_weak(status, ReadingRecord, std::memory_order_acquire))
+            {
+                // The callback gets the copy, so that writers do not wait for it
+                recordCopy.Clear();
+                CopyRecord(*ViewState, i, recordCopy);
+                record.Status.store(LiveRecord, std::memory_order_release);
+                data = &recordCopy;
+            }
+            else
+                std::this_thread::yield();
+        }
+
+        if constexpr (std::is_same<decltype(func(*data)), bool>::value)
+        {
+            if (!func(*data))
+                break;
+        }
+        else
+            func(*data);
+    }
+}
@@ -0,0 +1,296 @@
+#include "DataStorageWal.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#include "DataStorageSnapshot.h"
+
+#if defined(_WIN32)
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+DataStorageWal::DataStorageWal() {}
+
+std::uint32_t DataStorageWal::Checksum(const char* begin, const char* end)
+{
+    // FNV-1a
+    std::uint32_t res = 2166136261u;
+    for (const char* it = begin; it != end; ++it)
+    {
+        res ^= static_cast<unsigned char>(*it);
+        res *= 16777619u;
+    }
+
+    return res;
+}
+
+bool DataStorageWal::WriteToDisk(const std::string& data)
+{
+    if (std::fwrite(data.data(), 1, data.size(), File) != data.size() || std::fflush(File) != 0)
+        return false;
+
+#if defined(_WIN32)
+    return _commit(_fileno(File)) == 0;
+#else
+    return fsync(fileno(File)) == 0;
+#endif
+}
+
+void DataStorageWal::CommitLoop()
+{
+    std::unique_lock<std::mutex> lock(Mtx);
+
+    while (true)
+    {
+        // Wait for the first entry
+        CommitCv.wait(lock, [this]() { return IsStopped || !Buffer.empty(); });
+
+        // Wait for the commit interval, or for enough data, or for the request to flush, so that entries are written together
+        CommitCv.wait_for(lock, Settings.CommitInterval, [this]()
+            {
+                return IsStopped || IsFlushRequested || Buffer.size() >= Settings.CommitSize;
+            }
+        );
+
+        IsFlushRequested = false;
+
+        if (!Buffer.empty() && !IsFailed)
+        {
+            // New entries are appended to the empty buffer while the data is written
+            std::string data;
+            data.swap(Buffer);
+            std::uint64_t lsn = LastLsn;
+
+            lock.unlock();
+            bool isWritten = WriteToDisk(data);
+            lock.lock();
+
+            if (isWritten)
+                CommittedLsn = lsn;
+            else
+                IsFailed = true;
+        }
+
+        CommittedCv.notify_all();
+
+        if (IsStopped && (Buffer.empty() || IsFailed))
+            break;
+    }
+}
+
+bool DataStorageWal::Open(const std::string& path, const DataStorageWalSettings& settings, std::uint64_t minLsn)
+{
+    Close();
+
+    // Find the last correct entry
+    std::uint64_t lastLsn = minLsn;
+    std::size_t validSize = 0;
+    if (!Read(path, [&lastLsn](std::uint64_t lsn, const char*, const char*) { lastLsn = std::max(lastLsn, lsn); return true; }, validSize))
+        return false;
+
+    // Cut off the damaged entry, so that new entries are not lost after it
+    std::error_code errorCode;
+    if (std::filesystem::exists(path, errorCode) && std::filesystem::file_size(path, errorCode) != validSize)
+    {
+        std::filesystem::resize_file(path, validSize, errorCode);
+        if (errorCode)
+            return false;
+    }
+
+    File = std::fopen(path.c_str(), "ab");
+    if (File == nullptr)
+        return false;
+
+    Settings = settings;
+    Buffer.clear();
+    LastLsn = lastLsn;
+    CommittedLsn = lastLsn;
+    IsFlushRequested = false;
+    IsFailed = false;
+    IsStopped = false;
+    for (auto& it : CommitWaitHistogram)
+        it = 0;
+
+    CommitThread = std::thread([this]() { CommitLoop(); });
+    return true;
+}
+
+void DataStorageWal::Close()
+{
+    if (File == nullptr)
+        return;
+
+    // The commit thread writes all entries before stopping
+    {
+        std::lock_guard<std::mutex> lock(Mtx);
+        IsStopped = true;
+    }
+
+    CommitCv.notify_one();
+    CommitThread.join();
+
+    std::fclose(File);
+    File = nullptr;
+}
+
+std::uint64_t DataStorageWal::Append(const std::string& data)
+{
+    std::uint64_t lsn;
+    bool isWakeNeeded;
+
+    {
+        std::lock_guard<std::mutex> lock(Mtx);
+        lsn = ++LastLsn;
+
+        // The size of the data, the LSN, the data and the checksum
+        std::size_t entryBegin = Buffer.size();
+        DataStorageSnapshotCodec<std::uint32_t>::Save(static_cast<std::uint32_t>(data.size()), Buffer);
+        std::size_t checkedBegin = Buffer.size();
+        DataStorageSnapshotCodec<std::uint64_t>::Save(lsn, Buffer);
+        Buffer.append(data);
+        DataStorageSnapshotCodec<std::uint32_t>::Save(Checksum(Buffer.data() + checkedBegin, Buffer.data() + Buffer.size()), Buffer);
+
+        // Wake the commit thread only when the buffer becomes not empty or full
+        isWakeNeeded = entryBegin == 0 || (Buffer.size() >= Settings.CommitSize && entryBegin < Settings.CommitSize);
+    }
+
+    if (isWakeNeeded)
+        CommitCv.notify_one();
+
+    return lsn;
+}
+
+bool DataStorageWal::WaitForCommit(std::uint64_t lsn)
+{
+    std::unique_lock<std::mutex> lock(Mtx);
+    if (CommittedLsn >= lsn || File == nullptr)
+        return !IsFailed;
+
+    auto waitBegin = std::chrono::steady_clock::now();
+    CommittedCv.wait(lock, [this, lsn]() { return CommittedLsn >= lsn || IsFailed || IsStopped; });
+
+    // Add the wait to the histogram
+    std::uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - waitBegin).count();
+    std::size_t bucket = 0;
+    while (microseconds > 1 && bucket < HistogramBucketsCount - 1)
+    {
+        microseconds >>= 1;
+        ++bucket;
+    }
+    ++CommitWaitHistogram[bucket];
+
+    return CommittedLsn >= lsn;
+}
+
+bool DataStorageWal::Flush()
+{
+    std::uint64_t lsn;
+    {
+        std::lock_guard<std::mutex> lock(Mtx);
+        if (File == nullptr)
+            return !IsFailed;
+
+        lsn = LastLsn;
+        IsFlushRequested = true;
+    }
+
+    CommitCv.notify_one();
+
+    std::unique_lock<std::mutex> lock(Mtx);
+    CommittedCv.wait(lock, [this, lsn]() { return CommittedLsn >= lsn || IsFailed; });
+    return !IsFailed;
+}
+
+bool DataStorageWal::Clear()
+{
+    if (!Flush())
+        return false;
+
+    std::lock_guard<std::mutex> lock(Mtx);
+
+    // Entries are appended only to the buffer while the mutex is locked, so the file can be cleared
+    // The file is opened for appending, so the next entries are written to the beginning of the cleared file
+#if defined(_WIN32)
+    bool isCleared = _chsize_s(_fileno(File), 0) == 0 && _commit(_fileno(File)) == 0;
+#else
+    bool isCleared = ftruncate(fileno(File), 0) == 0 && fsync(fileno(File)) == 0;
+#endif
+
+    if (!isCleared)
+        IsFailed = true;
+
+    return isCleared;
+}
+
+std::uint64_t DataStorageWal::GetLastLsn() const
+{
+    std::lock_guard<std::mutex> lock(Mtx);
+    return LastLsn;
+}
+
+const DataStorageWalSettings& DataStorageWal::GetSettings() const
+{
+    return Settings;
+}
+
+std::vector<std::size_t> DataStorageWal::GetCommitWaitHistogram() const
+{
+    std::lock_guard<std::mutex> lock(Mtx);
+    return std::vector<std::size_t>(CommitWaitHistogram, CommitWaitHistogram + HistogramBucketsCount);
+}
+
+bool DataStorageWal::Read(const std::string& path, const std::function<bool(std::uint64_t lsn, const char* begin, const char* end)>& func, std::size_t& validSize)
+{
+    validSize = 0;
+
+    // The log is empty if the file does not exist
+    std::error_code errorCode;
+    if (!std::filesystem::exists(path, errorCode))
+        return !errorCode;
+
+    DataStorageSnapshotFile file;
+    if (!file.Open(path))
+        return false;
+
+    const char* begin = file.GetData();
+    const char* ptr = begin;
+    const char* end = begin + file.GetSize();
+
+    while (ptr != end)
+    {
+        const char* entryPtr = ptr;
+        std::uint32_t size, checksum;
+        std::uint64_t lsn;
+
+        // Stop at the incomplete entry
+        if (!DataStorageSnapshotCodec<std::uint32_t>::Load(entryPtr, end, size))
+            break;
+
+        const char* checkedBegin = entryPtr;
+        if (!DataStorageSnapshotCodec<std::uint64_t>::Load(entryPtr, end, lsn) || static_cast<std::size_t>(end - entryPtr) < size)
+            break;
+
+        const char* dataBegin = entryPtr;
+        entryPtr += size;
+        const char* checkedEnd = entryPtr;
+
+        // Stop at the damaged entry
+        if (!DataStorageSnapshotCodec<std::uint32_t>::Load(entryPtr, end, checksum) || checksum != Checksum(checkedBegin, checkedEnd))
+            break;
+
+        ptr = entryPtr;
+        validSize = static_cast<std::size_t>(ptr - begin);
+
+        if (!func(lsn, dataBegin, checkedEnd))
+            break;
+    }
+
+    return true;
+}
+
+DataStorageWal::~DataStorageWal()
+{
+    Close();
+}
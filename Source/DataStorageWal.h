@@ -0,0 +1,183 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Types of the write-ahead log entries
+enum DataStorageWalEntryType : std::uint8_t
+{
+    /// A record was created. Contains the id of the record and values of all keys
+    CreateRecordEntry = 1,
+    /// A record was erased. Contains the id of the record
+    EraseRecordEntry = 2,
+    /// The value of a key of a record was changed. Contains the id of the record, the name of the key and the new value
+    SetDataEntry = 3,
+    /// A key was added. Contains the name of the key, the name of its type, the index policy and the default value
+    AddKeyEntry = 4,
+    /// A key was removed. Contains the name of the key
+    RemoveKeyEntry = 5,
+    /// All records were deleted
+    DropDataEntry = 6,
+    /// All records and keys were deleted
+    DropDataStorageEntry = 7,
+    /// A composite index was added. Contains the number of its keys, the names of the keys and the index policy
+    AddCompositeIndexEntry = 8,
+    /// A composite index was removed. Contains the number of its keys and the names of the keys
+    RemoveCompositeIndexEntry = 9
+};
+
+/// Settings of the write-ahead log
+struct DataStorageWalSettings
+{
+    /// Maximum time between appending an entry and writing it to the disk
+    std::chrono::microseconds CommitInterval = std::chrono::microseconds(2000);
+
+    /// Entries are written to the disk without waiting for CommitInterval when this number of bytes is not written
+    std::size_t CommitSize = 1 << 20;
+
+    /// If true, each change of DataStorage waits until its entry is written to the disk, otherwise changes can be lost in the last CommitInterval
+    bool IsSyncCommit = false;
+};
+
+/**
+    \brief A class for the write-ahead log of DataStorage
+
+    Entries are appended to the memory buffer, and the background thread writes the buffer to the file and calls fsync.
+    All entries appended since the previous write are written with one fsync, so many changes share the cost of one disk sync.
+    Each entry has the log sequence number (LSN), which grows by one with each entry, and WaitForCommit waits until the entry is on the disk.
+
+    Each entry in the file is stored as the size of the data, the LSN, the data and the checksum of the LSN and data,
+    so an entry damaged by a crash during writing is found when reading the log, and all entries after it are ignored.
+    All methods are thread safe.
+*/
+class DataStorageWal
+{
+private:
+    // Number of buckets of the commit wait histogram
+    static constexpr std::size_t HistogramBucketsCount = 32;
+
+    // Settings of the log
+    DataStorageWalSettings Settings;
+
+    // The log file
+    std::FILE* File = nullptr;
+
+    // Mutex to protect the buffer and the state of the log
+    mutable std::mutex Mtx;
+
+    // Signals the commit thread that there is data to write
+    std::condition_variable CommitCv;
+
+    // Signals waiting threads that entries were written
+    std::condition_variable CommittedCv;
+
+    // Entries that are not written to the file
+    std::string Buffer;
+
+    // LSN of the last appended entry
+    std::uint64_t LastLsn = 0;
+
+    // LSN of the last entry written to the disk
+    std::uint64_t CommittedLsn = 0;
+
+    // Is the commit of all buffered entries requested without waiting for CommitInterval
+    bool IsFlushRequested = false;
+
+    // Was writing to the file failed. Entries are not written after the failure
+    bool IsFailed = false;
+
+    // Is the commit thread stopped
+    bool IsStopped = false;
+
+    // Thread to write entries to the disk
+    std::thread CommitThread;
+
+    // Number of waits in WaitForCommit. The bucket i counts waits from 2^i to 2^(i+1) microseconds, and the bucket 0 counts waits less than 2 microseconds
+    std::size_t CommitWaitHistogram[HistogramBucketsCount] = {};
+
+    // Function of the commit thread
+    void CommitLoop();
+
+    // Write data to the file and sync it with the disk. Returns false on failure
+    bool WriteToDisk(const std::string& data);
+
+    // Checksum of the entry
+    static std::uint32_t Checksum(const char* begin, const char* end);
+
+public:
+    /// Default constructor. The log is not open
+    DataStorageWal();
+
+    /// Deleted copy constructor
+    DataStorageWal(const DataStorageWal& other) = delete;
+
+    /// Deleted assign operator
+    DataStorageWal& operator= (const DataStorageWal& other) = delete;
+
+    /**
+        \brief Method for opening the log to append entries
+
+        Entries after the first damaged entry are cut off from the file, and new entries are appended after the last correct one.
+
+        \param [in] path path to the log file. The file is created if it does not exist
+        \param [in] settings settings of the log
+        \param [in] minLsn the least LSN of previous entries. LSN of new entries will be greater than it and than LSN of entries in the file
+
+        \return returns true if the log was opened, otherwise false
+    */
+    bool Open(const std::string& path, const DataStorageWalSettings& settings, std::uint64_t minLsn = 0);
+
+    /// Method for closing the log. All appended entries are written to the disk
+    void Close();
+
+    /// \brief Method for appending the entry
+    /// \param [in] data the entry
+    /// \return LSN of the entry
+    std::uint64_t Append(const std::string& data);
+
+    /// \brief Method for waiting until the entry is written to the disk
+    /// \param [in] lsn LSN of the entry
+    /// \return returns true if the entry was written, or false if writing failed
+    bool WaitForCommit(std::uint64_t lsn);
+
+    /// \brief Method for writing all appended entries to the disk immediately
+    /// \return returns true if the entries were written, or false if writing failed
+    bool Flush();
+
+    /// \brief Method for deleting all entries from the file, for example when they are saved to the snapshot. LSN of new entries continues to grow
+    /// \return returns true if the file was cleared, otherwise false
+    bool Clear();
+
+    /// \brief Method for getting the LSN of the last appended entry
+    /// \return LSN of the last entry
+    std::uint64_t GetLastLsn() const;
+
+    /// \brief Method for getting the settings of the log
+    /// \return settings of the log
+    const DataStorageWalSettings& GetSettings() const;
+
+    /// \brief Method for getting the histogram of waits in WaitForCommit
+    /// \return vector where the element i is the number of waits from 2^i to 2^(i+1) microseconds. The element 0 also counts shorter waits
+    std::vector<std::size_t> GetCommitWaitHistogram() const;
+
+    /**
+        \brief Method for reading all correct entries of the log file
+
+        \param [in] path path to the log file
+        \param [in] func function called for each entry with its LSN and data. If it returns false, reading stops
+        \param [out] validSize size of the beginning of the file with correct entries
+
+        \return returns false if the file exists and can not be read, otherwise true
+    */
+    static bool Read(const std::string& path, const std::function<bool(std::uint64_t lsn, const char* begin, const char* end)>& func, std::size_t& validSize);
+
+    /// Destructor. Closes the log
+    ~DataStorageWal();
+};
@@ -0,0 +1,144 @@
+#include "EpochManager.h"
+
+EpochManager::ThreadEpochOwner::~ThreadEpochOwner()
+{
+    if (Owned != nullptr)
+        Owned->IsUsed.store(false);
+}
+
+EpochManager::EpochManager() {}
+
+EpochManager& EpochManager::GetInstance()
+{
+    static EpochManager epochManager;
+    return epochManager;
+}
+
+EpochManager::ThreadEpoch& EpochManager::GetThreadEpoch()
+{
+    static thread_local ThreadEpochOwner threadEpochOwner;
+
+    if (threadEpochOwner.Owned != nullptr)
+        return *threadEpochOwner.Owned;
+
+    // Try to reuse thread epoch of finished thread
+    for (ThreadEpoch* it = ThreadEpochs.load(); it != nullptr; it = it->Next)
+    {
+        bool isUsed = false;
+        if (it->IsUsed.compare_exchange_strong(isUsed, true))
+        {
+            threadEpochOwner.Owned = it;
+            return *it;
+        }
+    }
+
+    // Add new thread epoch to the begin of the list
+    ThreadEpoch* threadEpoch = new ThreadEpoch;
+    threadEpoch->IsUsed.store(true);
+    threadEpoch->Next = ThreadEpochs.load();
+    while (!ThreadEpochs.compare_exchange_weak(threadEpoch->Next, threadEpoch));
+
+    threadEpochOwner.Owned = threadEpoch;
+    return *threadEpoch;
+}
+
+void EpochManager::Enter()
+{
+    ThreadEpoch& threadEpoch = GetThreadEpoch();
+
+    ++threadEpoch.Depth;
+    if (threadEpoch.Depth == 1)
+    {
+        // Announce the epoch. The fence guarantees that the announcement is visible to the writer before any pointer is read
+        threadEpoch.Epoch.store(GlobalEpoch.load());
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+void EpochManager::Exit()
+{
+    ThreadEpoch& threadEpoch = GetThreadEpoch();
+
+    --threadEpoch.Depth;
+    if (threadEpoch.Depth == 0)
+        threadEpoch.Epoch.store(0, std::memory_order_release);
+}
+
+void EpochManager::Retire(void* ptr, void (*deleteFunc)(void* ptr))
+{
+    // The fence guarantees that the object is removed from the structure before the epoch is read
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    std::lock_guard<std::mutex> lk(RetiredMtx);
+    RetiredObjects.push_back({ ptr, deleteFunc, GlobalEpoch.load() });
+
+    ++RetiresSinceCollect;
+    if (RetiresSinceCollect >= CollectInterval)
+        CollectLocked();
+}
+
+void EpochManager::Collect()
+{
+    std::lock_guard<std::mutex> lk(RetiredMtx);
+    CollectLocked();
+}
+
+void EpochManager::CollectLocked()
+{
+    RetiresSinceCollect = 0;
+
+    // Advance the global epoch if all active threads have announced the current epoch
+    std::uint64_t globalEpoch = GlobalEpoch.load();
+    bool isAllThreadsInGlobalEpoch = true;
+
+    for (ThreadEpoch* it = ThreadEpochs.load(); it != nullptr; it = it->Next)
+    {
+        std::uint64_t threadEpoch = it->Epoch.load();
+        if (threadEpoch != 0 && threadEpoch != globalEpoch)
+        {
+            isAllThreadsInGlobalEpoch = false;
+            break;
+        }
+    }
+
+    if (isAllThreadsInGlobalEpoch && GlobalEpoch.compare_exchange_strong(globalEpoch, globalEpoch + 1))
+        ++globalEpoch;
+
+    // Delete objects retired at least two epochs ago
+    std::size_t keptCount = 0;
+    for (std::size_t i = 0; i < RetiredObjects.size(); ++i)
+    {
+        if (RetiredObjects[i].Epoch + 2 <= globalEpoch)
+            RetiredObjects[i].DeleteFunc(RetiredObjects[i].Ptr);
+        else
+            RetiredObjects[keptCount++] = RetiredObjects[i];
+    }
+
+    RetiredObjects.resize(keptCount);
+}
+
+EpochManager::~EpochManager()
+{
+    // There are no readers at the end of the program, so all objects can be deleted
+    for (auto& it : RetiredObjects)
+        it.DeleteFunc(it.Ptr);
+
+    ThreadEpoch* it = ThreadEpochs.load();
+    while (it != nullptr)
+    {
+        ThreadEpoch* next = it->Next;
+        delete it;
+        it = next;
+    }
+}
+
+
+EpochGuard::EpochGuard()
+{
+    EpochManager::GetInstance().Enter();
+}
+
+EpochGuard::~EpochGuard()
+{
+    EpochManager::GetInstance().Exit();
+}
\ No newline at end of file
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+    \brief A class for safe memory reclamation in lock-free code
+
+    Lock-free readers can hold pointers to objects that the writer has already removed from the structure.
+    Such objects cannot be deleted immediately, so the writer retires them using Retire, and they are deleted later,
+    when all readers that could see them have left.
+
+    Epoch-based reclamation is used. There is a global epoch, and each reader announces the global epoch when entering
+    the critical section using Enter and clears the announcement using Exit. The global epoch is advanced only when
+    all active readers have announced the current epoch. An object retired in an epoch can be deleted when the global epoch
+    is advanced twice, since after that there are no readers that entered before the object was retired.
+
+    Readers do not write to shared variables, each thread has its own cache line with its epoch.
+    The class is a singleton, so that one thread has only one epoch for all structures.
+
+    Usage example:
+    \code
+        // Reader
+        {
+            EpochGuard epochGuard;
+            // Pointers read here are valid until the end of the scope
+        }
+
+        // Writer, after removing ptr from the structure
+        EpochManager::GetInstance().Retire(ptr);
+    \endcode
+*/
+class EpochManager
+{
+private:
+    // Epoch of one thread, aligned to the cache line size so that threads do not contend
+    struct alignas(64) ThreadEpoch
+    {
+        // The epoch announced by the thread. Equal to 0 if the thread is not inside the critical section
+        std::atomic<std::uint64_t> Epoch{0};
+
+        // Is the object used by a thread
+        std::atomic_bool IsUsed{false};
+
+        // Number of nested Enter calls. Used only by the owner thread
+        std::size_t Depth = 0;
+
+        // Next thread epoch in the list
+        ThreadEpoch* Next = nullptr;
+    };
+
+    // Object retired by the writer
+    struct RetiredObject
+    {
+        // Pointer to the object
+        void* Ptr;
+
+        // Function to delete the object
+        void (*DeleteFunc)(void* ptr);
+
+        // The global epoch at the moment of retirement
+        std::uint64_t Epoch;
+    };
+
+    // Owner of thread epoch. Releases the thread epoch when the thread exits
+    struct ThreadEpochOwner
+    {
+        ThreadEpoch* Owned = nullptr;
+        ~ThreadEpochOwner();
+    };
+
+    // Global epoch. Starts from 1, since 0 means that the thread is not inside the critical section
+    std::atomic<std::uint64_t> GlobalEpoch{1};
+
+    // List of all thread epochs. Thread epochs are never deleted, and are reused by new threads
+    std::atomic<ThreadEpoch*> ThreadEpochs{nullptr};
+
+    // Mutex to protect retired objects
+    std::mutex RetiredMtx;
+
+    // All objects waiting for deletion
+    std::vector<RetiredObject> RetiredObjects;
+
+    // Number of retirements since the last collection
+    std::size_t RetiresSinceCollect = 0;
+
+    // How many retirements trigger a collection
+    static constexpr std::size_t CollectInterval = 64;
+
+    // Private constructor for singleton
+    EpochManager();
+
+    // Get thread epoch of the current thread
+    ThreadEpoch& GetThreadEpoch();
+
+    // Try to advance the global epoch and delete old objects. RetiredMtx must be locked
+    void CollectLocked();
+
+public:
+    /// Deleted copy constructor
+    EpochManager(const EpochManager& other) = delete;
+
+    /// Deleted assign operator
+    EpochManager& operator= (const EpochManager& other) = delete;
+
+    /// \brief Method for getting the only object of the class
+    /// \return ref to the epoch manager
+    static EpochManager& GetInstance();
+
+    /// \brief Method for entering the critical section.
+    /// Objects that were reachable when entering will not be deleted until Exit. Nested calls are allowed
+    void Enter();
+
+    /// \brief Method for leaving the critical section
+    void Exit();
+
+    /**
+        \brief Method for deferred deletion of the object
+
+        The object must be already unreachable for new readers.
+        It will be deleted when all current readers leave the critical section.
+
+        \param [in] ptr pointer to the object
+        \param [in] deleteFunc function to delete the object
+    */
+    void Retire(void* ptr, void (*deleteFunc)(void* ptr));
+
+    /// \brief Template method for deferred deletion of the object
+    /// \tparam <T> Type of the object, it will be deleted using delete
+    /// \param [in] ptr pointer to the object
+    template <class T>
+    void Retire(T* ptr)
+    {
+        Retire(static_cast<void*>(ptr), [](void* ptrToDelete) { delete static_cast<T*>(ptrToDelete); });
+    }
+
+    /// \brief Method to try to delete retired objects.
+    /// It is called automatically by Retire, but can be called to release memory earlier
+    void Collect();
+
+    /// Destructor. Deletes all retired objects
+    ~EpochManager();
+};
+
+/**
+    \brief RAII wrapper for EpochManager critical section
+
+    Calls EpochManager::Enter in constructor and EpochManager::Exit in destructor
+*/
+class EpochGuard
+{
+public:
+    /// Constructor. Enters the critical section
+    EpochGuard();
+
+    /// Deleted copy constructor
+    EpochGuard(const EpochGuard& other) = delete;
+
+    /// Deleted assign operator
+    EpochGuard& operator= (const EpochGuard& other) = delete;
+
+    /// Destructor. Leaves the critical section
+    ~EpochGuard();
+};
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+    \brief A class for collecting durations of operations
+
+    Durations are counted in buckets by powers of two of nanoseconds: bucket 0 counts durations of 0 ns,
+    and bucket i counts durations from 2 ^ (i - 1) to 2 ^ i - 1 ns. So adding a duration takes a few atomic increments without locks,
+    and percentiles are found with the precision of two times, which is enough to see latency spikes.
+
+    All methods are thread safe. Results read while other threads add durations can be slightly inconsistent with each other.
+*/
+class LatencyHistogram
+{
+public:
+    /// Number of buckets. The last bucket counts all durations longer than 2 ^ (BucketsCount - 2) ns
+    static constexpr std::size_t BucketsCount = 48;
+
+private:
+    // Number of durations in each bucket
+    std::atomic<std::uint64_t> Buckets[BucketsCount];
+
+    // Number of durations
+    std::atomic<std::uint64_t> Count;
+
+    // Sum of all durations in nanoseconds
+    std::atomic<std::uint64_t> TotalNs;
+
+    // Maximum duration in nanoseconds
+    std::atomic<std::uint64_t> MaxNs;
+
+public:
+    /// Default constructor. Creates an empty histogram
+    LatencyHistogram()
+    {
+        Reset();
+    }
+
+    /// Deleted copy constructor
+    LatencyHistogram(const LatencyHistogram& other) = delete;
+
+    /// Deleted assign operator
+    LatencyHistogram& operator= (const LatencyHistogram& other) = delete;
+
+    /// \brief Method for adding a duration
+    /// \param [in] durationNs duration in nanoseconds
+    void Add(std::uint64_t durationNs)
+    {
+        std::size_t bucket = 0;
+        while (bucket < BucketsCount - 1 && (durationNs >> bucket) != 0)
+            ++bucket;
+
+        Buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        Count.fetch_add(1, std::memory_order_relaxed);
+        TotalNs.fetch_add(durationNs, std::memory_order_relaxed);
+
+        std::uint64_t maxNs = MaxNs.load(std::memory_order_relaxed);
+        while (durationNs > maxNs && !MaxNs.compare_exchange_weak(maxNs, durationNs, std::memory_order_relaxed));
+    }
+
+    /// \brief Method for adding the time passed since the moment
+    /// \param [in] start the moment when the operation started
+    void AddSince(std::chrono::steady_clock::time_point start)
+    {
+        Add(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+    }
+
+    /// \brief Method for getting the number of durations
+    /// \return number of durations
+    std::uint64_t GetCount() const
+    {
+        return Count.load(std::memory_order_relaxed);
+    }
+
+    /// \brief Method for getting the sum of all durations
+    /// \return sum of durations in nanoseconds
+    std::uint64_t GetTotalNs() const
+    {
+        return TotalNs.load(std::memory_order_relaxed);
+    }
+
+    /// \brief Method for getting the maximum duration
+    /// \return maximum duration in nanoseconds
+    std::uint64_t GetMaxNs() const
+    {
+        return MaxNs.load(std::memory_order_relaxed);
+    }
+
+    /// \brief Method for getting the number of durations in the bucket
+    /// \param [in] bucket number of the bucket, less than BucketsCount
+    /// \return number of durations from 2 ^ (bucket - 1) to 2 ^ bucket - 1 ns
+    std::uint64_t GetBucketCount(std::size_t bucket) const
+    {
+        return Buckets[bucket].load(std::memory_order_relaxed);
+    }
+
+    /**
+        \brief Method for getting the percentile of durations
+
+        \param [in] percentile the percentile from 0 to 100, for example 99 or 99.9
+
+        \return upper bound of the bucket containing the percentile in nanoseconds, or 0 if there are no durations
+    */
+    std::uint64_t GetPercentileNs(double percentile) const
+    {
+        std::uint64_t count = GetCount();
+        if (count == 0)
+            return 0;
+
+        std::uint64_t rank = static_cast<std::uint64_t>(count * percentile / 100.0);
+        std::uint64_t sum = 0;
+        for (std::size_t i = 0; i < BucketsCount; ++i)
+        {
+            sum += GetBucketCount(i);
+            if (sum > rank)
+                return i == 0 ? 0 : (std::uint64_t(1) << i) - 1;
+        }
+
+        return GetMaxNs();
+    }
+
+    /// Method for deleting all durations
+    void Reset()
+    {
+        for (auto& it : Buckets)
+            it.store(0, std::memory_order_relaxed);
+
+        Count.store(0, std::memory_order_relaxed);
+        TotalNs.store(0, std::memory_order_relaxed);
+        MaxNs.store(0, std::memory_order_relaxed);
+    }
+};
+
+/**
+    \brief A class for measuring the duration of a scope
+
+    The duration from the constructor to the destructor is added to the histogram. If the histogram is nullptr, the clock is not read at all,
+    so the timer costs only a check of the pointer when statistics are disabled.
+
+    \code
+        LatencyTimer timer(isStatsEnabled ? &histogram : nullptr);
+    \endcode
+*/
+class LatencyTimer
+{
+private:
+    // Histogram for the duration or nullptr
+    LatencyHistogram* Histogram;
+
+    // The moment of creation of the timer
+    std::chrono::steady_clock::time_point Start;
+
+public:
+    /// \brief Constructor. Starts measuring
+    /// \param [in] histogram histogram to add the duration to, or nullptr to measure nothing
+    LatencyTimer(LatencyHistogram* histogram) : Histogram(histogram)
+    {
+        if (Histogram != nullptr)
+            Start = std::chrono::steady_clock::now();
+    }
+
+    /// Deleted copy constructor
+    LatencyTimer(const LatencyTimer& other) = delete;
+
+    /// Deleted assign operator
+    LatencyTimer& operator= (const LatencyTimer& other) = delete;
+
+    /// Destructor. Adds the duration to the histogram
+    ~LatencyTimer()
+    {
+        if (Histogram != nullptr)
+            Histogram->AddSince(Start);
+    }
+};
@@ -0,0 +1,128 @@
+#include "MemoryPool.h"
+
+#include <new>
+
+MemoryPool::MemoryPool() {}
+
+MemoryPool::~MemoryPool()
+{
+    for (auto& it : Chunks)
+        ::operator delete(it);
+}
+
+MemoryPool::BlockHeader* MemoryPool::AllocateLocked(std::size_t sizeClass)
+{
+    // Reuse freed block
+    if (FreeLists[sizeClass] != nullptr)
+    {
+        FreeBlock* block = FreeLists[sizeClass];
+        FreeLists[sizeClass] = block->Next;
+        return reinterpret_cast<BlockHeader*>(block);
+    }
+
+    // Cut new block from the last chunk. The rest of the chunk is lost if the block does not fit
+    std::size_t blockSize = sizeof(BlockHeader) + (sizeClass + 1) * SizeClassStep;
+    if (static_cast<std::size_t>(ChunkEnd - ChunkBegin) < blockSize)
+    {
+        ChunkBegin = static_cast<char*>(::operator new(ChunkSize));
+        ChunkEnd = ChunkBegin + ChunkSize;
+        Chunks.emplace_back(ChunkBegin);
+    }
+
+    BlockHeader* res = reinterpret_cast<BlockHeader*>(ChunkBegin);
+    ChunkBegin += blockSize;
+    return res;
+}
+
+MemoryPool* MemoryPool::Create()
+{
+    return new MemoryPool;
+}
+
+void MemoryPool::AddOwner()
+{
+    std::lock_guard<std::mutex> lock(Mtx);
+    ++OwnersCount;
+}
+
+void MemoryPool::ReleaseOwner()
+{
+    bool isUnused;
+    {
+        std::lock_guard<std::mutex> lock(Mtx);
+        --OwnersCount;
+        isUnused = OwnersCount == 0 && BlocksCount == 0;
+    }
+
+    if (isUnused)
+        delete this;
+}
+
+void* MemoryPool::Allocate(MemoryPool* pool, std::size_t size)
+{
+    BlockHeader* header;
+
+    if (pool == nullptr || size > SizeClassStep * SizeClassesCount)
+    {
+        header = static_cast<BlockHeader*>(::operator new(sizeof(BlockHeader) + size));
+        header->Pool = nullptr;
+        header->SizeClass = 0;
+    }
+    else
+    {
+        std::size_t sizeClass = size == 0 ? 0 : (size - 1) / SizeClassStep;
+
+        std::lock_guard<std::mutex> lock(pool->Mtx);
+        header = pool->AllocateLocked(sizeClass);
+        header->Pool = pool;
+        header->SizeClass = sizeClass;
+        ++pool->BlocksCount;
+    }
+
+    return header + 1;
+}
+
+void MemoryPool::Deallocate(void* ptr)
+{
+    if (ptr == nullptr)
+        return;
+
+    BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+    MemoryPool* pool = header->Pool;
+
+    if (pool == nullptr)
+    {
+        ::operator delete(header);
+        return;
+    }
+
+    bool isUnused;
+    {
+        std::lock_guard<std::mutex> lock(pool->Mtx);
+
+        // Return the block to the free list of its size class
+        FreeBlock* block = reinterpret_cast<FreeBlock*>(header);
+        std::size_t sizeClass = header->SizeClass;
+        block->Next = pool->FreeLists[sizeClass];
+        pool->FreeLists[sizeClass] = block;
+
+        --pool->BlocksCount;
+        isUnused = pool->OwnersCount == 0 && pool->BlocksCount == 0;
+    }
+
+    // The last block of the pool without owners
+    if (isUnused)
+        delete pool;
+}
+
+std::size_t MemoryPool::GetBlocksCount()
+{
+    std::lock_guard<std::mutex> lock(Mtx);
+    return BlocksCount;
+}
+
+std::size_t MemoryPool::GetReservedMemory()
+{
+    std::lock_guard<std::mutex> lock(Mtx);
+    return Chunks.size() * ChunkSize;
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/**
+    \brief A class for allocating many small blocks of memory
+
+    Memory is taken from the system in big chunks, and blocks are cut from chunks. Blocks are divided into size classes,
+    and freed blocks are stored in a free list of their size class to be reused, so allocations and deallocations
+    do not call the system allocator. Blocks larger than the largest size class are allocated using the operator new.
+
+    Each block has a header with a pointer to its pool, so a block can be freed by the static Deallocate without knowing the pool.
+    This allows to free blocks using EpochManager and delete, when the pool is no longer available to the caller.
+
+    The pool is created using Create and is deleted when all owners have called ReleaseOwner and all blocks are freed,
+    so blocks retired by lock-free structures can outlive the structure that allocated them.
+    All methods are thread safe.
+*/
+class MemoryPool
+{
+private:
+    // Header before each block. Its size keeps blocks aligned to 16 bytes
+    struct alignas(16) BlockHeader
+    {
+        // Pool of the block. Equal to nullptr if the block was allocated using the operator new
+        MemoryPool* Pool;
+
+        // Size class of the block
+        std::size_t SizeClass;
+    };
+
+    // Free block in the free list
+    struct FreeBlock
+    {
+        FreeBlock* Next;
+    };
+
+    // Difference between sizes of neighboring size classes
+    static constexpr std::size_t SizeClassStep = 16;
+
+    // Number of size classes. Blocks of up to SizeClassStep * SizeClassesCount bytes are allocated from chunks
+    static constexpr std::size_t SizeClassesCount = 32;
+
+    // Size of memory chunks taken from the system
+    static constexpr std::size_t ChunkSize = 64 * 1024;
+
+    // Mutex to protect the pool
+    std::mutex Mtx;
+
+    // Free lists of all size classes
+    FreeBlock* FreeLists[SizeClassesCount] = {};
+
+    // All chunks
+    std::vector<char*> Chunks;
+
+    // Free space of the last chunk
+    char* ChunkBegin = nullptr;
+    char* ChunkEnd = nullptr;
+
+    // Number of blocks that were allocated and not freed
+    std::size_t BlocksCount = 0;
+
+    // Number of owners of the pool
+    std::size_t OwnersCount = 1;
+
+    // Private constructor, use Create
+    MemoryPool();
+
+    // Private destructor, the pool deletes itself
+    ~MemoryPool();
+
+    // Allocate block of the size class. Mtx must be locked
+    BlockHeader* AllocateLocked(std::size_t sizeClass);
+
+public:
+    /// Deleted copy constructor
+    MemoryPool(const MemoryPool& other) = delete;
+
+    /// Deleted assign operator
+    MemoryPool& operator= (const MemoryPool& other) = delete;
+
+    /// \brief Method for creating a new pool. The caller is the only owner of the pool
+    /// \return pointer to the new pool
+    static MemoryPool* Create();
+
+    /// Method for adding an owner of the pool
+    void AddOwner();
+
+    /// Method for removing an owner of the pool. The pool is deleted when there are no owners and no allocated blocks
+    void ReleaseOwner();
+
+    /**
+        \brief Method for allocating a block of memory
+
+        \param [in] pool the pool to allocate from. If it is nullptr, the block is allocated using the operator new
+        \param [in] size size of the block
+
+        \return pointer to the block aligned to 16 bytes
+    */
+    static void* Allocate(MemoryPool* pool, std::size_t size);
+
+    /// \brief Method for freeing a block allocated by Allocate
+    /// \param [in] ptr pointer to the block. Can be nullptr
+    static void Deallocate(void* ptr);
+
+    /// \brief Method for getting the number of allocated blocks
+    /// \return number of blocks that were allocated and not freed
+    std::size_t GetBlocksCount();
+
+    /// \brief Method for getting the size of memory taken from the system
+    /// \return size of all chunks in bytes
+    std::size_t GetReservedMemory();
+};
+
+/**
+    \brief Allocator for standard containers using MemoryPool
+
+    \tparam <T> Type of allocated objects
+
+    Allocators with different pools are compatible, since each block knows its pool.
+*/
+template <class T>
+class PoolAllocator
+{
+public:
+    /// Type of allocated objects
+    typedef T value_type;
+
+    /// Pool to allocate from. If it is nullptr, the operator new is used
+    MemoryPool* Pool = nullptr;
+
+    /// \brief Constructor
+    /// \param [in] pool pool to allocate from
+    PoolAllocator(MemoryPool* pool = nullptr) noexcept : Pool(pool) {}
+
+    /// \brief Converting constructor
+    /// \param [in] other allocator of another type
+    template <class U>
+    PoolAllocator(const PoolAllocator<U>& other) noexcept : Pool(other.Pool) {}
+
+    /// \brief Method for allocating memory for objects
+    /// \param [in] count number of objects
+    /// \return pointer to the memory
+    T* allocate(std::size_t count)
+    {
+        return static_cast<T*>(MemoryPool::Allocate(Pool, count * sizeof(T)));
+    }
+
+    /// \brief Method for freeing memory
+    /// \param [in] ptr pointer to the memory
+    void deallocate(T* ptr, std::size_t)
+    {
+        MemoryPool::Deallocate(ptr);
+    }
+
+    /// \brief Comparison operator. Any allocator can free memory of another, so all allocators are equal
+    /// \return true
+    template <class U>
+    bool operator==(const PoolAllocator<U>&) const noexcept
+    {
+        return true;
+    }
+
+    /// \brief Comparison operator
+    /// \return false
+    template <class U>
+    bool operator!=(const PoolAllocator<U>&) const noexcept
+    {
+        return false;
+    }
+};
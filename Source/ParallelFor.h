@@ -0,0 +1,42 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+/**
+    \brief Function for processing a range in parallel threads
+
+    \tparam <F> Function or lambda function with the signature void(std::size_t begin, std::size_t end)
+
+    The range [0, count) is divided into equal parts, one for each hardware thread, and func is called for each part in its own thread.
+    Parts are at least minPartSize long, so small ranges are processed by the calling thread without creating threads.
+
+    \param [in] count the size of the range
+    \param [in] minPartSize the minimum size of one part
+    \param [in] func function to be called for each part
+*/
+template <class F>
+void ParallelFor(std::size_t count, std::size_t minPartSize, F&& func)
+{
+    std::size_t threadsCount = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), (count + minPartSize - 1) / minPartSize);
+
+    if (threadsCount <= 1)
+    {
+        func(0, count);
+        return;
+    }
+
+    std::size_t partSize = (count + threadsCount - 1) / threadsCount;
+    std::vector<std::thread> threads;
+
+    for (std::size_t i = 0; i < threadsCount; ++i)
+    {
+        std::size_t begin = i * partSize;
+        std::size_t end = std::min(count, begin + partSize);
+        threads.emplace_back([&func, begin, end]() { func(begin, end); });
+    }
+
+    for (auto& it : threads)
+        it.join();
+}
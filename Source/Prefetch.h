@@ -0,0 +1,17 @@
+#pragma once
+
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
+
+/// \brief Function for loading memory to the cache in advance. Used when many independent searches are made at once,
+/// so that the memory of the next searches is loaded while the current one is processed
+/// \param [in] ptr pointer to the memory to be read
+inline void PrefetchForRead(const void* ptr)
+{
+#if defined(_MSC_VER)
+    _mm_prefetch(static_cast<const char*>(ptr), _MM_HINT_T0);
+#else
+    __builtin_prefetch(ptr, 0, 3);
+#endif
+}
@@ -1,92 +1,250 @@
 #include "ReadWriteMutex.h"
 
-ReadWriteMutex::ReadWriteMutex() 
-{ 
-    ReadCounter.store(0);
-    IsCondVarWaiting.store(false);
+#include <utility>
+#include <vector>
+
+// Get index of the current thread. Indexes are given to threads in turn, so threads are evenly distributed between reader counters
+static std::size_t GetThreadIndex()
+{
+    static std::atomic<std::size_t> ThreadsCounter(0);
+    static thread_local std::size_t ThreadIndex = ThreadsCounter.fetch_add(1, std::memory_order_relaxed);
+    return ThreadIndex;
+}
+
+// Read lock of the mutex taken by the current thread
+struct ThreadReadLock
+{
+    // The mutex
+    const RecursiveReadWriteMutex* Mtx;
+
+    // Number of read locks of the mutex taken by the thread
+    std::size_t Depth;
+
+    // The moment when the outer read lock was taken. Set only if statistics of the mutex are collected
+    std::chrono::steady_clock::time_point LockTime;
+};
+
+// Get the read lock of the mutex taken by the current thread
+static ThreadReadLock& GetThreadReadLock(const RecursiveReadWriteMutex* mtx)
+{
+    // Read locks taken by the current thread. A thread usually holds only a few locks at the same time, so a linear search is used
+    static thread_local std::vector<ThreadReadLock> ThreadReadLocks;
+
+    for (auto& it : ThreadReadLocks)
+        if (it.Mtx == mtx)
+            return it;
+
+    // Reuse an empty entry if there is one
+    for (auto& it : ThreadReadLocks)
+        if (it.Depth == 0)
+        {
+            it.Mtx = mtx;
+            return it;
+        }
+
+    ThreadReadLocks.push_back({ mtx, 0, std::chrono::steady_clock::time_point() });
+    return ThreadReadLocks.back();
+}
+
+ReadWriteMutex::ReadWriteMutex()
+{
+    IsWriterActive.store(false);
+
+    // The number of counters is the number of hardware threads rounded up to a power of two
+    std::size_t countersCount = 1;
+    while (countersCount < std::thread::hardware_concurrency())
+        countersCount <<= 1;
+
+    ReaderCounters = new ReaderCounter[countersCount];
+    ReaderCountersMask = countersCount - 1;
+}
+
+ReadWriteMutex::ReaderCounter& ReadWriteMutex::GetReaderCounter()
+{
+    return ReaderCounters[GetThreadIndex() & ReaderCountersMask];
+}
+
+bool ReadWriteMutex::IsReadersEmpty() const
+{
+    for (std::size_t i = 0; i <= ReaderCountersMask; ++i)
+        if (ReaderCounters[i].Counter.load() != 0)
+            return false;
+
+    return true;
 }
 
 void ReadWriteMutex::ReadLock()
 {
-    WriteMutex.lock();
-    ReadMutex.lock();
-    ReadCounter.fetch_add(1);
-    ReadMutex.unlock();
-    WriteMutex.unlock();
+    ReaderCounter& readerCounter = GetReaderCounter();
+
+    while (true)
+    {
+        // Register the reader. If there is no writer, then it will wait for this reader
+        readerCounter.Counter.fetch_add(1);
+        if (!IsWriterActive.load())
+            return;
+
+        // There is a writer, so the reader is canceled and the writer is notified in case it waits for this reader
+        readerCounter.Counter.fetch_sub(1);
+        std::unique_lock<std::mutex> lk(WaitMutex);
+        WriterCv.notify_one();
+
+        // Wait until the writer leaves
+        ReadersCv.wait(lk, [&]() { return !IsWriterActive.load(); });
+    }
 }
 
 void ReadWriteMutex::ReadUnlock()
 {
-    ReadMutex.lock();
-    ReadCounter.fetch_sub(1);
-
-    if (ReadCounter.load() == 0)
-        while (IsCondVarWaiting.load()) Cv.notify_all();
-    
-    ReadMutex.unlock();
+    GetReaderCounter().Counter.fetch_sub(1);
+
+    // Notify the writer in case it waits for this reader. The mutex is locked so that the notification is not lost
+    if (IsWriterActive.load())
+    {
+        std::lock_guard<std::mutex> lk(WaitMutex);
+        WriterCv.notify_one();
+    }
 }
 
 void ReadWriteMutex::WriteLock()
 {
-    std::mutex mtx;
-    std::unique_lock<std::mutex> lk(mtx);
-
     WriteMutex.lock();
-    
-    IsCondVarWaiting.store(true);
 
-    if (ReadCounter > 0) Cv.wait(lk);
-    
-    IsCondVarWaiting.store(false);
+    // Stop new readers
+    IsWriterActive.store(true);
+
+    // Wait until all readers leave
+    std::unique_lock<std::mutex> lk(WaitMutex);
+    WriterCv.wait(lk, [&]() { return IsReadersEmpty(); });
 }
 
 void ReadWriteMutex::WriteUnlock()
 {
+    {
+        std::lock_guard<std::mutex> lk(WaitMutex);
+        IsWriterActive.store(false);
+    }
+
+    ReadersCv.notify_all();
     WriteMutex.unlock();
 }
 
+ReadWriteMutex::~ReadWriteMutex()
+{
+    delete[] ReaderCounters;
+}
 
-RecursiveReadWriteMutex::RecursiveReadWriteMutex() 
-{ 
-    ReadCounter.store(0);
-    IsCondVarWaiting.store(false);
+
+RecursiveReadWriteMutex::RecursiveReadWriteMutex()
+{
+    WriterThreadId.store(std::thread::id());
+    Stats.store(nullptr);
 }
 
 void RecursiveReadWriteMutex::ReadLock()
 {
-    WriteMutex.lock();
-    ReadMutex.lock();
-    ReadCounter.fetch_add(1);
-    ReadMutex.unlock();
-    WriteMutex.unlock();
+    // The thread already holds the write lock
+    if (WriterThreadId.load(std::memory_order_relaxed) == std::this_thread::get_id())
+    {
+        ++WriteDepth;
+        return;
+    }
+
+    // Only the first read lock in the thread locks the mutex
+    ThreadReadLock& readLock = GetThreadReadLock(this);
+    if (readLock.Depth == 0)
+    {
+        ReadWriteMutexStats* stats = Stats.load(std::memory_order_relaxed);
+        if (stats != nullptr)
+        {
+            auto start = std::chrono::steady_clock::now();
+            Mtx.ReadLock();
+            readLock.LockTime = std::chrono::steady_clock::now();
+            stats->ReadWait.Add(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(readLock.LockTime - start).count()));
+        }
+        else
+        {
+            Mtx.ReadLock();
+            readLock.LockTime = std::chrono::steady_clock::time_point();
+        }
+    }
+
+    ++readLock.Depth;
 }
 
 void RecursiveReadWriteMutex::ReadUnlock()
 {
-    ReadMutex.lock();
-    ReadCounter.fetch_sub(1);
-
-    if (ReadCounter.load() == 0)
-        while (IsCondVarWaiting.load()) Cv.notify_all();
-    
-    ReadMutex.unlock();
+    // The read lock was taken inside the write lock
+    if (WriterThreadId.load(std::memory_order_relaxed) == std::this_thread::get_id())
+    {
+        --WriteDepth;
+        return;
+    }
+
+    ThreadReadLock& readLock = GetThreadReadLock(this);
+    --readLock.Depth;
+
+    if (readLock.Depth == 0)
+    {
+        ReadWriteMutexStats* stats = Stats.load(std::memory_order_relaxed);
+        if (stats != nullptr && readLock.LockTime != std::chrono::steady_clock::time_point())
+            stats->ReadHold.AddSince(readLock.LockTime);
+
+        Mtx.ReadUnlock();
+    }
 }
 
 void RecursiveReadWriteMutex::WriteLock()
 {
-    std::mutex mtx;
-    std::unique_lock<std::mutex> lk(mtx);
+    // The thread already holds the write lock
+    if (WriterThreadId.load(std::memory_order_relaxed) == std::this_thread::get_id())
+    {
+        ++WriteDepth;
+        return;
+    }
+
+    ReadWriteMutexStats* stats = Stats.load(std::memory_order_relaxed);
+    if (stats != nullptr)
+    {
+        auto start = std::chrono::steady_clock::now();
+        Mtx.WriteLock();
+        WriteLockTime = std::chrono::steady_clock::now();
+        stats->WriteWait.Add(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(WriteLockTime - start).count()));
+    }
+    else
+    {
+        Mtx.WriteLock();
+        WriteLockTime = std::chrono::steady_clock::time_point();
+    }
+
+    WriterThreadId.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    WriteDepth = 1;
+}
 
-    WriteMutex.lock();
-    
-    IsCondVarWaiting.store(true);
+void RecursiveReadWriteMutex::WriteUnlock()
+{
+    --WriteDepth;
+
+    if (WriteDepth == 0)
+    {
+        ReadWriteMutexStats* stats = Stats.load(std::memory_order_relaxed);
+        if (stats != nullptr && WriteLockTime != std::chrono::steady_clock::time_point())
+            stats->WriteHold.AddSince(WriteLockTime);
 
-    if (ReadCounter > 0) Cv.wait(lk);
-    
-    IsCondVarWaiting.store(false);
+        WriterThreadId.store(std::thread::id(), std::memory_order_relaxed);
+        Mtx.WriteUnlock();
+    }
 }
 
-void RecursiveReadWriteMutex::WriteUnlock()
+bool RecursiveReadWriteMutex::IsOnlyReadLocked() const
 {
-    WriteMutex.unlock();
+    if (WriterThreadId.load(std::memory_order_relaxed) == std::this_thread::get_id())
+        return false;
+
+    return GetThreadReadLock(this).Depth != 0;
+}
+
+void RecursiveReadWriteMutex::SetStats(ReadWriteMutexStats* stats)
+{
+    Stats.store(stats);
 }
\ No newline at end of file
@@ -6,6 +6,8 @@
 #include <atomic>
 #include <condition_variable>
 
+#include "LatencyHistogram.h"
+
 /**
     \brief A class for synchronizing threads
 
@@ -13,18 +15,57 @@
     A write lock will ensure that there can only be one thread in the code section at a time.
     The read lock will ensure that no thread using the write lock gets into the code section until all threads using the read lock are unblocked.
     At the same time, after the write lock, no new threads with a read lock will enter the code section until all threads using the write lock are unblocked.
+
+    Readers do not lock any mutex and do not write to a shared variable. Instead, there are several reader counters,
+    each in its own cache line, and each thread uses its own counter. So readers on different cores do not contend with each other.
+    The writer sets a flag that stops new readers and waits until all counters become zero.
 */
 class ReadWriteMutex
 {
 private:
-    std::mutex WriteMutex, ReadMutex;
-    std::atomic_int ReadCounter;
-    std::atomic_bool IsCondVarWaiting;
-    std::condition_variable Cv;
+    // Reader counter aligned to the cache line size, so that counters of different threads do not share a cache line
+    struct alignas(64) ReaderCounter
+    {
+        std::atomic<std::size_t> Counter{0};
+    };
+
+    // Reader counters. The number of counters is the number of hardware threads rounded up to a power of two
+    ReaderCounter* ReaderCounters = nullptr;
+
+    // Mask to get the counter index from the thread index
+    std::size_t ReaderCountersMask = 0;
+
+    // Is there an active or waiting writer
+    std::atomic_bool IsWriterActive;
+
+    // Mutex for writers
+    std::mutex WriteMutex;
+
+    // Mutex for condition variables
+    std::mutex WaitMutex;
+
+    // Condition variable to wait until the writer leaves
+    std::condition_variable ReadersCv;
+
+    // Condition variable to wait until the readers leave
+    std::condition_variable WriterCv;
+
+    // Get reader counter for the current thread
+    ReaderCounter& GetReaderCounter();
+
+    // Check that there are no readers
+    bool IsReadersEmpty() const;
+
 public:
     /// \brief Default constructor
     ReadWriteMutex();
 
+    /// Deleted copy constructor
+    ReadWriteMutex(const ReadWriteMutex& other) = delete;
+
+    /// Deleted assign operator
+    ReadWriteMutex& operator= (const ReadWriteMutex& other) = delete;
+
     /**
         \brief A method for locking a section of code for reading
 
@@ -47,6 +88,39 @@ public:
 
     /// \brief A method for unlocking a section of code for writing
     void WriteUnlock();
+
+    /// Default destructor
+    ~ReadWriteMutex();
+};
+
+/**
+    \brief Durations of waiting for and holding locks of RecursiveReadWriteMutex
+
+    Only the outer locks of each thread are measured, since recursive locks neither wait nor release the mutex.
+    See RecursiveReadWriteMutex::SetStats.
+*/
+struct ReadWriteMutexStats
+{
+    /// Time from the call of ReadLock to taking the read lock
+    LatencyHistogram ReadWait;
+
+    /// Time from taking the read lock to ReadUnlock
+    LatencyHistogram ReadHold;
+
+    /// Time from the call of WriteLock to taking the write lock
+    LatencyHistogram WriteWait;
+
+    /// Time from taking the write lock to WriteUnlock
+    LatencyHistogram WriteHold;
+
+    /// Method for deleting all durations
+    void Reset()
+    {
+        ReadWait.Reset();
+        ReadHold.Reset();
+        WriteWait.Reset();
+        WriteHold.Reset();
+    }
 };
 
 /**
@@ -92,14 +166,27 @@ public:
     rrwx.ReadUnlock();
     \endcode
     It is prohibited because it violates the logic of read and write operations and leads to deadlocking
+
+    Repeated read locks in the same thread never wait, even if a writer is waiting for readers.
 */
 class RecursiveReadWriteMutex
 {
 private:
-    std::recursive_mutex WriteMutex, ReadMutex;
-    std::atomic_int ReadCounter;
-    std::atomic_bool IsCondVarWaiting;
-    std::condition_variable Cv;
+    // Not recursive mutex to lock
+    ReadWriteMutex Mtx;
+
+    // Id of the thread holding the write lock
+    std::atomic<std::thread::id> WriterThreadId;
+
+    // Number of write and read locks taken by the thread holding the write lock. Used only by this thread
+    std::size_t WriteDepth = 0;
+
+    // Statistics of the locks or nullptr if they are not collected
+    std::atomic<ReadWriteMutexStats*> Stats;
+
+    // The moment when the write lock was taken. Used only by the thread holding the write lock and only if Stats is set
+    std::chrono::steady_clock::time_point WriteLockTime;
+
 public:
     /// \brief Default constructor
     RecursiveReadWriteMutex();
@@ -126,4 +213,19 @@ public:
 
     /// \brief A method for unlocking a section of code for writing
     void WriteUnlock();
+
+    /// \brief A method for checking whether the current thread holds only the read lock
+    /// The read lock can not be changed to the write lock, so the thread must not call WriteLock in this case
+    /// \return returns true if the current thread holds the read lock and does not hold the write lock, otherwise false
+    bool IsOnlyReadLocked() const;
+
+    /**
+        \brief A method for enabling measuring of the locks
+
+        When statistics are disabled, each outer lock costs one additional load of the pointer.
+        Locks taken before enabling are not measured.
+
+        \param [in] stats the statistics to add durations to, or nullptr to stop measuring. It must exist while it is set
+    */
+    void SetStats(ReadWriteMutexStats* stats);
 };
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ReadWriteMutex.h"
+
+// Parse the number without a sign. Returns false if the string has other characters or the number is too big
+static bool ParseNumber(const std::string& str, std::size_t& res)
+{
+    if (str.empty() || str.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+
+    try
+    {
+        res = std::stoull(str);
+    }
+    catch (const std::out_of_range&)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+/*
+    Benchmark of reader scaling. Each thread takes the read lock of RecursiveReadWriteMutex, reads one value of the protected table
+    and releases the lock for a fixed time. The result is printed in csv format.
+
+    Usage: ReadWriteMutexBenchmark [values count] [duration in milliseconds]
+    For example: ReadWriteMutexBenchmark 100000 1000
+*/
+int main(int argc, char** argv)
+{
+    // Number of values inside the table protected by the mutex
+    std::size_t valuesCount = 100000;
+    // Duration of each measurement in milliseconds
+    std::size_t durationMs = 1000;
+
+    if ((argc > 1 && (!ParseNumber(argv[1], valuesCount) || valuesCount == 0)) ||
+        (argc > 2 && (!ParseNumber(argv[2], durationMs) || durationMs > 24 * 60 * 60 * 1000)))
+    {
+        std::cerr << "Usage: ReadWriteMutexBenchmark [values count] [duration in milliseconds]" << std::endl;
+        std::cerr << "For example: ReadWriteMutexBenchmark 100000 1000" << std::endl;
+        return 1;
+    }
+
+    RecursiveReadWriteMutex mtx;
+    std::vector<std::size_t> values(valuesCount);
+    for (std::size_t i = 0; i < valuesCount; ++i)
+        values[i] = i;
+
+    std::size_t maxThreadsCount = std::thread::hardware_concurrency() * 2;
+    if (maxThreadsCount < 2) maxThreadsCount = 2;
+
+    std::cout << "threads,lookups,seconds,lookups_per_second" << std::endl;
+
+    for (std::size_t threadsCount = 1; threadsCount <= maxThreadsCount; threadsCount *= 2)
+    {
+        std::atomic_bool isStarted(false), isStopped(false);
+        std::vector<std::size_t> lookups(threadsCount, 0);
+        std::vector<std::size_t> sums(threadsCount, 0);
+        std::vector<std::thread> threads;
+
+        for (std::size_t i = 0; i < threadsCount; ++i)
+            threads.emplace_back([&, i]()
+                {
+                    while (!isStarted.load()) std::this_thread::yield();
+
+                    std::size_t count = 0, sum = 0;
+                    std::size_t id = i % valuesCount;
+                    while (!isStopped.load(std::memory_order_relaxed))
+                    {
+                        mtx.ReadLock();
+                        sum += values[id];
+                        mtx.ReadUnlock();
+
+                        id = (id + 7919) % valuesCount;
+                        ++count;
+                    }
+
+                    lookups[i] = count;
+                    // The sum is stored so that the reads are not optimized out
+                    sums[i] = sum;
+                }
+            );
+
+        auto start = std::chrono::steady_clock::now();
+        isStarted.store(true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(durationMs));
+        isStopped.store(true);
+
+        for (auto& it : threads)
+            it.join();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::size_t total = 0;
+        for (auto& it : lookups)
+            total += it;
+
+        std::cout << threadsCount << "," << total << "," << seconds << "," << static_cast<std::size_t>(total / seconds) << std::endl;
+    }
+}
\ No newline at end of file
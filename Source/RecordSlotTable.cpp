@@ -0,0 +1,72 @@
+#include "RecordSlotTable.h"
+
+#include <new>
+
+RecordSlotTable::RecordSlotTable() {}
+
+RecordSlotTable& RecordSlotTable::GetInstance()
+{
+    // The table is never deleted, so handles can be checked in static destructors
+    static RecordSlotTable* recordSlotTable = new RecordSlotTable;
+    return *recordSlotTable;
+}
+
+RecordSlotTable::Slot& RecordSlotTable::GetSlot(std::uint32_t index) const
+{
+    return Pages[index / PageSize].load(std::memory_order_acquire)[index % PageSize];
+}
+
+std::uint64_t RecordSlotTable::Acquire()
+{
+    std::lock_guard<std::mutex> lock(Mtx);
+
+    std::uint32_t index;
+
+    // Reuse freed slot
+    if (FirstFree != 0)
+    {
+        index = FirstFree;
+        FirstFree = GetSlot(index).NextFree;
+    }
+    else
+    {
+        if (SlotsCount == static_cast<std::uint64_t>(PageSize) * MaxPagesCount)
+            throw std::bad_alloc();
+
+        index = static_cast<std::uint32_t>(SlotsCount);
+        ++SlotsCount;
+
+        // Create new page
+        if (Pages[index / PageSize].load(std::memory_order_relaxed) == nullptr)
+            Pages[index / PageSize].store(new Slot[PageSize], std::memory_order_release);
+    }
+
+    std::uint64_t generation = GetSlot(index).Generation.load(std::memory_order_relaxed);
+    return (generation << 32) | index;
+}
+
+void RecordSlotTable::Release(std::uint64_t handle)
+{
+    std::uint32_t index = static_cast<std::uint32_t>(handle);
+    if (index == 0)
+        return;
+
+    // Only one call can change the generation, so the slot is added to the free list once
+    Slot& slot = GetSlot(index);
+    std::uint32_t generation = static_cast<std::uint32_t>(handle >> 32);
+    if (!slot.Generation.compare_exchange_strong(generation, generation + 1, std::memory_order_release, std::memory_order_relaxed))
+        return;
+
+    std::lock_guard<std::mutex> lock(Mtx);
+    slot.NextFree = FirstFree;
+    FirstFree = index;
+}
+
+bool RecordSlotTable::IsValid(std::uint64_t handle) const
+{
+    std::uint32_t index = static_cast<std::uint32_t>(handle);
+    if (index == 0)
+        return false;
+
+    return GetSlot(index).Generation.load(std::memory_order_acquire) == static_cast<std::uint32_t>(handle >> 32);
+}
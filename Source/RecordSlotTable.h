@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+/**
+    \brief A table of slots with generation counters for checking the validity of records
+
+    Each record occupies a slot and is addressed by a 64-bit handle, which consists of the slot index and the generation of the slot.
+    When the record is deleted, the generation of its slot is incremented, so all handles to the record become invalid,
+    and the slot can be reused by a new record with a new generation. Checking the handle is one atomic load and one comparison.
+
+    Slots are stored in pages that are never moved or freed, so the handle can be checked at any time, even after the DataStorage
+    that created the record was destroyed. The class is a singleton, so handles of all DataStorages are checked the same way.
+    Acquire and Release are thread safe, IsValid is lock-free.
+*/
+class RecordSlotTable
+{
+private:
+    // Slot of the record
+    struct Slot
+    {
+        // Generation of the slot. Incremented when the record is deleted
+        std::atomic<std::uint32_t> Generation{1};
+
+        // Index of the next free slot. Used only when the slot is free and Mtx is locked
+        std::uint32_t NextFree = 0;
+    };
+
+    // Number of slots in one page
+    static constexpr std::uint32_t PageSize = 1u << 16;
+
+    // Maximum number of pages. The index of the slot is 32-bit
+    static constexpr std::uint32_t MaxPagesCount = 1u << 16;
+
+    // All pages. Pages are created when needed and never deleted
+    std::atomic<Slot*> Pages[MaxPagesCount] = {};
+
+    // Mutex to protect the free list and new slots
+    std::mutex Mtx;
+
+    // Index of the first free slot. Equal to 0 if there are no free slots
+    std::uint32_t FirstFree = 0;
+
+    // Number of slots ever created. The slot with index 0 is never used, so the handle equal to 0 is always invalid
+    std::uint64_t SlotsCount = 1;
+
+    // Private constructor for singleton
+    RecordSlotTable();
+
+    // Get slot by index. The page of the slot must exist
+    Slot& GetSlot(std::uint32_t index) const;
+
+public:
+    /// The handle which never points to the slot
+    static constexpr std::uint64_t InvalidHandle = 0;
+
+    /// Deleted copy constructor
+    RecordSlotTable(const RecordSlotTable& other) = delete;
+
+    /// Deleted assign operator
+    RecordSlotTable& operator= (const RecordSlotTable& other) = delete;
+
+    /// \brief Method for getting the only object of the class
+    /// \return ref to the slot table
+    static RecordSlotTable& GetInstance();
+
+    /// \brief Method for taking a free slot
+    /// \return handle of the slot
+    std::uint64_t Acquire();
+
+    /**
+        \brief Method for freeing the slot
+
+        All handles to the slot become invalid. Calling the method again with the same handle does nothing
+
+        \param [in] handle handle returned by Acquire
+    */
+    void Release(std::uint64_t handle);
+
+    /// \brief Method for checking the handle
+    /// \param [in] handle handle to check
+    /// \return true if the slot was not released since the handle was acquired, otherwise false
+    bool IsValid(std::uint64_t handle) const;
+};
@@ -0,0 +1,194 @@
+#include "ShardedDataStorage.h"
+
+ShardedDataStorage::ShardedDataStorage(std::size_t shardsCount)
+{
+    if (shardsCount == 0)
+        shardsCount = std::thread::hardware_concurrency();
+
+    if (shardsCount == 0)
+        shardsCount = 1;
+
+    for (std::size_t i = 0; i < shardsCount; ++i)
+        Shards.emplace_back(new DataStorage);
+
+    NextShard.store(0);
+}
+
+std::size_t ShardedDataStorage::GetNewRecordShard()
+{
+    if (ShardKeyName.empty())
+        return NextShard.fetch_add(1, std::memory_order_relaxed) % Shards.size();
+
+    return DefaultShard;
+}
+
+bool ShardedDataStorage::IsKeyExist(const std::string& keyName) const
+{
+    return Shards[0]->IsKeyExist(keyName);
+}
+
+void ShardedDataStorage::RemoveKey(const std::string& keyName)
+{
+    ShardKeyMtx.WriteLock();
+
+    // Distribute new records in turn if it was the shard key
+    bool isShardKey = keyName == ShardKeyName;
+    for (auto& it : Shards)
+    {
+        it->RemoveKey(keyName);
+        if (isShardKey)
+            it->SetShardKeyName(std::string());
+    }
+
+    if (isShardKey)
+    {
+        ShardKeyName.clear();
+        ShardKeyType = nullptr;
+        GetDataSaverShard = nullptr;
+        GetRecordShard = nullptr;
+    }
+
+    ShardKeyMtx.WriteUnlock();
+}
+
+bool ShardedDataStorage::AddCompositeIndex(const std::vector<std::string>& keyNames, DataStorageIndexPolicy indexPolicy)
+{
+    bool res = true;
+
+    // All shards have the same keys, so the index is added either to all of them or to none
+    for (auto& it : Shards)
+        res = it->AddCompositeIndex(keyNames, indexPolicy) && res;
+
+    return res;
+}
+
+void ShardedDataStorage::RemoveCompositeIndex(const std::vector<std::string>& keyNames)
+{
+    for (auto& it : Shards)
+        it->RemoveCompositeIndex(keyNames);
+}
+
+DataStorageRecordRef ShardedDataStorage::CreateRecord()
+{
+    DataStorageRecordRef res;
+    ShardKeyMtx.ReadLock();
+    res = Shards[GetNewRecordShard()]->CreateRecord();
+    ShardKeyMtx.ReadUnlock();
+    return res;
+}
+
+DataStorageRecordRef ShardedDataStorage::CreateRecord(const std::vector<std::pair<std::string, DataSaver>>& params)
+{
+    DataStorageRecordRef res;
+    ShardKeyMtx.ReadLock();
+
+    std::size_t shard = GetNewRecordShard();
+    bool isShardFound = true;
+
+    // Find the value of the shard key. The value of another type would be hashed differently
+    if (!ShardKeyName.empty())
+        for (auto& it : params)
+            if (it.first == ShardKeyName)
+                isShardFound = GetDataSaverShard(it.second, shard);
+
+    if (isShardFound)
+        res = Shards[shard]->CreateRecord(params);
+
+    ShardKeyMtx.ReadUnlock();
+    return res;
+}
+
+DataStorageRecordRef ShardedDataStorage::CreateRecord(std::vector<std::pair<std::string, DataSaver>>&& params)
+{
+    DataStorageRecordRef res;
+    ShardKeyMtx.ReadLock();
+
+    std::size_t shard = GetNewRecordShard();
+    bool isShardFound = true;
+
+    // Find the value of the shard key. The value of another type would be hashed differently
+    if (!ShardKeyName.empty())
+        for (auto& it : params)
+            if (it.first == ShardKeyName)
+                isShardFound = GetDataSaverShard(it.second, shard);
+
+    if (isShardFound)
+        res = Shards[shard]->CreateRecord(std::move(params));
+
+    ShardKeyMtx.ReadUnlock();
+    return res;
+}
+
+DataStorageRecordSet ShardedDataStorage::GetRecords(const DataStorageQuery& query) const
+{
+    DataStorageRecordSet res;
+    ForEachRecord(query, [&res](const DataStorageRecordRef& recordRef) { res.AddNewRecord(recordRef); });
+    return res;
+}
+
+void ShardedDataStorage::DropDataStorage()
+{
+    ShardKeyMtx.WriteLock();
+
+    for (auto& it : Shards)
+    {
+        it->DropDataStorage();
+        it->SetShardKeyName(std::string());
+    }
+
+    ShardKeyName.clear();
+    ShardKeyType = nullptr;
+    GetDataSaverShard = nullptr;
+    GetRecordShard = nullptr;
+
+    ShardKeyMtx.WriteUnlock();
+}
+
+void ShardedDataStorage::DropData()
+{
+    for (auto& it : Shards)
+        it->DropData();
+}
+
+void ShardedDataStorage::EraseRecord(const DataStorageRecordRef& recordRefToErase)
+{
+    if (!recordRefToErase.IsValid())
+        return;
+
+    ShardKeyMtx.ReadLock();
+
+    // The shard of the record is known from the shard key value, otherwise all shards are checked.
+    // The record without the shard key is already erased, since all records of shards have it
+    std::size_t shard;
+    if (!ShardKeyName.empty())
+    {
+        if (GetRecordShard(recordRefToErase, shard))
+            Shards[shard]->EraseRecord(recordRefToErase);
+    }
+    else
+        for (auto& it : Shards)
+            it->EraseRecord(recordRefToErase);
+
+    ShardKeyMtx.ReadUnlock();
+}
+
+std::size_t ShardedDataStorage::Size() const
+{
+    std::size_t res = 0;
+
+    for (auto& it : Shards)
+        res += it->Size();
+
+    return res;
+}
+
+std::size_t ShardedDataStorage::GetShardsCount() const
+{
+    return Shards.size();
+}
+
+ShardedDataStorage::~ShardedDataStorage()
+{
+    for (auto& it : Shards)
+        delete it;
+}
\ No newline at end of file
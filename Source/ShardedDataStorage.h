@@ -0,0 +1,389 @@
+#pragma once
+
+#include <functional>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+#include "DataStorage.h"
+
+/**
+    \brief A class for storing data in several independent DataStorage shards
+
+    All mutations inside DataStorage are performed under one write lock, so only one thread can create or erase records at a time.
+    This class splits records between several DataStorage shards, each with its own lock and indices,
+    so that threads working with different shards do not block each other.
+
+    The shard of the record is selected by the hash of the shard key value, which is set using SetShardKey.
+    Requests for the shard key are sent to one shard, requests for other keys are sent to all shards in turn.
+    If the shard key is not set, records are distributed between shards in turn.
+
+    All keys are added to all shards, so the interface is the same as in DataStorage.
+
+    The value of the shard key of the record can not be changed using DataStorageRecordRef::SetData, since the record would stay
+    in the shard of the old value. To change it, erase the record and create it again.
+*/
+class ShardedDataStorage
+{
+private:
+    // All shards
+    std::vector<DataStorage*> Shards;
+
+    // Name of the shard key. Empty if shard key is not set
+    std::string ShardKeyName;
+
+    // Type of the shard key. Values of other types are hashed differently, so they are not used to select shards. Equal to nullptr if shard key is not set
+    const std::type_info* ShardKeyType = nullptr;
+
+    // Function to get the shard index from a DataSaver with the shard key value. Returns false if the value has another type
+    std::function<bool(const DataSaver& keyValue, std::size_t& shard)> GetDataSaverShard;
+
+    // Function to get the shard index from the record. Returns false if the record does not have the shard key
+    std::function<bool(const DataStorageRecordRef& recordRef, std::size_t& shard)> GetRecordShard;
+
+    // Shard index for records with default shard key value
+    std::size_t DefaultShard = 0;
+
+    // Counter to distribute records between shards in turn if the shard key is not set
+    std::atomic<std::size_t> NextShard;
+
+    // Mutex to protect the shard key. Only changes of the shard key lock it for writing, so it does not block shards
+    mutable RecursiveReadWriteMutex ShardKeyMtx;
+
+    // Get shard index from the shard key value
+    template <class T>
+    std::size_t GetValueShard(const T& keyValue) const
+    {
+        return std::hash<T>()(keyValue) % Shards.size();
+    }
+
+    // Get shard index for new record without the shard key value
+    std::size_t GetNewRecordShard();
+
+public:
+    /// \brief Constructor
+    /// \param [in] shardsCount number of shards. If it is 0, then the number of hardware threads is used
+    ShardedDataStorage(std::size_t shardsCount = 0);
+
+    /// Deleted copy constructor
+    ShardedDataStorage(const ShardedDataStorage& other) = delete;
+
+    /// Deleted assign operator
+    ShardedDataStorage& operator= (const ShardedDataStorage& other) = delete;
+
+    /**
+        \brief Template function to add the shard key with default value to all shards
+
+        \tparam <T> Any type of data for which std::hash is specialized
+
+        The key is added to all shards like in SetKey and is used to select the shard of new records.
+        The shard key can be set only while there are no records, since existing records cannot be moved between shards.
+
+        \param [in] keyName shard key name
+        \param [in] defaultKeyValue default key value
+        \param [in] indexPolicy indices to maintain for the key, see DataStorage::SetKey
+
+        \return returns true if the shard key was set, and false if there are records
+    */
+    template <class T>
+    bool SetShardKey(const std::string& keyName, const T& defaultKeyValue, DataStorageIndexPolicy indexPolicy = DataStorageIndexPolicy::HashAndOrderedIndex)
+    {
+        ShardKeyMtx.WriteLock();
+
+        if (Size() != 0)
+        {
+            ShardKeyMtx.WriteUnlock();
+            return false;
+        }
+
+        // Records of shards can not change the shard key
+        for (auto& it : Shards)
+        {
+            it->SetKey(keyName, defaultKeyValue, indexPolicy);
+            it->SetShardKeyName(keyName);
+        }
+
+        ShardKeyName = keyName;
+        ShardKeyType = &typeid(T);
+        DefaultShard = GetValueShard(defaultKeyValue);
+
+        GetDataSaverShard = [this](const DataSaver& keyValue, std::size_t& shard)
+            {
+                const T* value = keyValue.GetDataPtr<T>();
+                if (value == nullptr)
+                    return false;
+
+                shard = GetValueShard(*value);
+                return true;
+            };
+
+        GetRecordShard = [this, keyName, defaultKeyValue](const DataStorageRecordRef& recordRef, std::size_t& shard)
+            {
+                T value = defaultKeyValue;
+                if (!recordRef.GetData(keyName, value))
+                    return false;
+
+                shard = GetValueShard(value);
+                return true;
+            };
+
+        ShardKeyMtx.WriteUnlock();
+        return true;
+    }
+
+    /**
+        \brief Template function to add new key with default value to all shards
+
+        \tparam <T> Any type of data except for c arrays
+
+        Works the same way as DataStorage::SetKey. The shard key cannot be changed by this function, use SetShardKey
+
+        Unique values are checked only inside each shard, so the UniqueIndex policy guarantees global uniqueness only for the shard key.
+
+        \param [in] keyName new key name
+        \param [in] defaultKeyValue default key value
+        \param [in] indexPolicy indices to maintain for the key, see DataStorage::SetKey
+
+        \return returns true if the key was added to all shards, and false if it is the shard key or a unique key and there are several records
+    */
+    template <class T>
+    bool SetKey(const std::string& keyName, const T& defaultKeyValue, DataStorageIndexPolicy indexPolicy = DataStorageIndexPolicy::HashAndOrderedIndex)
+    {
+        ShardKeyMtx.ReadLock();
+
+        // Unique keys are rejected for all shards at once, so that shards do not have different keys
+        bool res = keyName != ShardKeyName && (!(indexPolicy & DataStorageIndexPolicy::UniqueIndex) || Size() <= 1);
+        if (res)
+            for (auto& it : Shards)
+                res = it->SetKey(keyName, defaultKeyValue, indexPolicy) && res;
+
+        ShardKeyMtx.ReadUnlock();
+        return res;
+    }
+
+    /**
+        \brief The method for checking whether the key exists
+
+        \param [in] keyName the name of the key to search for
+
+        \return returns true if the key was found otherwise returns false
+    */
+    bool IsKeyExist(const std::string& keyName) const;
+
+    /**
+        \brief The method for getting a default key value
+
+        \tparam <T> Any type of data except for c arrays
+
+        \param [in] keyName the name of the key to search for
+        \param [out] defaultKeyValue the ref to which the default value will be written
+
+        \return returns true if the key was found otherwise returns false
+    */
+    template <class T>
+    bool GetKeyValue(const std::string& keyName, T& defaultKeyValue) const
+    {
+        return Shards[0]->GetKeyValue(keyName, defaultKeyValue);
+    }
+
+    /// \brief The method for deleting the key from all shards
+    /// If it was the shard key, new records will be distributed between shards in turn
+    /// \param [in] keyName the key to remove
+    void RemoveKey(const std::string& keyName);
+
+    /// \brief Method for adding the composite index to all shards, see DataStorage::AddCompositeIndex
+    /// \param [in] keyNames names of at least two different keys of the index
+    /// \param [in] indexPolicy indices to maintain for the values of the keys
+    /// \return returns true if the index was added to all shards, otherwise false
+    bool AddCompositeIndex(const std::vector<std::string>& keyNames, DataStorageIndexPolicy indexPolicy = DataStorageIndexPolicy::HashIndex);
+
+    /// \brief Method for deleting the composite index from all shards
+    /// \param [in] keyNames names of the keys of the index in the same order as in AddCompositeIndex
+    void RemoveCompositeIndex(const std::vector<std::string>& keyNames);
+
+    /// \brief Method to create new record in the shard of the default shard key value
+    /// \return ref to new record
+    DataStorageRecordRef CreateRecord();
+
+    /**
+        \brief Method to create new record
+
+        Works the same way as DataStorage::CreateRecord(const std::vector<std::pair<std::string, DataSaver>>& params).
+        The record is created in the shard selected by the value of the shard key from params.
+
+        \param [in] params a vector of pairs with data to be put in the storage
+
+        \return ref to new record. It is not valid if the value of the shard key has another type
+    */
+    DataStorageRecordRef CreateRecord(const std::vector<std::pair<std::string, DataSaver>>& params);
+
+    /**
+        \brief Method to create new record by moving data from params
+
+        Works the same way as DataStorage::CreateRecord(std::vector<std::pair<std::string, DataSaver>>&& params).
+
+        \param [in] params a vector of pairs with data to be moved to the storage
+
+        \return ref to new record. It is not valid if the value of the shard key has another type
+    */
+    DataStorageRecordRef CreateRecord(std::vector<std::pair<std::string, DataSaver>>&& params);
+
+    /**
+        \brief The method for getting a reference to the data inside storage
+
+        \tparam <T> Any type of data except for c arrays
+
+        If keyName is the shard key, only one shard is searched, otherwise shards are searched in turn until the record is found.
+        The value of the shard key must have the type of the shard key, otherwise the record is not found
+
+        \param [in] keyName the name of the key to search for
+        \param [in] keyValue the value of the key to be found
+
+        \return ref to requested record
+    */
+    template <class T>
+    DataStorageRecordRef GetRecord(const std::string& keyName, const T& keyValue) const
+    {
+        DataStorageRecordRef res;
+        ShardKeyMtx.ReadLock();
+
+        if (!ShardKeyName.empty() && keyName == ShardKeyName)
+        {
+            // Values of other types have other hashes, so the shard would be wrong
+            if (typeid(T) == *ShardKeyType)
+                res = Shards[GetValueShard(keyValue)]->GetRecord(keyName, keyValue);
+        }
+        else
+        {
+            for (auto& it : Shards)
+            {
+                res = it->GetRecord(keyName, keyValue);
+                if (res.IsValid())
+                    break;
+            }
+        }
+
+        ShardKeyMtx.ReadUnlock();
+        return res;
+    }
+
+    /**
+        \brief The method for iterating over all records with the key values satisfying the request
+
+        \tparam <T> Any type of data for which the operator < is defined
+        \tparam <F> Function or lambda function with the signature void(const DataStorageRecordRef& recordRef) or bool(const DataStorageRecordRef& recordRef).
+        If the function returns false, the iteration stops
+
+        Works the same way as DataStorage::ForEachRecordInRange. The shard key is hashed, so all shards are searched in turn,
+        and records are ordered only inside each shard
+
+        \param [in] keyName the name of the key to search for
+        \param [in] request the request with the range of the key values, see DataStorageRequests.h
+        \param [in] func function to be called for each found record
+
+        \return returns true if the key was found otherwise returns false
+    */
+    template <class T, class F>
+    bool ForEachRecordInRange(const std::string& keyName, const DataStorageRequest<T>& request, F&& func) const
+    {
+        bool res = false;
+        bool isStopped = false;
+
+        for (auto& it : Shards)
+        {
+            res = it->ForEachRecordInRange(keyName, request, [&func, &isStopped](const DataStorageRecordRef& recordRef)
+                {
+                    if constexpr (std::is_same<decltype(func(recordRef)), bool>::value)
+                        isStopped = !func(recordRef);
+                    else
+                        func(recordRef);
+
+                    return !isStopped;
+                }
+            );
+
+            if (!res || isStopped)
+                break;
+        }
+
+        return res;
+    }
+
+    /**
+        \brief The method for getting all records with the key values satisfying the request from all shards
+
+        \tparam <T> Any type of data for which the operator < is defined
+
+        \param [in] keyName the name of the key to search for
+        \param [in] request the request with the range of the key values, see DataStorageRequests.h
+
+        \return set of found records. It is empty if the key was not found
+    */
+    template <class T>
+    DataStorageRecordSet GetRecordsInRange(const std::string& keyName, const DataStorageRequest<T>& request) const
+    {
+        DataStorageRecordSet res;
+        ForEachRecordInRange(keyName, request, [&res](const DataStorageRecordRef& recordRef) { res.AddNewRecord(recordRef); });
+        return res;
+    }
+
+    /**
+        \brief The method for iterating over all records satisfying all requests of the query
+
+        \tparam <F> Function or lambda function with the signature void(const DataStorageRecordRef& recordRef) or bool(const DataStorageRecordRef& recordRef).
+        If the function returns false, the iteration stops
+
+        Works the same way as DataStorage::ForEachRecord. The most selective request is selected in each shard separately
+
+        \param [in] query the query with requests on the keys, see DataStorageQuery
+        \param [in] func function to be called for each found record
+    */
+    template <class F>
+    void ForEachRecord(const DataStorageQuery& query, F&& func) const
+    {
+        bool isStopped = false;
+
+        for (auto& it : Shards)
+        {
+            it->ForEachRecord(query, [&func, &isStopped](const DataStorageRecordRef& recordRef)
+                {
+                    if constexpr (std::is_same<decltype(func(recordRef)), bool>::value)
+                        isStopped = !func(recordRef);
+                    else
+                        func(recordRef);
+
+                    return !isStopped;
+                }
+            );
+
+            if (isStopped)
+                break;
+        }
+    }
+
+    /// \brief The method for getting all records satisfying all requests of the query from all shards
+    /// \param [in] query the query with requests on the keys, see DataStorageQuery
+    /// \return set of found records
+    DataStorageRecordSet GetRecords(const DataStorageQuery& query) const;
+
+    /// A method for deleting all data and keys from all shards
+    void DropDataStorage();
+
+    /// A method for deleting all data, but keeping all keys
+    void DropData();
+
+    /// \brief Method for deleting a record
+    /// \param recordRefToErase the reference to the record that needs to be deleted
+    void EraseRecord(const DataStorageRecordRef& recordRefToErase);
+
+    /// \brief Method for getting the number of records in all shards
+    /// \return number of records
+    std::size_t Size() const;
+
+    /// \brief Method for getting the number of shards
+    /// \return number of shards
+    std::size_t GetShardsCount() const;
+
+    /// Default destructor
+    ~ShardedDataStorage();
+};
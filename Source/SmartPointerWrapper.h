@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 /**
     \brief A class for storing pointers.
 
@@ -8,7 +10,8 @@
     It stores a pointer inside itself, so when copying or assigning objects of this class, 
     the pointer will be copied, but the contents will be the same. The memory for the pointer will be allocated only when the object is created, 
     no memory will be allocated when copying or assigning. The deletion of the pointer will occur when the last object of the class storing the pointer is destroyed. 
-    A counter is implemented inside the class, which increases when copying or assigning an object, and decreases when deleting or re-assigning
+    A counter is implemented inside the class, which increases when copying or assigning an object, and decreases when deleting or re-assigning.
+    The counter is atomic, so objects pointing to the same data can be copied and destroyed in different threads
 */
 template <class T>
 class SmartPointerWrapper
@@ -17,7 +20,7 @@ private:
     // Pointer to store data inside wrapper
     T* Data = nullptr;
     // Pointer to store ref counter
-    std::size_t* RefCounter = nullptr;
+    std::atomic<std::size_t>* RefCounter = nullptr;
 public:
 
     /// \brief Copy constructor
@@ -93,7 +96,7 @@ public:
     SmartPointerWrapper(Args&&... args)
     {
         Data = new T(args...);
-        RefCounter = new std::size_t(1);
+        RefCounter = new std::atomic<std::size_t>(1);
     }
 
     /**
@@ -107,24 +110,15 @@ public:
         // Check is other same as this
         if (&other != this)
         {
-            // Checking whether the data was previously assigned
-            if (RefCounter != nullptr)
-            {
-                // Destroy previously data if this object was last
-                if (*RefCounter == 1)
-                {
-                    delete RefCounter;
-                    delete Data;
-                }
-                else
-                {
-                    --*RefCounter;
-                }
-            }
+            // Take a reference to other data before releasing previous data
+            if (other.RefCounter != nullptr)
+                other.RefCounter->fetch_add(1, std::memory_order_relaxed);
+
+            // Destroy previously data if this object was last
+            Unlink();
 
             Data = other.Data;
             RefCounter = other.RefCounter;
-            ++*RefCounter;
         }
 
         return *this;
@@ -151,17 +145,14 @@ public:
         if(RefCounter != nullptr)
         {
             // Check reference counter
-            if (*RefCounter == 1)
+            if (RefCounter->fetch_sub(1, std::memory_order_acq_rel) == 1)
             {
                 delete RefCounter;
-                RefCounter = nullptr;
                 delete Data;
-                Data = nullptr;
-            }
-            else
-            {
-                --*RefCounter;
             }
+
+            RefCounter = nullptr;
+            Data = nullptr;
         }
     }
 
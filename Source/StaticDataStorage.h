@@ -0,0 +1,727 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "DataStorageClasses.h"
+#include "MemoryPool.h"
+#include "ReadWriteMutex.h"
+#include "RecordSlotTable.h"
+
+// Classes declaration
+template <class... Columns>
+class StaticDataStorage;
+
+template <class... Columns>
+class StaticDataStorageRecordRef;
+
+/**
+    \brief Column of StaticDataStorage
+
+    \tparam <Tag> Any type used as the name of the column. It can be an empty struct and is never created
+    \tparam <T> The type of data stored in the column. Any type of data except for c arrays
+    \tparam <Policy> Indices maintained for the column, see DataStorageIndexPolicy
+
+    Usage example:
+    \code
+        struct Id {};
+        typedef StaticDataStorageColumn<Id, int, DataStorageIndexPolicy::HashIndex | DataStorageIndexPolicy::UniqueIndex> IdColumn;
+    \endcode
+*/
+template <class Tag, class T, DataStorageIndexPolicy Policy = DataStorageIndexPolicy::HashAndOrderedIndex>
+struct StaticDataStorageColumn
+{
+    /// Type used as the name of the column
+    typedef Tag TagType;
+
+    /// Type of data stored in the column
+    typedef T ValueType;
+
+    /// Are the values of the column unique
+    static constexpr bool IsUnique = (Policy & DataStorageIndexPolicy::UniqueIndex) != 0;
+
+    /// Does the column have the ordered index
+    static constexpr bool IsOrderedIndex = (Policy & DataStorageIndexPolicy::OrderedIndex) != 0;
+
+    /// Does the column have the hash index. Unique columns without indices get the hash index, like in DataStorage
+    static constexpr bool IsHashIndex = (Policy & DataStorageIndexPolicy::HashIndex) != 0 || (IsUnique && !IsOrderedIndex);
+};
+
+/// \brief Number of the column with the Tag inside Columns
+/// \tparam <Tag> Tag of the column
+/// \tparam <Columns> List of StaticDataStorageColumn
+template <class Tag, class... Columns>
+struct StaticDataStorageTagIndex
+{
+    /// \brief Method for finding the column
+    /// \return number of the first column with the Tag or the number of columns if there is no such column
+    static constexpr std::size_t Find()
+    {
+        constexpr bool isSameTag[] = { std::is_same<Tag, typename Columns::TagType>::value... };
+        for (std::size_t i = 0; i < sizeof...(Columns); ++i)
+            if (isSameTag[i])
+                return i;
+
+        return sizeof...(Columns);
+    }
+
+    /// Number of the column
+    static constexpr std::size_t Value = Find();
+
+    static_assert(Value < sizeof...(Columns), "StaticDataStorage does not have a column with this tag");
+};
+
+/// \brief Type of data stored in the column with the Tag
+/// \tparam <Tag> Tag of the column
+/// \tparam <Columns> List of StaticDataStorageColumn
+template <class Tag, class... Columns>
+using StaticDataStorageValueType = typename std::tuple_element<StaticDataStorageTagIndex<Tag, Columns...>::Value, std::tuple<typename Columns::ValueType...>>::type;
+
+/**
+    \brief Record of StaticDataStorage
+
+    \tparam <Columns> List of StaticDataStorageColumn
+
+    Values of all columns are stored in one struct, so the record does not store key names and does not allocate memory for each value.
+*/
+template <class... Columns>
+struct StaticDataStorageRecord
+{
+    /// Values of all columns in the order of Columns
+    std::tuple<typename Columns::ValueType...> Values;
+
+    /// Handle of the record inside RecordSlotTable. Released when the record is deleted, so all refs to the record become invalid
+    std::uint64_t Handle;
+
+    /// \brief Constructor
+    /// \param [in] values values of all columns
+    StaticDataStorageRecord(const std::tuple<typename Columns::ValueType...>& values) : Values(values), Handle(RecordSlotTable::GetInstance().Acquire()) {}
+
+    /// Deleted copy constructor
+    StaticDataStorageRecord(const StaticDataStorageRecord& other) = delete;
+
+    /// Deleted assign operator
+    StaticDataStorageRecord& operator= (const StaticDataStorageRecord& other) = delete;
+
+    /// Allocate record from the pool
+    static void* operator new(std::size_t size, MemoryPool* memoryPool)
+    {
+        return MemoryPool::Allocate(memoryPool, size);
+    }
+
+    /// Delete record allocated from the pool
+    static void operator delete(void* ptr)
+    {
+        MemoryPool::Deallocate(ptr);
+    }
+
+    /// Called if the constructor throws
+    static void operator delete(void* ptr, MemoryPool*)
+    {
+        MemoryPool::Deallocate(ptr);
+    }
+
+    /// Destructor. Invalidates all refs to the record
+    ~StaticDataStorageRecord()
+    {
+        RecordSlotTable::GetInstance().Release(Handle);
+    }
+};
+
+/// Empty type used instead of indices that are not maintained for the column
+struct StaticDataStorageNoIndex
+{
+    /// \brief Constructor. The allocator is not used
+    template <class Allocator>
+    StaticDataStorageNoIndex(const Allocator&) {}
+};
+
+/**
+    \brief Indices of one column of StaticDataStorage
+
+    \tparam <Column> StaticDataStorageColumn
+    \tparam <Record> StaticDataStorageRecord
+
+    Indices that are not set by the policy of the column are replaced with StaticDataStorageNoIndex,
+    and the code to update them is not generated.
+*/
+template <class Column, class Record>
+struct StaticDataStorageIndex
+{
+    /// Type of data stored in the column
+    typedef typename Column::ValueType T;
+
+    /// Hash index of the column
+    typename std::conditional<Column::IsHashIndex,
+        std::unordered_multimap<T, Record*, std::hash<T>, std::equal_to<T>, PoolAllocator<std::pair<const T, Record*>>>,
+        StaticDataStorageNoIndex>::type HashIndex;
+
+    /// Ordered index of the column
+    typename std::conditional<Column::IsOrderedIndex,
+        std::multimap<T, Record*, std::less<T>, PoolAllocator<std::pair<const T, Record*>>>,
+        StaticDataStorageNoIndex>::type OrderedIndex;
+
+    /// \brief Constructor
+    /// \param [in] pool pool to allocate nodes of indices from
+    StaticDataStorageIndex(MemoryPool* pool) : HashIndex(PoolAllocator<std::pair<const T, Record*>>(pool)), OrderedIndex(PoolAllocator<std::pair<const T, Record*>>(pool)) {}
+
+    /// \brief Method for adding the record to the indices
+    /// \param [in] value value of the column of the record
+    /// \param [in] record the record
+    void Add(const T& value, Record* record)
+    {
+        if constexpr (Column::IsHashIndex)
+            HashIndex.emplace(value, record);
+
+        if constexpr (Column::IsOrderedIndex)
+            OrderedIndex.emplace(value, record);
+    }
+
+    /// \brief Method for erasing the record from the indices
+    /// \param [in] value value of the column of the record
+    /// \param [in] record the record
+    void Erase(const T& value, Record* record)
+    {
+        if constexpr (Column::IsHashIndex)
+            EraseFromIndex(HashIndex, value, record);
+
+        if constexpr (Column::IsOrderedIndex)
+            EraseFromIndex(OrderedIndex, value, record);
+    }
+
+    /// \brief Method for finding the record with the value. The hash index is used if it exists
+    /// \param [in] value value to find
+    /// \return the found record or nullptr if there is no such record
+    Record* Find(const T& value) const
+    {
+        if constexpr (Column::IsHashIndex)
+        {
+            auto it = HashIndex.find(value);
+            return it != HashIndex.end() ? it->second : nullptr;
+        }
+        else
+        {
+            auto it = OrderedIndex.find(value);
+            return it != OrderedIndex.end() ? it->second : nullptr;
+        }
+    }
+
+    /// Method for deleting all records from the indices
+    void Clear()
+    {
+        if constexpr (Column::IsHashIndex)
+            HashIndex.clear();
+
+        if constexpr (Column::IsOrderedIndex)
+            OrderedIndex.clear();
+    }
+
+private:
+    // Erase the record from the index with equal values
+    template <class Index>
+    static void EraseFromIndex(Index& index, const T& value, Record* record)
+    {
+        auto FirstAndLastIterators = index.equal_range(value);
+        for (auto it = FirstAndLastIterators.first; it != FirstAndLastIterators.second; ++it)
+        {
+            if (it->second == record)
+            {
+                index.erase(it);
+                break;
+            }
+        }
+    }
+};
+
+/**
+    \brief A class to work with the record inside StaticDataStorage
+
+    \tparam <Columns> List of StaticDataStorageColumn
+
+    Works like DataStorageRecordRef, but columns are selected by tags at compile time instead of key names.
+    The object becomes invalid when the record is erased. All methods lock the StaticDataStorage, so the object can be used from any thread.
+*/
+template <class... Columns>
+class StaticDataStorageRecordRef
+{
+private:
+    // StaticDataStorage of the record
+    StaticDataStorage<Columns...>* Storage = nullptr;
+
+    // Pointer to the record
+    StaticDataStorageRecord<Columns...>* DataRecord = nullptr;
+
+    // Handle of the record. The record is deleted if the handle is not valid
+    std::uint64_t Handle = RecordSlotTable::InvalidHandle;
+
+public:
+    /// Making the StaticDataStorage class friendly so that it has access to the record
+    friend StaticDataStorage<Columns...>;
+
+    /// Default constructor. Creates invalid object
+    StaticDataStorageRecordRef() {}
+
+    /// \brief Constructor
+    /// \param [in] storage StaticDataStorage of the record
+    /// \param [in] record the record
+    StaticDataStorageRecordRef(StaticDataStorage<Columns...>* storage, StaticDataStorageRecord<Columns...>* record) :
+        Storage(storage), DataRecord(record), Handle(record->Handle) {}
+
+    /**
+        \brief Method for getting data of the column
+
+        \tparam <Tag> Tag of the column
+
+        \param [out] data reference to record the received data
+
+        \return returns true if the record is valid, otherwise false
+    */
+    template <class Tag>
+    bool GetData(StaticDataStorageValueType<Tag, Columns...>& data) const
+    {
+        if (Storage == nullptr)
+            return false;
+
+        return Storage->template GetData<Tag>(*this, data);
+    }
+
+    /**
+        \brief Method for updating data of the column inside StaticDataStorage
+
+        \tparam <Tag> Tag of the column
+
+        If the column is unique and the value is already used by another record, then the data will not be changed
+
+        \param [in] data new value
+
+        \return returns true if the data was changed otherwise returns false
+    */
+    template <class Tag>
+    bool SetData(const StaticDataStorageValueType<Tag, Columns...>& data)
+    {
+        if (Storage == nullptr)
+            return false;
+
+        return Storage->template SetData<Tag>(*this, data);
+    }
+
+    /// \brief A function to check the validity of a class object
+    /// An object may no longer be valid if the record it refers to has been deleted
+    /// \return returns true if the object is valid, otherwise false
+    bool IsValid() const
+    {
+        return RecordSlotTable::GetInstance().IsValid(Handle);
+    }
+
+    /// A method for decoupling a class object from record
+    void Unlink()
+    {
+        Storage = nullptr;
+        DataRecord = nullptr;
+        Handle = RecordSlotTable::InvalidHandle;
+    }
+
+    /// \brief Comparison operator
+    /// \param [in] other object to compare with
+    /// \return returns true if both objects point to the same record
+    bool operator==(const StaticDataStorageRecordRef& other) const
+    {
+        return Handle == other.Handle;
+    }
+
+    /// \brief Comparison operator
+    /// \param [in] other object to compare with
+    /// \return returns true if objects point to different records
+    bool operator!=(const StaticDataStorageRecordRef& other) const
+    {
+        return Handle != other.Handle;
+    }
+};
+
+/**
+    \brief A class for storing data with the schema known at compile time
+
+    \tparam <Columns> List of StaticDataStorageColumn
+
+    An alternative to DataStorage for tables whose keys do not change at runtime.
+    The record is a struct with values of all columns, and columns are selected by tags, so there is no search of keys by name,
+    no type checks at runtime and no type erasure. The code to update indices of each column is generated by the compiler
+    for the index policy of the column, without std::function.
+
+    The interface is the same as in DataStorage, but key names are replaced with tags.
+
+    Usage example:
+    \code
+        struct Id {};
+        struct Name {};
+
+        StaticDataStorage<
+            StaticDataStorageColumn<Id, int, DataStorageIndexPolicy::HashIndex | DataStorageIndexPolicy::UniqueIndex>,
+            StaticDataStorageColumn<Name, std::string, DataStorageIndexPolicy::NoIndex>> sds(-1, "");
+
+        sds.CreateRecord(0, "mrognor");
+
+        auto recordRef = sds.GetRecord<Id>(0);
+        recordRef.SetData<Name>("mrognor2");
+
+        std::string name;
+        recordRef.GetData<Name>(name);
+
+        sds.EraseRecord(recordRef);
+    \endcode
+*/
+template <class... Columns>
+class StaticDataStorage
+{
+    static_assert(sizeof...(Columns) > 0, "StaticDataStorage must have at least one column");
+
+public:
+    /// Type of refs to records of this StaticDataStorage
+    typedef StaticDataStorageRecordRef<Columns...> RecordRef;
+
+private:
+    // Type of records
+    typedef StaticDataStorageRecord<Columns...> Record;
+
+    // Pool for records and nodes of indices
+    MemoryPool* Pool;
+
+    // Values of columns for new records
+    std::tuple<typename Columns::ValueType...> DefaultValues;
+
+    // Indices of all columns in the order of Columns
+    std::tuple<StaticDataStorageIndex<Columns, Record>...> Indices;
+
+    // Unordered set with all records
+    std::unordered_set<Record*> RecordsSet;
+
+    // Recursive mutex for thread safety
+    mutable RecursiveReadWriteMutex RecursiveReadWriteMtx;
+
+    // Type of the column with number I
+    template <std::size_t I>
+    using ColumnType = typename std::tuple_element<I, std::tuple<Columns...>>::type;
+
+    // Find the record with the value of the column with number I. Must be called under the lock
+    template <std::size_t I>
+    Record* FindRecord(const typename ColumnType<I>::ValueType& value) const
+    {
+        if constexpr (ColumnType<I>::IsHashIndex || ColumnType<I>::IsOrderedIndex)
+            return std::get<I>(Indices).Find(value);
+        else
+        {
+            // Check all records if the column does not have indices
+            for (auto& it : RecordsSet)
+                if (std::get<I>(it->Values) == value)
+                    return it;
+
+            return nullptr;
+        }
+    }
+
+    // Check that the value of the unique column with number I is not used by other records. Must be called under the lock
+    template <std::size_t I>
+    bool IsUniqueValueFree(const typename ColumnType<I>::ValueType& value, const Record* record) const
+    {
+        if constexpr (ColumnType<I>::IsUnique)
+        {
+            Record* foundedRecord = FindRecord<I>(value);
+            return foundedRecord == nullptr || foundedRecord == record;
+        }
+        else
+            return true;
+    }
+
+    // Check values of all unique columns of the record. Must be called under the lock
+    template <std::size_t... I>
+    bool IsUniqueValuesFree(const Record* record, std::index_sequence<I...>) const
+    {
+        return (IsUniqueValueFree<I>(std::get<I>(record->Values), record) && ...);
+    }
+
+    // Add the record to indices of all columns. Must be called under the write lock
+    template <std::size_t... I>
+    void AddToIndices(Record* record, std::index_sequence<I...>)
+    {
+        (std::get<I>(Indices).Add(std::get<I>(record->Values), record), ...);
+    }
+
+    // Erase the record from indices of all columns. Must be called under the write lock
+    template <std::size_t... I>
+    void EraseFromIndices(Record* record, std::index_sequence<I...>)
+    {
+        (std::get<I>(Indices).Erase(std::get<I>(record->Values), record), ...);
+    }
+
+    // Add new record to the StaticDataStorage and to all indices. If the value of a unique column is already used, the record is deleted and invalid ref is returned
+    // Must be called under the write lock
+    RecordRef AddRecord(Record* newRecord)
+    {
+        if (!IsUniqueValuesFree(newRecord, std::index_sequence_for<Columns...>()))
+        {
+            delete newRecord;
+            return RecordRef();
+        }
+
+        RecordsSet.emplace(newRecord);
+        AddToIndices(newRecord, std::index_sequence_for<Columns...>());
+
+        return RecordRef(this, newRecord);
+    }
+
+    // Check that the ref points to the record of this StaticDataStorage. Must be called under the lock
+    bool IsRecordOfStorage(const RecordRef& recordRef) const
+    {
+        return recordRef.Storage == this && recordRef.IsValid();
+    }
+
+public:
+    /// \brief Constructor. Values of columns for new records are created by default constructors
+    /// \param [in] memoryPool the pool to allocate from. If it is nullptr, a new pool is created, see DataStorage::DataStorage
+    StaticDataStorage(MemoryPool* memoryPool = nullptr) :
+        Pool(memoryPool != nullptr ? memoryPool : MemoryPool::Create()), Indices(StaticDataStorageIndex<Columns, Record>(Pool)...)
+    {
+        if (memoryPool != nullptr)
+            Pool->AddOwner();
+    }
+
+    /// \brief Constructor
+    /// \param [in] defaultValues values of all columns for new records in the order of Columns
+    StaticDataStorage(const typename Columns::ValueType&... defaultValues) :
+        Pool(MemoryPool::Create()), DefaultValues(defaultValues...), Indices(StaticDataStorageIndex<Columns, Record>(Pool)...) {}
+
+    /// Deleted copy constructor
+    StaticDataStorage(const StaticDataStorage& other) = delete;
+
+    /// Deleted assign operator
+    StaticDataStorage& operator= (const StaticDataStorage& other) = delete;
+
+    /// \brief Method to create new record with default values
+    /// \return returns ref to the new record or invalid ref if the default value of a unique column is already used
+    RecordRef CreateRecord()
+    {
+        RecordRef res;
+        RecursiveReadWriteMtx.WriteLock();
+        res = AddRecord(new (Pool) Record(DefaultValues));
+        RecursiveReadWriteMtx.WriteUnlock();
+        return res;
+    }
+
+    /// \brief Method to create new record
+    /// \param [in] values values of all columns in the order of Columns
+    /// \return returns ref to the new record or invalid ref if the value of a unique column is already used
+    RecordRef CreateRecord(const typename Columns::ValueType&... values)
+    {
+        RecordRef res;
+        RecursiveReadWriteMtx.WriteLock();
+        res = AddRecord(new (Pool) Record(std::tuple<typename Columns::ValueType...>(values...)));
+        RecursiveReadWriteMtx.WriteUnlock();
+        return res;
+    }
+
+    /**
+        \brief Method for getting a record using a column value
+
+        \tparam <Tag> Tag of the column
+
+        The hash index is used if it exists, then the ordered index, otherwise all records are checked
+
+        \param [in] keyValue the value of the column to be found
+
+        \return returns ref to the found record or invalid ref if there is no such record
+    */
+    template <class Tag>
+    RecordRef GetRecord(const StaticDataStorageValueType<Tag, Columns...>& keyValue) const
+    {
+        RecordRef res;
+        RecursiveReadWriteMtx.ReadLock();
+
+        Record* foundedRecord = FindRecord<StaticDataStorageTagIndex<Tag, Columns...>::Value>(keyValue);
+        if (foundedRecord != nullptr)
+            res = RecordRef(const_cast<StaticDataStorage*>(this), foundedRecord);
+
+        RecursiveReadWriteMtx.ReadUnlock();
+        return res;
+    }
+
+    /**
+        \brief Method for getting all records with the column value
+
+        \tparam <Tag> Tag of the column
+
+        \param [in] keyValue the value of the column to be found
+
+        \return vector with refs to the found records
+    */
+    template <class Tag>
+    std::vector<RecordRef> GetRecords(const StaticDataStorageValueType<Tag, Columns...>& keyValue) const
+    {
+        constexpr std::size_t I = StaticDataStorageTagIndex<Tag, Columns...>::Value;
+        std::vector<RecordRef> res;
+        RecursiveReadWriteMtx.ReadLock();
+
+        StaticDataStorage* storage = const_cast<StaticDataStorage*>(this);
+        if constexpr (ColumnType<I>::IsHashIndex)
+        {
+            auto FirstAndLastIterators = std::get<I>(Indices).HashIndex.equal_range(keyValue);
+            for (auto it = FirstAndLastIterators.first; it != FirstAndLastIterators.second; ++it)
+                res.emplace_back(storage, it->second);
+        }
+        else if constexpr (ColumnType<I>::IsOrderedIndex)
+        {
+            auto FirstAndLastIterators = std::get<I>(Indices).OrderedIndex.equal_range(keyValue);
+            for (auto it = FirstAndLastIterators.first; it != FirstAndLastIterators.second; ++it)
+                res.emplace_back(storage, it->second);
+        }
+        else
+        {
+            // Check all records if the column does not have indices
+            for (auto& it : RecordsSet)
+                if (std::get<I>(it->Values) == keyValue)
+                    res.emplace_back(storage, it);
+        }
+
+        RecursiveReadWriteMtx.ReadUnlock();
+        return res;
+    }
+
+    /**
+        \brief Method for getting data of the column of the record
+
+        \tparam <Tag> Tag of the column
+
+        \param [in] recordRef the record to get data from
+        \param [out] data reference to record the received data
+
+        \return returns true if the record exists, otherwise false
+    */
+    template <class Tag>
+    bool GetData(const RecordRef& recordRef, StaticDataStorageValueType<Tag, Columns...>& data) const
+    {
+        bool res = false;
+        RecursiveReadWriteMtx.ReadLock();
+
+        if (IsRecordOfStorage(recordRef))
+        {
+            data = std::get<StaticDataStorageTagIndex<Tag, Columns...>::Value>(recordRef.DataRecord->Values);
+            res = true;
+        }
+
+        RecursiveReadWriteMtx.ReadUnlock();
+        return res;
+    }
+
+    /**
+        \brief Method for updating data of the column of the record
+
+        \tparam <Tag> Tag of the column
+
+        If the column is unique and the value is already used by another record, then the data will not be changed
+
+        \param [in] recordRef the record to change
+        \param [in] data new value
+
+        \return returns true if the data was changed otherwise returns false
+    */
+    template <class Tag>
+    bool SetData(const RecordRef& recordRef, const StaticDataStorageValueType<Tag, Columns...>& data)
+    {
+        constexpr std::size_t I = StaticDataStorageTagIndex<Tag, Columns...>::Value;
+        bool res = false;
+        RecursiveReadWriteMtx.WriteLock();
+
+        if (IsRecordOfStorage(recordRef) && IsUniqueValueFree<I>(data, recordRef.DataRecord))
+        {
+            // Move the record to the new value inside indices of the column
+            auto& value = std::get<I>(recordRef.DataRecord->Values);
+            std::get<I>(Indices).Erase(value, recordRef.DataRecord);
+            value = data;
+            std::get<I>(Indices).Add(value, recordRef.DataRecord);
+            res = true;
+        }
+
+        RecursiveReadWriteMtx.WriteUnlock();
+        return res;
+    }
+
+    /**
+        \brief Method for iterating over all records
+
+        \tparam <F> Function or lambda function with the signature void(const RecordRef& recordRef)
+
+        The storage is locked for reading during the iteration, so the function must not change the storage
+
+        \param [in] func function to be called for each record
+    */
+    template <class F>
+    void ForEachRecord(F&& func) const
+    {
+        RecursiveReadWriteMtx.ReadLock();
+
+        StaticDataStorage* storage = const_cast<StaticDataStorage*>(this);
+        for (auto& it : RecordsSet)
+            func(RecordRef(storage, it));
+
+        RecursiveReadWriteMtx.ReadUnlock();
+    }
+
+    /// \brief Method for deleting a record
+    /// All refs to this record become invalid
+    /// \param [in] recordRefToErase the record that needs to be deleted
+    void EraseRecord(const RecordRef& recordRefToErase)
+    {
+        RecursiveReadWriteMtx.WriteLock();
+
+        if (IsRecordOfStorage(recordRefToErase))
+        {
+            Record* record = recordRefToErase.DataRecord;
+            EraseFromIndices(record, std::index_sequence_for<Columns...>());
+            RecordsSet.erase(record);
+            delete record;
+        }
+
+        RecursiveReadWriteMtx.WriteUnlock();
+    }
+
+    /// A method for deleting all records
+    void DropData()
+    {
+        RecursiveReadWriteMtx.WriteLock();
+
+        std::apply([](auto&... index) { (index.Clear(), ...); }, Indices);
+
+        for (auto& it : RecordsSet)
+            delete it;
+        RecordsSet.clear();
+
+        RecursiveReadWriteMtx.WriteUnlock();
+    }
+
+    /// \brief Method for getting the number of records
+    /// \return number of records
+    std::size_t Size() const
+    {
+        std::size_t res;
+        RecursiveReadWriteMtx.ReadLock();
+        res = RecordsSet.size();
+        RecursiveReadWriteMtx.ReadUnlock();
+        return res;
+    }
+
+    /// Destructor
+    ~StaticDataStorage()
+    {
+        for (auto& it : RecordsSet)
+            delete it;
+
+        // The pool is deleted when indices free their nodes
+        Pool->ReleaseOwner();
+    }
+};